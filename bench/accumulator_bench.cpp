@@ -0,0 +1,76 @@
+/// @file accumulator_bench.cpp
+///
+/// Benchmark of the per Stop cost of each accumulator policy.
+///
+/// Usage: accumulator_bench [--csv | --json]
+///
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+#include "timey.hpp"
+#include "bench.hpp"
+
+// CountingClock isolates the cost of the accumulator from the cost of
+// reading the clock, while still producing varying samples.
+struct CountingClock {
+    static int64_t now;
+    static int64_t Now() { return now += 997; }
+    static timey::NanosecondsType ToNanoseconds(int64_t ticks) {
+        return ticks * timey::Nanosecond;
+    }
+    static double NanosecondsPerTick() { return 1; }
+};
+int64_t CountingClock::now = 0;
+
+// Int64Welford is the integer Welford update Timer used before accumulator
+// policies, which overflows for samples of about 3 seconds.
+class Int64Welford {
+   public:
+    Int64Welford() { Reset(); }
+    void Reset(void) { mean_ = secondMoment_ = 0; }
+    void Add(int64_t x, size_t count) {
+        int64_t mean = mean_ + ((double)(x - mean_) / count);
+        secondMoment_ += (x - mean) * (x - mean_);
+        mean_ = mean;
+    }
+    void Merge(const Int64Welford&, size_t, size_t) {}
+    double Mean(size_t) const { return mean_; }
+    double Variance(size_t count) const {
+        return count ? (double)secondMoment_ / count : 0;
+    }
+
+   private:
+    int64_t mean_;
+    int64_t secondMoment_;
+};
+
+template <class Accumulator>
+void BenchAccumulator(const std::string& name, bench::Format format) {
+    const size_t iterations = 10000000;
+    timey::BasicTimer<CountingClock, Accumulator> t(name);
+    bench::Result r = bench::Measure("Start/Stop(" + name + ")",
+                                     [&t]() {
+                                         t.Start();
+                                         t.Stop();
+                                     },
+                                     iterations);
+    bench::DoNotOptimize(t);
+    bench::WriteResult(std::cout, r, format);
+}
+
+int main(int argc, char* argv[]) {
+    bench::Format format;
+    if (!bench::ParseFormat(argc, argv, format)) {
+        return 2;
+    }
+
+    bench::WriteHeader(std::cout, format);
+    BenchAccumulator<Int64Welford>("Int64Welford (legacy)", format);
+    BenchAccumulator<timey::CompensatedMoments>("CompensatedMoments", format);
+#ifdef __SIZEOF_INT128__
+    BenchAccumulator<timey::Int128Moments>("Int128Moments", format);
+#endif
+
+    return 0;
+}
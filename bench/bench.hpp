@@ -0,0 +1,229 @@
+/// @file bench.hpp
+///
+/// Minimal helpers shared by the timey benchmarks.
+///
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace bench {
+/// DoNotOptimize prevents the compiler from optimizing away the computation
+/// of 'value'.
+///
+/// @param [in] value Value to keep alive
+template <class T>
+inline void DoNotOptimize(const T& value) {
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+/// Result is the measurement of a benchmark: the mean time of a call over
+/// the repetitions and the half width of its 95% confidence interval.
+struct Result {
+    std::string name;
+    double mean;
+    double ci95;
+    double min;
+    size_t iterations;
+    int repeats;
+};
+
+/// StudentT975 returns the 97.5% quantile of Student's t distribution with
+/// 'df' degrees of freedom, for a two-sided 95% confidence interval.
+///
+/// @param [in] df Degrees of freedom
+/// @retval Quantile
+inline double StudentT975(int df) {
+    static const double t[] = {12.706, 4.303, 3.182, 2.776, 2.571,
+                               2.447,  2.365, 2.306, 2.262, 2.228,
+                               2.201,  2.179, 2.160, 2.145, 2.131,
+                               2.120,  2.110, 2.101, 2.093, 2.086};
+    if (df < 1) {
+        return 0;
+    }
+    return df <= 20 ? t[df - 1] : 1.96;
+}
+
+/// Summarize returns the result of the per call times, in nanoseconds, of
+/// each repetition of a benchmark.
+///
+/// @param [in] name Name of the benchmark
+/// @param [in] ns Nanoseconds per call of each repetition
+/// @param [in] iterations Number of calls per repetition
+/// @retval Result of the benchmark
+inline Result Summarize(const std::string& name, const std::vector<double>& ns,
+                        size_t iterations) {
+    double sum = 0;
+    for (double x : ns) {
+        sum += x;
+    }
+    double mean = sum / ns.size();
+    double squares = 0;
+    for (double x : ns) {
+        squares += (x - mean) * (x - mean);
+    }
+    int n = (int)ns.size();
+    double stddev = n > 1 ? std::sqrt(squares / (n - 1)) : 0;
+    return Result{name,
+                  mean,
+                  StudentT975(n - 1) * stddev / std::sqrt((double)n),
+                  *std::min_element(ns.begin(), ns.end()),
+                  iterations,
+                  n};
+}
+
+/// Repeat calls 'fn' 'iterations' times per repetition, after one warm up
+/// repetition, and returns the mean time of a call in nanoseconds of each
+/// of 'repeats' repetitions.
+///
+/// @param [in] fn Callable to benchmark
+/// @param [in] iterations Number of calls per repetition
+/// @param [in] repeats Number of repetitions
+/// @retval Nanoseconds per call of each repetition
+template <class F>
+std::vector<double> Repeat(F fn, size_t iterations, int repeats = 10) {
+    using std::chrono::steady_clock;
+    std::vector<double> ns;
+    for (int r = -1; r < repeats; r++) {
+        steady_clock::time_point start = steady_clock::now();
+        for (size_t i = 0; i < iterations; i++) {
+            fn();
+        }
+        std::chrono::duration<double, std::nano> elapsed =
+            steady_clock::now() - start;
+        if (r >= 0) {
+            ns.push_back(elapsed.count() / iterations);
+        }
+    }
+    return ns;
+}
+
+/// Measure calls 'fn' 'iterations' times per repetition, after one warm up
+/// repetition, and returns the mean time of a call with its confidence
+/// interval over 'repeats' repetitions.
+///
+/// @param [in] name Name of the benchmark
+/// @param [in] fn Callable to benchmark
+/// @param [in] iterations Number of calls per repetition
+/// @param [in] repeats Number of repetitions
+/// @retval Result of the benchmark
+template <class F>
+Result Measure(const std::string& name, F fn, size_t iterations,
+               int repeats = 10) {
+    return Summarize(name, Repeat(fn, iterations, repeats), iterations);
+}
+
+/// RunThreads runs 'fn' 'iterations' times on each of 'n_threads' threads,
+/// started together, and returns the wall time in nanoseconds.
+///
+/// @param [in] n_threads Number of threads
+/// @param [in] iterations Number of calls per thread
+/// @param [in] fn Callable to benchmark
+/// @retval Wall time in nanoseconds
+template <class F>
+double RunThreads(size_t n_threads, size_t iterations, F fn) {
+    std::atomic<size_t> ready(0);
+    std::atomic<bool> go(false);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < n_threads; i++) {
+        threads.emplace_back([&]() {
+            ready++;
+            while (!go.load()) {
+            }
+            for (size_t j = 0; j < iterations; j++) {
+                fn();
+            }
+        });
+    }
+    while (ready.load() != n_threads) {
+    }
+    auto start = std::chrono::steady_clock::now();
+    go.store(true);
+    for (auto& t : threads) {
+        t.join();
+    }
+    std::chrono::duration<double, std::nano> elapsed =
+        std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+/// Format selects how WriteResult writes a result.
+enum class Format { Table, Csv, Json };
+
+/// ParseFormat sets 'format' from the arguments of a benchmark taking only
+/// --csv or --json, and writes the usage to std::cerr otherwise.
+///
+/// @param [in] argc Number of arguments
+/// @param [in] argv Arguments
+/// @param [out] format Output format
+/// @retval TRUE If the arguments are valid
+/// @retval FALSE Otherwise
+inline bool ParseFormat(int argc, char* argv[], Format& format) {
+    format = Format::Table;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--csv") {
+            format = Format::Csv;
+        } else if (arg == "--json") {
+            format = Format::Json;
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--csv | --json]"
+                      << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+/// WriteHeader writes the header of the results in 'format', if any.
+///
+/// @param [in] out Output Stream
+/// @param [in] format Output format
+inline void WriteHeader(std::ostream& out, Format format) {
+    if (format == Format::Table) {
+        out << std::setw(45) << std::left << "Benchmark" << std::setw(30)
+            << "ns/op (95% CI)" << std::setw(15) << "min" << "iterations"
+            << std::endl;
+    } else if (format == Format::Csv) {
+        out << "name,ns_per_op,ci95,min,iterations,repeats" << std::endl;
+    }
+}
+
+/// WriteResult writes a result in 'format': an aligned table row, a CSV
+/// row, or a JSON object on one line.
+///
+/// @param [in] out Output Stream
+/// @param [in] r Result
+/// @param [in] format Output format
+inline void WriteResult(std::ostream& out, const Result& r, Format format) {
+    std::ostringstream ns;
+    ns << std::fixed << std::setprecision(2) << r.mean;
+    std::ostringstream ci;
+    ci << std::fixed << std::setprecision(2) << r.ci95;
+    std::ostringstream min;
+    min << std::fixed << std::setprecision(2) << r.min;
+    if (format == Format::Table) {
+        out << std::setw(45) << std::left << r.name << std::setw(30)
+            << ns.str() + " +- " + ci.str() << std::setw(15) << min.str()
+            << r.iterations << std::endl;
+    } else if (format == Format::Csv) {
+        out << r.name << "," << ns.str() << "," << ci.str() << ","
+            << min.str() << "," << r.iterations << "," << r.repeats
+            << std::endl;
+    } else {
+        out << "{\"name\":\"" << r.name << "\",\"ns_per_op\":" << ns.str()
+            << ",\"ci95\":" << ci.str() << ",\"min\":" << min.str()
+            << ",\"iterations\":" << r.iterations
+            << ",\"repeats\":" << r.repeats << "}" << std::endl;
+    }
+}
+}
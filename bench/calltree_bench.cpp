@@ -0,0 +1,90 @@
+/// @file calltree_bench.cpp
+///
+/// Benchmark of CallTree Push/Pop on a warm tree as the number of children
+/// of the active scope grows, compared with a flat TimerSet by handle.
+///
+/// Usage: calltree_bench [--csv | --json]
+///
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "timey.hpp"
+#include "bench.hpp"
+
+// NullClock isolates the cost of the tree from the cost of reading the
+// clock.
+struct NullClock {
+    static int64_t Now() { return 0; }
+    static timey::NanosecondsType ToNanoseconds(int64_t ticks) {
+        return ticks * timey::Nanosecond;
+    }
+    static double NanosecondsPerTick() { return 1; }
+};
+
+typedef timey::BasicTimer<NullClock> NullTimer;
+
+void BenchChildren(size_t n_children, bench::Format format) {
+    const size_t iterations = 2000000;
+    std::string suffix = "/" + std::to_string(n_children);
+
+    timey::BasicCallTree<NullTimer> tree;
+    timey::ScopeId outer = timey::RegisterScope("outer");
+    std::vector<timey::ScopeId> scopes;
+    for (size_t i = 0; i < n_children; i++) {
+        scopes.push_back(timey::RegisterScope("scope_" + std::to_string(i)));
+    }
+    tree.Push(outer);
+
+    // Warm the tree so that every path exists
+    for (auto s : scopes) {
+        tree.Push(s);
+        tree.Pop();
+    }
+
+    size_t i = 0;
+    bench::WriteResult(std::cout,
+                       bench::Measure("CallTree::Push/Pop" + suffix,
+                                      [&]() {
+                                          tree.Push(scopes[i]);
+                                          tree.Pop();
+                                          i = (i + 1 == n_children) ? 0
+                                                                    : i + 1;
+                                      },
+                                      iterations),
+                       format);
+
+    timey::BasicTimerSet<NullTimer> ts;
+    std::vector<timey::TimerHandle> handles;
+    for (size_t j = 0; j < n_children; j++) {
+        handles.push_back(ts.Add("scope_" + std::to_string(j)));
+    }
+    i = 0;
+    bench::WriteResult(std::cout,
+                       bench::Measure("TimerSet::Start/Stop(handle)" + suffix,
+                                      [&]() {
+                                          ts.Start(handles[i]);
+                                          ts.Stop(handles[i]);
+                                          i = (i + 1 == n_children) ? 0
+                                                                    : i + 1;
+                                      },
+                                      iterations),
+                       format);
+    bench::DoNotOptimize(tree);
+    bench::DoNotOptimize(ts);
+}
+
+int main(int argc, char* argv[]) {
+    bench::Format format;
+    if (!bench::ParseFormat(argc, argv, format)) {
+        return 2;
+    }
+
+    bench::WriteHeader(std::cout, format);
+    const size_t counts[] = {1, 10, 100, 1000};
+    for (size_t n : counts) {
+        BenchChildren(n, format);
+    }
+    return 0;
+}
@@ -0,0 +1,47 @@
+/// @file clock_bench.cpp
+///
+/// Benchmark of the per Start/Stop cost of each clock policy.
+///
+/// Usage: clock_bench [--csv | --json]
+///
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "timey.hpp"
+#include "bench.hpp"
+
+template <class Clock>
+void BenchClock(const std::string& name, bench::Format format) {
+    const size_t iterations = 5000000;
+    timey::BasicTimer<Clock> t(name);
+    bench::Result r = bench::Measure(name + "::Start/Stop",
+                                     [&t]() {
+                                         t.Start();
+                                         t.Stop();
+                                     },
+                                     iterations);
+    bench::DoNotOptimize(t);
+    bench::WriteResult(std::cout, r, format);
+    if (format == bench::Format::Table) {
+        std::cout << std::setw(45) << std::left << "  clock overhead"
+                  << timey::Humanize(timey::ClockOverhead<Clock>())
+                  << std::endl;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    bench::Format format;
+    if (!bench::ParseFormat(argc, argv, format)) {
+        return 2;
+    }
+
+    bench::WriteHeader(std::cout, format);
+    BenchClock<timey::HighResolutionClock>("HighResolutionClock", format);
+    BenchClock<timey::SteadyClock>("SteadyClock", format);
+#ifdef TIMEY_HAS_TSC
+    BenchClock<timey::TscClock>("TscClock", format);
+#endif
+
+    return 0;
+}
@@ -0,0 +1,69 @@
+/// @file concurrent_bench.cpp
+///
+/// Multithreaded stress benchmark of ConcurrentTimerSet, compared with a
+/// TimerSet guarded by a mutex.
+///
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "timey.hpp"
+#include "bench.hpp"
+
+// PairsPerSecond runs 'fn' on 'n_threads' threads and returns the total
+// number of Start/Stop pairs per second.
+template <class F>
+double PairsPerSecond(size_t n_threads, size_t iterations, F fn) {
+    return n_threads * iterations * 1e9 /
+           bench::RunThreads(n_threads, iterations, fn);
+}
+
+int main(void) {
+    const size_t iterations = 1000000;
+    size_t max_threads = std::max(1u, std::thread::hardware_concurrency());
+
+    std::cout << "Start/Stop pairs per second (millions)" << std::endl;
+    std::cout << std::setw(10) << std::left << "Threads" << std::setw(15)
+              << "concurrent" << std::setw(15) << "mutex" << std::setw(15)
+              << "scaling" << std::endl;
+
+    double single = 0;
+    for (size_t n = 1; n <= max_threads; n *= 2) {
+        timey::ConcurrentTimerSet cts;
+        timey::TimerHandle ch = cts.Add("timer");
+        double concurrent = PairsPerSecond(n, iterations, [&]() {
+            cts.Start(ch);
+            cts.Stop(ch);
+        });
+        if (n == 1) {
+            single = concurrent;
+        }
+
+        timey::TimerSet ts;
+        timey::TimerHandle h = ts.Add("timer");
+        std::mutex mutex;
+        double locked = PairsPerSecond(n, iterations, [&]() {
+            // A Timer cannot be started twice, so hold the lock for the
+            // whole pair
+            std::lock_guard<std::mutex> lock(mutex);
+            ts.Start(h);
+            ts.Stop(h);
+        });
+
+        std::cout << std::setw(10) << n << std::fixed << std::setprecision(2)
+                  << std::setw(15) << concurrent / 1e6 << std::setw(15)
+                  << locked / 1e6 << std::setw(15) << concurrent / single
+                  << std::endl;
+        if (cts.Get(ch).Count() != n * iterations) {
+            std::cerr << "Lost samples" << std::endl;
+            return 1;
+        }
+    }
+
+    return 0;
+}
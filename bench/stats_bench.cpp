@@ -0,0 +1,75 @@
+/// @file stats_bench.cpp
+///
+/// Benchmark of the per Stop cost of each statistics configuration.
+///
+/// Usage: stats_bench [--csv | --json]
+///
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+#include "timey.hpp"
+#include "bench.hpp"
+
+// CountingClock isolates the cost of the statistics from the cost of
+// reading the clock, while still producing varying samples.
+struct CountingClock {
+    static int64_t now;
+    static int64_t Now() { return now += 997; }
+    static timey::NanosecondsType ToNanoseconds(int64_t ticks) {
+        return ticks * timey::Nanosecond;
+    }
+    static double NanosecondsPerTick() { return 1; }
+};
+int64_t CountingClock::now = 0;
+
+template <class TimerType>
+void BenchStats(const std::string& name, TimerType& t, bench::Format format) {
+    const size_t iterations = 10000000;
+    bench::Result r = bench::Measure("Start/Stop(" + name + ")",
+                                     [&t]() {
+                                         t.Start();
+                                         t.Stop();
+                                     },
+                                     iterations);
+    bench::DoNotOptimize(t);
+    bench::WriteResult(std::cout, r, format);
+}
+
+int main(int argc, char* argv[]) {
+    using namespace timey;
+    bench::Format format;
+    if (!bench::ParseFormat(argc, argv, format)) {
+        return 2;
+    }
+
+    bench::WriteHeader(std::cout, format);
+
+    BasicTimer<CountingClock, NoMoments, stats::Pack<>> count_total;
+    BenchStats("count + total", count_total, format);
+
+    BasicTimer<CountingClock, DefaultMoments, stats::Pack<>> moments;
+    BenchStats("+ moments", moments, format);
+
+    BasicTimer<CountingClock, DefaultMoments, stats::Pack<stats::MinMax>>
+        min_max;
+    BenchStats("+ min/max", min_max, format);
+
+    BasicTimer<CountingClock, DefaultMoments, stats::Pack<stats::Percentiles>>
+        histogram;
+    histogram.EnableHistogram();
+    BenchStats("+ histogram", histogram, format);
+
+    BasicTimer<CountingClock, DefaultMoments, stats::Pack<stats::Snapshots>>
+        snapshots;
+    BenchStats("+ snapshots", snapshots, format);
+
+    BasicTimer<CountingClock, DefaultMoments, stats::Pack<stats::Windows>>
+        windows;
+    BenchStats("+ windows", windows, format);
+
+    BasicTimer<CountingClock> default_disabled;
+    BenchStats("Timer default (disabled)", default_disabled, format);
+
+    return 0;
+}
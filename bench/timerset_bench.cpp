@@ -0,0 +1,103 @@
+/// @file timerset_bench.cpp
+///
+/// Benchmark of TimerSet Start/Stop by name and by handle as the number of
+/// timers grows, compared with a plain std::map of timers.
+///
+/// Usage: timerset_bench [--csv | --json]
+///
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "timey.hpp"
+#include "bench.hpp"
+
+// NullClock isolates the cost of finding the timer from the cost of reading
+// the clock.
+struct NullClock {
+    static int64_t Now() { return 0; }
+    static timey::NanosecondsType ToNanoseconds(int64_t ticks) {
+        return ticks * timey::Nanosecond;
+    }
+    static double NanosecondsPerTick() { return 1; }
+};
+
+template <class Clock>
+void BenchTimerCount(const std::string& clock_name, size_t n_timers,
+                     bench::Format format) {
+    typedef timey::BasicTimer<Clock> TimerType;
+    const size_t iterations = 2000000;
+
+    timey::BasicTimerSet<TimerType> ts;
+    std::map<std::string, TimerType> map;
+    std::vector<std::string> names;
+    std::vector<timey::TimerHandle> handles;
+    for (size_t i = 0; i < n_timers; i++) {
+        names.push_back("timer_" + std::to_string(i));
+        handles.push_back(ts.Add(names.back()));
+        map.insert({names.back(), TimerType(names.back())});
+    }
+    std::string suffix =
+        "/" + clock_name + "/" + std::to_string(n_timers);
+
+    size_t i = 0;
+    bench::WriteResult(
+        std::cout,
+        bench::Measure("std::map::Start/Stop" + suffix,
+                       [&]() {
+                           const std::string& name = names[i++ % n_timers];
+                           // Lookup pattern of the map based TimerSet
+                           if (map.find(name) != map.end()) {
+                               map[name].Start();
+                           }
+                           if (map.find(name) != map.end()) {
+                               map[name].Stop();
+                           }
+                       },
+                       iterations),
+        format);
+    i = 0;
+    bench::WriteResult(
+        std::cout,
+        bench::Measure("TimerSet::Start/Stop(name)" + suffix,
+                       [&]() {
+                           const std::string& name = names[i++ % n_timers];
+                           ts.Start(name);
+                           ts.Stop(name);
+                       },
+                       iterations),
+        format);
+    i = 0;
+    bench::WriteResult(
+        std::cout,
+        bench::Measure("TimerSet::Start/Stop(handle)" + suffix,
+                       [&]() {
+                           timey::TimerHandle h = handles[i++ % n_timers];
+                           ts.Start(h);
+                           ts.Stop(h);
+                       },
+                       iterations),
+        format);
+    bench::DoNotOptimize(ts);
+    bench::DoNotOptimize(map);
+}
+
+int main(int argc, char* argv[]) {
+    bench::Format format;
+    if (!bench::ParseFormat(argc, argv, format)) {
+        return 2;
+    }
+
+    bench::WriteHeader(std::cout, format);
+    for (size_t n : {1, 10, 100, 1000, 10000}) {
+        BenchTimerCount<NullClock>("NullClock", n, format);
+    }
+    for (size_t n : {1, 10, 100, 1000, 10000}) {
+        BenchTimerCount<timey::HighResolutionClock>("HighResolutionClock", n,
+                                                    format);
+    }
+
+    return 0;
+}
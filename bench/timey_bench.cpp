@@ -0,0 +1,277 @@
+/// @file timey_bench.cpp
+///
+/// Benchmark suite of the hot paths of timey: Timer and TimerSet Start/Stop,
+/// Humanize, Report, writing large TimerSets and multithreaded contention.
+/// Every benchmark reports ns/op with a 95% confidence interval over its
+/// repetitions.
+///
+/// Usage: timey_bench [--csv | --json] [filter]
+///
+/// Only the benchmarks whose name contains 'filter' are run.
+///
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "timey.hpp"
+#include "bench.hpp"
+
+namespace {
+/// Suite runs the benchmarks selected by the filter and writes their
+/// results as they complete.
+class Suite {
+   public:
+    Suite(bench::Format format, const std::string& filter)
+        : format_(format), filter_(filter) {
+        bench::WriteHeader(std::cout, format_);
+    }
+
+    /// Selected returns true if the benchmark 'name' is to be run.
+    bool Selected(const std::string& name) const {
+        return name.find(filter_) != std::string::npos;
+    }
+
+    /// Run measures 'fn' as the benchmark 'name' if it is selected.
+    template <class F>
+    void Run(const std::string& name, F fn, size_t iterations) {
+        if (Selected(name)) {
+            Write(bench::Measure(name, fn, iterations));
+        }
+    }
+
+    /// Write writes a result.
+    void Write(const bench::Result& r) {
+        bench::WriteResult(std::cout, r, format_);
+    }
+
+   private:
+    bench::Format format_;
+    std::string filter_;
+};
+
+void BenchTimer(Suite& suite) {
+    timey::Timer t("timer");
+    suite.Run("Timer::Start/Stop",
+              [&t]() {
+                  t.Start();
+                  t.Stop();
+              },
+              1000000);
+    bench::DoNotOptimize(t);
+
+    timey::Timer fixed("fixed");
+    fixed.SampleEvery(64);
+    suite.Run("Timer::Start/Stop(sampled 1/64)",
+              [&fixed]() {
+                  fixed.Start();
+                  fixed.Stop();
+              },
+              1000000);
+    bench::DoNotOptimize(fixed);
+
+    timey::Timer random("random");
+    random.SampleEvery(64, timey::SamplingMode::Random);
+    suite.Run("Timer::Start/Stop(random 1/64)",
+              [&random]() {
+                  random.Start();
+                  random.Stop();
+              },
+              1000000);
+    bench::DoNotOptimize(random);
+
+    timey::BasicTimer<timey::HighResolutionClock, timey::DefaultMoments,
+                      timey::stats::Pack<timey::stats::Counters>>
+        counted("counted");
+    std::string name = counted.EnableCounters()
+                           ? timey::ThreadPerfGroup().Rdpmc() ? "rdpmc"
+                                                              : "read"
+                           : "unavailable";
+    suite.Run("Timer::Start/Stop(counters " + name + ")",
+              [&counted]() {
+                  counted.Start();
+                  counted.Stop();
+              },
+              100000);
+    bench::DoNotOptimize(counted);
+}
+
+void BenchTimerSet(Suite& suite, size_t n_timers) {
+    timey::TimerSet ts;
+    std::vector<std::string> names;
+    std::vector<timey::TimerHandle> handles;
+    for (size_t i = 0; i < n_timers; i++) {
+        names.push_back("timer_" + std::to_string(i));
+        handles.push_back(ts.Add(names.back()));
+    }
+    std::string suffix = "/" + std::to_string(n_timers);
+
+    size_t i = 0;
+    suite.Run("TimerSet::Start/Stop(name)" + suffix,
+              [&]() {
+                  ts.Start(names[i]);
+                  ts.Stop(names[i]);
+                  i = (i + 1 == n_timers) ? 0 : i + 1;
+              },
+              500000);
+    i = 0;
+    suite.Run("TimerSet::Start/Stop(handle)" + suffix,
+              [&]() {
+                  ts.Start(handles[i]);
+                  ts.Stop(handles[i]);
+                  i = (i + 1 == n_timers) ? 0 : i + 1;
+              },
+              1000000);
+    bench::DoNotOptimize(ts);
+}
+
+void BenchFormatting(Suite& suite) {
+    timey::NanosecondsType short_duration = 1500 * timey::Nanosecond;
+    timey::NanosecondsType long_duration = 3665005 * timey::Microsecond;
+    suite.Run("Humanize(1.5us)",
+              [&]() {
+                  std::string s = timey::Humanize(short_duration);
+                  bench::DoNotOptimize(s);
+              },
+              200000);
+    suite.Run("Humanize(1h1m5.005s)",
+              [&]() {
+                  std::string s = timey::Humanize(long_duration);
+                  bench::DoNotOptimize(s);
+              },
+              200000);
+
+    timey::Timer t("timer");
+    for (int i = 0; i < 100; i++) {
+        t.Start();
+        t.Stop();
+    }
+    suite.Run("Timer::Report",
+              [&]() {
+                  std::string s = t.Report();
+                  bench::DoNotOptimize(s);
+              },
+              100000);
+}
+
+void BenchWriteTimerSet(Suite& suite, size_t n_timers) {
+    std::string name = "operator<<(TimerSet)/" + std::to_string(n_timers);
+    if (!suite.Selected(name)) {
+        return;
+    }
+    timey::TimerSet ts;
+    for (size_t i = 0; i < n_timers; i++) {
+        timey::TimerHandle h = ts.Add("timer_" + std::to_string(i));
+        ts.Start(h);
+        ts.Stop(h);
+    }
+    std::ostringstream out;
+    suite.Run(name,
+              [&]() {
+                  out.str("");
+                  out << ts;
+              },
+              n_timers >= 10000 ? 5 : 200);
+}
+
+void BenchContention(Suite& suite, size_t n_threads) {
+    const size_t iterations = 200000;
+    const int repeats = 10;
+    std::string suffix = "/" + std::to_string(n_threads);
+
+    std::string name = "ConcurrentTimerSet::Start/Stop" + suffix;
+    if (suite.Selected(name)) {
+        timey::ConcurrentTimerSet cts;
+        timey::TimerHandle h = cts.Add("timer");
+        std::vector<double> ns;
+        for (int r = 0; r < repeats; r++) {
+            ns.push_back(bench::RunThreads(n_threads, iterations, [&]() {
+                             cts.Start(h);
+                             cts.Stop(h);
+                         }) /
+                         iterations);
+        }
+        suite.Write(bench::Summarize(name, ns, iterations));
+    }
+
+    name = "ConcurrentTimerSet::Begin/End" + suffix;
+    if (suite.Selected(name)) {
+        // All threads share the in-flight counter of the timer
+        timey::ConcurrentTimerSet cts;
+        timey::TimerHandle h = cts.Add("timer");
+        std::vector<double> ns;
+        for (int r = 0; r < repeats; r++) {
+            ns.push_back(bench::RunThreads(n_threads, iterations, [&]() {
+                             cts.Begin(h).End();
+                         }) /
+                         iterations);
+        }
+        suite.Write(bench::Summarize(name, ns, iterations));
+    }
+
+    name = "SnapshotTimerSet::Start/Stop+Reporter" + suffix;
+    if (suite.Selected(name)) {
+        // One timer per thread, with a reporter taking snapshots throughout
+        timey::SnapshotTimerSet ts;
+        std::vector<timey::TimerHandle> handles;
+        for (size_t i = 0; i < n_threads; i++) {
+            handles.push_back(ts.Add("timer_" + std::to_string(i)));
+        }
+        std::atomic<size_t> next(0);
+        std::vector<double> ns;
+        timey::Reporter reporter(
+            ts, [](const std::vector<timey::TimerSnapshot>&,
+                   timey::NanosecondsType) {},
+            timey::Millisecond);
+        for (int r = 0; r < repeats; r++) {
+            next = 0;
+            ns.push_back(bench::RunThreads(n_threads, iterations, [&]() {
+                             // Threads are new in every repetition
+                             static thread_local size_t index = next++;
+                             ts.Start(handles[index]);
+                             ts.Stop(handles[index]);
+                         }) /
+                         iterations);
+        }
+        suite.Write(bench::Summarize(name, ns, iterations));
+    }
+}
+}
+
+int main(int argc, char* argv[]) {
+    bench::Format format = bench::Format::Table;
+    std::string filter;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--csv") {
+            format = bench::Format::Csv;
+        } else if (arg == "--json") {
+            format = bench::Format::Json;
+        } else if (arg[0] != '-') {
+            filter = arg;
+        } else {
+            std::cerr << "Usage: timey_bench [--csv | --json] [filter]"
+                      << std::endl;
+            return 2;
+        }
+    }
+
+    Suite suite(format, filter);
+    BenchTimer(suite);
+    for (size_t n : {1, 10, 100, 10000}) {
+        BenchTimerSet(suite, n);
+    }
+    BenchFormatting(suite);
+    for (size_t n : {100, 10000}) {
+        BenchWriteTimerSet(suite, n);
+    }
+    size_t max_threads = std::max(1u, std::thread::hardware_concurrency());
+    for (size_t n = 1; n <= max_threads; n *= 2) {
+        BenchContention(suite, n);
+    }
+
+    return 0;
+}
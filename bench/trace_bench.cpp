@@ -0,0 +1,71 @@
+/// @file trace_bench.cpp
+///
+/// Benchmark of Tracer Begin/End pairs on the instrumented thread, as the
+/// number of tracing threads grows. The file is written by the writer
+/// thread and is not part of the measured cost. Each repetition is the mean
+/// over the threads; the number of dropped events is written to stderr.
+///
+/// Usage: trace_bench [--csv | --json]
+///
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "timey.hpp"
+#include "bench.hpp"
+
+void BenchThreads(size_t n_threads, bench::Format format) {
+    // The warm up and the repetitions fit in the ring of each thread, so
+    // that the measured cost is not the cost of dropping events.
+    const size_t iterations = 40000;
+    const std::string path = "timey_trace_bench.json";
+
+    timey::ScopeId work = timey::RegisterScope("work");
+    timey::Tracer tracer(path, 1 << 20);
+    std::vector<std::vector<double>> ns(n_threads);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < n_threads; t++) {
+        threads.emplace_back([&, t]() {
+            ns[t] = bench::Repeat(
+                [&]() {
+                    tracer.Begin(work);
+                    tracer.End(work);
+                },
+                iterations);
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    tracer.Close();
+
+    std::vector<double> mean(ns[0].size(), 0);
+    for (const std::vector<double>& thread_ns : ns) {
+        for (size_t r = 0; r < mean.size(); r++) {
+            mean[r] += thread_ns[r] / n_threads;
+        }
+    }
+    std::string name = "Tracer::Begin/End/" + std::to_string(n_threads);
+    bench::WriteResult(std::cout, bench::Summarize(name, mean, iterations),
+                       format);
+    std::cerr << name << ": " << tracer.Dropped() << " events dropped"
+              << std::endl;
+    std::remove(path.c_str());
+}
+
+int main(int argc, char* argv[]) {
+    bench::Format format;
+    if (!bench::ParseFormat(argc, argv, format)) {
+        return 2;
+    }
+
+    bench::WriteHeader(std::cout, format);
+    const size_t counts[] = {1, 2, 4};
+    for (size_t n : counts) {
+        BenchThreads(n, format);
+    }
+    return 0;
+}
@@ -0,0 +1,34 @@
+/// @file scopedtimer_basics.cpp
+///
+/// Example demonstrating the basic usage of ScopedTimer and TIMEY_SCOPE.
+///
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+#include "timey.hpp"
+
+void Assemble(void) {
+    // Times the rest of the function with the "assemble" timer of
+    // GlobalTimerSet
+    TIMEY_SCOPE("assemble");
+    std::this_thread::sleep_for(timey::Millisecond);
+}
+
+int main(void) {
+    timey::TimerSet ts;
+    timey::TimerHandle solve = ts.Add("solve");
+
+    for (int i = 0; i < 10; i++) {
+        Assemble();
+        {
+            // Stops the timer on every path out of the scope
+            timey::ScopedTimer scope(ts, solve);
+            std::this_thread::sleep_for(2 * timey::Millisecond);
+        }
+    }
+
+    // Print the reports
+    std::cout << timey::GlobalTimerSet() << std::endl;
+    std::cout << ts << std::endl;
+}
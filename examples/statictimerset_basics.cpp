@@ -0,0 +1,33 @@
+/// @file statictimerset_basics.cpp
+///
+/// Example demonstrating the basic usage of the StaticTimerSet class.
+///
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+#include "timey.hpp"
+
+// Declare the timers of the StaticTimerSet
+TIMEY_TIMER_TAG(Assemble, "assemble");
+TIMEY_TIMER_TAG(Solve, "solve");
+
+int main(void) {
+    // The set of timers is fixed at compile time
+    timey::StaticTimerSet<Assemble, Solve> ts;
+
+    for (int i = 0; i < 10; i++) {
+        // Address a timer by its tag
+        ts.Start<Assemble>();
+        std::this_thread::sleep_for(timey::Millisecond);
+        ts.Stop<Assemble>();
+
+        // or by the identifier of its name
+        ts.Start<timey::TimerId("solve")>();
+        std::this_thread::sleep_for(2 * timey::Millisecond);
+        ts.Stop<timey::TimerId("solve")>();
+    }
+
+    // Print the StaticTimerSet report
+    std::cout << ts << std::endl;
+}
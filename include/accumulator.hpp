@@ -0,0 +1,257 @@
+/// @file accumulator.hpp
+///
+/// Accumulator policies for the moments of Timer samples
+///
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace timey {
+namespace internal {
+/// KahanAdd adds 'x' to the compensated sum 'sum' + 'compensation' using
+/// Neumaier's variant of Kahan summation.
+///
+/// @param [in,out] sum Running sum
+/// @param [in,out] compensation Running compensation
+/// @param [in] x Value to add
+inline void KahanAdd(double& sum, double& compensation, double x) {
+    double t = sum + x;
+    if ((sum >= 0 ? sum : -sum) >= (x >= 0 ? x : -x)) {
+        compensation += (sum - t) + x;
+    } else {
+        compensation += (x - t) + sum;
+    }
+    sum = t;
+}
+
+/// Uint128 is an unsigned 128-bit integer held as two 64-bit halves, for
+/// exact sums of squared durations on compilers without __int128.
+struct Uint128 {
+    uint64_t high;
+    uint64_t low;
+};
+
+/// Multiply returns the exact 128-bit product of 'a' and 'b'.
+inline Uint128 Multiply(uint64_t a, uint64_t b) {
+    uint64_t a_low = a & 0xFFFFFFFF, a_high = a >> 32;
+    uint64_t b_low = b & 0xFFFFFFFF, b_high = b >> 32;
+    uint64_t low_low = a_low * b_low;
+    uint64_t low_high = a_low * b_high;
+    uint64_t high_low = a_high * b_low;
+    uint64_t middle = (low_low >> 32) + (low_high & 0xFFFFFFFF) +
+                      (high_low & 0xFFFFFFFF);
+    return Uint128{a_high * b_high + (low_high >> 32) + (high_low >> 32) +
+                       (middle >> 32),
+                   (middle << 32) | (low_low & 0xFFFFFFFF)};
+}
+
+/// Add returns 'a' + 'b', modulo 2^128.
+inline Uint128 Add(Uint128 a, Uint128 b) {
+    uint64_t low = a.low + b.low;
+    return Uint128{a.high + b.high + (low < a.low ? 1 : 0), low};
+}
+
+/// SecondMoment returns the sum of the squared deviations from the mean of
+/// 'count' samples, from their exact sum and sum of squares. With
+/// |sum| = q * count + r, the second moment
+///     sumSquares - sum^2 / count
+///   = sumSquares - q * (|sum| + r) - r^2 / count
+/// where the first difference is exact, so that nothing cancels.
+///
+/// @param [in] count Number of samples
+/// @param [in] sum Sum of the samples
+/// @param [in] sum_squares Sum of the squared samples
+/// @retval Second moment of the samples
+inline double SecondMoment(uint64_t count, int64_t sum, Uint128 sum_squares) {
+    if (count == 0) {
+        return 0;
+    }
+    uint64_t magnitude = sum < 0 ? 0 - (uint64_t)sum : (uint64_t)sum;
+    uint64_t q = magnitude / count;
+    uint64_t r = magnitude % count;
+    Uint128 p = Multiply(q, magnitude + r);
+    if (sum_squares.high < p.high ||
+        (sum_squares.high == p.high && sum_squares.low < p.low)) {
+        return 0;
+    }
+    uint64_t low = sum_squares.low - p.low;
+    uint64_t high = sum_squares.high - p.high - (sum_squares.low < p.low);
+    double m2 = (double)high * 18446744073709551616.0 + (double)low -
+                (double)r * ((double)r / count);
+    return m2 > 0 ? m2 : 0;
+}
+}
+
+/// CompensatedMoments is an accumulator policy keeping the running mean and
+/// second moment of the samples in double precision, using Welford's update
+/// with Kahan compensated sums.
+///
+/// An accumulator policy provides:
+///   * Reset() clearing the accumulated samples
+///   * Add(x, count) adding sample 'x', where 'count' is the number of
+///     samples including 'x'
+///   * Merge(a, count, a_count) merging accumulator 'a' of 'a_count'
+///     samples into one of 'count' samples
+///   * Mean(count) and Variance(count) returning the mean and the
+///     population variance of 'count' samples
+///   * FromSums(count, sum, sum_squares) building an accumulator from the
+///     exact sum and sum of squares of 'count' samples
+///
+/// Samples are clock ticks; Timer converts the statistics to nanoseconds.
+class CompensatedMoments {
+   public:
+    CompensatedMoments() { Reset(); }
+
+    void Reset(void) {
+        mean_ = 0;
+        meanCompensation_ = 0;
+        secondMoment_ = 0;
+        secondMomentCompensation_ = 0;
+    }
+
+    void Add(int64_t x, size_t count) {
+        double delta = (double)x - Mean(count);
+        internal::KahanAdd(mean_, meanCompensation_, delta / count);
+        internal::KahanAdd(secondMoment_, secondMomentCompensation_,
+                           delta * ((double)x - Mean(count)));
+    }
+
+    void Merge(const CompensatedMoments& a, size_t count, size_t a_count) {
+        if (a_count == 0) {
+            return;
+        }
+        double n = (double)count + a_count;
+        double delta = a.Mean(a_count) - Mean(count);
+        internal::KahanAdd(mean_, meanCompensation_, delta * a_count / n);
+        internal::KahanAdd(secondMoment_, secondMomentCompensation_,
+                           a.secondMoment_);
+        internal::KahanAdd(secondMoment_, secondMomentCompensation_,
+                           a.secondMomentCompensation_);
+        internal::KahanAdd(secondMoment_, secondMomentCompensation_,
+                           delta * delta * count * a_count / n);
+    }
+
+    double Mean(size_t) const { return mean_ + meanCompensation_; }
+
+    double Variance(size_t count) const {
+        if (count == 0) {
+            return 0;
+        }
+        double m2 = secondMoment_ + secondMomentCompensation_;
+        return (m2 > 0 ? m2 : 0) / count;
+    }
+
+    static CompensatedMoments FromSums(size_t count, int64_t sum,
+                                       internal::Uint128 sum_squares) {
+        CompensatedMoments m;
+        if (count > 0) {
+            m.mean_ = (double)sum / count;
+            m.secondMoment_ = internal::SecondMoment(count, sum, sum_squares);
+        }
+        return m;
+    }
+
+   private:
+    double mean_;
+    double meanCompensation_;
+    double secondMoment_;
+    double secondMomentCompensation_;
+};
+
+/// NoMoments is an accumulator policy keeping nothing, for timers that only
+/// need the count and the total. The standard deviation is not reported.
+///
+/// See CompensatedMoments for the accumulator policy interface.
+class NoMoments {
+   public:
+    void Reset(void) {}
+
+    void Add(int64_t, size_t) {}
+
+    void Merge(const NoMoments&, size_t, size_t) {}
+
+    double Mean(size_t) const { return 0; }
+
+    double Variance(size_t) const { return 0; }
+
+    static NoMoments FromSums(size_t, int64_t, internal::Uint128) {
+        return NoMoments();
+    }
+};
+
+#ifdef __SIZEOF_INT128__
+/// Int128Moments is an accumulator policy keeping the exact sum and sum of
+/// squares of the samples in 128-bit integers. The second moment is
+/// recovered exactly when the statistics are read, so there is no rounding
+/// on the hot path and no overflow for samples below 2^43 ticks (about 2.4
+/// hours in nanoseconds) over 2^40 samples.
+///
+/// See CompensatedMoments for the accumulator policy interface.
+class Int128Moments {
+   public:
+    __extension__ typedef __int128 Int128;
+
+    Int128Moments() { Reset(); }
+
+    void Reset(void) {
+        sum_ = 0;
+        sumSquares_ = 0;
+    }
+
+    void Add(int64_t x, size_t) {
+        sum_ += x;
+        sumSquares_ += (Int128)x * x;
+    }
+
+    void Merge(const Int128Moments& a, size_t, size_t) {
+        sum_ += a.sum_;
+        sumSquares_ += a.sumSquares_;
+    }
+
+    double Mean(size_t count) const {
+        if (count == 0) {
+            return 0;
+        }
+        Int128 q = sum_ / (Int128)count;
+        Int128 r = sum_ % (Int128)count;
+        return (double)q + (double)r / count;
+    }
+
+    double Variance(size_t count) const {
+        if (count == 0) {
+            return 0;
+        }
+        // With sum = q * count + r, the second moment
+        //     sumSquares - sum^2 / count
+        //   = sumSquares - q * (q * count + 2 * r) - r^2 / count
+        // where every term fits in 128 bits.
+        Int128 n = count;
+        Int128 q = sum_ / n;
+        Int128 r = sum_ % n;
+        Int128 m2 = sumSquares_ - q * (q * n + 2 * r);
+        double second_moment = (double)m2 - (double)r * ((double)r / count);
+        return (second_moment > 0 ? second_moment : 0) / count;
+    }
+
+    static Int128Moments FromSums(size_t, int64_t sum,
+                                  internal::Uint128 sum_squares) {
+        Int128Moments m;
+        m.sum_ = sum;
+        m.sumSquares_ =
+            ((Int128)sum_squares.high << 64) | (Int128)sum_squares.low;
+        return m;
+    }
+
+   private:
+    Int128 sum_;
+    Int128 sumSquares_;
+};
+
+/// DefaultMoments is the accumulator policy used by Timer.
+typedef Int128Moments DefaultMoments;
+#else
+/// DefaultMoments is the accumulator policy used by Timer.
+typedef CompensatedMoments DefaultMoments;
+#endif
+}
@@ -0,0 +1,459 @@
+/// @file calltree.hpp
+///
+/// CallTree class for hierarchical timing of nested scopes
+///
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "utils.hpp"
+#include "timer.hpp"
+#include "scopedtimer.hpp"
+
+#ifdef TIMEY_DISABLE
+#define TIMEY_CALL_SCOPE(name) static_cast<void>(0)
+#else
+/// TIMEY_CALL_SCOPE times the rest of the enclosing scope as the scope
+/// 'name' of the CallTree of the calling thread, ThreadCallTree. The scope
+/// name is registered the first time the scope is entered. TIMEY_CALL_SCOPE
+/// compiles to nothing when TIMEY_DISABLE is defined.
+///
+/// @param name Name of the scope
+#define TIMEY_CALL_SCOPE(name)                                             \
+    static const ::timey::ScopeId TIMEY_CONCAT(timey_scope_id_,            \
+                                               __LINE__) =                 \
+        ::timey::RegisterScope(name);                                      \
+    ::timey::CallScope TIMEY_CONCAT(timey_call_scope_, __LINE__)(          \
+        ::timey::ThreadCallTree(), TIMEY_CONCAT(timey_scope_id_, __LINE__))
+#endif
+
+namespace timey {
+/// ScopeId is the identifier of a registered scope name. See RegisterScope.
+class ScopeId {
+   public:
+    /// Constructs the identifier of the root of a CallTree.
+    ScopeId() : id_(0) {}
+
+    /// Id returns the identifier of the scope name.
+    ///
+    /// @retval Identifier of the scope name
+    uint32_t Id(void) const { return id_; }
+
+    bool operator==(const ScopeId& s) const { return id_ == s.id_; }
+    bool operator!=(const ScopeId& s) const { return id_ != s.id_; }
+
+   private:
+    explicit ScopeId(uint32_t id__) : id_(id__) {}
+
+    friend ScopeId RegisterScope(const std::string& name);
+
+    /// id_ is the position of the name in the scope registry.
+    uint32_t id_;
+};
+
+namespace internal {
+/// ScopeRegistry holds the registered scope names, shared by all threads.
+struct ScopeRegistry {
+    std::mutex mutex;
+    std::vector<std::string> names;
+    std::map<std::string, uint32_t> ids;
+
+    ScopeRegistry() : names(1) {}
+};
+
+/// Scopes returns the process wide scope registry.
+inline ScopeRegistry& Scopes(void) {
+    static ScopeRegistry registry;
+    return registry;
+}
+}
+
+/// RegisterScope returns the identifier of a scope name, registering the
+/// name if needed. Identifiers are shared by all threads and CallTrees.
+///
+/// @param [in] name Name of the scope
+/// @retval Identifier of the scope name
+inline ScopeId RegisterScope(const std::string& name) {
+    internal::ScopeRegistry& r = internal::Scopes();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    auto it = r.ids.find(name);
+    if (it != r.ids.end()) {
+        return ScopeId(it->second);
+    }
+    uint32_t id = (uint32_t)r.names.size();
+    r.names.push_back(name);
+    r.ids.insert({name, id});
+    return ScopeId(id);
+}
+
+/// ScopeName returns the name of a registered scope.
+///
+/// @param [in] s Identifier of the scope name
+/// @retval Name of the scope
+inline std::string ScopeName(ScopeId s) {
+    internal::ScopeRegistry& r = internal::Scopes();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    return r.names[s.Id()];
+}
+
+namespace internal {
+/// CallTreeHeader returns the fixed format header used for reporting call
+/// tree statistics.
+///
+/// @retval std::string Fixed format header string.
+inline const std::string CallTreeHeader(void) {
+    return "Scope" + std::string(20, ' ') + "Count" + std::string(10, ' ') +
+           "Inclusive" + std::string(11, ' ') + "Exclusive" +
+           std::string(11, ' ') + "Mean" + std::string(16, ' ') +
+           "% Parent" + std::string(12, ' ');
+}
+}
+
+/// BasicCallTree class times nested scopes as a call tree: a scope pushed
+/// while another is active is a child of the active scope, and each node of
+/// the tree has its own timer of type TimerType. The report shows, for each
+/// node, the inclusive time, the exclusive time spent outside of its children
+/// and the percentage of the inclusive time of its parent.
+///
+/// Push and Pop are O(1). Once every path has been visited, they do not
+/// allocate. A CallTree is not thread safe: each thread times its own tree,
+/// see ThreadCallTree, and trees are combined with Merge.
+///
+/// CallTree is a BasicCallTree of Timer objects.
+///
+/// Example:
+/// @code
+///     CallTree tree;
+///     ScopeId solve = RegisterScope("solve");
+///     ScopeId assemble = RegisterScope("assemble");
+///     for(size_t i = 0; i < n; i++) {
+///         tree.Push(solve);
+///         tree.Push(assemble);
+///         assemble();
+///         tree.Pop();
+///         factorize();
+///         tree.Pop();
+///     }
+///
+///     // Write the call tree report to stdout
+///     std::cout << tree << std::endl;
+/// @endcode
+template <class TimerType>
+class BasicCallTree {
+   public:
+    BasicCallTree();
+
+    // API
+    void Push(ScopeId s);
+    void Push(const std::string& name);
+    void Pop(void);
+    size_t Depth(void) const;
+    size_t Count(void) const;
+    const TimerType& Get(const std::string& path) const;
+    NanosecondsType Exclusive(const std::string& path) const;
+    void Merge(const BasicCallTree& tree);
+    BasicCallTree& operator+=(const BasicCallTree& tree);
+
+    // Friend functions
+    template <class T>
+    friend std::ostream& operator<<(std::ostream& out,
+                                    const BasicCallTree<T>& tree);
+
+   private:
+    /// Node is a node of the call tree.
+    struct Node {
+        ScopeId scope;
+        size_t parent;
+        TimerType timer;
+        /// children holds the indices of the children in creation order.
+        std::vector<size_t> children;
+    };
+
+    size_t Child_(size_t parent, ScopeId s);
+    size_t Find_(const std::string& path) const;
+    NanosecondsType Inclusive_(size_t node) const;
+    NanosecondsType Exclusive_(size_t node) const;
+    void Merge_(const BasicCallTree& tree, size_t from, size_t to);
+    void Report_(std::ostream& out, size_t node, size_t depth) const;
+
+    /// nodes_ holds the nodes, the root first. A deque keeps references to
+    /// nodes stable as nodes are added.
+    std::deque<Node> nodes_;
+    /// children_ maps a parent index and a scope identifier to the index of
+    /// the child node.
+    std::unordered_map<uint64_t, size_t> children_;
+    /// stack_ holds the indices of the active nodes, innermost last.
+    std::vector<size_t> stack_;
+};
+
+/// CallTree is a BasicCallTree of Timer objects.
+typedef BasicCallTree<Timer> CallTree;
+
+template <class TimerType>
+BasicCallTree<TimerType>::BasicCallTree() {
+    nodes_.push_back(Node{ScopeId(), 0, TimerType(), {}});
+    stack_.reserve(64);
+}
+
+/// Push starts timing a scope as a child of the innermost active scope.
+///
+/// @param [in] s Identifier of the scope name
+template <class TimerType>
+inline void BasicCallTree<TimerType>::Push(ScopeId s) {
+    size_t node = Child_(stack_.empty() ? 0 : stack_.back(), s);
+    stack_.push_back(node);
+    nodes_[node].timer.Start();
+}
+
+/// Push starts timing a scope by name. The name is registered on each call;
+/// use Push by ScopeId on hot paths.
+///
+/// @param [in] name Name of the scope
+template <class TimerType>
+inline void BasicCallTree<TimerType>::Push(const std::string& name) {
+    Push(RegisterScope(name));
+}
+
+/// Pop stops timing the innermost active scope.
+///
+/// @throw std::runtime_error if no scope is active.
+template <class TimerType>
+inline void BasicCallTree<TimerType>::Pop(void) {
+    if (stack_.empty()) {
+        throw std::runtime_error("Pop called on an empty CallTree");
+    }
+    nodes_[stack_.back()].timer.Stop();
+    stack_.pop_back();
+}
+
+/// Depth returns the number of active scopes.
+///
+/// @retval Number of active scopes
+template <class TimerType>
+inline size_t BasicCallTree<TimerType>::Depth(void) const {
+    return stack_.size();
+}
+
+/// Count returns the number of nodes in the CallTree, not counting the root.
+///
+/// @retval Number of nodes in the CallTree
+template <class TimerType>
+inline size_t BasicCallTree<TimerType>::Count(void) const {
+    return nodes_.size() - 1;
+}
+
+/// Get returns the timer of a node by path, the names of the scopes from the
+/// outermost separated by '/', for example "solve/assemble".
+///
+/// @throw std::runtime_error if the path is not in the CallTree.
+///
+/// @param [in] path Path of the node
+/// @retval Timer object of the node
+template <class TimerType>
+const TimerType& BasicCallTree<TimerType>::Get(const std::string& path) const {
+    return nodes_[Find_(path)].timer;
+}
+
+/// Exclusive returns the time spent in a node but not in its children, by
+/// path. See Get.
+///
+/// @throw std::runtime_error if the path is not in the CallTree.
+///
+/// @param [in] path Path of the node
+/// @retval std::chrono::duration object in Nanoseconds
+template <class TimerType>
+NanosecondsType BasicCallTree<TimerType>::Exclusive(
+    const std::string& path) const {
+    return Exclusive_(Find_(path));
+}
+
+/// Merge combines the timers of another CallTree into the CallTree, node by
+/// node along the same paths, adding the nodes that are missing.
+///
+/// @param [in] tree CallTree to merge
+template <class TimerType>
+void BasicCallTree<TimerType>::Merge(const BasicCallTree& tree) {
+    Merge_(tree, 0, 0);
+}
+
+/// Operator overloading to merge another CallTree into the CallTree. See
+/// Merge.
+///
+/// @param [in] tree CallTree to merge
+/// @retval Updated CallTree
+template <class TimerType>
+BasicCallTree<TimerType>& BasicCallTree<TimerType>::operator+=(
+    const BasicCallTree& tree) {
+    Merge(tree);
+    return *this;
+}
+
+/// Child_ returns the index of the child of a node for a scope, adding the
+/// child if needed.
+template <class TimerType>
+inline size_t BasicCallTree<TimerType>::Child_(size_t parent, ScopeId s) {
+    uint64_t key = ((uint64_t)parent << 32) | s.Id();
+    auto it = children_.find(key);
+    if (it != children_.end()) {
+        return it->second;
+    }
+    size_t node = nodes_.size();
+    nodes_.push_back(Node{s, parent, TimerType(ScopeName(s)), {}});
+    nodes_[parent].children.push_back(node);
+    children_.insert({key, node});
+    return node;
+}
+
+/// Find_ returns the index of a node by path.
+template <class TimerType>
+size_t BasicCallTree<TimerType>::Find_(const std::string& path) const {
+    size_t node = 0;
+    std::istringstream names(path);
+    std::string name;
+    while (std::getline(names, name, '/')) {
+        size_t next = 0;
+        for (size_t c : nodes_[node].children) {
+            if (ScopeName(nodes_[c].scope) == name) {
+                next = c;
+                break;
+            }
+        }
+        if (next == 0) {
+            throw std::runtime_error("Invalid CallTree path '" + path + "'");
+        }
+        node = next;
+    }
+    if (node == 0) {
+        throw std::runtime_error("Invalid CallTree path '" + path + "'");
+    }
+    return node;
+}
+
+/// Inclusive_ returns the time spent in a node, or in all the top level
+/// nodes for the root.
+template <class TimerType>
+NanosecondsType BasicCallTree<TimerType>::Inclusive_(size_t node) const {
+    if (node != 0) {
+        return nodes_[node].timer.Elapsed();
+    }
+    NanosecondsType total(0);
+    for (size_t c : nodes_[0].children) {
+        total += nodes_[c].timer.Elapsed();
+    }
+    return total;
+}
+
+/// Exclusive_ returns the time spent in a node but not in its children.
+template <class TimerType>
+NanosecondsType BasicCallTree<TimerType>::Exclusive_(size_t node) const {
+    NanosecondsType exclusive = Inclusive_(node);
+    for (size_t c : nodes_[node].children) {
+        exclusive -= nodes_[c].timer.Elapsed();
+    }
+    return exclusive;
+}
+
+/// Merge_ merges the subtree of 'tree' at 'from' into the subtree at 'to'.
+template <class TimerType>
+void BasicCallTree<TimerType>::Merge_(const BasicCallTree& tree, size_t from,
+                                      size_t to) {
+    for (size_t c : tree.nodes_[from].children) {
+        size_t node = Child_(to, tree.nodes_[c].scope);
+        nodes_[node].timer.Merge(tree.nodes_[c].timer);
+        Merge_(tree, c, node);
+    }
+}
+
+/// Report_ writes the report of the subtree at 'node', indenting the names
+/// by depth.
+template <class TimerType>
+void BasicCallTree<TimerType>::Report_(std::ostream& out, size_t node,
+                                       size_t depth) const {
+    using std::setw;
+    using std::endl;
+    const Node& n = nodes_[node];
+    NanosecondsType inclusive = Inclusive_(node);
+    NanosecondsType parent = Inclusive_(n.parent);
+
+    std::ostringstream percent;
+    percent << std::fixed << std::setprecision(1)
+            << (parent.count() > 0 ? 100.0 * inclusive.count() / parent.count()
+                                   : 0.0)
+            << "%";
+    out << setw(25) << std::string(2 * (depth - 1), ' ') + ScopeName(n.scope)
+        << setw(15) << n.timer.Count() << setw(20) << Humanize(inclusive)
+        << setw(20) << Humanize(Exclusive_(node)) << setw(20)
+        << Humanize(n.timer.ElapsedMean()) << setw(20) << percent.str()
+        << endl;
+    for (size_t c : n.children) {
+        Report_(out, c, depth + 1);
+    }
+}
+
+/// Operator overloading to write a CallTree object to std::ostream. Nodes
+/// are written depth first, children in the order they were first pushed.
+///
+/// @param [in] out Output Stream
+/// @param [in] tree CallTree object
+/// @retval Updated output stream
+template <class TimerType>
+std::ostream& operator<<(std::ostream& out,
+                         const BasicCallTree<TimerType>& tree) {
+    using std::endl;
+    out << std::left;
+
+    std::string header = internal::CallTreeHeader();
+    out << header << endl;
+    out << internal::ReportRule(header) << endl;
+    for (size_t c : tree.nodes_[0].children) {
+        tree.Report_(out, c, 1);
+    }
+    out << internal::ReportRule(header) << endl;
+
+    return out;
+}
+
+/// BasicCallScope class pushes a scope on a CallTree when constructed and
+/// pops it when destroyed. CallScope is a BasicCallScope of CallTree.
+template <class TreeType>
+class BasicCallScope {
+   public:
+    /// Constructs a CallScope pushing 's' on 'tree'.
+    ///
+    /// @param [in] tree CallTree of the scope
+    /// @param [in] s Identifier of the scope name
+    BasicCallScope(TreeType& tree, ScopeId s) : tree_(tree) { tree_.Push(s); }
+
+    ~BasicCallScope() { tree_.Pop(); }
+
+    BasicCallScope(const BasicCallScope&) = delete;
+    BasicCallScope& operator=(const BasicCallScope&) = delete;
+
+   private:
+    /// tree_ is the CallTree the scope was pushed on.
+    TreeType& tree_;
+};
+
+/// CallScope is a BasicCallScope of CallTree.
+typedef BasicCallScope<CallTree> CallScope;
+
+/// ThreadCallTree returns the CallTree of the calling thread, used by
+/// TIMEY_CALL_SCOPE. The tree is destroyed when the thread exits, so it
+/// must be reported, or merged into another tree, by the thread itself.
+///
+/// @retval CallTree of the calling thread
+inline CallTree& ThreadCallTree(void) {
+    thread_local CallTree tree;
+    return tree;
+}
+}
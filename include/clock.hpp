@@ -0,0 +1,259 @@
+/// @file clock.hpp
+///
+/// Clock policies for Timer
+///
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <vector>
+
+#include "utils.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define TIMEY_HAS_TSC 1
+#endif
+
+#if defined(CLOCK_THREAD_CPUTIME_ID) && defined(CLOCK_PROCESS_CPUTIME_ID)
+#define TIMEY_HAS_CPU_CLOCKS 1
+#endif
+
+namespace timey {
+namespace internal {
+/// ChronoClock adapts a std::chrono clock to the clock policy interface used
+/// by Timer.
+///
+/// A clock policy provides:
+///   * Now() returning the current time as an int64_t tick count
+///   * ToNanoseconds(int64_t) converting a tick count to NanosecondsType
+///   * NanosecondsPerTick() returning the length of a tick in nanoseconds
+///
+/// Timer accumulates raw ticks and only converts them to nanoseconds when the
+/// statistics are read.
+template <class C>
+struct ChronoClock {
+    /// Now returns the current time of the underlying clock in ticks.
+    ///
+    /// @retval Ticks since the epoch of the underlying clock
+    static int64_t Now() { return C::now().time_since_epoch().count(); }
+
+    /// ToNanoseconds converts a tick count into a duration of Nanoseconds.
+    ///
+    /// @param [in] ticks Tick count
+    /// @retval std::chrono::duration object in Nanoseconds
+    static NanosecondsType ToNanoseconds(int64_t ticks) {
+        return std::chrono::duration_cast<NanosecondsType>(
+            typename C::duration(ticks));
+    }
+
+    /// NanosecondsPerTick returns the length of a single tick in nanoseconds.
+    ///
+    /// @retval Nanoseconds per tick
+    static double NanosecondsPerTick() {
+        return 1e9 * C::period::num / C::period::den;
+    }
+};
+}
+
+/// SteadyClock is a clock policy using std::chrono::steady_clock.
+///
+struct SteadyClock : internal::ChronoClock<std::chrono::steady_clock> {};
+
+/// HighResolutionClock is a clock policy using
+/// std::chrono::high_resolution_clock. It is the default clock for Timer.
+///
+struct HighResolutionClock
+    : internal::ChronoClock<std::chrono::high_resolution_clock> {};
+
+#ifdef TIMEY_HAS_TSC
+/// TscClock is a clock policy reading the CPU time stamp counter with
+/// rdtscp, which avoids the cost of a clock_gettime call on every Start and
+/// Stop.
+///
+/// Tick to nanosecond conversion is calibrated once against
+/// std::chrono::steady_clock, busy waiting for about 20ms, the first time
+/// it is needed: when the first timer using TscClock is constructed, so
+/// that no timed region or report pays for it, or earlier with
+/// timey::Calibrate. Programs that never use TscClock never calibrate. The
+/// calibration assumes an invariant TSC, which is the case on all modern
+/// x86 processors.
+///
+/// Example:
+/// @code
+///     timey::BasicTimer<timey::TscClock> t;
+///     t.Start();
+///     compute_intensive_function();
+///     t.Stop();
+/// @endcode
+class TscClock {
+   public:
+    /// Now returns the current value of the time stamp counter.
+    ///
+    /// @retval Ticks of the time stamp counter
+    static int64_t Now() {
+        unsigned int aux;
+        return static_cast<int64_t>(__rdtscp(&aux));
+    }
+
+    /// ToNanoseconds converts a tick count into a duration of Nanoseconds
+    /// using the calibrated tick length.
+    ///
+    /// @param [in] ticks Tick count
+    /// @retval std::chrono::duration object in Nanoseconds
+    static NanosecondsType ToNanoseconds(int64_t ticks) {
+        return static_cast<int64_t>(ticks * NanosecondsPerTick()) *
+               timey::Nanosecond;
+    }
+
+    /// NanosecondsPerTick returns the calibrated length of a tick in
+    /// nanoseconds. It only calibrates if Calibrate was never called.
+    ///
+    /// @retval Nanoseconds per tick
+    static double NanosecondsPerTick() {
+        double ns_per_tick = NsPerTick_().load(std::memory_order_relaxed);
+        return ns_per_tick > 0 ? ns_per_tick : Calibrate();
+    }
+
+    /// Calibrate measures the length of a tick against
+    /// std::chrono::steady_clock over the given window, busy waiting for its
+    /// duration, and uses it for every later conversion.
+    ///
+    /// @param [in] window Duration of the calibration window
+    /// @retval Nanoseconds per tick
+    static double Calibrate(NanosecondsType window = 20 * timey::Millisecond) {
+        using std::chrono::steady_clock;
+        steady_clock::time_point start = steady_clock::now();
+        uint64_t start_ticks = __rdtsc();
+        steady_clock::time_point stop;
+        do {
+            stop = steady_clock::now();
+        } while (stop - start < window);
+        uint64_t stop_ticks = __rdtsc();
+
+        NanosecondsType elapsed =
+            std::chrono::duration_cast<NanosecondsType>(stop - start);
+        double ns_per_tick =
+            (double)elapsed.count() / (double)(stop_ticks - start_ticks);
+        NsPerTick_().store(ns_per_tick, std::memory_order_relaxed);
+        return ns_per_tick;
+    }
+
+   private:
+    /// NsPerTick_ returns the calibrated length of a tick, or zero before
+    /// the first calibration.
+    static std::atomic<double>& NsPerTick_() {
+        static std::atomic<double> ns_per_tick(0);
+        return ns_per_tick;
+    }
+};
+#endif
+
+#ifdef TIMEY_HAS_CPU_CLOCKS
+namespace internal {
+/// PosixClock adapts a POSIX clock_gettime clock to the clock policy
+/// interface, with ticks of one nanosecond.
+template <clockid_t Id>
+struct PosixClock {
+    /// Now returns the current time of the clock in nanoseconds.
+    ///
+    /// @retval Nanoseconds since the origin of the clock
+    static int64_t Now() {
+        timespec ts;
+        clock_gettime(Id, &ts);
+        return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+    }
+
+    /// ToNanoseconds converts a tick count into a duration of Nanoseconds.
+    ///
+    /// @param [in] ticks Tick count
+    /// @retval std::chrono::duration object in Nanoseconds
+    static NanosecondsType ToNanoseconds(int64_t ticks) {
+        return ticks * timey::Nanosecond;
+    }
+
+    /// NanosecondsPerTick returns the length of a single tick in nanoseconds.
+    ///
+    /// @retval Nanoseconds per tick
+    static double NanosecondsPerTick() { return 1; }
+};
+}
+
+/// ThreadCpuClock is a clock policy measuring the CPU time of the calling
+/// thread with CLOCK_THREAD_CPUTIME_ID. Time spent blocked, on locks or
+/// I/O, does not count. A timer using it must be started and stopped on the
+/// same thread. Reading it is a system call on most kernels, so it costs
+/// more than the wall clocks.
+struct ThreadCpuClock : internal::PosixClock<CLOCK_THREAD_CPUTIME_ID> {};
+
+/// ProcessCpuClock is a clock policy measuring the CPU time of every thread
+/// of the process with CLOCK_PROCESS_CPUTIME_ID, which grows faster than
+/// wall time while several threads run.
+struct ProcessCpuClock : internal::PosixClock<CLOCK_PROCESS_CPUTIME_ID> {};
+#endif
+
+namespace internal {
+/// MeasureClockOverhead returns the median, over 'pairs' measurements, of
+/// the ticks between two back-to-back reads of the clock, which is what an
+/// empty Start and Stop record.
+///
+/// @param [in] pairs Number of back-to-back reads
+/// @retval Overhead in clock ticks
+template <class Clock>
+int64_t MeasureClockOverhead(size_t pairs = 10001) {
+    std::vector<int64_t> overheads(pairs);
+    for (size_t i = 0; i < pairs; i++) {
+        int64_t start = Clock::Now();
+        int64_t stop = Clock::Now();
+        overheads[i] = stop - start;
+    }
+    std::nth_element(overheads.begin(), overheads.begin() + pairs / 2,
+                     overheads.end());
+    return overheads[pairs / 2];
+}
+}
+
+/// ClockOverheadTicks returns the overhead of reading the clock policy
+/// 'Clock' twice, in clock ticks. The first call per clock policy measures
+/// it, which happens when the first timer using the clock is constructed,
+/// or in Calibrate; see ClockOverhead.
+///
+/// @retval Overhead in clock ticks
+template <class Clock>
+int64_t ClockOverheadTicks() {
+    static const int64_t overhead = internal::MeasureClockOverhead<Clock>();
+    return overhead;
+}
+
+/// ClockOverhead returns the duration an empty Start and Stop record with
+/// the clock policy 'Clock': the median of many back-to-back reads of the
+/// clock, measured once per clock policy, see ClockOverheadTicks. Durations
+/// within a few multiples of the overhead are mostly the cost of timing
+/// itself.
+///
+/// @retval std::chrono::duration object in Nanoseconds
+template <class Clock = HighResolutionClock>
+NanosecondsType ClockOverhead() {
+    return Clock::ToNanoseconds(ClockOverheadTicks<Clock>());
+}
+
+/// Calibrate calibrates TscClock and measures the overhead of the clock
+/// policies of clock.hpp, which otherwise happens when the first timer
+/// using each clock is constructed. Call it from main, before timing, to
+/// keep the cost, about 20ms of busy waiting with TscClock, out of the
+/// setup of the timers. Calibrate does nothing when TIMEY_DISABLE is
+/// defined.
+inline void Calibrate() {
+#ifndef TIMEY_DISABLE
+#ifdef TIMEY_HAS_TSC
+    TscClock::NanosecondsPerTick();
+    ClockOverheadTicks<TscClock>();
+#endif
+    ClockOverheadTicks<HighResolutionClock>();
+    ClockOverheadTicks<SteadyClock>();
+#endif
+}
+}
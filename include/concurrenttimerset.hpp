@@ -0,0 +1,721 @@
+/// @file concurrenttimerset.hpp
+///
+/// ConcurrentTimerSet class
+///
+#pragma once
+
+#include <iostream>
+#include <iomanip>
+#include <stdexcept>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include "utils.hpp"
+#include "accumulator.hpp"
+#include "timer.hpp"
+#include "timerset.hpp"
+
+namespace timey {
+namespace internal {
+/// CacheLineSize is the assumed size of a cache line in bytes.
+constexpr size_t CacheLineSize = 64;
+
+/// CacheAlignedArray is a fixed size array of T starting on a cache line
+/// boundary.
+template <class T>
+class CacheAlignedArray {
+   public:
+    explicit CacheAlignedArray(size_t size__)
+        : size_(size__),
+          buffer_(new char[size__ * sizeof(T) + CacheLineSize]) {
+        void* p = buffer_.get();
+        size_t space = size_ * sizeof(T) + CacheLineSize;
+        data_ = static_cast<T*>(
+            std::align(CacheLineSize, size_ * sizeof(T), p, space));
+        for (size_t i = 0; i < size_; i++) {
+            new (data_ + i) T();
+        }
+    }
+    ~CacheAlignedArray() {
+        for (size_t i = 0; i < size_; i++) {
+            data_[i].~T();
+        }
+    }
+    CacheAlignedArray(const CacheAlignedArray&) = delete;
+    CacheAlignedArray& operator=(const CacheAlignedArray&) = delete;
+
+    T& operator[](size_t i) { return data_[i]; }
+    const T& operator[](size_t i) const { return data_[i]; }
+    size_t Size(void) const { return size_; }
+
+   private:
+    size_t size_;
+    std::unique_ptr<char[]> buffer_;
+    T* data_;
+};
+
+/// NextConcurrentTimerSetId returns a process wide unique identifier for a
+/// ConcurrentTimerSet.
+inline size_t NextConcurrentTimerSetId(void) {
+    static std::atomic<size_t> next_id(0);
+    return next_id.fetch_add(1);
+}
+
+/// LocalShards returns the calling thread's shards, indexed by the
+/// identifier of their ConcurrentTimerSet.
+inline std::vector<void*>& LocalShards(void) {
+    static thread_local std::vector<void*> shards;
+    return shards;
+}
+
+/// SlotStatistics holds the count, the total and the exact sum of squares
+/// of the samples of one timer recorded by one thread. Only the owning
+/// thread writes them, with plain loads and stores inside a sequence lock,
+/// so that other threads read the two halves of the sum of squares
+/// together. SlotStatistics is zero when value initialized, or when zero
+/// filled in shared memory.
+struct SlotStatistics {
+    /// ReadAttempts is the number of attempts of Read before it returns
+    /// statistics whose writer never finished, as after a crash.
+    static constexpr int ReadAttempts = 1000;
+
+    /// Record adds the duration 'x'. Record must only be called by the
+    /// owning thread.
+    ///
+    /// @param [in] x Duration in clock ticks
+    void Record(int64_t x) {
+        uint64_t magnitude = x < 0 ? 0 - (uint64_t)x : (uint64_t)x;
+        Uint128 sum_squares = Add(
+            Uint128{sumSquaresHigh.load(std::memory_order_relaxed),
+                    sumSquaresLow.load(std::memory_order_relaxed)},
+            Multiply(magnitude, magnitude));
+        uint64_t s = sequence.load(std::memory_order_relaxed);
+        sequence.store(s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        count.store(count.load(std::memory_order_relaxed) + 1,
+                    std::memory_order_relaxed);
+        total.store(total.load(std::memory_order_relaxed) + x,
+                    std::memory_order_relaxed);
+        sumSquaresHigh.store(sum_squares.high, std::memory_order_relaxed);
+        sumSquaresLow.store(sum_squares.low, std::memory_order_relaxed);
+        sequence.store(s + 2, std::memory_order_release);
+    }
+
+    /// Read reads the statistics consistently from any thread.
+    ///
+    /// @param [out] count__ Number of samples
+    /// @param [out] total__ Sum of the samples in clock ticks
+    /// @param [out] sum_squares Sum of the squared samples
+    void Read(uint64_t& count__, int64_t& total__,
+              Uint128& sum_squares) const {
+        for (int attempt = 1;; attempt++) {
+            uint64_t before = sequence.load(std::memory_order_acquire);
+            count__ = count.load(std::memory_order_relaxed);
+            total__ = total.load(std::memory_order_relaxed);
+            sum_squares.high = sumSquaresHigh.load(std::memory_order_relaxed);
+            sum_squares.low = sumSquaresLow.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (((before & 1) == 0 &&
+                 before == sequence.load(std::memory_order_relaxed)) ||
+                attempt == ReadAttempts) {
+                return;
+            }
+            std::this_thread::yield();
+        }
+    }
+
+    /// sequence is odd while the owner is writing.
+    std::atomic<uint64_t> sequence;
+    std::atomic<uint64_t> count;
+    /// total is the sum of the samples in clock ticks.
+    std::atomic<int64_t> total;
+    /// sumSquaresHigh and sumSquaresLow are the halves of the exact sum of
+    /// the squared samples in clock ticks.
+    std::atomic<uint64_t> sumSquaresHigh;
+    std::atomic<uint64_t> sumSquaresLow;
+};
+}
+
+/// BasicConcurrentTimerSet class is a set of named timers that can be
+/// started and stopped from many threads at once.
+///
+/// Every thread writes to its own cache line aligned shard of the timers,
+/// so Start and Stop take no locks and use no atomic read-modify-write
+/// instructions. A timer may run concurrently on different threads, but a
+/// thread must stop a timer before starting it again.
+///
+/// Get and operator<< aggregate the shards of all threads into Timer objects
+/// without stopping the writers. Each shard keeps the exact sum of squares
+/// of its samples and is read consistently, but the shards are read one
+/// after the other, so a view taken while samples are being recorded may be
+/// off by the samples in flight.
+///
+/// Begin starts a Span instead, for work that is in flight many times at
+/// once or that ends on another thread than it started, such as thread pool
+/// continuations and coroutines. Spans of a timer may overlap; each records
+/// its sample into the shard of the thread that ends it, and the number of
+/// spans in flight per timer is tracked with one atomic counter.
+///
+/// Timers are added up front, up to the capacity given at construction.
+///
+/// ConcurrentTimerSet is a BasicConcurrentTimerSet using the default clock
+/// policy.
+///
+/// Example:
+/// @code
+///     ConcurrentTimerSet ts;
+///     TimerHandle h = ts.Add("request");
+///
+///     // On every worker thread
+///     for(size_t i = 0; i < n; i++) {
+///         ts.Start(h);
+///         handle_request();
+///         ts.Stop(h);
+///     }
+///
+///     // Spans may overlap and end on any thread
+///     ConcurrentTimerSet::Span span = ts.Begin(h);
+///     std::thread worker([&span]() {
+///         handle_request();
+///         span.End();
+///     });
+///
+///     // On any thread
+///     std::cout << ts << std::endl;
+/// @endcode
+template <class Clock>
+class BasicConcurrentTimerSet {
+   public:
+    /// TimerType is the type of the aggregated timers.
+    typedef BasicTimer<Clock> TimerType;
+
+    /// Span is one start-stop cycle of a timer of the ConcurrentTimerSet,
+    /// started by Begin. A Span is movable but not copyable, and can be
+    /// ended on any thread. A Span that is still active when destroyed or
+    /// assigned to is ended, so that every path out of a scope or a
+    /// coroutine is timed; as these cannot throw, a duration that cannot be
+    /// recorded there is counted by Lost instead.
+    /// A Span must not outlive its ConcurrentTimerSet.
+    class Span {
+       public:
+        Span() noexcept : set_(nullptr), index_(0), start_(0) {}
+        Span(Span&& s) noexcept
+            : set_(s.set_), index_(s.index_), start_(s.start_) {
+            s.set_ = nullptr;
+        }
+        Span& operator=(Span&& s) noexcept {
+            if (this != &s) {
+                if (Active()) {
+                    EndNoThrow_();
+                }
+                set_ = s.set_;
+                index_ = s.index_;
+                start_ = s.start_;
+                s.set_ = nullptr;
+            }
+            return *this;
+        }
+        Span(const Span&) = delete;
+        Span& operator=(const Span&) = delete;
+        ~Span() {
+            if (Active()) {
+                EndNoThrow_();
+            }
+        }
+
+        /// Active returns true until the Span is ended, cancelled or moved
+        /// from.
+        bool Active(void) const { return set_ != nullptr; }
+
+        /// End stops the Span and records its duration into the timer, from
+        /// the calling thread.
+        ///
+        /// @throw std::runtime_error if the Span is not active
+        void End(void) {
+            int64_t stop = Clock::Now();
+            if (set_ == nullptr) {
+                throw std::runtime_error("End called on an inactive span");
+            }
+            set_->End_(index_, stop - start_);
+            set_ = nullptr;
+        }
+
+        /// Cancel stops the Span without recording its duration, for work
+        /// that was abandoned.
+        ///
+        /// @throw std::runtime_error if the Span is not active
+        void Cancel(void) {
+            if (set_ == nullptr) {
+                throw std::runtime_error("Cancel called on an inactive span");
+            }
+            set_->flights_[index_].current.fetch_sub(
+                1, std::memory_order_relaxed);
+            set_ = nullptr;
+        }
+
+       private:
+        friend class BasicConcurrentTimerSet;
+        Span(BasicConcurrentTimerSet* set, size_t index, int64_t start)
+            : set_(set), index_(index), start_(start) {}
+
+        /// EndNoThrow_ ends an active Span like End, for the destructor and
+        /// the move assignment.
+        void EndNoThrow_(void) noexcept {
+            int64_t stop = Clock::Now();
+            set_->EndNoThrow_(index_, stop - start_);
+            set_ = nullptr;
+        }
+
+        /// set_ is the ConcurrentTimerSet of an active Span, or nullptr.
+        BasicConcurrentTimerSet* set_;
+        /// index_ is the index of the timer in the shards.
+        size_t index_;
+        /// start_ is the clock reading taken by Begin.
+        int64_t start_;
+    };
+
+    explicit BasicConcurrentTimerSet(size_t capacity__ = 1024);
+    ~BasicConcurrentTimerSet();
+    BasicConcurrentTimerSet(const BasicConcurrentTimerSet&) = delete;
+    BasicConcurrentTimerSet& operator=(const BasicConcurrentTimerSet&) =
+        delete;
+
+    // API
+    size_t Count(void) const;
+    size_t Capacity(void) const { return capacity_; }
+    size_t Threads(void) const;
+    TimerHandle Add(const std::string& timer_name);
+    TimerHandle Handle(const std::string& timer_name) const;
+    void Start(const std::string& timer_name) { Start(Handle(timer_name)); }
+    void Stop(const std::string& timer_name) { Stop(Handle(timer_name)); }
+    TimerType Get(const std::string& timer_name) const;
+    TimerType Get(TimerHandle h) const;
+
+    // Handle API
+    void Start(TimerHandle h);
+    void Stop(TimerHandle h);
+
+    // Span API
+    Span Begin(const std::string& timer_name) {
+        return Begin(Handle(timer_name));
+    }
+    Span Begin(TimerHandle h);
+    int64_t InFlight(TimerHandle h) const;
+    int64_t PeakInFlight(TimerHandle h) const;
+    int64_t Lost(TimerHandle h) const;
+
+    /// ForEach calls 'fn' with the aggregate of each timer in the
+    /// ConcurrentTimerSet, in the order of their names. Timers cannot be
+    /// added from 'fn'.
+    ///
+    /// @param [in] fn Function taking a const TimerType&
+    template <class Fn>
+    void ForEach(Fn fn) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& t : timers_) {
+            fn(Aggregate_(t.second, t.first));
+        }
+    }
+
+    // Friend functions
+    template <class C>
+    friend std::ostream& operator<<(std::ostream& out,
+                                    const BasicConcurrentTimerSet<C>& ts);
+
+   private:
+    /// Slot holds the statistics of one timer on one thread. Only the owning
+    /// thread writes a Slot; the statistics can be read while the owner is
+    /// writing.
+    struct alignas(internal::CacheLineSize) Slot {
+        Slot() : running(false), start(0), statistics() {}
+        bool running;
+        int64_t start;
+        internal::SlotStatistics statistics;
+    };
+    typedef internal::CacheAlignedArray<Slot> Shard;
+
+    /// Flight counts the spans of one timer in flight on all threads, and
+    /// those whose duration was lost.
+    struct alignas(internal::CacheLineSize) Flight {
+        Flight() : current(0), peak(0), lost(0) {}
+        std::atomic<int64_t> current;
+        std::atomic<int64_t> peak;
+        std::atomic<int64_t> lost;
+    };
+
+    Shard& LocalShard_();
+    Shard& NewShard_();
+    size_t Index_(TimerHandle h) const;
+    static void Record_(Slot& slot, int64_t x);
+    void End_(size_t index, int64_t x);
+    void EndNoThrow_(size_t index, int64_t x) noexcept;
+    TimerType Aggregate_(size_t index, const std::string& timer_name) const;
+
+    /// id_ identifies this set in the per-thread shard tables.
+    size_t id_;
+    /// capacity_ is the maximum number of timers.
+    size_t capacity_;
+    /// mutex_ protects timers_ and shards_.
+    mutable std::mutex mutex_;
+    /// timers_ maps timer names to their index in the shards.
+    std::map<std::string, size_t> timers_;
+    /// shards_ holds one shard per thread that used the set.
+    std::vector<std::unique_ptr<Shard>> shards_;
+    /// flights_ holds the spans in flight of each timer.
+    internal::CacheAlignedArray<Flight> flights_;
+};
+
+/// ConcurrentTimerSet is a BasicConcurrentTimerSet using the default clock
+/// policy.
+typedef BasicConcurrentTimerSet<HighResolutionClock> ConcurrentTimerSet;
+
+template <class Clock>
+BasicConcurrentTimerSet<Clock>::BasicConcurrentTimerSet(size_t capacity__)
+    : id_(internal::NextConcurrentTimerSetId()),
+      capacity_(capacity__),
+      flights_(capacity__) {}
+
+template <class Clock>
+BasicConcurrentTimerSet<Clock>::~BasicConcurrentTimerSet() {}
+
+/// LocalShard_ returns the shard of the calling thread, creating it on first
+/// use.
+/// LocalShard_ is a private function and should not be used by end users.
+///
+/// @retval Shard of the calling thread
+template <class Clock>
+inline typename BasicConcurrentTimerSet<Clock>::Shard&
+BasicConcurrentTimerSet<Clock>::LocalShard_() {
+    std::vector<void*>& shards = internal::LocalShards();
+    if (id_ < shards.size() && shards[id_] != nullptr) {
+        return *static_cast<Shard*>(shards[id_]);
+    }
+    return NewShard_();
+}
+
+/// NewShard_ creates the shard of the calling thread.
+/// NewShard_ is a private function and should not be used by end users.
+///
+/// @retval Shard of the calling thread
+template <class Clock>
+typename BasicConcurrentTimerSet<Clock>::Shard&
+BasicConcurrentTimerSet<Clock>::NewShard_() {
+    // Every step that can throw comes before the shard is registered, so a
+    // failure leaks nothing and leaves the set unchanged.
+    std::vector<void*>& shards = internal::LocalShards();
+    if (shards.size() <= id_) {
+        shards.resize(id_ + 1, nullptr);
+    }
+    std::unique_ptr<Shard> shard(new Shard(capacity_));
+    Shard* local = shard.get();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        shards_.push_back(std::move(shard));
+    }
+    shards[id_] = local;
+    return *local;
+}
+
+/// Count returns the count of timers in the ConcurrentTimerSet
+///
+/// @retval Number of timers in the ConcurrentTimerSet
+template <class Clock>
+size_t BasicConcurrentTimerSet<Clock>::Count(void) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return timers_.size();
+}
+
+/// Threads returns the number of threads that have used the
+/// ConcurrentTimerSet.
+///
+/// @retval Number of shards in the ConcurrentTimerSet
+template <class Clock>
+size_t BasicConcurrentTimerSet<Clock>::Threads(void) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return shards_.size();
+}
+
+/// Add adds a new timer to the ConcurrentTimerSet with name 'timer_name'.
+///
+/// @throw std::runtime_error if a timer with the provided name already exists
+/// in the ConcurrentTimerSet, or if the ConcurrentTimerSet is full
+///
+/// @param [in] timer_name Name of the timer
+/// @retval Handle of the new timer
+template <class Clock>
+TimerHandle BasicConcurrentTimerSet<Clock>::Add(
+    const std::string& timer_name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (timers_.find(timer_name) != timers_.end()) {
+        throw std::runtime_error("Duplicate Timer '" + timer_name + "'");
+    }
+    if (timers_.size() == capacity_) {
+        throw std::runtime_error("ConcurrentTimerSet is full, cannot add '" +
+                                 timer_name + "'");
+    }
+    size_t index = timers_.size();
+    timers_.insert({timer_name, index});
+    return TimerHandle(index);
+}
+
+/// Handle returns a handle to a timer in the ConcurrentTimerSet by name.
+///
+/// @throw std::runtime_error if a timer with the provided name does not exist
+/// in the ConcurrentTimerSet
+///
+/// @param [in] timer_name Name of the timer
+/// @retval Handle of the timer with the given timer_name
+template <class Clock>
+TimerHandle BasicConcurrentTimerSet<Clock>::Handle(
+    const std::string& timer_name) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = timers_.find(timer_name);
+    if (it == timers_.end()) {
+        throw std::runtime_error("Invalid Timer '" + timer_name + "'");
+    }
+    return TimerHandle(it->second);
+}
+
+/// Start starts a timer on the calling thread.
+///
+/// @throw std::runtime_error if the handle is not valid, or if the timer is
+/// already running on the calling thread.
+///
+/// @param [in] h Handle of the timer
+template <class Clock>
+inline void BasicConcurrentTimerSet<Clock>::Start(TimerHandle h) {
+    Slot& slot = LocalShard_()[Index_(h)];
+    if (slot.running) {
+        throw std::runtime_error("Start called on a running timer");
+    }
+    slot.start = Clock::Now();
+    slot.running = true;
+}
+
+/// Stop stops a timer on the calling thread.
+///
+/// @throw std::runtime_error if the handle is not valid, or if the timer is
+/// idle on the calling thread.
+///
+/// @param [in] h Handle of the timer
+template <class Clock>
+inline void BasicConcurrentTimerSet<Clock>::Stop(TimerHandle h) {
+    int64_t stop = Clock::Now();
+    Slot& slot = LocalShard_()[Index_(h)];
+    if (!slot.running) {
+        throw std::runtime_error("Stop called on an idle timer");
+    }
+    Record_(slot, stop - slot.start);
+    slot.running = false;
+}
+
+/// Index_ returns the index of the timer of a handle in the shards. Any
+/// index below the capacity is within the shards, so a default or foreign
+/// handle is rejected with a single comparison.
+/// Index_ is a private function and should not be used by end users.
+///
+/// @throw std::runtime_error if the handle is not valid
+///
+/// @param h Handle of the timer
+/// @retval Index of the timer in the shards
+template <class Clock>
+inline size_t BasicConcurrentTimerSet<Clock>::Index_(TimerHandle h) const {
+    if (h.index_ >= capacity_) {
+        throw std::runtime_error("Invalid TimerHandle");
+    }
+    return h.index_;
+}
+
+/// Record_ adds the duration 'x' to a slot of the calling thread.
+/// Record_ is a private function and should not be used by end users.
+///
+/// @param slot Slot of the timer in the shard of the calling thread
+/// @param x Duration in clock ticks
+template <class Clock>
+inline void BasicConcurrentTimerSet<Clock>::Record_(Slot& slot, int64_t x) {
+    slot.statistics.Record(x);
+}
+
+/// Begin starts a Span of a timer. Spans of the same timer may overlap, on
+/// one thread or many, and each may end on any thread.
+///
+/// @throw std::runtime_error if the handle is not valid
+///
+/// @param [in] h Handle of the timer
+/// @retval Active Span of the timer
+template <class Clock>
+inline typename BasicConcurrentTimerSet<Clock>::Span
+BasicConcurrentTimerSet<Clock>::Begin(TimerHandle h) {
+    size_t index = Index_(h);
+    Flight& flight = flights_[index];
+    int64_t n = flight.current.fetch_add(1, std::memory_order_relaxed) + 1;
+    int64_t peak = flight.peak.load(std::memory_order_relaxed);
+    while (n > peak && !flight.peak.compare_exchange_weak(
+                           peak, n, std::memory_order_relaxed)) {
+    }
+    return Span(this, index, Clock::Now());
+}
+
+/// End_ records the duration of a Span into the shard of the calling thread.
+/// End_ is a private function and should not be used by end users.
+///
+/// @param index Index of the timer in the shards
+/// @param x Duration in clock ticks
+template <class Clock>
+inline void BasicConcurrentTimerSet<Clock>::End_(size_t index, int64_t x) {
+    Record_(LocalShard_()[index], x);
+    flights_[index].current.fetch_sub(1, std::memory_order_relaxed);
+}
+
+/// EndNoThrow_ records the duration of a Span like End_, and counts it as
+/// lost if the shard of the calling thread cannot be created.
+/// EndNoThrow_ is a private function and should not be used by end users.
+///
+/// @param index Index of the timer in the shards
+/// @param x Duration in clock ticks
+template <class Clock>
+void BasicConcurrentTimerSet<Clock>::EndNoThrow_(size_t index,
+                                                 int64_t x) noexcept {
+    try {
+        Record_(LocalShard_()[index], x);
+    } catch (...) {
+        flights_[index].lost.fetch_add(1, std::memory_order_relaxed);
+    }
+    flights_[index].current.fetch_sub(1, std::memory_order_relaxed);
+}
+
+/// InFlight returns the number of active spans of a timer.
+///
+/// @throw std::runtime_error if the handle is not valid
+///
+/// @param [in] h Handle of the timer
+/// @retval Number of spans begun and not yet ended or cancelled
+template <class Clock>
+int64_t BasicConcurrentTimerSet<Clock>::InFlight(TimerHandle h) const {
+    return flights_[Index_(h)].current.load(std::memory_order_relaxed);
+}
+
+/// PeakInFlight returns the largest number of spans of a timer that were
+/// active at once.
+///
+/// @throw std::runtime_error if the handle is not valid
+///
+/// @param [in] h Handle of the timer
+/// @retval Peak number of spans in flight
+template <class Clock>
+int64_t BasicConcurrentTimerSet<Clock>::PeakInFlight(TimerHandle h) const {
+    return flights_[Index_(h)].peak.load(std::memory_order_relaxed);
+}
+
+/// Lost returns the number of spans of a timer ended by their destructor
+/// or a move assignment whose duration could not be recorded, because the
+/// ending thread could not allocate its shard.
+///
+/// @throw std::runtime_error if the handle is not valid
+///
+/// @param [in] h Handle of the timer
+/// @retval Number of spans whose duration was lost
+template <class Clock>
+int64_t BasicConcurrentTimerSet<Clock>::Lost(TimerHandle h) const {
+    return flights_[Index_(h)].lost.load(std::memory_order_relaxed);
+}
+
+/// Aggregate_ combines the shards of a timer into a Timer object.
+/// Aggregate_ is a private function and should not be used by end users.
+///
+/// @param index Index of the timer in the shards
+/// @param timer_name Name of the timer
+/// @retval Aggregated Timer object
+template <class Clock>
+typename BasicConcurrentTimerSet<Clock>::TimerType
+BasicConcurrentTimerSet<Clock>::Aggregate_(
+    size_t index, const std::string& timer_name) const {
+    uint64_t count = 0;
+    int64_t total = 0;
+    internal::Uint128 sum_squares{0, 0};
+    for (auto& shard : shards_) {
+        uint64_t shard_count;
+        int64_t shard_total;
+        internal::Uint128 shard_sum_squares;
+        (*shard)[index].statistics.Read(shard_count, shard_total,
+                                        shard_sum_squares);
+        count += shard_count;
+        total += shard_total;
+        sum_squares = internal::Add(sum_squares, shard_sum_squares);
+    }
+
+    TimerType t(timer_name);
+    t.count_ = count;
+    t.sampled_ = count;
+    t.totalTime_ = total;
+    t.moments_ = TimerType::AccumulatorType::FromSums(count, total,
+                                                      sum_squares);
+    return t;
+}
+
+/// Get returns the aggregate of a timer over all threads by name.
+///
+/// @throw std::runtime_error if a timer with the provided name does not exist
+/// in the ConcurrentTimerSet
+///
+/// @param [in] timer_name Name of the timer
+/// @retval Aggregated Timer object
+template <class Clock>
+typename BasicConcurrentTimerSet<Clock>::TimerType
+BasicConcurrentTimerSet<Clock>::Get(const std::string& timer_name) const {
+    size_t index = Handle(timer_name).index_;
+    std::lock_guard<std::mutex> lock(mutex_);
+    return Aggregate_(index, timer_name);
+}
+
+/// Get returns the aggregate of a timer over all threads by handle.
+///
+/// @param [in] h Handle of the timer
+/// @retval Aggregated Timer object
+template <class Clock>
+typename BasicConcurrentTimerSet<Clock>::TimerType
+BasicConcurrentTimerSet<Clock>::Get(TimerHandle h) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& t : timers_) {
+        if (t.second == h.index_) {
+            return Aggregate_(h.index_, t.first);
+        }
+    }
+    throw std::runtime_error("Invalid TimerHandle");
+}
+
+/// Operator overloading to write the aggregate of a ConcurrentTimerSet
+/// object to std::ostream
+///
+/// @param [in] out Output Stream
+/// @param [in] ts ConcurrentTimerSet object
+/// @retval Updated output stream
+template <class Clock>
+std::ostream& operator<<(std::ostream& out,
+                         const BasicConcurrentTimerSet<Clock>& ts) {
+    out << std::left;
+
+    std::lock_guard<std::mutex> lock(ts.mutex_);
+    // Report header is defined in Timer.hpp
+    FormatBuffer report;
+    report.Append(internal::ReportHeader()).Append('\n');
+    report.Repeat('-', 80).Append('\n');
+    for (auto& t : ts.timers_) {
+        ts.Aggregate_(t.second, t.first).Report(report);
+        report.Append('\n');
+        if (report.Size() >= internal::ReportFlushSize) {
+            out << report;
+            report.Clear();
+        }
+    }
+    report.Repeat('-', 80).Append('\n');
+    out << report;
+
+    return out;
+}
+}
@@ -0,0 +1,190 @@
+/// @file cputime.hpp
+///
+/// CpuTime statistics policy measuring the CPU time of each start-stop cycle
+/// next to its wall time
+///
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "utils.hpp"
+#include "clock.hpp"
+
+namespace timey {
+/// CpuScope selects the CPU time a timer with the stats::CpuTime policy
+/// measures.
+enum class CpuScope {
+    /// Thread measures the CPU time of the thread running the timer.
+    Thread,
+    /// Process measures the CPU time of every thread of the process.
+    Process
+};
+
+namespace stats {
+/// CpuTime is a statistics policy optionally reading a CPU time clock at
+/// each timed Start and Stop, next to the wall clock of the timer. Report
+/// adds the CPU time, the wait time, which is the wall time the timer was
+/// not on a CPU, and the CPU utilisation, so that compute bound timers stand
+/// apart from timers waiting on locks or I/O. See EnableCpuTime.
+///
+/// Example:
+/// @code
+///     BasicTimer<SteadyClock, DefaultMoments, stats::Pack<stats::CpuTime>>
+///         t("query");
+///     t.EnableCpuTime();
+///     t.Start();
+///     run_query();
+///     t.Stop();
+///     std::cout << Humanize(t.ElapsedWait()) << " waiting" << std::endl;
+/// @endcode
+template <class Clock>
+class CpuTime {
+   public:
+    CpuTime() : enabled_(false), scope_(CpuScope::Thread) { Reset_(); }
+
+    /// EnableCpuTime makes the timer read the CPU time of 'scope' at each
+    /// timed Start and Stop. A timer measuring CpuScope::Thread must be
+    /// started and stopped on the same thread. Previously recorded cycles
+    /// are not measured.
+    ///
+    /// @param [in] scope CPU time of the thread or of the process
+    /// @retval TRUE If CPU time clocks are available on the platform
+    /// @retval FALSE Otherwise, and the timer keeps timing wall time only
+    bool EnableCpuTime(CpuScope scope = CpuScope::Thread) {
+#ifdef TIMEY_HAS_CPU_CLOCKS
+        enabled_ = true;
+        scope_ = scope;
+#else
+        (void)scope;
+#endif
+        return enabled_;
+    }
+
+    /// DisableCpuTime stops reading the CPU time.
+    void DisableCpuTime(void) { enabled_ = false; }
+
+    /// HasCpuTime returns true if the timer reads the CPU time.
+    bool HasCpuTime(void) const { return enabled_; }
+
+    /// MeasuredCalls returns the number of start-stop cycles whose CPU time
+    /// was measured.
+    uint64_t MeasuredCalls(void) const { return calls_; }
+
+    /// ElapsedCpu returns the total CPU time of the measured cycles.
+    ///
+    /// @retval std::chrono::duration object in Nanoseconds
+    NanosecondsType ElapsedCpu(void) const { return cpu_ * Nanosecond; }
+
+    /// ElapsedWait returns the wall time of the measured cycles minus their
+    /// CPU time, or zero if the CPU time is larger, as with the process CPU
+    /// time of several threads.
+    ///
+    /// @retval std::chrono::duration object in Nanoseconds
+    NanosecondsType ElapsedWait(void) const {
+        int64_t wait = Clock::ToNanoseconds(wall_).count() - cpu_;
+        return (wait > 0 ? wait : 0) * Nanosecond;
+    }
+
+    /// CpuUtilisation returns the CPU time over the wall time of the
+    /// measured cycles, in percent, or zero without wall time. It exceeds
+    /// 100 when several threads of the process run for CpuScope::Process.
+    ///
+    /// @retval CPU utilisation in percent
+    double CpuUtilisation(void) const {
+        int64_t wall = Clock::ToNanoseconds(wall_).count();
+        return wall <= 0 ? 0 : 100.0 * cpu_ / wall;
+    }
+
+   protected:
+    void Reset_(void) {
+        cpu_ = 0;
+        wall_ = 0;
+        calls_ = 0;
+        start_ = 0;
+        measured_ = false;
+    }
+
+    void Start_(void) {
+        if (enabled_) {
+            start_ = Now_();
+        }
+    }
+
+    void Stop_(int64_t) {
+        if (enabled_) {
+            int64_t cpu = Now_() - start_;
+            cpu_ += cpu > 0 ? cpu : 0;
+            calls_++;
+            measured_ = true;
+        }
+    }
+
+    void Add_(int64_t x, size_t) {
+        // Only the durations of the cycles measured by Stop_ count
+        if (measured_) {
+            wall_ += x;
+            measured_ = false;
+        }
+    }
+
+    void Merge_(const CpuTime& s, size_t, size_t) {
+        cpu_ += s.cpu_;
+        wall_ += s.wall_;
+        calls_ += s.calls_;
+    }
+
+    void ReportHeader_(FormatBuffer& out) const {
+        if (enabled_) {
+            out.Column("CPU", 20).Column("Wait", 20).Column("CPU %", 10);
+        }
+    }
+
+    void Report_(FormatBuffer& out) const {
+        if (!enabled_) {
+            return;
+        }
+        out.Column(ElapsedCpu(), 20).Column(ElapsedWait(), 20);
+        char digits[21];
+        size_t start = out.Size();
+        out.Append(digits,
+                   internal::DecimalTo(
+                       digits, (uint64_t)(CpuUtilisation() * 10 + 0.5), 1))
+            .Pad(start, 10);
+    }
+
+    void Export_(TimerFields& fields) const {
+        if (enabled_) {
+            fields.Add("cpu_ns", ElapsedCpu().count(), true);
+            fields.Add("wait_ns", ElapsedWait().count(), true);
+        }
+    }
+
+   private:
+    /// Now_ reads the CPU time clock of the scope, in nanoseconds.
+    int64_t Now_(void) const {
+#ifdef TIMEY_HAS_CPU_CLOCKS
+        return scope_ == CpuScope::Thread ? ThreadCpuClock::Now()
+                                          : ProcessCpuClock::Now();
+#else
+        return 0;
+#endif
+    }
+
+    /// enabled_ is true if the CPU time is read.
+    bool enabled_;
+    /// scope_ is the CPU time that is read.
+    CpuScope scope_;
+    /// measured_ is true between Stop_ and Add_ of a measured cycle.
+    bool measured_;
+    /// cpu_ is the total CPU time of the measured cycles, in nanoseconds.
+    int64_t cpu_;
+    /// wall_ is the total wall time of the measured cycles, in clock ticks.
+    int64_t wall_;
+    /// calls_ is the number of measured cycles.
+    uint64_t calls_;
+    /// start_ is the CPU time read by the latest Start, in nanoseconds.
+    int64_t start_;
+};
+}
+}
@@ -0,0 +1,362 @@
+/// @file export.hpp
+///
+/// Exporters writing the statistics of timers as JSON lines, CSV and
+/// OpenMetrics text, for tools and dashboards to read
+///
+#pragma once
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "utils.hpp"
+#include "timer.hpp"
+#include "timerset.hpp"
+#include "snapshot.hpp"
+
+namespace timey {
+namespace internal {
+/// SingleTimer presents one timer as a set of timers, for the exporters.
+template <class TimerType>
+class SingleTimer {
+   public:
+    explicit SingleTimer(const TimerType& t) : timer_(t) {}
+
+    template <class Fn>
+    void ForEach(Fn fn) const {
+        fn(timer_);
+    }
+
+   private:
+    const TimerType& timer_;
+};
+
+/// SnapshotList presents snapshots, as returned by TimerSet::Snapshot, as a
+/// set of timers, for the exporters.
+class SnapshotList {
+   public:
+    explicit SnapshotList(const std::vector<TimerSnapshot>& s)
+        : snapshots_(s) {}
+
+    template <class Fn>
+    void ForEach(Fn fn) const {
+        for (auto& s : snapshots_) {
+            fn(s);
+        }
+    }
+
+   private:
+    const std::vector<TimerSnapshot>& snapshots_;
+};
+
+/// Exported returns the object the exporters iterate over for 'timers': the
+/// timer set itself, or an adapter for a single timer or for snapshots.
+template <class TimerSetType>
+const TimerSetType& Exported(const TimerSetType& timers) {
+    return timers;
+}
+
+template <class Clock, class Accumulator, class Stats>
+SingleTimer<BasicTimer<Clock, Accumulator, Stats>> Exported(
+    const BasicTimer<Clock, Accumulator, Stats>& t) {
+    return SingleTimer<BasicTimer<Clock, Accumulator, Stats>>(t);
+}
+
+inline NullTimerSet Exported(const NullTimer&) { return NullTimerSet(); }
+
+inline SnapshotList Exported(const std::vector<TimerSnapshot>& snapshots) {
+    return SnapshotList(snapshots);
+}
+
+/// AppendEscaped appends 's' to 'out' with the characters '"', '\' and
+/// newline escaped by a backslash, as JSON strings and OpenMetrics label
+/// values require. Other control characters are escaped as JSON \\u
+/// sequences if 'json' is true.
+inline void AppendEscaped(FormatBuffer& out, const std::string& s,
+                          bool json) {
+    static const char hex[] = "0123456789abcdef";
+    for (char c : s) {
+        switch (c) {
+            case '"':
+            case '\\':
+                out.Append('\\').Append(c);
+                break;
+            case '\n':
+                out.Append("\\n", 2);
+                break;
+            default:
+                if (json && (unsigned char)c < 0x20) {
+                    out.Append("\\u00", 4)
+                        .Append(hex[(c >> 4) & 0xf])
+                        .Append(hex[c & 0xf]);
+                } else {
+                    out.Append(c);
+                }
+        }
+    }
+}
+
+/// AppendCsvField appends 's' to 'out' as a CSV field, quoted if it holds a
+/// comma, a quote or a line break.
+inline void AppendCsvField(FormatBuffer& out, const std::string& s) {
+    if (s.find_first_of(",\"\r\n") == std::string::npos) {
+        out.Append(s);
+        return;
+    }
+    out.Append('"');
+    for (char c : s) {
+        if (c == '"') {
+            out.Append('"');
+        }
+        out.Append(c);
+    }
+    out.Append('"');
+}
+
+/// Flush writes 'out' to 'stream' and empties it once it holds
+/// ReportFlushSize characters or more.
+inline void Flush(std::ostream& stream, FormatBuffer& out) {
+    if (out.Size() >= ReportFlushSize) {
+        stream << out;
+        out.Clear();
+    }
+}
+
+/// CollectFields adds the fields of each timer to 'all' if it has no field
+/// of that name yet, so that 'all' ends up with the fields of every timer.
+struct CollectFields {
+    template <class TimerType>
+    void operator()(const TimerType& t) {
+        fields->Clear();
+        t.Export(*fields);
+        for (size_t i = 0; i < fields->Size(); i++) {
+            if (all->Find(fields->Name(i)) == all->Size()) {
+                all->Add(fields->Name(i), 0, fields->Counter(i));
+            }
+        }
+    }
+
+    TimerFields* fields;
+    TimerFields* all;
+};
+
+/// JsonLine writes a timer as a JSON object on a line.
+struct JsonLine {
+    template <class TimerType>
+    void operator()(const TimerType& t) {
+        fields->Clear();
+        t.Export(*fields);
+        out->Append("{\"name\":\"", 9);
+        AppendEscaped(*out, t.Name(), true);
+        out->Append('"');
+        for (size_t i = 0; i < fields->Size(); i++) {
+            out->Append(",\"", 2)
+                .Append(fields->Name(i), std::strlen(fields->Name(i)))
+                .Append("\":", 2)
+                .AppendSigned(fields->Value(i));
+        }
+        out->Append("}\n", 2);
+        Flush(*stream, *out);
+    }
+
+    std::ostream* stream;
+    FormatBuffer* out;
+    TimerFields* fields;
+};
+
+/// CsvRow writes a timer as a CSV record with the columns of 'columns',
+/// leaving the fields the timer does not have empty.
+struct CsvRow {
+    template <class TimerType>
+    void operator()(const TimerType& t) {
+        fields->Clear();
+        t.Export(*fields);
+        AppendCsvField(*out, t.Name());
+        for (size_t i = 0; i < columns->Size(); i++) {
+            out->Append(',');
+            size_t j = fields->Find(columns->Name(i));
+            if (j < fields->Size()) {
+                out->AppendSigned(fields->Value(j));
+            }
+        }
+        out->Append('\n');
+        Flush(*stream, *out);
+    }
+
+    std::ostream* stream;
+    FormatBuffer* out;
+    TimerFields* fields;
+    const TimerFields* columns;
+};
+
+/// MetricSamples writes the sample of metric 'metric' of each timer that has
+/// the field 'field'.
+struct MetricSamples {
+    template <class TimerType>
+    void operator()(const TimerType& t) {
+        fields->Clear();
+        t.Export(*fields);
+        size_t i = fields->Find(field);
+        if (i == fields->Size()) {
+            return;
+        }
+        out->Append(*metric);
+        if (counter) {
+            out->Append("_total", 6);
+        }
+        out->Append("{timer=\"", 8);
+        AppendEscaped(*out, t.Name(), false);
+        out->Append("\"} ", 3).AppendSigned(fields->Value(i)).Append('\n');
+        Flush(*stream, *out);
+    }
+
+    std::ostream* stream;
+    FormatBuffer* out;
+    TimerFields* fields;
+    const char* field;
+    const std::string* metric;
+    bool counter;
+};
+
+/// MetricName returns the OpenMetrics name of field 'field' of the timers:
+/// 'prefix', an underscore and the field name, with the "_ns" suffix of
+/// durations spelled out as "_nanoseconds".
+inline std::string MetricName(const std::string& prefix, const char* field) {
+    std::string name = prefix + "_" + field;
+    if (name.size() > 3 && name.compare(name.size() - 3, 3, "_ns") == 0) {
+        name.replace(name.size() - 3, 3, "_nanoseconds");
+    }
+    return name;
+}
+}
+
+/// WriteJsonLines writes the statistics of each timer in 'timers' to 'out'
+/// as a JSON object on a line, with the integer fields of Timer::Export:
+/// @code
+///     {"name":"solve","count":10,"total_ns":52000,"mean_ns":5200,...}
+/// @endcode
+///
+/// 'timers' is a timer, a TimerSet, StaticTimerSet or ConcurrentTimerSet,
+/// or the snapshots of a TimerSet. Timers are formatted one at a time into
+/// a buffer written every 64KB, so large sets are not held in memory.
+///
+/// @param [in] out Output Stream
+/// @param [in] timers Timers to export
+template <class TimerSetType>
+void WriteJsonLines(std::ostream& out, const TimerSetType& timers) {
+    FormatBuffer buffer;
+    TimerFields fields;
+    internal::JsonLine line = {&out, &buffer, &fields};
+    internal::Exported(timers).ForEach(line);
+    out << buffer;
+}
+
+/// WriteCsv writes the statistics of each timer in 'timers' to 'out' as
+/// CSV, with a header line naming the columns: the timer name and the
+/// integer fields of Timer::Export. A timer without a field that other
+/// timers have, such as percentiles when its histogram is disabled, leaves
+/// it empty. See WriteJsonLines for the accepted timers.
+///
+/// @param [in] out Output Stream
+/// @param [in] timers Timers to export
+template <class TimerSetType>
+void WriteCsv(std::ostream& out, const TimerSetType& timers) {
+    FormatBuffer buffer;
+    TimerFields fields;
+    TimerFields columns;
+    internal::CollectFields collect = {&fields, &columns};
+    internal::Exported(timers).ForEach(collect);
+
+    buffer.Append("name", 4);
+    for (size_t i = 0; i < columns.Size(); i++) {
+        buffer.Append(',').Append(columns.Name(i),
+                                  std::strlen(columns.Name(i)));
+    }
+    buffer.Append('\n');
+    internal::CsvRow row = {&out, &buffer, &fields, &columns};
+    internal::Exported(timers).ForEach(row);
+    out << buffer;
+}
+
+/// WriteOpenMetrics writes the statistics of the timers in 'timers' to
+/// 'out' in the OpenMetrics text format, which Prometheus scrapes. Each
+/// field of Timer::Export is a metric family named 'prefix' and the field,
+/// with one sample per timer labelled with its name:
+/// @code
+///     # TYPE timey_timer_count counter
+///     timey_timer_count_total{timer="solve"} 10
+///     # TYPE timey_timer_mean_nanoseconds gauge
+///     # UNIT timey_timer_mean_nanoseconds nanoseconds
+///     timey_timer_mean_nanoseconds{timer="solve"} 5200
+///     ...
+///     # EOF
+/// @endcode
+///
+/// The timers are iterated once per metric family, so a ConcurrentTimerSet
+/// is aggregated several times. See WriteJsonLines for the accepted timers.
+///
+/// @param [in] out Output Stream
+/// @param [in] timers Timers to export
+/// @param [in] prefix Prefix of the metric names
+template <class TimerSetType>
+void WriteOpenMetrics(std::ostream& out, const TimerSetType& timers,
+                      const std::string& prefix = "timey_timer") {
+    FormatBuffer buffer;
+    TimerFields fields;
+    TimerFields families;
+    internal::CollectFields collect = {&fields, &families};
+    internal::Exported(timers).ForEach(collect);
+
+    for (size_t i = 0; i < families.Size(); i++) {
+        std::string metric = internal::MetricName(prefix, families.Name(i));
+        bool counter = families.Counter(i);
+        buffer.Append("# TYPE ", 7)
+            .Append(metric)
+            .Append(counter ? " counter\n" : " gauge\n");
+        if (metric.size() > 12 &&
+            metric.compare(metric.size() - 12, 12, "_nanoseconds") == 0) {
+            buffer.Append("# UNIT ", 7)
+                .Append(metric)
+                .Append(" nanoseconds\n", 13);
+        }
+        internal::MetricSamples samples = {
+            &out, &buffer, &fields, families.Name(i), &metric, counter};
+        internal::Exported(timers).ForEach(samples);
+    }
+    buffer.Append("# EOF\n", 6);
+    out << buffer;
+}
+
+/// WriteOpenMetricsFile writes the statistics of the timers in 'timers' to
+/// the file 'path' in the OpenMetrics text format, see WriteOpenMetrics. The
+/// file is written under a temporary name and renamed, so that a collector
+/// reading it, such as the textfile collector of the Prometheus node
+/// exporter, never sees a partial file.
+///
+/// @param [in] path Path of the file
+/// @param [in] timers Timers to export
+/// @param [in] prefix Prefix of the metric names
+/// @throw std::runtime_error if the file cannot be written
+template <class TimerSetType>
+void WriteOpenMetricsFile(const std::string& path, const TimerSetType& timers,
+                          const std::string& prefix = "timey_timer") {
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream out(temporary.c_str());
+        if (!out) {
+            throw internal::SystemError("Cannot create '" + temporary + "'");
+        }
+        WriteOpenMetrics(out, timers, prefix);
+        out.close();
+        if (!out) {
+            throw std::runtime_error("Cannot write '" + temporary + "'");
+        }
+    }
+    if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+        throw internal::SystemError("Cannot rename '" + temporary + "'");
+    }
+}
+}
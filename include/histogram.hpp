@@ -0,0 +1,262 @@
+/// @file histogram.hpp
+///
+/// Histogram class, a fixed memory log-linear histogram of timer samples
+///
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+namespace timey {
+/// Histogram class is a log-linear histogram of non-negative samples, in the
+/// spirit of HdrHistogram.
+///
+/// Values are counted in buckets whose width grows with the value, so that
+/// any recorded value can be recovered with the given number of significant
+/// decimal digits. The memory used is fixed at construction and does not grow
+/// with the number of samples. Values above the highest trackable value are
+/// counted as the highest trackable value.
+///
+/// Recording is O(1): the bucket is found from the position of the highest
+/// set bit of the value.
+///
+/// Example:
+/// @code
+///     Histogram h(3, 3600000000000);  // 3 digits, up to one hour in ns
+///     h.Record(sample);
+///     std::cout << h.ValueAtPercentile(99.9) << std::endl;
+/// @endcode
+class Histogram {
+   public:
+    /// DefaultHighestTrackableValue is the default highest trackable value,
+    /// 2^44 ticks, which is about 4.9 hours in nanoseconds.
+    static constexpr int64_t DefaultHighestTrackableValue = (int64_t)1 << 44;
+
+    /// Constructs a disabled histogram, which records nothing.
+    Histogram()
+        : significantDigits_(0),
+          highestTrackableValue_(0),
+          subBucketHalfCountMagnitude_(0),
+          subBucketHalfCount_(0),
+          subBucketMask_(0),
+          totalCount_(0),
+          min_(0),
+          max_(0) {}
+
+    /// Constructs an empty histogram.
+    ///
+    /// @throw std::invalid_argument if significant_digits is not between 1
+    /// and 5, or highest_trackable_value is less than 2
+    ///
+    /// @param [in] significant_digits Number of significant decimal digits
+    /// @param [in] highest_trackable_value Highest value tracked precisely
+    explicit Histogram(
+        int significant_digits,
+        int64_t highest_trackable_value = DefaultHighestTrackableValue)
+        : significantDigits_(significant_digits),
+          highestTrackableValue_(highest_trackable_value),
+          totalCount_(0),
+          min_(0),
+          max_(0) {
+        if (significant_digits < 1 || significant_digits > 5) {
+            throw std::invalid_argument(
+                "Histogram significant digits must be between 1 and 5");
+        }
+        if (highest_trackable_value < 2) {
+            throw std::invalid_argument(
+                "Histogram highest trackable value must be at least 2");
+        }
+        int64_t largest_single_unit_value =
+            2 * (int64_t)std::pow(10, significant_digits);
+        int sub_bucket_count_magnitude =
+            (int)std::ceil(std::log2((double)largest_single_unit_value));
+        subBucketHalfCountMagnitude_ = sub_bucket_count_magnitude - 1;
+        int64_t sub_bucket_count = (int64_t)1 << sub_bucket_count_magnitude;
+        subBucketHalfCount_ = sub_bucket_count / 2;
+        subBucketMask_ = sub_bucket_count - 1;
+
+        int64_t smallest_untrackable_value = sub_bucket_count;
+        size_t buckets = 1;
+        while (smallest_untrackable_value <= highest_trackable_value) {
+            if (smallest_untrackable_value >
+                std::numeric_limits<int64_t>::max() / 2) {
+                buckets++;
+                break;
+            }
+            smallest_untrackable_value <<= 1;
+            buckets++;
+        }
+        counts_.assign((buckets + 1) * subBucketHalfCount_, 0);
+    }
+
+    /// Enabled returns true if the histogram records values.
+    bool Enabled(void) const { return !counts_.empty(); }
+
+    /// SignificantDigits returns the number of significant decimal digits
+    /// the values are recorded with.
+    int SignificantDigits(void) const { return significantDigits_; }
+
+    /// HighestTrackableValue returns the highest value tracked precisely.
+    int64_t HighestTrackableValue(void) const {
+        return highestTrackableValue_;
+    }
+
+    /// MemoryBytes returns the size of the bucket counts in bytes.
+    size_t MemoryBytes(void) const {
+        return counts_.size() * sizeof(uint64_t);
+    }
+
+    /// TotalCount returns the number of recorded values.
+    uint64_t TotalCount(void) const { return totalCount_; }
+
+    /// Min returns the smallest recorded value, or zero if the histogram is
+    /// empty.
+    int64_t Min(void) const { return min_; }
+
+    /// Max returns the largest recorded value, or zero if the histogram is
+    /// empty.
+    int64_t Max(void) const { return max_; }
+
+    /// Clear removes all recorded values, keeping the configuration.
+    void Clear(void) {
+        counts_.assign(counts_.size(), 0);
+        totalCount_ = 0;
+        min_ = 0;
+        max_ = 0;
+    }
+
+    /// Record records a value. Record does nothing if the histogram is
+    /// disabled.
+    ///
+    /// @param [in] value Value to record; negative values are recorded as 0
+    void Record(int64_t value) {
+        if (counts_.empty()) {
+            return;
+        }
+        value = value < 0 ? 0 : value;
+        value = value > highestTrackableValue_ ? highestTrackableValue_ : value;
+        counts_[Index_(value)]++;
+        min_ = (totalCount_ == 0 || value < min_) ? value : min_;
+        max_ = value > max_ ? value : max_;
+        totalCount_++;
+    }
+
+    /// Merge adds the values recorded by another histogram. A disabled
+    /// histogram becomes a copy of 'h'.
+    ///
+    /// @throw std::runtime_error if the histograms have different
+    /// configurations
+    ///
+    /// @param [in] h Histogram to merge
+    void Merge(const Histogram& h) {
+        if (!h.Enabled()) {
+            return;
+        }
+        if (!Enabled()) {
+            *this = h;
+            return;
+        }
+        if (h.significantDigits_ != significantDigits_ ||
+            h.highestTrackableValue_ != highestTrackableValue_) {
+            throw std::runtime_error(
+                "Cannot merge histograms with different configurations");
+        }
+        if (h.totalCount_ == 0) {
+            return;
+        }
+        for (size_t i = 0; i < counts_.size(); i++) {
+            counts_[i] += h.counts_[i];
+        }
+        min_ = (totalCount_ == 0 || h.min_ < min_) ? h.min_ : min_;
+        max_ = h.max_ > max_ ? h.max_ : max_;
+        totalCount_ += h.totalCount_;
+    }
+
+    /// ValueAtPercentile returns the value below or at which 'percentile'
+    /// percent of the recorded values fall, within the precision of the
+    /// histogram.
+    ///
+    /// @param [in] percentile Percentile between 0 and 100
+    /// @retval Value at the percentile, or zero if the histogram is empty
+    int64_t ValueAtPercentile(double percentile) const {
+        if (totalCount_ == 0) {
+            return 0;
+        }
+        if (percentile <= 0) {
+            return min_;
+        }
+        percentile = percentile > 100 ? 100 : percentile;
+        uint64_t count_at_percentile =
+            (uint64_t)(percentile / 100 * totalCount_ + 0.5);
+        count_at_percentile = count_at_percentile > 0 ? count_at_percentile : 1;
+
+        uint64_t total = 0;
+        for (size_t i = 0; i < counts_.size(); i++) {
+            total += counts_[i];
+            if (total >= count_at_percentile) {
+                int64_t value = HighestEquivalentValue_(ValueFromIndex_(i));
+                return value < max_ ? value : max_;
+            }
+        }
+        return max_;
+    }
+
+   private:
+    /// Index_ returns the position of the bucket count of a value.
+    size_t Index_(int64_t value) const {
+        int pow2_ceiling =
+            64 - __builtin_clzll((uint64_t)(value | subBucketMask_));
+        int bucket = pow2_ceiling - (subBucketHalfCountMagnitude_ + 1);
+        int64_t sub_bucket = value >> bucket;
+        return ((size_t)(bucket + 1) << subBucketHalfCountMagnitude_) +
+               (sub_bucket - subBucketHalfCount_);
+    }
+
+    /// ValueFromIndex_ returns the lowest value counted at an index.
+    int64_t ValueFromIndex_(size_t index) const {
+        int bucket = (int)(index >> subBucketHalfCountMagnitude_) - 1;
+        int64_t sub_bucket =
+            (index & (subBucketHalfCount_ - 1)) + subBucketHalfCount_;
+        if (bucket < 0) {
+            sub_bucket -= subBucketHalfCount_;
+            bucket = 0;
+        }
+        return sub_bucket << bucket;
+    }
+
+    /// HighestEquivalentValue_ returns the highest value counted in the same
+    /// bucket as 'value'.
+    int64_t HighestEquivalentValue_(int64_t value) const {
+        int pow2_ceiling =
+            64 - __builtin_clzll((uint64_t)(value | subBucketMask_));
+        int bucket = pow2_ceiling - (subBucketHalfCountMagnitude_ + 1);
+        int64_t sub_bucket = value >> bucket;
+        int64_t lowest = sub_bucket << bucket;
+        return lowest + ((int64_t)1 << bucket) - 1;
+    }
+
+    /// significantDigits_ is the number of significant decimal digits.
+    int significantDigits_;
+    /// highestTrackableValue_ is the highest value tracked precisely.
+    int64_t highestTrackableValue_;
+    /// subBucketHalfCountMagnitude_ is log2 of half the number of sub
+    /// buckets per bucket.
+    int subBucketHalfCountMagnitude_;
+    /// subBucketHalfCount_ is half the number of sub buckets per bucket.
+    int64_t subBucketHalfCount_;
+    /// subBucketMask_ masks the values counted in the first bucket.
+    int64_t subBucketMask_;
+    /// counts_ holds the bucket counts.
+    std::vector<uint64_t> counts_;
+    /// totalCount_ is the number of recorded values.
+    uint64_t totalCount_;
+    /// min_ is the smallest recorded value.
+    int64_t min_;
+    /// max_ is the largest recorded value.
+    int64_t max_;
+};
+}
@@ -0,0 +1,281 @@
+/// @file metricsserver.hpp
+///
+/// MetricsServer class serving OpenMetrics text over HTTP on the loopback
+/// interface, for Prometheus to scrape
+///
+#pragma once
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "utils.hpp"
+
+namespace timey {
+/// MetricsRequestTimeout is how long the MetricsServer gives a connection to
+/// send its request and receive the response.
+constexpr std::chrono::milliseconds MetricsRequestTimeout(1000);
+
+/// MetricsServer class is a minimal HTTP server on 127.0.0.1 answering
+/// "GET /metrics" with the output of a function, typically
+/// WriteOpenMetrics, from a background thread. Requests are served one at a
+/// time; it is meant for a local scraper, not for the network.
+///
+/// The function runs on the server thread, so it must only read timers that
+/// can be read while they run, such as the snapshots of a SnapshotTimerSet
+/// or a ConcurrentTimerSet.
+///
+/// Example:
+/// @code
+///     SnapshotTimerSet ts;
+///     MetricsServer server(
+///         [&ts](std::ostream& out) { WriteOpenMetrics(out, ts.Snapshot()); },
+///         9464);
+/// @endcode
+class MetricsServer {
+   public:
+    /// Writer writes the response body of a scrape to a stream.
+    typedef std::function<void(std::ostream&)> Writer;
+
+    MetricsServer(Writer writer, uint16_t port__ = 0);
+    ~MetricsServer();
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+    // API
+    void Stop(void);
+
+    /// Port returns the port the server listens on, which is chosen by the
+    /// system if the server was constructed with port 0.
+    ///
+    /// @retval Port of the server
+    uint16_t Port(void) const { return port_; }
+
+   private:
+    typedef std::chrono::steady_clock::time_point Deadline;
+
+    void Run_(void);
+    void Serve_(int fd);
+    bool Wait_(int fd, short events, Deadline deadline);
+    bool SendAll_(int fd, const char* data, size_t size, Deadline deadline);
+
+    /// writer_ writes the metrics.
+    Writer writer_;
+    /// listener_ is the listening socket.
+    int listener_;
+    /// wakeup_ is a pipe whose write end stops the server thread.
+    int wakeup_[2];
+    /// port_ is the port of listener_.
+    uint16_t port_;
+    /// server_ accepts and serves the connections.
+    std::thread server_;
+};
+
+/// Constructs a server listening on 127.0.0.1:'port__' and starts its
+/// thread.
+///
+/// @param [in] writer Function writing the metrics to a stream
+/// @param [in] port__ Port to listen on, or 0 for any free port
+/// @throw std::runtime_error if the port cannot be bound
+inline MetricsServer::MetricsServer(Writer writer, uint16_t port__)
+    : writer_(writer), listener_(-1), port_(port__) {
+    listener_ = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (listener_ < 0) {
+        throw internal::SystemError("Cannot create socket");
+    }
+    int one = 1;
+    ::setsockopt(listener_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(port__);
+    socklen_t length = sizeof(address);
+    if (::bind(listener_, (sockaddr*)&address, sizeof(address)) != 0 ||
+        ::listen(listener_, 16) != 0 ||
+        ::getsockname(listener_, (sockaddr*)&address, &length) != 0) {
+        std::runtime_error e = internal::SystemError(
+            "Cannot listen on port " + std::to_string(port__));
+        ::close(listener_);
+        throw e;
+    }
+    port_ = ntohs(address.sin_port);
+
+    if (::pipe(wakeup_) != 0) {
+        std::runtime_error e = internal::SystemError("Cannot create pipe");
+        ::close(listener_);
+        throw e;
+    }
+    server_ = std::thread(&MetricsServer::Run_, this);
+}
+
+inline MetricsServer::~MetricsServer() { Stop(); }
+
+/// Stop stops the server thread and closes the socket. Stop is called by
+/// the destructor.
+inline void MetricsServer::Stop(void) {
+    if (!server_.joinable()) {
+        return;
+    }
+    char c = 0;
+    while (::write(wakeup_[1], &c, 1) < 0 && errno == EINTR) {
+    }
+    server_.join();
+    ::close(listener_);
+    ::close(wakeup_[0]);
+    ::close(wakeup_[1]);
+}
+
+/// Run_ is the server thread: it serves connections until Stop.
+/// Run_ is a private function and should not be used by end users.
+inline void MetricsServer::Run_(void) {
+    pollfd fds[2] = {{listener_, POLLIN, 0}, {wakeup_[0], POLLIN, 0}};
+    for (;;) {
+        if (::poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        if (fds[1].revents != 0) {
+            return;
+        }
+        if (fds[0].revents & POLLIN) {
+            int fd = ::accept(listener_, nullptr, nullptr);
+            if (fd >= 0) {
+                Serve_(fd);
+                ::close(fd);
+            }
+        }
+    }
+}
+
+/// Wait_ waits until socket 'fd' is ready for 'events', the deadline
+/// passes or Stop is called.
+/// Wait_ is a private function and should not be used by end users.
+///
+/// @param [in] fd Socket to wait for
+/// @param [in] events POLLIN or POLLOUT
+/// @param [in] deadline Time after which the connection is dropped
+/// @retval TRUE If the socket is ready
+/// @retval FALSE If the deadline passed, the server is stopping or the
+///               connection failed
+inline bool MetricsServer::Wait_(int fd, short events, Deadline deadline) {
+    pollfd fds[2] = {{fd, events, 0}, {wakeup_[0], POLLIN, 0}};
+    for (;;) {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now());
+        if (left.count() <= 0) {
+            return false;
+        }
+        int n = ::poll(fds, 2, (int)left.count());
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        return n > 0 && fds[1].revents == 0 && fds[0].revents != 0;
+    }
+}
+
+/// SendAll_ writes the 'size' characters of 'data' to socket 'fd' before
+/// the deadline.
+/// SendAll_ is a private function and should not be used by end users.
+///
+/// @retval TRUE If every character was sent
+/// @retval FALSE If the connection failed, the deadline passed or the
+///               server is stopping
+inline bool MetricsServer::SendAll_(int fd, const char* data, size_t size,
+                                    Deadline deadline) {
+    while (size > 0) {
+        if (!Wait_(fd, POLLOUT, deadline)) {
+            return false;
+        }
+        ssize_t n = ::send(fd, data, size, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK ||
+                      errno == EINTR)) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        data += n;
+        size -= (size_t)n;
+    }
+    return true;
+}
+
+/// Serve_ reads an HTTP request from 'fd' and writes the response.
+/// Connections that do not complete the exchange within
+/// MetricsRequestTimeout are dropped, however slowly the client sends or
+/// reads, and Stop does not wait for them.
+/// Serve_ is a private function and should not be used by end users.
+inline void MetricsServer::Serve_(int fd) {
+    Deadline deadline =
+        std::chrono::steady_clock::now() + MetricsRequestTimeout;
+    std::string request;
+    char data[1024];
+    while (request.find("\r\n\r\n") == std::string::npos &&
+           request.find("\n\n") == std::string::npos &&
+           request.size() < 8192) {
+        if (!Wait_(fd, POLLIN, deadline)) {
+            return;
+        }
+        ssize_t n = ::recv(fd, data, sizeof(data), MSG_DONTWAIT);
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK ||
+                      errno == EINTR)) {
+            continue;
+        }
+        if (n <= 0) {
+            return;
+        }
+        request.append(data, (size_t)n);
+    }
+
+    std::string status = "200 OK";
+    std::string type =
+        "application/openmetrics-text; version=1.0.0; charset=utf-8";
+    std::ostringstream body;
+    if (request.compare(0, 4, "GET ") != 0) {
+        status = "405 Method Not Allowed";
+    } else if (request.compare(4, 9, "/metrics ") != 0 &&
+               request.compare(4, 9, "/metrics?") != 0) {
+        status = "404 Not Found";
+    }
+    if (status[0] == '2') {
+        try {
+            writer_(body);
+        } catch (const std::exception& e) {
+            status = "500 Internal Server Error";
+            body.str("");
+            body << e.what() << "\n";
+            type = "text/plain; charset=utf-8";
+        }
+    } else {
+        type = "text/plain; charset=utf-8";
+        body << status << "\n";
+    }
+
+    std::string content = body.str();
+    std::string header = "HTTP/1.1 " + status +
+                         "\r\nContent-Type: " + type +
+                         "\r\nContent-Length: " +
+                         std::to_string(content.size()) +
+                         "\r\nConnection: close\r\n\r\n";
+    if (SendAll_(fd, header.data(), header.size(), deadline)) {
+        SendAll_(fd, content.data(), content.size(), deadline);
+    }
+}
+}
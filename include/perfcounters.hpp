@@ -0,0 +1,384 @@
+/// @file perfcounters.hpp
+///
+/// PerfGroup reading hardware performance counters with perf_event_open, and
+/// the Counters statistics policy reading them around each start-stop cycle
+///
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include "utils.hpp"
+#include "clock.hpp"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define TIMEY_HAS_PERF 1
+#endif
+
+namespace timey {
+/// PerfEvent is a perf event type and config, as in perf_event_attr.
+struct PerfEvent {
+    uint32_t type;
+    uint64_t config;
+};
+
+/// PerfCounts holds the counts of the events of a PerfGroup: by default
+/// cycles, instructions, last level cache misses and branch misses.
+struct PerfCounts {
+    /// Size is the maximum number of events of a PerfGroup.
+    static constexpr size_t Size = 4;
+
+    PerfCounts() : values() {}
+
+    /// Cycles returns the count of the first event, the CPU cycles.
+    uint64_t Cycles(void) const { return values[0]; }
+
+    /// Instructions returns the count of the second event, the retired
+    /// instructions.
+    uint64_t Instructions(void) const { return values[1]; }
+
+    /// CacheMisses returns the count of the third event, the last level
+    /// cache misses.
+    uint64_t CacheMisses(void) const { return values[2]; }
+
+    /// BranchMisses returns the count of the fourth event, the mispredicted
+    /// branches.
+    uint64_t BranchMisses(void) const { return values[3]; }
+
+    /// Ipc returns the instructions per cycle, or zero without cycles.
+    double Ipc(void) const {
+        return values[0] == 0 ? 0 : (double)values[1] / values[0];
+    }
+
+    uint64_t values[Size];
+};
+
+/// HardwareEvents returns the events of the default PerfGroup: cycles,
+/// instructions, last level cache misses and branch misses.
+inline const PerfEvent* HardwareEvents(void) {
+#ifdef TIMEY_HAS_PERF
+    static const PerfEvent events[PerfCounts::Size] = {
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES}};
+#else
+    static const PerfEvent events[PerfCounts::Size] = {};
+#endif
+    return events;
+}
+
+/// PerfGroup is a group of up to four perf events counting the user space
+/// work of the calling thread, scheduled on the PMU together so that their
+/// counts cover the same time.
+///
+/// Read uses the rdpmc instruction on the pages the kernel maps for each
+/// event when it allows it, which costs tens of cycles, and a read system
+/// call on the group otherwise. If the kernel forbids perf events, as in
+/// many containers, or the CPU lacks an event, the group is not Valid and
+/// Read returns zeros.
+///
+/// A PerfGroup must be read by the thread that created it.
+class PerfGroup {
+   public:
+    /// Constructs a group counting 'n' events of 'events' for the calling
+    /// thread.
+    ///
+    /// @param [in] events Events to count
+    /// @param [in] n Number of events, at most PerfCounts::Size
+    explicit PerfGroup(const PerfEvent* events = HardwareEvents(),
+                       size_t n = PerfCounts::Size)
+        : size_(0), rdpmc_(false) {
+        for (size_t i = 0; i < PerfCounts::Size; i++) {
+            fds_[i] = -1;
+            pages_[i] = nullptr;
+        }
+        Open_(events, n > PerfCounts::Size ? (size_t)PerfCounts::Size : n);
+    }
+    ~PerfGroup() { Close_(); }
+    PerfGroup(const PerfGroup&) = delete;
+    PerfGroup& operator=(const PerfGroup&) = delete;
+
+    /// Valid returns true if every event of the group could be opened.
+    bool Valid(void) const { return size_ != 0; }
+
+    /// Rdpmc returns true if Read uses rdpmc rather than a system call.
+    bool Rdpmc(void) const { return rdpmc_; }
+
+    /// Read returns the current counts of the events, or zeros if the group
+    /// is not Valid.
+    ///
+    /// @retval Counts of the events
+    PerfCounts Read(void) const {
+        PerfCounts counts;
+#ifdef TIMEY_HAS_PERF
+        if (rdpmc_) {
+            for (size_t i = 0; i < size_; i++) {
+                if (!ReadRdpmc_(pages_[i], counts.values[i])) {
+                    return ReadGroup_();
+                }
+            }
+            return counts;
+        }
+        if (size_ != 0) {
+            return ReadGroup_();
+        }
+#endif
+        return counts;
+    }
+
+   private:
+#ifdef TIMEY_HAS_PERF
+    void Open_(const PerfEvent* events, size_t n) {
+        size_t page = (size_t)sysconf(_SC_PAGESIZE);
+        bool rdpmc = true;
+        for (size_t i = 0; i < n; i++) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = events[i].type;
+            attr.config = events[i].config;
+            attr.read_format = PERF_FORMAT_GROUP;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            fds_[i] = (int)syscall(__NR_perf_event_open, &attr, 0, -1,
+                                   i == 0 ? -1 : fds_[0], 0);
+            if (fds_[i] < 0) {
+                Close_();
+                return;
+            }
+            void* p = mmap(nullptr, page, PROT_READ, MAP_SHARED, fds_[i], 0);
+            pages_[i] = p == MAP_FAILED ? nullptr : p;
+            rdpmc = rdpmc && pages_[i] != nullptr &&
+                    static_cast<perf_event_mmap_page*>(pages_[i])
+                        ->cap_user_rdpmc;
+        }
+        size_ = n;
+#ifdef TIMEY_HAS_TSC
+        rdpmc_ = rdpmc;
+#else
+        (void)rdpmc;
+#endif
+    }
+
+    void Close_(void) {
+        size_t page = (size_t)sysconf(_SC_PAGESIZE);
+        for (size_t i = 0; i < PerfCounts::Size; i++) {
+            if (pages_[i] != nullptr) {
+                munmap(pages_[i], page);
+                pages_[i] = nullptr;
+            }
+            if (fds_[i] >= 0) {
+                close(fds_[i]);
+                fds_[i] = -1;
+            }
+        }
+        size_ = 0;
+        rdpmc_ = false;
+    }
+
+    /// ReadRdpmc_ reads the count of the event of 'page' with rdpmc, under
+    /// the sequence lock of the page. It returns false if the event is not
+    /// scheduled on a counter at the moment.
+    static bool ReadRdpmc_(void* page, uint64_t& value) {
+#ifdef TIMEY_HAS_TSC
+        volatile perf_event_mmap_page* pc =
+            static_cast<volatile perf_event_mmap_page*>(page);
+        uint32_t sequence;
+        do {
+            sequence = pc->lock;
+            __asm__ __volatile__("" ::: "memory");
+            uint32_t index = pc->index;
+            int64_t offset = pc->offset;
+            if (!pc->cap_user_rdpmc || index == 0) {
+                return false;
+            }
+            // The counter is 'width' bits wide and sign extended
+            unsigned shift = 64 - pc->pmc_width;
+            uint64_t raw = (uint64_t)__rdpmc((int)index - 1);
+            int64_t count = (int64_t)(raw << shift) >> shift;
+            value = (uint64_t)(offset + count);
+            __asm__ __volatile__("" ::: "memory");
+        } while (pc->lock != sequence);
+        return true;
+#else
+        (void)page;
+        (void)value;
+        return false;
+#endif
+    }
+
+    /// ReadGroup_ reads the counts of every event with one read system call
+    /// on the group leader.
+    PerfCounts ReadGroup_(void) const {
+        PerfCounts counts;
+        uint64_t buffer[1 + PerfCounts::Size];
+        ssize_t n = read(fds_[0], buffer, sizeof(buffer));
+        if (n >= (ssize_t)sizeof(uint64_t)) {
+            for (size_t i = 0; i < buffer[0] && i < size_; i++) {
+                counts.values[i] = buffer[1 + i];
+            }
+        }
+        return counts;
+    }
+#else
+    void Open_(const PerfEvent*, size_t) {}
+    void Close_(void) {}
+    PerfCounts ReadGroup_(void) const { return PerfCounts(); }
+#endif
+
+    /// size_ is the number of events, or zero if the group is not valid.
+    size_t size_;
+    /// rdpmc_ is true if every event can be read with rdpmc.
+    bool rdpmc_;
+    /// fds_ holds the file descriptors of the events, the leader first.
+    int fds_[PerfCounts::Size];
+    /// pages_ holds the mapped pages of the events, or null.
+    void* pages_[PerfCounts::Size];
+};
+
+/// ThreadPerfGroup returns the hardware counter group of the calling
+/// thread, opened on first use. Timers counting on a thread share its
+/// group.
+///
+/// @retval PerfGroup of the calling thread
+inline const PerfGroup& ThreadPerfGroup(void) {
+    static thread_local PerfGroup group;
+    return group;
+}
+
+namespace stats {
+/// Counters is a statistics policy optionally reading the hardware
+/// performance counters of ThreadPerfGroup around each timed start-stop
+/// cycle, and reporting the instructions per cycle and the last level
+/// cache and branch misses per call. See EnableCounters.
+///
+/// The counts cover the user space work of the thread between Start and
+/// Stop, including one clock read; the wall time excludes the counter
+/// reads. A timer with counters must be started and stopped on the same
+/// thread.
+///
+/// Example:
+/// @code
+///     BasicTimer<SteadyClock, DefaultMoments, stats::Pack<stats::Counters>>
+///         t("solve");
+///     if (!t.EnableCounters()) {
+///         std::cerr << "No performance counters, timing only" << std::endl;
+///     }
+/// @endcode
+template <class Clock>
+class Counters {
+   public:
+    Counters() : enabled_(false), calls_(0) {}
+
+    /// EnableCounters makes the timer read the hardware counters of the
+    /// thread at each Start and Stop, if perf events are available. The
+    /// timer keeps timing only otherwise. Previously recorded cycles are
+    /// not counted.
+    ///
+    /// @param [in] enable Whether to read the counters
+    /// @retval TRUE If the counters are read
+    /// @retval FALSE If they are disabled or not available
+    bool EnableCounters(bool enable = true) {
+        enabled_ = enable && ThreadPerfGroup().Valid();
+        return enabled_;
+    }
+
+    /// HasCounters returns true if the timer reads the hardware counters.
+    bool HasCounters(void) const { return enabled_; }
+
+    /// Counts returns the total counts over the counted start-stop cycles.
+    const PerfCounts& Counts(void) const { return total_; }
+
+    /// CountedCalls returns the number of start-stop cycles counted.
+    uint64_t CountedCalls(void) const { return calls_; }
+
+   protected:
+    void Reset_(void) {
+        total_ = PerfCounts();
+        calls_ = 0;
+    }
+
+    void Start_(void) {
+        if (enabled_) {
+            start_ = ThreadPerfGroup().Read();
+        }
+    }
+
+    void Stop_(int64_t) {
+        if (!enabled_) {
+            return;
+        }
+        PerfCounts stop = ThreadPerfGroup().Read();
+        for (size_t i = 0; i < PerfCounts::Size; i++) {
+            total_.values[i] += stop.values[i] - start_.values[i];
+        }
+        calls_++;
+    }
+
+    void Add_(int64_t, size_t) {}
+
+    void Merge_(const Counters& s, size_t, size_t) {
+        for (size_t i = 0; i < PerfCounts::Size; i++) {
+            total_.values[i] += s.total_.values[i];
+        }
+        calls_ += s.calls_;
+    }
+
+    void ReportHeader_(FormatBuffer& out) const {
+        if (enabled_) {
+            out.Column("IPC", 10).Column("LLC Miss/Call", 15).Column(
+                "Br Miss/Call", 15);
+        }
+    }
+
+    void Report_(FormatBuffer& out) const {
+        if (!enabled_) {
+            return;
+        }
+        Decimal_(out, total_.Ipc(), 10);
+        Decimal_(out, PerCall_(total_.CacheMisses()), 15);
+        Decimal_(out, PerCall_(total_.BranchMisses()), 15);
+    }
+
+    void Export_(TimerFields& fields) const {
+        if (!enabled_) {
+            return;
+        }
+        fields.Add("cycles", (int64_t)total_.Cycles(), true);
+        fields.Add("instructions", (int64_t)total_.Instructions(), true);
+        fields.Add("llc_misses", (int64_t)total_.CacheMisses(), true);
+        fields.Add("branch_misses", (int64_t)total_.BranchMisses(), true);
+    }
+
+   private:
+    double PerCall_(uint64_t value) const {
+        return calls_ == 0 ? 0 : (double)value / calls_;
+    }
+
+    /// Decimal_ appends 'x' with two decimals in a column of 'width'.
+    static void Decimal_(FormatBuffer& out, double x, size_t width) {
+        char digits[21];
+        size_t start = out.Size();
+        out.Append(digits, internal::DecimalTo(
+                               digits, (uint64_t)(x * 100 + 0.5), 2))
+            .Pad(start, width);
+    }
+
+    /// enabled_ is true if the counters are read.
+    bool enabled_;
+    /// calls_ is the number of counted start-stop cycles.
+    uint64_t calls_;
+    /// start_ holds the counts read by the latest Start.
+    PerfCounts start_;
+    /// total_ holds the counts summed over the counted cycles.
+    PerfCounts total_;
+};
+}
+}
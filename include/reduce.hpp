@@ -0,0 +1,87 @@
+/// @file reduce.hpp
+///
+/// Parallel tree reduction of timers
+///
+#pragma once
+
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace timey {
+namespace internal {
+/// MergeLevel merges element i + stride into element i for every i that is
+/// a multiple of 2 * stride, using up to 'threads' threads.
+///
+/// @param [in,out] items Partially reduced items
+/// @param [in] stride Distance between merged items
+/// @param [in] threads Maximum number of threads
+template <class T>
+void MergeLevel(std::vector<T>& items, size_t stride, size_t threads) {
+    size_t pairs = (items.size() - stride + 2 * stride - 1) / (2 * stride);
+    auto merge = [&items, stride, pairs](size_t first, size_t last) {
+        for (size_t p = first; p < last && p < pairs; p++) {
+            size_t i = p * 2 * stride;
+            items[i].Merge(items[i + stride]);
+        }
+    };
+
+    // Spawning threads is only worth it for large levels
+    const size_t min_pairs_per_thread = 64;
+    threads = std::min(threads, pairs / min_pairs_per_thread);
+    if (threads <= 1) {
+        merge(0, pairs);
+        return;
+    }
+
+    size_t chunk = (pairs + threads - 1) / threads;
+    std::vector<std::thread> workers;
+    for (size_t t = 1; t < threads; t++) {
+        workers.emplace_back(merge, t * chunk, (t + 1) * chunk);
+    }
+    merge(0, chunk);
+    for (auto& w : workers) {
+        w.join();
+    }
+}
+}
+
+/// Reduce merges a range of timers, or of TimerSets, into one by pairwise
+/// tree reduction. Each level of the tree is merged in parallel on up to
+/// 'threads' threads, so the depth of the reduction is O(log n).
+///
+/// The result has the name of the first timer of the range.
+///
+/// Example:
+/// @code
+///     std::vector<Timer> per_worker(n_workers);
+///     // ... each worker times into per_worker[i] ...
+///     Timer total = Reduce(per_worker.begin(), per_worker.end());
+///     std::cout << total << std::endl;
+/// @endcode
+///
+/// @throw std::runtime_error if the range is empty
+///
+/// @param [in] first Iterator to the first item
+/// @param [in] last Iterator past the last item
+/// @param [in] threads Maximum number of threads, defaults to the number of
+/// hardware threads
+/// @retval Merged item
+template <class Iterator>
+typename std::iterator_traits<Iterator>::value_type Reduce(
+    Iterator first, Iterator last,
+    size_t threads = std::thread::hardware_concurrency()) {
+    typedef typename std::iterator_traits<Iterator>::value_type T;
+    std::vector<T> items(first, last);
+    if (items.empty()) {
+        throw std::runtime_error("Reduce called on an empty range");
+    }
+    threads = std::max(threads, (size_t)1);
+    for (size_t stride = 1; stride < items.size(); stride *= 2) {
+        internal::MergeLevel(items, stride, threads);
+    }
+    return items[0];
+}
+}
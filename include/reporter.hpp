@@ -0,0 +1,229 @@
+/// @file reporter.hpp
+///
+/// Reporter class writing periodic snapshots of a TimerSet from a background
+/// thread
+///
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "utils.hpp"
+#include "timer.hpp"
+#include "timerset.hpp"
+#include "snapshot.hpp"
+
+namespace timey {
+/// SnapshotTimer is a Timer with the stats::Snapshots policy, whose
+/// statistics can be read while another thread starts and stops it.
+typedef BasicTimer<HighResolutionClock, DefaultMoments,
+                   stats::Pack<stats::PerSample, stats::Percentiles,
+                               stats::Snapshots>>
+    SnapshotTimer;
+
+/// SnapshotTimerSet is a BasicTimerSet of SnapshotTimer objects, which a
+/// Reporter can report on while the timers run.
+typedef BasicTimerSet<SnapshotTimer> SnapshotTimerSet;
+
+namespace internal {
+/// WriteSnapshotReport writes the report of the snapshots taken over
+/// 'interval' in the format of a TimerSet report, after a line with the
+/// interval.
+///
+/// @param [in] out Output Stream
+/// @param [in] snapshots Snapshots to write
+/// @param [in] interval Duration the snapshots cover
+inline void WriteSnapshotReport(std::ostream& out,
+                                const std::vector<TimerSnapshot>& snapshots,
+                                NanosecondsType interval) {
+    const std::string& header = ReportHeader();
+    FormatBuffer report;
+    report.Append("Interval ", 9).AppendDuration(interval).Append('\n');
+    report.Append(header).Append('\n');
+    report.Repeat('-', header.size() - 10).Append('\n');
+    for (auto& s : snapshots) {
+        s.Report(report);
+        report.Append('\n');
+    }
+    report.Repeat('-', header.size() - 10).Append('\n');
+    out << std::left << report << std::flush;
+}
+}
+
+/// BasicReporter class takes a snapshot of a TimerSet at a fixed interval
+/// from a background thread and hands the statistics of the start-stop
+/// cycles since the previous snapshot to a callback, or writes them to a
+/// stream. Snapshots take no locks on the timers, so the workload is not
+/// paused; see stats::Snapshots.
+///
+/// TimerSetType is any TimerSet with a Snapshot function, such as
+/// SnapshotTimerSet. Timers must be added before the reporter is
+/// constructed and not deleted while it runs. Reporter is a BasicReporter of
+/// a SnapshotTimerSet.
+///
+/// Example:
+/// @code
+///     SnapshotTimerSet ts;
+///     TimerHandle h = ts.Add("request");
+///     Reporter reporter(ts, std::cerr, 10 * Second);
+///
+///     for(size_t i = 0; i < n; i++) {
+///         ts.Start(h);
+///         handle_request();
+///         ts.Stop(h);
+///     }
+/// @endcode
+template <class TimerSetType>
+class BasicReporter {
+   public:
+    /// Callback is called from the reporter thread with the snapshots of
+    /// the start-stop cycles since the previous call, and the duration they
+    /// cover.
+    typedef std::function<void(const std::vector<TimerSnapshot>&,
+                               NanosecondsType)>
+        Callback;
+
+    BasicReporter(const TimerSetType& ts, Callback callback,
+                  NanosecondsType interval = 10 * Second);
+    BasicReporter(const TimerSetType& ts, std::ostream& out,
+                  NanosecondsType interval = 10 * Second);
+    ~BasicReporter();
+    BasicReporter(const BasicReporter&) = delete;
+    BasicReporter& operator=(const BasicReporter&) = delete;
+
+    // API
+    void Stop(void);
+
+   private:
+    void Run_(void);
+    void Report_(void);
+
+    /// timerSet_ is the reported TimerSet.
+    const TimerSetType& timerSet_;
+    /// callback_ receives the statistics of every interval.
+    Callback callback_;
+    /// interval_ is the time between two snapshots.
+    NanosecondsType interval_;
+    /// previous_ holds the previous snapshot of each timer by name, for the
+    /// reporter thread only.
+    std::map<std::string, TimerSnapshot> previous_;
+    /// previousTime_ is the time of the previous snapshot.
+    std::chrono::steady_clock::time_point previousTime_;
+    /// mutex_ protects stopping_.
+    std::mutex mutex_;
+    /// wakeup_ wakes the reporter thread up when the reporter is stopped.
+    std::condition_variable wakeup_;
+    /// stopping_ tells the reporter thread to report a last time and stop.
+    bool stopping_;
+    /// reporter_ takes the snapshots.
+    std::thread reporter_;
+};
+
+/// Reporter is a BasicReporter of a SnapshotTimerSet.
+typedef BasicReporter<SnapshotTimerSet> Reporter;
+
+/// Constructs a reporter calling 'callback' every 'interval' and starts its
+/// thread.
+///
+/// @param [in] ts TimerSet to report on
+/// @param [in] callback Function receiving the statistics of every interval
+/// @param [in] interval Time between two snapshots
+template <class TimerSetType>
+BasicReporter<TimerSetType>::BasicReporter(const TimerSetType& ts,
+                                           Callback callback,
+                                           NanosecondsType interval)
+    : timerSet_(ts),
+      callback_(callback),
+      interval_(interval),
+      previousTime_(std::chrono::steady_clock::now()),
+      stopping_(false) {
+    for (auto& s : timerSet_.Snapshot()) {
+        previous_[s.Name()] = s;
+    }
+    reporter_ = std::thread(&BasicReporter::Run_, this);
+}
+
+/// Constructs a reporter writing the statistics of every 'interval' to
+/// 'out' and starts its thread. 'out' is only written by the reporter
+/// thread.
+///
+/// @param [in] ts TimerSet to report on
+/// @param [in] out Output Stream
+/// @param [in] interval Time between two snapshots
+template <class TimerSetType>
+BasicReporter<TimerSetType>::BasicReporter(const TimerSetType& ts,
+                                           std::ostream& out,
+                                           NanosecondsType interval)
+    : BasicReporter(ts,
+                    [&out](const std::vector<TimerSnapshot>& snapshots,
+                           NanosecondsType elapsed) {
+                        internal::WriteSnapshotReport(out, snapshots, elapsed);
+                    },
+                    interval) {}
+
+template <class TimerSetType>
+BasicReporter<TimerSetType>::~BasicReporter() {
+    Stop();
+}
+
+/// Stop reports the start-stop cycles since the previous snapshot a last
+/// time and stops the reporter thread. Stop is called by the destructor.
+template <class TimerSetType>
+void BasicReporter<TimerSetType>::Stop(void) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_) {
+            return;
+        }
+        stopping_ = true;
+    }
+    wakeup_.notify_one();
+    reporter_.join();
+}
+
+/// Run_ is the reporter thread: it reports every interval until the
+/// reporter is stopped.
+/// Run_ is a private function and should not be used by end users.
+template <class TimerSetType>
+void BasicReporter<TimerSetType>::Run_(void) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    std::chrono::steady_clock::time_point next = previousTime_ + interval_;
+    while (!stopping_) {
+        if (wakeup_.wait_until(lock, next) == std::cv_status::timeout) {
+            lock.unlock();
+            Report_();
+            lock.lock();
+            next += interval_;
+        }
+    }
+    lock.unlock();
+    Report_();
+}
+
+/// Report_ takes a snapshot of the TimerSet and passes the statistics since
+/// the previous snapshot to the callback.
+/// Report_ is a private function and should not be used by end users.
+template <class TimerSetType>
+void BasicReporter<TimerSetType>::Report_(void) {
+    std::chrono::steady_clock::time_point now =
+        std::chrono::steady_clock::now();
+    std::vector<TimerSnapshot> snapshots = timerSet_.Snapshot();
+    std::vector<TimerSnapshot> deltas;
+    deltas.reserve(snapshots.size());
+    for (auto& s : snapshots) {
+        TimerSnapshot& previous = previous_[s.Name()];
+        deltas.push_back(s.Since(previous));
+        previous = s;
+    }
+    callback_(deltas,
+              std::chrono::duration_cast<NanosecondsType>(now - previousTime_));
+    previousTime_ = now;
+}
+}
@@ -0,0 +1,129 @@
+/// @file samplebuffer.hpp
+///
+/// SampleBuffer class for storing per-iteration timer samples
+///
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "utils.hpp"
+
+namespace timey {
+/// SampleMode selects what a SampleBuffer does once it is full.
+///
+/// Ring overwrites the oldest samples, keeping the latest ones.
+/// Fixed keeps the first samples and drops the rest.
+enum class SampleMode { Ring, Fixed };
+
+/// SampleBuffer class is a fixed capacity buffer of samples, in clock ticks.
+///
+/// All the memory is allocated by Reserve, so Add never allocates.
+class SampleBuffer {
+   public:
+    SampleBuffer() : mode_(SampleMode::Ring), next_(0), size_(0), added_(0) {}
+
+    /// Reserve allocates room for 'capacity' samples and clears the buffer.
+    /// A capacity of zero disables the buffer.
+    ///
+    /// @param [in] capacity Number of samples to keep
+    /// @param [in] mode What to do once the buffer is full
+    void Reserve(size_t capacity, SampleMode mode) {
+        std::vector<int64_t>(capacity).swap(data_);
+        mode_ = mode;
+        Clear();
+    }
+
+    /// Clear removes all samples, keeping the capacity.
+    void Clear(void) {
+        next_ = 0;
+        size_ = 0;
+        added_ = 0;
+    }
+
+    /// Add records a sample. Add does nothing if the buffer is disabled.
+    ///
+    /// @param [in] x Sample in clock ticks
+    void Add(int64_t x) {
+        added_++;
+        if (size_ == data_.size()) {
+            if (mode_ == SampleMode::Fixed || data_.empty()) {
+                return;
+            }
+        } else {
+            size_++;
+        }
+        data_[next_] = x;
+        next_ = (next_ + 1 == data_.size()) ? 0 : next_ + 1;
+    }
+
+    /// Capacity returns the number of samples the buffer can hold.
+    size_t Capacity(void) const { return data_.size(); }
+
+    /// Size returns the number of samples in the buffer.
+    size_t Size(void) const { return size_; }
+
+    /// Dropped returns the number of samples that were added but are no
+    /// longer, or never were, in the buffer.
+    size_t Dropped(void) const { return added_ - size_; }
+
+    /// Mode returns what the buffer does once it is full.
+    SampleMode Mode(void) const { return mode_; }
+
+    /// Ticks returns the i-th oldest sample in the buffer.
+    ///
+    /// @param [in] i Index of the sample, from 0 to Size() - 1
+    /// @retval Sample in clock ticks
+    int64_t Ticks(size_t i) const {
+        size_t first = (size_ == data_.size()) ? next_ : 0;
+        size_t j = first + i;
+        return data_[j < data_.size() ? j : j - data_.size()];
+    }
+
+   private:
+    /// data_ holds the samples.
+    std::vector<int64_t> data_;
+    /// mode_ selects what Add does once the buffer is full.
+    SampleMode mode_;
+    /// next_ is the position of the next sample in data_.
+    size_t next_;
+    /// size_ is the number of samples in data_.
+    size_t size_;
+    /// added_ is the number of samples added since the last Clear.
+    size_t added_;
+};
+
+/// SampleView class is a read-only view of the samples of a Timer, in
+/// chronological order. The view does not copy the samples and is
+/// invalidated by the next Stop, Reset or ReserveSamples on the Timer.
+template <class Clock>
+class SampleView {
+   public:
+    explicit SampleView(const SampleBuffer& buffer__) : buffer_(&buffer__) {}
+
+    /// Size returns the number of samples in the view.
+    size_t Size(void) const { return buffer_->Size(); }
+
+    /// Dropped returns the number of samples recorded by the Timer that are
+    /// not in the view.
+    size_t Dropped(void) const { return buffer_->Dropped(); }
+
+    /// Ticks returns the i-th sample in clock ticks.
+    ///
+    /// @param [in] i Index of the sample, from 0 to Size() - 1
+    int64_t Ticks(size_t i) const { return buffer_->Ticks(i); }
+
+    /// Operator overloading to return the i-th sample in duration of
+    /// Nanoseconds.
+    ///
+    /// @param [in] i Index of the sample, from 0 to Size() - 1
+    /// @retval std::chrono::duration object in Nanoseconds
+    NanosecondsType operator[](size_t i) const {
+        return Clock::ToNanoseconds(buffer_->Ticks(i));
+    }
+
+   private:
+    const SampleBuffer* buffer_;
+};
+}
@@ -0,0 +1,415 @@
+/// @file samplelog.hpp
+///
+/// SampleLog class writing every sample to a memory mapped binary file, and
+/// SampleLogReader class reading it back
+///
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "utils.hpp"
+#include "clock.hpp"
+
+namespace timey {
+/// SampleRecord is a sample of a SampleLog: the start tick and the duration,
+/// in clock ticks, of one start-stop cycle of a timer.
+struct SampleRecord {
+    /// timer is the index of the timer in the name table of the log.
+    uint32_t timer;
+    uint32_t reserved;
+    int64_t start;
+    int64_t elapsed;
+};
+
+namespace internal {
+/// SampleLogMagic identifies a sample log file.
+constexpr char SampleLogMagic[8] = {'T', 'I', 'M', 'E', 'Y', 'L', 'O', 'G'};
+/// SampleLogVersion is the version of the sample log format.
+constexpr uint32_t SampleLogVersion = 1;
+
+/// SampleLogHeader is the fixed size header at the start of a sample log.
+/// The file layout is the header, the name table, padding to a multiple of
+/// 8 bytes and the records:
+///
+///     SampleLogHeader
+///     for each timer: uint32_t length, followed by 'length' characters
+///     SampleRecord[records]
+///
+/// All values are in the byte order of the machine that wrote the log.
+struct SampleLogHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t timers;
+    double nsPerTick;
+    /// dataOffset is the offset of the first record from the file start.
+    uint64_t dataOffset;
+    /// records is the number of records, updated after every record so that
+    /// the log of a crashed process can be read.
+    uint64_t records;
+};
+}
+
+/// BasicSampleLog class writes every sample of a set of timers to a binary
+/// file, without formatting and without write calls: records are stored in
+/// a memory mapped file, which is grown by doubling when full. The timer
+/// names are fixed when the log is created.
+///
+/// SampleLog is not thread safe. SampleLog is a BasicSampleLog using the
+/// default clock policy.
+///
+/// Example:
+/// @code
+///     SampleLog log("samples.log", {"assemble", "solve"});
+///     uint32_t solve = log.Handle("solve");
+///     for(size_t i = 0; i < n; i++) {
+///         int64_t start = log.Now();
+///         solve();
+///         log.Add(solve, start, log.Now());
+///     }
+///     log.Close();
+/// @endcode
+///
+/// The log is analysed offline with timey-analyze or SampleLogReader.
+template <class Clock>
+class BasicSampleLog {
+   public:
+    /// ClockType is the clock policy used by the log.
+    typedef Clock ClockType;
+
+    BasicSampleLog(const std::string& path,
+                   const std::vector<std::string>& names,
+                   size_t initial_capacity = 1 << 16);
+    ~BasicSampleLog();
+    BasicSampleLog(const BasicSampleLog&) = delete;
+    BasicSampleLog& operator=(const BasicSampleLog&) = delete;
+
+    // API
+    uint32_t Handle(const std::string& name) const;
+    void Add(uint32_t timer, int64_t start, int64_t stop);
+    void Close(void);
+
+    /// Now returns the current tick of the clock of the log.
+    ///
+    /// @retval Current clock tick
+    static int64_t Now(void) { return Clock::Now(); }
+
+    /// Size returns the number of records in the log.
+    ///
+    /// @retval Number of records
+    size_t Size(void) const { return size_; }
+
+   private:
+    void Map_(size_t capacity);
+    void Grow_(void);
+
+    /// names_ is the name table of the log.
+    std::vector<std::string> names_;
+    /// fd_ is the descriptor of the log file, or -1 once closed.
+    int fd_;
+    /// dataOffset_ is the offset of the first record in the file.
+    size_t dataOffset_;
+    /// map_ is the mapping of the whole file.
+    char* map_;
+    /// records_ points to the first record in map_.
+    SampleRecord* records_;
+    /// size_ is the number of records written.
+    size_t size_;
+    /// capacity_ is the number of records that fit in the mapping.
+    size_t capacity_;
+};
+
+/// SampleLog is a BasicSampleLog using the default clock policy.
+typedef BasicSampleLog<HighResolutionClock> SampleLog;
+
+/// Constructs a sample log writing to 'path', with one timer per name.
+///
+/// @throw std::runtime_error if the file cannot be created or mapped
+///
+/// @param [in] path Path of the log file
+/// @param [in] names Names of the timers of the log
+/// @param [in] initial_capacity Number of records of the initial mapping
+template <class Clock>
+BasicSampleLog<Clock>::BasicSampleLog(const std::string& path,
+                                      const std::vector<std::string>& names,
+                                      size_t initial_capacity)
+    : names_(names),
+      fd_(-1),
+      dataOffset_(sizeof(internal::SampleLogHeader)),
+      map_(nullptr),
+      records_(nullptr),
+      size_(0),
+      capacity_(0) {
+    for (auto& name : names_) {
+        dataOffset_ += sizeof(uint32_t) + name.size();
+    }
+    dataOffset_ = (dataOffset_ + 7) / 8 * 8;
+
+    fd_ = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd_ < 0) {
+        throw internal::SystemError("Cannot open sample log '" + path + "'");
+    }
+    try {
+        Map_(initial_capacity > 0 ? initial_capacity : 1);
+    } catch (...) {
+        close(fd_);
+        throw;
+    }
+
+    internal::SampleLogHeader* header =
+        reinterpret_cast<internal::SampleLogHeader*>(map_);
+    std::memcpy(header->magic, internal::SampleLogMagic, 8);
+    header->version = internal::SampleLogVersion;
+    header->timers = (uint32_t)names_.size();
+    header->nsPerTick = Clock::NanosecondsPerTick();
+    header->dataOffset = dataOffset_;
+    header->records = 0;
+    char* p = map_ + sizeof(internal::SampleLogHeader);
+    for (auto& name : names_) {
+        uint32_t length = (uint32_t)name.size();
+        std::memcpy(p, &length, sizeof(length));
+        std::memcpy(p + sizeof(length), name.data(), length);
+        p += sizeof(length) + length;
+    }
+}
+
+template <class Clock>
+BasicSampleLog<Clock>::~BasicSampleLog() {
+    try {
+        Close();
+    } catch (const std::runtime_error&) {
+    }
+}
+
+/// Handle returns the index of the timer 'name' in the log.
+///
+/// @throw std::runtime_error if the log has no timer named 'name'
+///
+/// @param [in] name Name of the timer
+/// @retval Index of the timer
+template <class Clock>
+uint32_t BasicSampleLog<Clock>::Handle(const std::string& name) const {
+    for (size_t i = 0; i < names_.size(); i++) {
+        if (names_[i] == name) {
+            return (uint32_t)i;
+        }
+    }
+    throw std::runtime_error("SampleLog has no timer named '" + name + "'");
+}
+
+/// Add records a start-stop cycle of the timer 'timer'. Add does not check
+/// 'timer' and calls into the system only when the mapping is full.
+///
+/// @throw std::runtime_error if the log is closed or cannot be grown
+///
+/// @param [in] timer Index of the timer, as returned by Handle
+/// @param [in] start Clock tick when the timer started
+/// @param [in] stop Clock tick when the timer stopped
+template <class Clock>
+inline void BasicSampleLog<Clock>::Add(uint32_t timer, int64_t start,
+                                       int64_t stop) {
+    if (size_ >= capacity_) {
+        Grow_();
+    }
+    records_[size_] = SampleRecord{timer, 0, start, stop - start};
+    size_++;
+    reinterpret_cast<internal::SampleLogHeader*>(map_)->records = size_;
+}
+
+/// Close truncates the file to its records and unmaps it. Records added
+/// after Close throw. Close is called by the destructor.
+///
+/// @throw std::runtime_error if the file cannot be truncated
+template <class Clock>
+void BasicSampleLog<Clock>::Close(void) {
+    if (fd_ < 0) {
+        return;
+    }
+    munmap(map_, dataOffset_ + capacity_ * sizeof(SampleRecord));
+    map_ = nullptr;
+    records_ = nullptr;
+    capacity_ = 0;
+    int fd = fd_;
+    fd_ = -1;
+    int result =
+        ftruncate(fd, (off_t)(dataOffset_ + size_ * sizeof(SampleRecord)));
+    close(fd);
+    if (result != 0) {
+        throw internal::SystemError("Cannot truncate sample log");
+    }
+}
+
+/// Map_ resizes the file to hold 'capacity' records and maps it, replacing
+/// the current mapping only once the new one succeeded, so that a log which
+/// cannot grow keeps its records and stays usable.
+/// Map_ is a private function and should not be used by end users.
+///
+/// @param [in] capacity Number of records of the mapping
+template <class Clock>
+void BasicSampleLog<Clock>::Map_(size_t capacity) {
+    size_t length = dataOffset_ + capacity * sizeof(SampleRecord);
+    if (ftruncate(fd_, (off_t)length) != 0) {
+        throw internal::SystemError("Cannot grow sample log");
+    }
+    void* map = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED,
+                     fd_, 0);
+    if (map == MAP_FAILED) {
+        throw internal::SystemError("Cannot map sample log");
+    }
+    if (map_ != nullptr) {
+        munmap(map_, dataOffset_ + capacity_ * sizeof(SampleRecord));
+    }
+    map_ = static_cast<char*>(map);
+    records_ = reinterpret_cast<SampleRecord*>(map_ + dataOffset_);
+    capacity_ = capacity;
+}
+
+/// Grow_ doubles the capacity of the mapping.
+/// Grow_ is a private function and should not be used by end users.
+template <class Clock>
+void BasicSampleLog<Clock>::Grow_(void) {
+    if (fd_ < 0) {
+        throw std::runtime_error("Add called on a closed SampleLog");
+    }
+    Map_(2 * capacity_);
+}
+
+/// SampleLogReader class maps a sample log read only and gives access to
+/// its name table and records. Records are read from the mapping, so a log
+/// much larger than memory is read without copying.
+///
+/// Example:
+/// @code
+///     SampleLogReader log("samples.log");
+///     for(const SampleRecord& r : log) {
+///         std::cout << log.Names()[r.timer] << " "
+///                   << log.ToNanoseconds(r.elapsed).count() << std::endl;
+///     }
+/// @endcode
+class SampleLogReader {
+   public:
+    explicit SampleLogReader(const std::string& path);
+    ~SampleLogReader();
+    SampleLogReader(const SampleLogReader&) = delete;
+    SampleLogReader& operator=(const SampleLogReader&) = delete;
+
+    /// Names returns the name table of the log.
+    ///
+    /// @retval Names of the timers, by index
+    const std::vector<std::string>& Names(void) const { return names_; }
+
+    /// NanosecondsPerTick returns the length of a tick of the clock that
+    /// wrote the log.
+    ///
+    /// @retval Nanoseconds per tick
+    double NanosecondsPerTick(void) const { return nsPerTick_; }
+
+    /// ToNanoseconds converts a tick count of the log into nanoseconds.
+    ///
+    /// @param [in] ticks Tick count
+    /// @retval std::chrono::duration object in Nanoseconds
+    NanosecondsType ToNanoseconds(int64_t ticks) const {
+        return static_cast<int64_t>(ticks * nsPerTick_) * Nanosecond;
+    }
+
+    /// Size returns the number of records in the log.
+    ///
+    /// @retval Number of records
+    size_t Size(void) const { return size_; }
+
+    /// operator[] returns the record at 'index'.
+    ///
+    /// @param [in] index Index of the record
+    /// @retval Record
+    const SampleRecord& operator[](size_t index) const {
+        return records_[index];
+    }
+
+    const SampleRecord* begin(void) const { return records_; }
+    const SampleRecord* end(void) const { return records_ + size_; }
+
+   private:
+    /// map_ is the mapping of the whole file.
+    char* map_;
+    /// length_ is the length of the mapping.
+    size_t length_;
+    std::vector<std::string> names_;
+    double nsPerTick_;
+    const SampleRecord* records_;
+    size_t size_;
+};
+
+/// Constructs a reader of the sample log at 'path'.
+///
+/// @throw std::runtime_error if the file cannot be mapped or is not a
+///                           sample log
+///
+/// @param [in] path Path of the log file
+inline SampleLogReader::SampleLogReader(const std::string& path)
+    : map_(nullptr), length_(0), nsPerTick_(0), records_(nullptr), size_(0) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw internal::SystemError("Cannot open sample log '" + path + "'");
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        throw internal::SystemError("Cannot stat sample log '" + path + "'");
+    }
+    length_ = (size_t)st.st_size;
+    if (length_ < sizeof(internal::SampleLogHeader)) {
+        close(fd);
+        throw std::runtime_error("'" + path + "' is not a sample log");
+    }
+    void* map = mmap(nullptr, length_, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        throw internal::SystemError("Cannot map sample log '" + path + "'");
+    }
+    map_ = static_cast<char*>(map);
+    madvise(map_, length_, MADV_SEQUENTIAL);
+
+    const internal::SampleLogHeader* header =
+        reinterpret_cast<const internal::SampleLogHeader*>(map_);
+    const char* end = map_ + length_;
+    const char* p = map_ + sizeof(internal::SampleLogHeader);
+    bool valid =
+        std::memcmp(header->magic, internal::SampleLogMagic, 8) == 0 &&
+        header->version == internal::SampleLogVersion &&
+        header->dataOffset <= length_ && header->dataOffset % 8 == 0 &&
+        header->records <=
+            (length_ - header->dataOffset) / sizeof(SampleRecord);
+    for (uint32_t i = 0; valid && i < header->timers; i++) {
+        uint32_t n;
+        valid = end - p >= (ptrdiff_t)sizeof(n);
+        if (valid) {
+            std::memcpy(&n, p, sizeof(n));
+            p += sizeof(n);
+            valid = end - p >= (ptrdiff_t)n;
+        }
+        if (valid) {
+            names_.push_back(std::string(p, n));
+            p += n;
+        }
+    }
+    if (!valid || p > map_ + header->dataOffset) {
+        munmap(map_, length_);
+        throw std::runtime_error("'" + path + "' is not a sample log");
+    }
+    nsPerTick_ = header->nsPerTick;
+    records_ =
+        reinterpret_cast<const SampleRecord*>(map_ + header->dataOffset);
+    size_ = (size_t)header->records;
+}
+
+inline SampleLogReader::~SampleLogReader() { munmap(map_, length_); }
+}
@@ -0,0 +1,129 @@
+/// @file scopedtimer.hpp
+///
+/// ScopedTimer class and the TIMEY_SCOPE macro
+///
+#pragma once
+
+#include <cassert>
+#include <stdexcept>
+#include <string>
+
+#include "timer.hpp"
+#include "timerset.hpp"
+
+#define TIMEY_CONCAT_(a, b) a##b
+#define TIMEY_CONCAT(a, b) TIMEY_CONCAT_(a, b)
+
+#ifdef TIMEY_DISABLE
+#define TIMEY_SCOPE(name) static_cast<void>(0)
+#else
+/// TIMEY_SCOPE times the rest of the enclosing scope with the timer 'name'
+/// of GlobalTimerSet. The timer is added and its handle looked up the first
+/// time the scope is entered; after that, entering the scope costs a Start
+/// by handle. TIMEY_SCOPE compiles to nothing when TIMEY_DISABLE is defined.
+///
+/// GlobalTimerSet is not thread safe, so TIMEY_SCOPE must only be used from
+/// one thread.
+///
+/// @param name Name of the timer
+#define TIMEY_SCOPE(name)                                                  \
+    static const ::timey::TimerHandle TIMEY_CONCAT(timey_handle_,          \
+                                                   __LINE__) =             \
+        ::timey::internal::ScopeHandle(::timey::GlobalTimerSet(), name);   \
+    ::timey::ScopedTimer TIMEY_CONCAT(timey_scope_, __LINE__)(             \
+        ::timey::GlobalTimerSet(), TIMEY_CONCAT(timey_handle_, __LINE__))
+#endif
+
+namespace timey {
+/// BasicScopedTimer class starts a timer when constructed and stops it when
+/// destroyed, so that a scope is timed on every path out of it.
+///
+/// ScopedTimer never throws: a timer that is already running when the scope
+/// is entered, for example by recursion, is left to its outer scope, and a
+/// stale handle fails an assertion unless NDEBUG is defined, in which case
+/// the scope is not timed.
+/// ScopedTimer is a BasicScopedTimer of Timer objects.
+///
+/// Example:
+/// @code
+///     TimerSet ts;
+///     TimerHandle solve = ts.Add("solve");
+///     for(size_t i = 0; i < n; i++) {
+///         ScopedTimer scope(ts, solve);
+///         solve();
+///     }
+/// @endcode
+template <class TimerType>
+class BasicScopedTimer {
+   public:
+    /// Constructs a ScopedTimer timing the scope with 't'.
+    ///
+    /// @param [in] t Timer to start
+    explicit BasicScopedTimer(TimerType& t) noexcept : timer_(Start_(&t)) {}
+
+    /// Constructs a ScopedTimer timing the scope with a timer of a TimerSet,
+    /// by handle.
+    ///
+    /// @param [in] ts TimerSet of the timer
+    /// @param [in] h Handle of the timer
+    template <class TimerSetType>
+    BasicScopedTimer(TimerSetType& ts, TimerHandle h) noexcept
+        : timer_(Start_(ts.Find(h))) {
+        assert(ts.Find(h) != nullptr && "Invalid or stale TimerHandle");
+    }
+
+    ~BasicScopedTimer() {
+        if (timer_ != nullptr && timer_->Running()) {
+            timer_->Stop();
+        }
+    }
+
+    BasicScopedTimer(const BasicScopedTimer&) = delete;
+    BasicScopedTimer& operator=(const BasicScopedTimer&) = delete;
+
+   private:
+    /// Start_ starts 't' unless it is null or already running.
+    /// Start_ is a private function and should not be used by end users.
+    ///
+    /// @param [in] t Timer to start, or nullptr
+    /// @retval 't' if it was started, nullptr otherwise
+    static TimerType* Start_(TimerType* t) noexcept {
+        if (t == nullptr || t->Running()) {
+            return nullptr;
+        }
+        t->Start();
+        return t;
+    }
+
+    /// timer_ is the timer started by the ScopedTimer, if any.
+    TimerType* timer_;
+};
+
+/// ScopedTimer is a BasicScopedTimer of Timer objects.
+typedef BasicScopedTimer<Timer> ScopedTimer;
+
+/// GlobalTimerSet returns the TimerSet of the timers of TIMEY_SCOPE.
+///
+/// @retval TimerSet of TIMEY_SCOPE
+inline TimerSet& GlobalTimerSet(void) {
+    static TimerSet ts;
+    return ts;
+}
+
+namespace internal {
+/// ScopeHandle returns the handle of the timer 'name' in 'ts', adding the
+/// timer if needed.
+///
+/// @param [in] ts TimerSet of the timer
+/// @param [in] name Name of the timer
+/// @retval Handle of the timer
+template <class TimerSetType>
+TimerHandle ScopeHandle(TimerSetType& ts, const std::string& name) {
+    try {
+        return ts.Handle(name);
+    } catch (const std::runtime_error&) {
+        return ts.Add(name);
+    }
+}
+}
+}
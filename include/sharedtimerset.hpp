@@ -0,0 +1,806 @@
+/// @file sharedtimerset.hpp
+///
+/// SharedTimerSet class keeping its timers in POSIX shared memory, so that
+/// the timers of many processes can be aggregated by another process
+///
+#pragma once
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "utils.hpp"
+#include "accumulator.hpp"
+#include "timer.hpp"
+#include "timerset.hpp"
+#include "concurrenttimerset.hpp"
+
+static_assert(ATOMIC_INT_LOCK_FREE == 2 && ATOMIC_LLONG_LOCK_FREE == 2,
+              "SharedTimerSet needs lock free atomics in shared memory");
+
+namespace timey {
+/// SharedAccess is the access of a process to a SharedTimerSet it attaches
+/// to.
+enum class SharedAccess {
+    /// ReadWrite allows adding, starting and stopping timers.
+    ReadWrite,
+    /// ReadOnly maps the shared memory read only, for monitors.
+    ReadOnly
+};
+
+namespace internal {
+/// SharedTimerSetMagic identifies the shared memory of a SharedTimerSet.
+constexpr char SharedTimerSetMagic[8] = {'T', 'I', 'M', 'E',
+                                         'Y', 'S', 'H', 'M'};
+/// SharedTimerSetVersion is the version of the shared memory layout.
+constexpr uint32_t SharedTimerSetVersion = 3;
+/// SharedNameSize is the size of a timer name in the name table, including
+/// the terminating null character.
+constexpr size_t SharedNameSize = 64;
+/// SharedAttachTimeout is how long attaching waits for the process creating
+/// the shared memory to size it and write its header.
+constexpr std::chrono::milliseconds SharedAttachTimeout(1000);
+
+/// SharedHeader is the header at the start of the shared memory of a
+/// SharedTimerSet. The layout is the header, the owner table of 'workers'
+/// process ids padded to a cache line, the name table of 'capacity' names
+/// of SharedNameSize characters, and the slot table of 'workers' rows of
+/// 'capacity' slots, each on its own cache line.
+struct alignas(CacheLineSize) SharedHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t capacity;
+    uint32_t workers;
+    uint32_t reserved;
+    double nsPerTick;
+    /// timers is the number of names in the name table.
+    std::atomic<uint32_t> timers;
+    /// lock serializes Add across processes. It holds the process id of
+    /// the owner, or 0.
+    std::atomic<int32_t> lock;
+    /// ready is set once the creator has written the header.
+    std::atomic<uint32_t> ready;
+};
+
+/// SharedSlot holds the statistics of one timer of one worker. Only the
+/// owning worker writes a slot; the statistics can be read while the owner
+/// is writing.
+struct alignas(CacheLineSize) SharedSlot {
+    SlotStatistics statistics;
+    int64_t start;
+    uint32_t running;
+};
+
+static_assert(sizeof(SharedHeader) == CacheLineSize &&
+                  sizeof(SharedSlot) == CacheLineSize,
+              "Shared memory layout is one cache line per entry");
+
+/// SharedOwnersSize returns the size of the owner table of 'workers'
+/// workers, rounded up to a cache line.
+inline size_t SharedOwnersSize(size_t workers) {
+    size_t size = workers * sizeof(std::atomic<int32_t>);
+    return (size + CacheLineSize - 1) / CacheLineSize * CacheLineSize;
+}
+
+/// SharedSize returns the size of the shared memory of a SharedTimerSet.
+inline size_t SharedSize(size_t capacity, size_t workers) {
+    return sizeof(SharedHeader) + SharedOwnersSize(workers) +
+           capacity * SharedNameSize + capacity * workers * sizeof(SharedSlot);
+}
+
+/// ProcessAlive returns whether process 'pid' exists. A process of another
+/// user is reported alive.
+inline bool ProcessAlive(int32_t pid) {
+    return kill((pid_t)pid, 0) == 0 || errno != ESRCH;
+}
+
+/// SharedName returns the POSIX shared memory object name of 'name', which
+/// starts with a slash.
+inline std::string SharedName(const std::string& name) {
+    return name.compare(0, 1, "/") == 0 ? name : "/" + name;
+}
+}
+
+/// BasicSharedTimerSet class is a set of named timers stored in a named
+/// POSIX shared memory segment, so that the worker processes of a service
+/// record into one table that outlives them, and a monitor process can
+/// attach and report the timers aggregated over all workers while they run.
+///
+/// Every worker writes to its own row of cache line sized slots, so Start
+/// and Stop make no system calls and take no locks. A worker is a process,
+/// or a thread, with its own worker index: 0 for the process creating the
+/// set, and any other index set with Worker or claimed with ClaimWorker. A
+/// forked process inherits the mapping and must change its worker index.
+/// A claimed worker is released by ReleaseWorker or when the set is
+/// destroyed, and the worker of a process that died without releasing it
+/// is claimed again, with the timers it left running stopped.
+///
+/// As with ConcurrentTimerSet, each slot keeps the exact sum of squares of
+/// its samples and is read consistently, but the slots are read one after
+/// the other, so a view taken while samples are being recorded may be off
+/// by the samples in flight. Reports are in the order the timers were
+/// added. All processes must use the same clock policy.
+///
+/// SharedTimerSet is a BasicSharedTimerSet using the default clock policy.
+///
+/// Example:
+/// @code
+///     // Parent, before forking the workers
+///     SharedTimerSet ts("myservice", 64, 16);
+///     TimerHandle h = ts.Add("request");
+///
+///     // In each forked worker
+///     ts.ClaimWorker();
+///     for(;;) {
+///         ts.Start(h);
+///         handle_request();
+///         ts.Stop(h);
+///     }
+///
+///     // In a monitor process
+///     SharedTimerSet monitor("myservice", SharedAccess::ReadOnly);
+///     std::cout << monitor << std::endl;
+/// @endcode
+template <class Clock>
+class BasicSharedTimerSet {
+   public:
+    /// TimerType is the type of the aggregated timers.
+    typedef BasicTimer<Clock> TimerType;
+
+    BasicSharedTimerSet(const std::string& name, size_t capacity__,
+                        size_t workers__);
+    explicit BasicSharedTimerSet(
+        const std::string& name,
+        SharedAccess access = SharedAccess::ReadWrite);
+    ~BasicSharedTimerSet();
+    BasicSharedTimerSet(const BasicSharedTimerSet&) = delete;
+    BasicSharedTimerSet& operator=(const BasicSharedTimerSet&) = delete;
+
+    static void Remove(const std::string& name);
+
+    // API
+    size_t Count(void) const;
+    size_t ClaimWorker(void);
+    void ReleaseWorker(void);
+    void Worker(size_t worker__);
+    TimerHandle Add(const std::string& timer_name);
+    TimerHandle Handle(const std::string& timer_name) const;
+    void Start(const std::string& timer_name) { Start(Handle(timer_name)); }
+    void Stop(const std::string& timer_name) { Stop(Handle(timer_name)); }
+    TimerType Get(const std::string& timer_name) const;
+    TimerType Get(TimerHandle h) const;
+    TimerType Get(TimerHandle h, size_t worker__) const;
+
+    // Handle API
+    void Start(TimerHandle h);
+    void Stop(TimerHandle h);
+
+    /// Capacity returns the maximum number of timers.
+    size_t Capacity(void) const { return header_->capacity; }
+
+    /// Workers returns the number of worker rows.
+    size_t Workers(void) const { return header_->workers; }
+
+    /// Worker returns the worker index of this process.
+    size_t Worker(void) const { return worker_; }
+
+    /// NanosecondsPerTick returns the nanoseconds per tick of the clock of
+    /// the process that created the set.
+    double NanosecondsPerTick(void) const { return header_->nsPerTick; }
+
+    /// ForEach calls 'fn' with the aggregate of each timer, in the order
+    /// they were added.
+    ///
+    /// @param [in] fn Function taking a const TimerType&
+    template <class Fn>
+    void ForEach(Fn fn) const {
+        size_t count = Count();
+        for (size_t i = 0; i < count; i++) {
+            fn(Aggregate_(i, 0, Workers()));
+        }
+    }
+
+    // Friend functions
+    template <class C>
+    friend std::ostream& operator<<(std::ostream& out,
+                                    const BasicSharedTimerSet<C>& ts);
+
+   private:
+    void Map_(int fd, size_t size, bool writable);
+    void Check_(size_t size) const;
+    void Own_(size_t worker__);
+    internal::SharedSlot& Row_(TimerHandle h);
+    void Lock_(void);
+    void Unlock_(void);
+    std::atomic<int32_t>& Owner_(size_t worker__) const;
+    const char* Name_(size_t index) const;
+    internal::SharedSlot& Slot_(size_t worker__, size_t index) const;
+    TimerType Aggregate_(size_t index, size_t first, size_t last) const;
+
+    /// name_ is the shared memory object name.
+    std::string name_;
+    /// map_ is the mapping of the shared memory.
+    char* map_;
+    /// size_ is the size of the mapping.
+    size_t size_;
+    /// header_ points to the header at the start of map_.
+    internal::SharedHeader* header_;
+    /// slots_ points to the slot table in map_.
+    internal::SharedSlot* slots_;
+    /// row_ points to the slots of this worker, or is null when read only.
+    internal::SharedSlot* row_;
+    /// worker_ is the worker index of this process.
+    size_t worker_;
+};
+
+/// SharedTimerSet is a BasicSharedTimerSet using the default clock policy.
+typedef BasicSharedTimerSet<HighResolutionClock> SharedTimerSet;
+
+/// Constructs a shared timer set named 'name' with room for 'capacity__'
+/// timers of 'workers__' workers, or attaches to it read-write if it
+/// already exists, as after a crash of the service. The process is worker
+/// 0, and the timers of worker 0 left running by a crashed creator are
+/// stopped.
+///
+/// @throw std::runtime_error if the shared memory cannot be created or
+/// mapped, or if it exists with a different capacity or number of workers
+///
+/// @param [in] name Name of the shared memory object
+/// @param [in] capacity__ Maximum number of timers
+/// @param [in] workers__ Number of workers
+template <class Clock>
+BasicSharedTimerSet<Clock>::BasicSharedTimerSet(const std::string& name,
+                                                size_t capacity__,
+                                                size_t workers__)
+    : name_(internal::SharedName(name)),
+      map_(nullptr),
+      size_(internal::SharedSize(capacity__, workers__)),
+      header_(nullptr),
+      slots_(nullptr),
+      row_(nullptr),
+      worker_(0) {
+    if (capacity__ == 0 || workers__ == 0 || capacity__ > UINT32_MAX ||
+        workers__ > UINT32_MAX) {
+        throw std::invalid_argument("Invalid SharedTimerSet size");
+    }
+    int fd = shm_open(name_.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+    bool created = fd >= 0;
+    if (!created && errno == EEXIST) {
+        fd = shm_open(name_.c_str(), O_RDWR, 0);
+    }
+    if (fd < 0) {
+        throw internal::SystemError("Cannot open shared memory '" + name_ +
+                                    "'");
+    }
+    if (created && ftruncate(fd, (off_t)size_) != 0) {
+        std::runtime_error e = internal::SystemError(
+            "Cannot size shared memory '" + name_ + "'");
+        close(fd);
+        shm_unlink(name_.c_str());
+        throw e;
+    }
+    Map_(fd, created ? size_ : 0, true);
+
+    if (created) {
+        std::memcpy(header_->magic, internal::SharedTimerSetMagic, 8);
+        header_->version = internal::SharedTimerSetVersion;
+        header_->capacity = (uint32_t)capacity__;
+        header_->workers = (uint32_t)workers__;
+        header_->nsPerTick = Clock::NanosecondsPerTick();
+        header_->timers.store(0, std::memory_order_relaxed);
+        header_->lock.store(0, std::memory_order_relaxed);
+        header_->ready.store(1, std::memory_order_release);
+    } else if (Capacity() != capacity__ || Workers() != workers__) {
+        munmap(map_, size_);
+        throw std::runtime_error("SharedTimerSet '" + name_ +
+                                 "' exists with a different size");
+    }
+    slots_ = reinterpret_cast<internal::SharedSlot*>(
+        map_ + sizeof(internal::SharedHeader) +
+        internal::SharedOwnersSize(Workers()) +
+        Capacity() * internal::SharedNameSize);
+    row_ = slots_;
+    Owner_(0).store((int32_t)getpid(), std::memory_order_release);
+    Own_(0);
+}
+
+/// Constructs a shared timer set attached to the existing shared memory
+/// 'name'. The process is worker 0 if 'access' is ReadWrite.
+///
+/// @throw std::runtime_error if the shared memory does not exist, cannot be
+/// mapped, or does not hold a SharedTimerSet
+///
+/// @param [in] name Name of the shared memory object
+/// @param [in] access ReadOnly for a monitor, ReadWrite for a worker
+template <class Clock>
+BasicSharedTimerSet<Clock>::BasicSharedTimerSet(const std::string& name,
+                                                SharedAccess access)
+    : name_(internal::SharedName(name)),
+      map_(nullptr),
+      size_(0),
+      header_(nullptr),
+      slots_(nullptr),
+      row_(nullptr),
+      worker_(0) {
+    bool writable = access == SharedAccess::ReadWrite;
+    int fd = shm_open(name_.c_str(), writable ? O_RDWR : O_RDONLY, 0);
+    if (fd < 0) {
+        throw internal::SystemError("Cannot open shared memory '" + name_ +
+                                    "'");
+    }
+    Map_(fd, 0, writable);
+    slots_ = reinterpret_cast<internal::SharedSlot*>(
+        map_ + sizeof(internal::SharedHeader) +
+        internal::SharedOwnersSize(Workers()) +
+        Capacity() * internal::SharedNameSize);
+    row_ = writable ? slots_ : nullptr;
+}
+
+/// Destroys the shared timer set, releasing the worker this process
+/// claimed, and unmaps the shared memory.
+template <class Clock>
+BasicSharedTimerSet<Clock>::~BasicSharedTimerSet() {
+    if (row_ != nullptr) {
+        int32_t self = (int32_t)getpid();
+        Owner_(worker_).compare_exchange_strong(self, 0);
+    }
+    munmap(map_, size_);
+}
+
+/// Remove removes the shared memory object 'name'. Processes attached to it
+/// keep their mapping.
+///
+/// @throw std::runtime_error if the shared memory cannot be removed
+///
+/// @param [in] name Name of the shared memory object
+template <class Clock>
+void BasicSharedTimerSet<Clock>::Remove(const std::string& name) {
+    if (shm_unlink(internal::SharedName(name).c_str()) != 0) {
+        throw internal::SystemError("Cannot remove shared memory '" +
+                                    internal::SharedName(name) + "'");
+    }
+}
+
+/// Map_ maps the shared memory of 'fd' and closes 'fd'. A 'size' of 0 maps
+/// an existing set, whose header is checked once the process creating it
+/// has sized it and set ready, for up to SharedAttachTimeout.
+/// Map_ is a private function and should not be used by end users.
+template <class Clock>
+void BasicSharedTimerSet<Clock>::Map_(int fd, size_t size, bool writable) {
+    bool existing = size == 0;
+    std::chrono::steady_clock::time_point deadline =
+        std::chrono::steady_clock::now() + internal::SharedAttachTimeout;
+    for (;;) {
+        if (existing) {
+            struct stat st;
+            if (fstat(fd, &st) != 0) {
+                std::runtime_error e = internal::SystemError(
+                    "Cannot stat shared memory '" + name_ + "'");
+                close(fd);
+                throw e;
+            }
+            size = (size_t)st.st_size;
+        }
+        if (size >= sizeof(internal::SharedHeader)) {
+            void* p = mmap(nullptr, size,
+                           PROT_READ | (writable ? PROT_WRITE : 0),
+                           MAP_SHARED, fd, 0);
+            if (p == MAP_FAILED) {
+                std::runtime_error e = internal::SystemError(
+                    "Cannot map shared memory '" + name_ + "'");
+                close(fd);
+                throw e;
+            }
+            map_ = static_cast<char*>(p);
+            size_ = size;
+            header_ = reinterpret_cast<internal::SharedHeader*>(map_);
+            if (!existing ||
+                header_->ready.load(std::memory_order_acquire) != 0) {
+                break;
+            }
+            munmap(map_, size_);
+        }
+        if (std::chrono::steady_clock::now() >= deadline) {
+            close(fd);
+            throw std::runtime_error("Shared memory '" + name_ +
+                                     "' is not a SharedTimerSet");
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    close(fd);
+    if (existing) {
+        try {
+            Check_(size);
+        } catch (...) {
+            munmap(map_, size_);
+            throw;
+        }
+    }
+}
+
+/// Check_ checks that a mapping of 'size' bytes holds a complete
+/// SharedTimerSet.
+/// Check_ is a private function and should not be used by end users.
+template <class Clock>
+void BasicSharedTimerSet<Clock>::Check_(size_t size) const {
+    if (size < sizeof(internal::SharedHeader) ||
+        header_->ready.load(std::memory_order_acquire) == 0) {
+        throw std::runtime_error("Shared memory '" + name_ +
+                                 "' is not a SharedTimerSet");
+    }
+    if (std::memcmp(header_->magic, internal::SharedTimerSetMagic, 8) != 0 ||
+        header_->version != internal::SharedTimerSetVersion ||
+        size < internal::SharedSize(header_->capacity, header_->workers)) {
+        throw std::runtime_error("Shared memory '" + name_ +
+                                 "' is not a SharedTimerSet");
+    }
+}
+
+/// Count returns the number of timers in the SharedTimerSet, including
+/// those added by other processes.
+///
+/// @retval Number of timers
+template <class Clock>
+size_t BasicSharedTimerSet<Clock>::Count(void) const {
+    return header_->timers.load(std::memory_order_acquire);
+}
+
+/// ClaimWorker makes this process use the first worker index that is not
+/// claimed, or whose process died without releasing it. Worker 0 belongs
+/// to the creating process. The timers a dead process left running on the
+/// worker are stopped, without recording a sample. A worker this process
+/// claimed before is released first.
+///
+/// @throw std::runtime_error if every worker is claimed or the set is read
+/// only
+///
+/// @retval Worker index of this process
+template <class Clock>
+size_t BasicSharedTimerSet<Clock>::ClaimWorker(void) {
+    if (row_ == nullptr) {
+        throw std::runtime_error("SharedTimerSet is read only");
+    }
+    ReleaseWorker();
+    int32_t self = (int32_t)getpid();
+    for (size_t w = 1; w < Workers(); w++) {
+        std::atomic<int32_t>& owner = Owner_(w);
+        int32_t pid = owner.load(std::memory_order_acquire);
+        if ((pid == 0 || (pid != self && !internal::ProcessAlive(pid))) &&
+            owner.compare_exchange_strong(pid, self)) {
+            Own_(w);
+            return w;
+        }
+    }
+    throw std::runtime_error("SharedTimerSet has no free worker");
+}
+
+/// ReleaseWorker releases the worker this process claimed, so that another
+/// process can claim it, and makes this process worker 0 again.
+///
+/// @throw std::runtime_error if the set is read only
+template <class Clock>
+void BasicSharedTimerSet<Clock>::ReleaseWorker(void) {
+    if (row_ == nullptr) {
+        throw std::runtime_error("SharedTimerSet is read only");
+    }
+    if (worker_ != 0) {
+        int32_t self = (int32_t)getpid();
+        Owner_(worker_).compare_exchange_strong(self, 0);
+        Worker(0);
+    }
+}
+
+/// Worker sets the worker index of this process. Two processes must not use
+/// the same index at the same time.
+///
+/// @throw std::runtime_error if the index is out of range or the set is
+/// read only
+///
+/// @param [in] worker__ Worker index, less than Workers()
+template <class Clock>
+void BasicSharedTimerSet<Clock>::Worker(size_t worker__) {
+    if (row_ == nullptr) {
+        throw std::runtime_error("SharedTimerSet is read only");
+    }
+    if (worker__ >= Workers()) {
+        throw std::runtime_error("Invalid SharedTimerSet worker " +
+                                 std::to_string(worker__));
+    }
+    worker_ = worker__;
+    row_ = slots_ + worker__ * Capacity();
+}
+
+/// Add adds a new timer with name 'timer_name', visible to every process.
+///
+/// @throw std::runtime_error if a timer with the provided name already
+/// exists, the name is too long, the set is full or read only
+///
+/// @param [in] timer_name Name of the timer
+/// @retval Handle of the new timer
+template <class Clock>
+TimerHandle BasicSharedTimerSet<Clock>::Add(const std::string& timer_name) {
+    if (row_ == nullptr) {
+        throw std::runtime_error("SharedTimerSet is read only");
+    }
+    if (timer_name.size() >= internal::SharedNameSize) {
+        throw std::runtime_error("Timer name too long for SharedTimerSet '" +
+                                 timer_name + "'");
+    }
+    Lock_();
+    size_t count = Count();
+    for (size_t i = 0; i < count; i++) {
+        if (timer_name == Name_(i)) {
+            Unlock_();
+            throw std::runtime_error("Duplicate Timer '" + timer_name + "'");
+        }
+    }
+    if (count == Capacity()) {
+        Unlock_();
+        throw std::runtime_error("SharedTimerSet is full, cannot add '" +
+                                 timer_name + "'");
+    }
+    char* name = const_cast<char*>(Name_(count));
+    std::memcpy(name, timer_name.c_str(), timer_name.size() + 1);
+    header_->timers.store((uint32_t)count + 1, std::memory_order_release);
+    Unlock_();
+    return TimerHandle(count);
+}
+
+/// Handle returns a handle to a timer by name.
+///
+/// @throw std::runtime_error if a timer with the provided name does not exist
+///
+/// @param [in] timer_name Name of the timer
+/// @retval Handle of the timer with the given timer_name
+template <class Clock>
+TimerHandle BasicSharedTimerSet<Clock>::Handle(
+    const std::string& timer_name) const {
+    size_t count = Count();
+    for (size_t i = 0; i < count; i++) {
+        if (timer_name == Name_(i)) {
+            return TimerHandle(i);
+        }
+    }
+    throw std::runtime_error("Invalid Timer '" + timer_name + "'");
+}
+
+/// Start starts a timer of this worker.
+///
+/// @throw std::runtime_error if the handle is not valid, the timer is
+/// already running on this worker, or the set is read only
+///
+/// @param [in] h Handle of the timer
+template <class Clock>
+inline void BasicSharedTimerSet<Clock>::Start(TimerHandle h) {
+    if (row_ == nullptr) {
+        throw std::runtime_error("SharedTimerSet is read only");
+    }
+    internal::SharedSlot& slot = Row_(h);
+    if (slot.running) {
+        throw std::runtime_error("Start called on a running timer");
+    }
+    slot.running = 1;
+    slot.start = Clock::Now();
+}
+
+/// Stop stops a timer of this worker.
+///
+/// @throw std::runtime_error if the handle is not valid, the timer is idle
+/// on this worker, or the set is read only
+///
+/// @param [in] h Handle of the timer
+template <class Clock>
+inline void BasicSharedTimerSet<Clock>::Stop(TimerHandle h) {
+    int64_t stop = Clock::Now();
+    if (row_ == nullptr) {
+        throw std::runtime_error("SharedTimerSet is read only");
+    }
+    internal::SharedSlot& slot = Row_(h);
+    if (!slot.running) {
+        throw std::runtime_error("Stop called on an idle timer");
+    }
+    slot.statistics.Record(stop - slot.start);
+    slot.running = 0;
+}
+
+/// Row_ returns the slot of a timer of this worker, checking the handle
+/// against the timers of every process, so that a default or foreign
+/// handle cannot write out of the row in the shared memory.
+/// Row_ is a private function and should not be used by end users.
+///
+/// @throw std::runtime_error if the handle is not valid
+template <class Clock>
+inline internal::SharedSlot& BasicSharedTimerSet<Clock>::Row_(TimerHandle h) {
+    if (h.index_ >= Count()) {
+        throw std::runtime_error("Invalid TimerHandle");
+    }
+    return row_[h.index_];
+}
+
+/// Own_ makes this process use worker 'worker__', which it owns, stops
+/// the timers a previous owner left running, and ends the writes it left
+/// unfinished.
+/// Own_ is a private function and should not be used by end users.
+template <class Clock>
+void BasicSharedTimerSet<Clock>::Own_(size_t worker__) {
+    Worker(worker__);
+    for (size_t i = 0; i < Capacity(); i++) {
+        std::atomic<uint64_t>& sequence = row_[i].statistics.sequence;
+        uint64_t s = sequence.load(std::memory_order_relaxed);
+        if ((s & 1) != 0) {
+            sequence.store(s + 1, std::memory_order_release);
+        }
+        row_[i].running = 0;
+    }
+}
+
+/// Lock_ takes the lock of the name table, from another process that died
+/// holding it if needed. A process that died while adding a timer had not
+/// yet published it, so the name table is consistent.
+/// Lock_ is a private function and should not be used by end users.
+template <class Clock>
+void BasicSharedTimerSet<Clock>::Lock_(void) {
+    int32_t self = (int32_t)getpid();
+    int32_t owner = 0;
+    while (!header_->lock.compare_exchange_weak(owner, self,
+                                                std::memory_order_acquire)) {
+        if (owner != 0 && owner != self && !internal::ProcessAlive(owner)) {
+            // Steal the lock from the dead owner, unless another process
+            // just did
+            if (header_->lock.compare_exchange_strong(
+                    owner, self, std::memory_order_acquire)) {
+                return;
+            }
+        }
+        owner = 0;
+        std::this_thread::yield();
+    }
+}
+
+/// Unlock_ releases the lock of the name table.
+/// Unlock_ is a private function and should not be used by end users.
+template <class Clock>
+void BasicSharedTimerSet<Clock>::Unlock_(void) {
+    header_->lock.store(0, std::memory_order_release);
+}
+
+/// Owner_ returns the process id owning worker 'worker__', or 0.
+/// Owner_ is a private function and should not be used by end users.
+template <class Clock>
+std::atomic<int32_t>& BasicSharedTimerSet<Clock>::Owner_(
+    size_t worker__) const {
+    return reinterpret_cast<std::atomic<int32_t>*>(
+        map_ + sizeof(internal::SharedHeader))[worker__];
+}
+
+/// Name_ returns the name of timer 'index' in the name table.
+/// Name_ is a private function and should not be used by end users.
+template <class Clock>
+const char* BasicSharedTimerSet<Clock>::Name_(size_t index) const {
+    return map_ + sizeof(internal::SharedHeader) +
+           internal::SharedOwnersSize(header_->workers) +
+           index * internal::SharedNameSize;
+}
+
+/// Slot_ returns the slot of timer 'index' of worker 'worker__'.
+/// Slot_ is a private function and should not be used by end users.
+template <class Clock>
+internal::SharedSlot& BasicSharedTimerSet<Clock>::Slot_(size_t worker__,
+                                                        size_t index) const {
+    return slots_[worker__ * Capacity() + index];
+}
+
+/// Aggregate_ combines the slots of timer 'index' of the workers from
+/// 'first' to 'last', excluded, into a Timer object.
+/// Aggregate_ is a private function and should not be used by end users.
+template <class Clock>
+typename BasicSharedTimerSet<Clock>::TimerType
+BasicSharedTimerSet<Clock>::Aggregate_(size_t index, size_t first,
+                                       size_t last) const {
+    uint64_t count = 0;
+    int64_t total = 0;
+    internal::Uint128 sum_squares{0, 0};
+    for (size_t w = first; w < last; w++) {
+        uint64_t slot_count;
+        int64_t slot_total;
+        internal::Uint128 slot_sum_squares;
+        Slot_(w, index).statistics.Read(slot_count, slot_total,
+                                        slot_sum_squares);
+        count += slot_count;
+        total += slot_total;
+        sum_squares = internal::Add(sum_squares, slot_sum_squares);
+    }
+
+    TimerType t(Name_(index));
+    t.count_ = count;
+    t.sampled_ = count;
+    t.totalTime_ = total;
+    t.moments_ = TimerType::AccumulatorType::FromSums(count, total,
+                                                      sum_squares);
+    return t;
+}
+
+/// Get returns the aggregate of a timer over all workers by name.
+///
+/// @throw std::runtime_error if a timer with the provided name does not exist
+///
+/// @param [in] timer_name Name of the timer
+/// @retval Aggregated Timer object
+template <class Clock>
+typename BasicSharedTimerSet<Clock>::TimerType BasicSharedTimerSet<
+    Clock>::Get(const std::string& timer_name) const {
+    return Get(Handle(timer_name));
+}
+
+/// Get returns the aggregate of a timer over all workers by handle.
+///
+/// @throw std::runtime_error if the handle is not valid
+///
+/// @param [in] h Handle of the timer
+/// @retval Aggregated Timer object
+template <class Clock>
+typename BasicSharedTimerSet<Clock>::TimerType BasicSharedTimerSet<
+    Clock>::Get(TimerHandle h) const {
+    if (h.index_ >= Count()) {
+        throw std::runtime_error("Invalid TimerHandle");
+    }
+    return Aggregate_(h.index_, 0, Workers());
+}
+
+/// Get returns the timer of one worker by handle.
+///
+/// @throw std::runtime_error if the handle or the worker is not valid
+///
+/// @param [in] h Handle of the timer
+/// @param [in] worker__ Worker index
+/// @retval Timer object of the worker
+template <class Clock>
+typename BasicSharedTimerSet<Clock>::TimerType BasicSharedTimerSet<
+    Clock>::Get(TimerHandle h, size_t worker__) const {
+    if (h.index_ >= Count() || worker__ >= Workers()) {
+        throw std::runtime_error("Invalid TimerHandle");
+    }
+    return Aggregate_(h.index_, worker__, worker__ + 1);
+}
+
+/// Operator overloading to write the aggregate of a SharedTimerSet over all
+/// workers to std::ostream
+///
+/// @param [in] out Output Stream
+/// @param [in] ts SharedTimerSet object
+/// @retval Updated output stream
+template <class Clock>
+std::ostream& operator<<(std::ostream& out,
+                         const BasicSharedTimerSet<Clock>& ts) {
+    out << std::left;
+
+    // Report header is defined in Timer.hpp
+    FormatBuffer report;
+    report.Append(internal::ReportHeader()).Append('\n');
+    report.Repeat('-', 80).Append('\n');
+    ts.ForEach([&](const typename BasicSharedTimerSet<Clock>::TimerType& t) {
+        t.Report(report);
+        report.Append('\n');
+        if (report.Size() >= internal::ReportFlushSize) {
+            out << report;
+            report.Clear();
+        }
+    });
+    report.Repeat('-', 80).Append('\n');
+    out << report;
+
+    return out;
+}
+}
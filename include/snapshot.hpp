@@ -0,0 +1,281 @@
+/// @file snapshot.hpp
+///
+/// TimerSnapshot class and the Snapshots statistics policy, for reading the
+/// statistics of a Timer while another thread records samples
+///
+#pragma once
+
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+#include "utils.hpp"
+#include "accumulator.hpp"
+
+namespace timey {
+/// TimerSnapshot is a consistent copy of the count, total and second moment
+/// of the durations of a timer, in nanoseconds, taken at one point in time.
+/// The second moment is the sum of the squared deviations from the mean, so
+/// that the standard deviation of many samples, or of merged and
+/// subtracted snapshots, does not cancel catastrophically. Snapshots are
+/// independent of the clock policy of the timer.
+///
+/// Example:
+/// @code
+///     TimerSnapshot before = t.Snapshot();
+///     std::this_thread::sleep_for(10 * Second);
+///     TimerSnapshot delta = t.Snapshot().Since(before);
+///     std::cout << delta.Count() << " " << Humanize(delta.Mean()) << endl;
+/// @endcode
+class TimerSnapshot {
+   public:
+    TimerSnapshot() : count_(0), total_(0), secondMoment_(0) {}
+    TimerSnapshot(uint64_t count__, NanosecondsType total__,
+                  double second_moment)
+        : count_(count__), total_(total__), secondMoment_(second_moment) {}
+
+    /// Name returns the name of the timer, which is set by the TimerSet the
+    /// snapshot was taken from.
+    std::string Name(void) const { return name_; }
+
+    /// Name sets the name of the timer.
+    ///
+    /// @param [in] name__ Name of the timer
+    void Name(const std::string& name__) { name_ = name__; }
+
+    /// Count returns the number of start-stop cycles.
+    uint64_t Count(void) const { return count_; }
+
+    /// Elapsed returns the total duration of the start-stop cycles.
+    NanosecondsType Elapsed(void) const { return total_; }
+
+    /// Mean returns the mean duration of a start-stop cycle, or zero if
+    /// there was none.
+    NanosecondsType Mean(void) const {
+        return count_ == 0 ? NanosecondsType(0) : total_ / (int64_t)count_;
+    }
+
+    /// StdDev returns the standard deviation of the durations, or zero if
+    /// there was no start-stop cycle.
+    NanosecondsType StdDev(void) const {
+        if (count_ == 0) {
+            return NanosecondsType(0);
+        }
+        return (int64_t)std::sqrt(secondMoment_ / count_) * Nanosecond;
+    }
+
+    /// Since returns the statistics of the start-stop cycles recorded
+    /// between 'previous' and the snapshot, undoing the merge of Chan et al.
+    /// for the second moment. If the timer was reset in between, the
+    /// snapshot is returned unchanged.
+    ///
+    /// @param [in] previous Earlier snapshot of the same timer
+    /// @retval Snapshot of the start-stop cycles since 'previous'
+    TimerSnapshot Since(const TimerSnapshot& previous) const {
+        if (previous.count_ > count_) {
+            return *this;
+        }
+        TimerSnapshot delta(count_ - previous.count_, total_ - previous.total_,
+                            0);
+        if (previous.count_ > 0 && delta.count_ > 0) {
+            double d = MeanOf_(delta) - MeanOf_(previous);
+            double m2 = secondMoment_ - previous.secondMoment_ -
+                        d * d * previous.count_ * delta.count_ / count_;
+            delta.secondMoment_ = m2 > 0 ? m2 : 0;
+        } else if (delta.count_ > 0) {
+            delta.secondMoment_ = secondMoment_;
+        }
+        delta.name_ = name_;
+        return delta;
+    }
+
+    /// Merge adds the start-stop cycles of 's' to the snapshot, as
+    /// Timer::Merge does, combining the second moments with the parallel
+    /// algorithm of Chan et al. The name of the snapshot is unchanged.
+    ///
+    /// @param [in] s Snapshot to merge
+    void Merge(const TimerSnapshot& s) {
+        if (s.count_ == 0) {
+            return;
+        }
+        if (count_ > 0) {
+            double n = (double)count_ + s.count_;
+            double d = MeanOf_(s) - MeanOf_(*this);
+            secondMoment_ += s.secondMoment_ + d * d * count_ * s.count_ / n;
+        } else {
+            secondMoment_ = s.secondMoment_;
+        }
+        count_ += s.count_;
+        total_ += s.total_;
+    }
+
+    /// SecondMoment returns the sum of the squared deviations of the
+    /// durations from their mean, in nanoseconds squared.
+    double SecondMoment(void) const { return secondMoment_; }
+
+    /// Report returns a std::string report of the snapshot in the format of
+    /// Timer::Report, without the header or decorations.
+    ///
+    /// @returns std::string report of the snapshot
+    std::string Report(void) const {
+        FormatBuffer out;
+        Report(out);
+        return out.Str();
+    }
+
+    /// Report appends the report of the snapshot to 'out', see Report().
+    ///
+    /// @param [in,out] out Buffer the report is appended to
+    void Report(FormatBuffer& out) const {
+        out.Column(name_, 15)
+            .Column(count_, 15)
+            .Column(Elapsed(), 20)
+            .Column(Mean(), 20)
+            .Column(StdDev(), 20);
+    }
+
+    /// Export adds the statistics of the snapshot to 'fields', as
+    /// Timer::Export does.
+    ///
+    /// @param [in,out] fields Fields the statistics are added to
+    void Export(TimerFields& fields) const {
+        fields.Add("count", (int64_t)count_, true);
+        fields.Add("total_ns", Elapsed().count(), true);
+        fields.Add("mean_ns", Mean().count());
+        fields.Add("stddev_ns", StdDev().count());
+    }
+
+   private:
+    /// MeanOf_ returns the mean duration of 's' in nanoseconds, unrounded.
+    static double MeanOf_(const TimerSnapshot& s) {
+        return (double)s.total_.count() / s.count_;
+    }
+
+    std::string name_;
+    uint64_t count_;
+    NanosecondsType total_;
+    /// secondMoment_ is the sum of the squared deviations from the mean, in
+    /// nanoseconds squared.
+    double secondMoment_;
+};
+
+namespace stats {
+/// Snapshots is a statistics policy keeping a copy of the count, total and
+/// exact 128-bit sum of squares of the durations behind a sequence lock, so
+/// that another thread can take a consistent TimerSnapshot while the timer
+/// is started and stopped. Stop only adds plain stores and no lock or
+/// atomic read-modify-write; Snapshot retries while a Stop is in progress.
+/// The second moment of the snapshot is derived from the exact sums, so it
+/// does not degrade over billions of samples.
+///
+/// Only one thread may start and stop the timer, and Reset and Merge must
+/// not run concurrently with Snapshot.
+template <class Clock>
+class Snapshots {
+   public:
+    Snapshots()
+        : sequence_(0),
+          count_(0),
+          total_(0),
+          sumSquaresHigh_(0),
+          sumSquaresLow_(0) {}
+    Snapshots(const Snapshots& s)
+        : sequence_(0),
+          count_(s.count_.load(std::memory_order_relaxed)),
+          total_(s.total_.load(std::memory_order_relaxed)),
+          sumSquaresHigh_(s.sumSquaresHigh_.load(std::memory_order_relaxed)),
+          sumSquaresLow_(s.sumSquaresLow_.load(std::memory_order_relaxed)) {}
+    Snapshots& operator=(const Snapshots& s) {
+        Write_(s.count_.load(std::memory_order_relaxed),
+               s.total_.load(std::memory_order_relaxed), s.SumSquares_());
+        return *this;
+    }
+
+    /// Snapshot returns a consistent copy of the statistics of the timer,
+    /// without a name. Snapshot may be called from any thread.
+    ///
+    /// @retval TimerSnapshot of the timer
+    TimerSnapshot Snapshot(void) const {
+        uint64_t before;
+        uint64_t count;
+        int64_t total;
+        internal::Uint128 sum_squares;
+        do {
+            before = sequence_.load(std::memory_order_acquire);
+            count = count_.load(std::memory_order_relaxed);
+            total = total_.load(std::memory_order_relaxed);
+            sum_squares = SumSquares_();
+            std::atomic_thread_fence(std::memory_order_acquire);
+        } while ((before & 1) != 0 ||
+                 before != sequence_.load(std::memory_order_relaxed));
+        double ns_per_tick = Clock::NanosecondsPerTick();
+        return TimerSnapshot(
+            count, Clock::ToNanoseconds(total),
+            internal::SecondMoment(count, total, sum_squares) * ns_per_tick *
+                ns_per_tick);
+    }
+
+   protected:
+    void Reset_(void) { Write_(0, 0, internal::Uint128{0, 0}); }
+
+    void Start_(void) {}
+
+    void Stop_(int64_t) {}
+
+    void Add_(int64_t x, size_t count) {
+        uint64_t magnitude = x < 0 ? 0 - (uint64_t)x : (uint64_t)x;
+        Write_(count, total_.load(std::memory_order_relaxed) + x,
+               internal::Add(SumSquares_(),
+                             internal::Multiply(magnitude, magnitude)));
+    }
+
+    void Merge_(const Snapshots& s, size_t count, size_t s_count) {
+        Write_(count + s_count,
+               total_.load(std::memory_order_relaxed) +
+                   s.total_.load(std::memory_order_relaxed),
+               internal::Add(SumSquares_(), s.SumSquares_()));
+    }
+
+    void ReportHeader_(FormatBuffer&) const {}
+
+    void Report_(FormatBuffer&) const {}
+
+    void Export_(TimerFields&) const {}
+
+   private:
+    /// Write_ stores new statistics inside a write section of the sequence
+    /// lock.
+    void Write_(uint64_t count, int64_t total, internal::Uint128 sum_squares) {
+        uint64_t sequence = sequence_.load(std::memory_order_relaxed);
+        sequence_.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        count_.store(count, std::memory_order_relaxed);
+        total_.store(total, std::memory_order_relaxed);
+        sumSquaresHigh_.store(sum_squares.high, std::memory_order_relaxed);
+        sumSquaresLow_.store(sum_squares.low, std::memory_order_relaxed);
+        sequence_.store(sequence + 2, std::memory_order_release);
+    }
+
+    /// SumSquares_ returns the sum of squares, which is only consistent
+    /// on the writing thread or inside a read section of the sequence lock.
+    internal::Uint128 SumSquares_(void) const {
+        return internal::Uint128{
+            sumSquaresHigh_.load(std::memory_order_relaxed),
+            sumSquaresLow_.load(std::memory_order_relaxed)};
+    }
+
+    /// sequence_ is odd while a write is in progress.
+    std::atomic<uint64_t> sequence_;
+    std::atomic<uint64_t> count_;
+    /// total_ is the total duration in clock ticks.
+    std::atomic<int64_t> total_;
+    /// sumSquaresHigh_ and sumSquaresLow_ are the halves of the exact sum of
+    /// the squared durations in clock ticks.
+    std::atomic<uint64_t> sumSquaresHigh_;
+    std::atomic<uint64_t> sumSquaresLow_;
+};
+}
+}
@@ -0,0 +1,428 @@
+/// @file snapshotfile.hpp
+///
+/// Lossless snapshot files of timers, and ClusterTimerSet merging the
+/// snapshot files of many nodes
+///
+#pragma once
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "utils.hpp"
+#include "timer.hpp"
+#include "snapshot.hpp"
+#include "export.hpp"
+
+namespace timey {
+namespace internal {
+/// SnapshotFileMagic is the first line of a snapshot file, which holds the
+/// version of the format. Version 1 files held the sum of squares where
+/// version 2 files hold the second moment.
+inline const std::string& SnapshotFileMagic(void) {
+    static const std::string magic = "timey-snapshot 2";
+    return magic;
+}
+
+/// SnapshotFileMagicV1 is the first line of a version 1 snapshot file.
+inline const std::string& SnapshotFileMagicV1(void) {
+    static const std::string magic = "timey-snapshot 1";
+    return magic;
+}
+
+/// SummaryOf returns the snapshot written to a snapshot file for a timer.
+template <class TimerType>
+TimerSnapshot SummaryOf(const TimerType& t) {
+    return t.Summary();
+}
+
+inline const TimerSnapshot& SummaryOf(const TimerSnapshot& s) { return s; }
+
+/// SnapshotLine writes a timer as a line of a snapshot file: the count and
+/// the total in nanoseconds as integers, the second moment as a hexadecimal
+/// floating point number, which is read back bit for bit, and the name with
+/// backslashes and line breaks escaped.
+struct SnapshotLine {
+    std::ostream* out;
+    FormatBuffer* buffer;
+
+    template <class TimerType>
+    void operator()(const TimerType& t) {
+        const TimerSnapshot& s = SummaryOf(t);
+        char second_moment[64];
+        int n = std::snprintf(second_moment, sizeof(second_moment), "%a",
+                              s.SecondMoment());
+        buffer->AppendInteger(s.Count())
+            .Append(' ')
+            .AppendSigned(s.Elapsed().count())
+            .Append(' ')
+            .Append(second_moment, (size_t)n)
+            .Append(' ');
+        for (char c : s.Name()) {
+            if (c == '\\') {
+                buffer->Append("\\\\", 2);
+            } else if (c == '\n') {
+                buffer->Append("\\n", 2);
+            } else {
+                buffer->Append(c);
+            }
+        }
+        buffer->Append('\n');
+        Flush(*out, *buffer);
+    }
+};
+
+/// ParseSnapshotLine parses a line of a snapshot file written by
+/// SnapshotLine. The sum of squares of a version 1 line is converted to the
+/// second moment, with the rounding that version 1 files suffered from.
+///
+/// @throw std::runtime_error if the line is malformed
+///
+/// @param [in] line Line without its line break
+/// @param [in] version1 Whether the line is from a version 1 file
+/// @retval Snapshot of the line
+inline TimerSnapshot ParseSnapshotLine(const std::string& line,
+                                       bool version1 = false) {
+    const char* p = line.c_str();
+    char* end;
+    errno = 0;
+    uint64_t count = std::strtoull(p, &end, 10);
+    bool valid = end != p && *end == ' ' && *p != '-';
+    p = end;
+    int64_t total = std::strtoll(p, &end, 10);
+    valid = valid && end != p && *end == ' ';
+    p = end;
+    double second_moment = std::strtod(p, &end);
+    valid = valid && end != p && *end == ' ' && errno == 0;
+    if (!valid) {
+        throw std::runtime_error("Invalid snapshot line '" + line + "'");
+    }
+
+    std::string name;
+    for (p = end + 1; *p != '\0'; p++) {
+        if (*p == '\\' && (p[1] == '\\' || p[1] == 'n')) {
+            name += p[1] == 'n' ? '\n' : '\\';
+            p++;
+        } else {
+            name += *p;
+        }
+    }
+    if (version1 && count > 0) {
+        second_moment -= (double)total * total / count;
+        second_moment = second_moment > 0 ? second_moment : 0;
+    }
+    TimerSnapshot s(count, total * Nanosecond, second_moment);
+    s.Name(name);
+    return s;
+}
+}
+
+/// WriteSnapshotFile writes the count, total and second moment of the
+/// durations of each timer in 'timers' to 'out' in the snapshot file format,
+/// which ReadSnapshotFile reads back without loss, unlike the humanized
+/// durations of the reports:
+/// @code
+///     timey-snapshot 2
+///     10 52000 0x1.0c8p+18 solve
+/// @endcode
+///
+/// The count and total are exact integers and the second moment is the
+/// double of Timer::Summary, bit for bit. Merging snapshots combines the
+/// second moments with the algorithm of Chan et al., so that the standard
+/// deviation of many merged nodes keeps the precision of the accumulators
+/// instead of cancelling a sum of squares against the squared mean.
+///
+/// 'timers' is a timer, a TimerSet, StaticTimerSet, ConcurrentTimerSet or
+/// SharedTimerSet, or snapshots. Timers are taken with Timer::Summary.
+///
+/// @param [in] out Output Stream
+/// @param [in] timers Timers to write
+template <class TimerSetType>
+void WriteSnapshotFile(std::ostream& out, const TimerSetType& timers) {
+    FormatBuffer buffer;
+    buffer.Append(internal::SnapshotFileMagic()).Append('\n');
+    internal::SnapshotLine line = {&out, &buffer};
+    internal::Exported(timers).ForEach(line);
+    out << buffer;
+}
+
+/// WriteSnapshotFile writes the timers in 'timers' to the file 'path', see
+/// WriteSnapshotFile. The file is written under a temporary name and
+/// renamed, so that a merge never reads a partial file.
+///
+/// @throw std::runtime_error if the file cannot be written
+///
+/// @param [in] path Path of the file
+/// @param [in] timers Timers to write
+template <class TimerSetType>
+void WriteSnapshotFile(const std::string& path, const TimerSetType& timers) {
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream out(temporary.c_str());
+        if (!out) {
+            throw internal::SystemError("Cannot create '" + temporary + "'");
+        }
+        WriteSnapshotFile(out, timers);
+        out.close();
+        if (!out) {
+            throw std::runtime_error("Cannot write '" + temporary + "'");
+        }
+    }
+    if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+        throw internal::SystemError("Cannot rename '" + temporary + "'");
+    }
+}
+
+/// ReadSnapshotFile reads the snapshots written by WriteSnapshotFile, in
+/// the order they were written. Version 1 files, holding the sum of
+/// squares, are still read.
+///
+/// @throw std::runtime_error if the stream is not a snapshot file, or holds
+/// the same timer twice
+///
+/// @param [in] in Input stream
+/// @retval Snapshots of the timers
+inline std::vector<TimerSnapshot> ReadSnapshotFile(std::istream& in) {
+    std::string line;
+    if (!std::getline(in, line) || (line != internal::SnapshotFileMagic() &&
+                                    line != internal::SnapshotFileMagicV1())) {
+        throw std::runtime_error("Not a timey snapshot file");
+    }
+    bool version1 = line == internal::SnapshotFileMagicV1();
+    std::vector<TimerSnapshot> snapshots;
+    std::set<std::string> names;
+    while (std::getline(in, line)) {
+        snapshots.push_back(internal::ParseSnapshotLine(line, version1));
+        if (!names.insert(snapshots.back().Name()).second) {
+            throw std::runtime_error("Duplicate Timer '" +
+                                     snapshots.back().Name() + "'");
+        }
+    }
+    return snapshots;
+}
+
+/// ReadSnapshotFile reads the snapshot file 'path', see ReadSnapshotFile.
+///
+/// @throw std::runtime_error if the file cannot be read or is not a
+/// snapshot file
+///
+/// @param [in] path Path of the file
+/// @retval Snapshots of the timers
+inline std::vector<TimerSnapshot> ReadSnapshotFile(const std::string& path) {
+    std::ifstream in(path.c_str());
+    if (!in) {
+        throw internal::SystemError("Cannot open '" + path + "'");
+    }
+    try {
+        return ReadSnapshotFile(in);
+    } catch (const std::runtime_error& e) {
+        throw std::runtime_error(path + ": " + e.what());
+    }
+}
+
+/// ClusterTimer is the merge of one timer over the nodes of a cluster: the
+/// count, total, mean and standard deviation of the durations of every
+/// node, and the spread of the total between the nodes that have the timer.
+class ClusterTimer {
+   public:
+    ClusterTimer() : nodes_(0), minTotal_(0), maxTotal_(0) {}
+
+    /// Constructs the cluster timer of one node.
+    ///
+    /// @param [in] s Snapshot of the timer on the node
+    explicit ClusterTimer(const TimerSnapshot& s)
+        : timer_(s),
+          nodes_(1),
+          minTotal_(s.Elapsed()),
+          maxTotal_(s.Elapsed()) {}
+
+    /// Merge adds the nodes of 't' to the timer.
+    ///
+    /// @param [in] t Timer of other nodes
+    void Merge(const ClusterTimer& t) {
+        if (t.nodes_ == 0) {
+            return;
+        }
+        minTotal_ = nodes_ == 0 || t.minTotal_ < minTotal_ ? t.minTotal_
+                                                           : minTotal_;
+        maxTotal_ = nodes_ == 0 || t.maxTotal_ > maxTotal_ ? t.maxTotal_
+                                                           : maxTotal_;
+        if (nodes_ == 0) {
+            timer_.Name(t.timer_.Name());
+        }
+        timer_.Merge(t.timer_);
+        nodes_ += t.nodes_;
+    }
+
+    /// Timer returns the timer merged over the nodes.
+    const TimerSnapshot& Timer(void) const { return timer_; }
+
+    /// Name returns the name of the timer.
+    std::string Name(void) const { return timer_.Name(); }
+
+    /// Count returns the number of start-stop cycles on every node.
+    uint64_t Count(void) const { return timer_.Count(); }
+
+    /// Nodes returns the number of nodes that have the timer.
+    size_t Nodes(void) const { return nodes_; }
+
+    /// MinNodeTotal returns the smallest total of a node.
+    NanosecondsType MinNodeTotal(void) const { return minTotal_; }
+
+    /// MaxNodeTotal returns the largest total of a node.
+    NanosecondsType MaxNodeTotal(void) const { return maxTotal_; }
+
+    /// Skew returns the largest total of a node over the mean total of the
+    /// nodes: 1 when the nodes are balanced, and the slowdown the slowest
+    /// node causes otherwise. Skew is zero if no node ran the timer.
+    double Skew(void) const {
+        if (nodes_ == 0 || timer_.Elapsed().count() == 0) {
+            return 0;
+        }
+        return (double)maxTotal_.count() * nodes_ / timer_.Elapsed().count();
+    }
+
+    /// ReportHeader appends the header of the columns of Report to 'out'.
+    ///
+    /// @param [in,out] out Buffer the header is appended to
+    void ReportHeader(FormatBuffer& out) const {
+        out.Append(internal::ReportHeader())
+            .Column("Nodes", 10)
+            .Column("Min Node", 20)
+            .Column("Max Node", 20)
+            .Append("Skew");
+    }
+
+    /// Report appends the report of the timer to 'out', in the format of
+    /// Timer::Report followed by the number of nodes, the smallest and
+    /// largest total of a node and the skew.
+    ///
+    /// @param [in,out] out Buffer the report is appended to
+    void Report(FormatBuffer& out) const {
+        timer_.Report(out);
+        char skew[21];
+        size_t n = internal::DecimalTo(
+            skew, (uint64_t)(Skew() * 100 + 0.5), 2);
+        out.Column((uint64_t)nodes_, 10)
+            .Column(minTotal_, 20)
+            .Column(maxTotal_, 20)
+            .Append(skew, n);
+    }
+
+    /// Export adds the statistics of the timer to 'fields', as
+    /// Timer::Export does, followed by the number of nodes and the smallest
+    /// and largest total of a node.
+    ///
+    /// @param [in,out] fields Fields the statistics are added to
+    void Export(TimerFields& fields) const {
+        timer_.Export(fields);
+        fields.Add("nodes", (int64_t)nodes_);
+        fields.Add("node_min_total_ns", minTotal_.count());
+        fields.Add("node_max_total_ns", maxTotal_.count());
+    }
+
+   private:
+    TimerSnapshot timer_;
+    size_t nodes_;
+    NanosecondsType minTotal_;
+    NanosecondsType maxTotal_;
+};
+
+/// ClusterTimerSet merges the snapshot files of the nodes of a cluster, by
+/// timer name. ClusterTimerSets merge with each other, so that the files of
+/// many nodes can be read and merged in parallel with Reduce.
+///
+/// Example:
+/// @code
+///     std::vector<ClusterTimerSet> nodes(paths.size());
+///     for (size_t i = 0; i < paths.size(); i++) {
+///         nodes[i].Add(ReadSnapshotFile(paths[i]));
+///     }
+///     std::cout << Reduce(nodes.begin(), nodes.end()) << std::endl;
+/// @endcode
+class ClusterTimerSet {
+   public:
+    ClusterTimerSet() : nodes_(0) {}
+
+    /// Add adds the timers of one node, with distinct names.
+    ///
+    /// @param [in] node Snapshots of the timers of the node
+    void Add(const std::vector<TimerSnapshot>& node) {
+        for (auto& s : node) {
+            timers_[s.Name()].Merge(ClusterTimer(s));
+        }
+        nodes_++;
+    }
+
+    /// Merge adds the nodes of 'ts' to the set.
+    ///
+    /// @param [in] ts Set of other nodes
+    void Merge(const ClusterTimerSet& ts) {
+        for (auto& t : ts.timers_) {
+            timers_[t.first].Merge(t.second);
+        }
+        nodes_ += ts.nodes_;
+    }
+
+    /// Count returns the number of timers.
+    size_t Count(void) const { return timers_.size(); }
+
+    /// Nodes returns the number of nodes added.
+    size_t Nodes(void) const { return nodes_; }
+
+    /// Get returns a timer by name.
+    ///
+    /// @throw std::runtime_error if a timer with the provided name does not
+    /// exist
+    ///
+    /// @param [in] timer_name Name of the timer
+    /// @retval Merged timer
+    const ClusterTimer& Get(const std::string& timer_name) const {
+        auto it = timers_.find(timer_name);
+        if (it == timers_.end()) {
+            throw std::runtime_error("Invalid Timer '" + timer_name + "'");
+        }
+        return it->second;
+    }
+
+    /// ForEach calls 'fn' with each timer, in name order.
+    ///
+    /// @param [in] fn Function taking a const ClusterTimer&
+    template <class Fn>
+    void ForEach(Fn fn) const {
+        for (auto& t : timers_) {
+            fn(t.second);
+        }
+    }
+
+   private:
+    std::map<std::string, ClusterTimer> timers_;
+    size_t nodes_;
+};
+
+/// Operator overloading to write a ClusterTimerSet to std::ostream
+///
+/// @param [in] out Output Stream
+/// @param [in] ts ClusterTimerSet object
+/// @retval Updated output stream
+inline std::ostream& operator<<(std::ostream& out, const ClusterTimerSet& ts) {
+    FormatBuffer report;
+    ClusterTimer().ReportHeader(report);
+    size_t rule = report.Size();
+    report.Append('\n').Repeat('-', rule).Append('\n');
+    ts.ForEach([&](const ClusterTimer& t) {
+        t.Report(report);
+        report.Append('\n');
+        internal::Flush(out, report);
+    });
+    report.Repeat('-', rule).Append('\n');
+    return out << report;
+}
+}
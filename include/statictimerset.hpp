@@ -0,0 +1,254 @@
+/// @file statictimerset.hpp
+///
+/// StaticTimerSet class
+///
+#pragma once
+
+#include <iostream>
+#include <iomanip>
+#include <cstdint>
+#include <type_traits>
+
+#include "utils.hpp"
+#include "timer.hpp"
+
+/// TIMEY_TIMER_TAG declares a tag type naming a timer of a StaticTimerSet.
+///
+/// @param tag Name of the tag type
+/// @param name String literal name of the timer
+#define TIMEY_TIMER_TAG(tag, name)                                      \
+    struct tag {                                                        \
+        static constexpr const char* Name() { return name; }            \
+        static constexpr uint64_t Id() { return ::timey::TimerId(name); } \
+    }
+
+namespace timey {
+/// TimerId returns the compile time identifier of a timer name, which is the
+/// 64-bit FNV-1a hash of the name.
+///
+/// @param [in] name Null terminated name of the timer
+/// @param [in] hash Hash of the preceding characters
+/// @retval Identifier of the timer name
+constexpr uint64_t TimerId(const char* name,
+                           uint64_t hash = 14695981039346656037ULL) {
+    return (*name == '\0')
+               ? hash
+               : TimerId(name + 1,
+                         (hash ^ (uint64_t)(unsigned char)*name) *
+                             1099511628211ULL);
+}
+
+namespace internal {
+/// ContainsId is true if one of Tags has the identifier Id.
+template <uint64_t Id, class... Tags>
+struct ContainsId : std::false_type {};
+
+template <uint64_t Id, class T, class... Ts>
+struct ContainsId<Id, T, Ts...>
+    : std::integral_constant<bool, T::Id() == Id ||
+                                       ContainsId<Id, Ts...>::value> {};
+
+/// UniqueIds is true if no two of Tags have the same identifier.
+template <class... Tags>
+struct UniqueIds : std::true_type {};
+
+template <class T, class... Ts>
+struct UniqueIds<T, Ts...>
+    : std::integral_constant<bool, !ContainsId<T::Id(), Ts...>::value &&
+                                       UniqueIds<Ts...>::value> {};
+
+template <uint64_t Id, class... Tags>
+struct IndexOfId;
+
+template <uint64_t Id, class... Tags>
+struct IndexOfIdNext
+    : std::integral_constant<size_t, 1 + IndexOfId<Id, Tags...>::value> {};
+
+/// IndexOfId is the position of the tag with identifier Id in Tags.
+template <uint64_t Id>
+struct IndexOfId<Id> {
+    static_assert(Id != Id, "Unknown timer in StaticTimerSet");
+};
+
+template <uint64_t Id, class T, class... Ts>
+struct IndexOfId<Id, T, Ts...>
+    : std::conditional<T::Id() == Id, std::integral_constant<size_t, 0>,
+                       IndexOfIdNext<Id, Ts...>>::type {};
+}
+
+/// BasicStaticTimerSet class is a fixed set of timers whose names are known
+/// at compile time.
+///
+/// Timers are named by tag types declared with TIMEY_TIMER_TAG and addressed
+/// either by tag or by TimerId of their name. The name to timer resolution
+/// happens at compile time, so Start and Stop are a direct array access.
+/// Duplicate names are a compile time error.
+///
+/// StaticTimerSet is a BasicStaticTimerSet of Timer objects.
+///
+/// Example:
+/// @code
+///     TIMEY_TIMER_TAG(Assemble, "assemble");
+///     TIMEY_TIMER_TAG(Solve, "solve");
+///
+///     StaticTimerSet<Assemble, Solve> ts;
+///     for(size_t i = 0; i < n; i++) {
+///         ts.Start<Assemble>();
+///         assemble();
+///         ts.Stop<Assemble>();
+///
+///         ts.Start<TimerId("solve")>();
+///         solve();
+///         ts.Stop<TimerId("solve")>();
+///     }
+///
+///     // Write the timing report to stdout
+///     std::cout << ts << std::endl;
+/// @endcode
+template <class TimerType, class... Tags>
+class BasicStaticTimerSet {
+    static_assert(sizeof...(Tags) > 0, "StaticTimerSet needs a timer");
+    static_assert(internal::UniqueIds<Tags...>::value,
+                  "Duplicate Timer in StaticTimerSet");
+
+   public:
+    BasicStaticTimerSet() {
+        const char* names[] = {Tags::Name()...};
+        for (size_t i = 0; i < sizeof...(Tags); i++) {
+            timers_[i].Name(names[i]);
+        }
+    }
+
+    /// Count returns the count of timers in the StaticTimerSet
+    ///
+    /// @retval Number of timers in the StaticTimerSet
+    static constexpr size_t Count(void) { return sizeof...(Tags); }
+
+    /// Index returns the position of a timer in the StaticTimerSet by
+    /// identifier.
+    ///
+    /// @retval Index of the timer
+    template <uint64_t Id>
+    static constexpr size_t Index(void) {
+        return internal::IndexOfId<Id, Tags...>::value;
+    }
+
+    /// Running returns true if any of the timers in the StaticTimerSet are
+    /// currently running, false otherwise.
+    ///
+    /// @retval TRUE if any of the timers in the StaticTimerSet are running
+    /// @retval FALSE otherwise
+    bool Running(void) const {
+        for (auto& t : timers_) {
+            if (t.Running()) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// ForEach calls 'fn' with each timer in the StaticTimerSet, in the order
+    /// they were declared.
+    ///
+    /// @param [in] fn Function taking a const TimerType&
+    template <class Fn>
+    void ForEach(Fn fn) const {
+        for (auto& t : timers_) {
+            fn(t);
+        }
+    }
+
+    /// Start starts a timer in the StaticTimerSet by identifier.
+    template <uint64_t Id>
+    void Start(void) {
+        timers_[Index<Id>()].Start();
+    }
+
+    /// Stop stops a timer in the StaticTimerSet by identifier.
+    template <uint64_t Id>
+    void Stop(void) {
+        timers_[Index<Id>()].Stop();
+    }
+
+    /// Restart restarts a timer in the StaticTimerSet by identifier.
+    template <uint64_t Id>
+    void Restart(void) {
+        timers_[Index<Id>()].Restart();
+    }
+
+    /// Reset resets a timer in the StaticTimerSet by identifier.
+    template <uint64_t Id>
+    void Reset(void) {
+        timers_[Index<Id>()].Reset();
+    }
+
+    /// Get returns a timer in the StaticTimerSet by identifier.
+    ///
+    /// @retval Timer object with the given identifier
+    template <uint64_t Id>
+    TimerType& Get(void) {
+        return timers_[Index<Id>()];
+    }
+
+    /// Start starts a timer in the StaticTimerSet by tag.
+    template <class Tag>
+    void Start(void) {
+        Start<Tag::Id()>();
+    }
+
+    /// Stop stops a timer in the StaticTimerSet by tag.
+    template <class Tag>
+    void Stop(void) {
+        Stop<Tag::Id()>();
+    }
+
+    /// Restart restarts a timer in the StaticTimerSet by tag.
+    template <class Tag>
+    void Restart(void) {
+        Restart<Tag::Id()>();
+    }
+
+    /// Reset resets a timer in the StaticTimerSet by tag.
+    template <class Tag>
+    void Reset(void) {
+        Reset<Tag::Id()>();
+    }
+
+    /// Get returns a timer in the StaticTimerSet by tag.
+    ///
+    /// @retval Timer object with the given tag
+    template <class Tag>
+    TimerType& Get(void) {
+        return Get<Tag::Id()>();
+    }
+
+    // Friend functions
+    template <class T, class... Ts>
+    friend std::ostream& operator<<(std::ostream& out,
+                                    const BasicStaticTimerSet<T, Ts...>& ts);
+
+   private:
+    /// timers_ holds the timers in the order of Tags.
+    TimerType timers_[sizeof...(Tags)];
+};
+
+/// StaticTimerSet is a BasicStaticTimerSet of Timer objects.
+template <class... Tags>
+using StaticTimerSet = BasicStaticTimerSet<Timer, Tags...>;
+
+/// Operator overloading to write a StaticTimerSet object to std::ostream.
+/// Timers are written in the order they were declared.
+///
+/// @param [in] out Output Stream
+/// @param [in] ts StaticTimerSet object
+/// @retval Updated output stream
+template <class TimerType, class... Tags>
+std::ostream& operator<<(std::ostream& out,
+                         const BasicStaticTimerSet<TimerType, Tags...>& ts) {
+    out << std::left;
+    internal::WriteReport<TimerType>(
+        out, std::begin(ts.timers_), std::end(ts.timers_),
+        [](const TimerType& t) -> const TimerType& { return t; });
+    return out;
+}
+}
@@ -0,0 +1,354 @@
+/// @file stats.hpp
+///
+/// Statistics policies for Timer
+///
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+#include "utils.hpp"
+#include "samplebuffer.hpp"
+#include "histogram.hpp"
+
+namespace timey {
+namespace internal {
+/// PercentileHeader returns the fixed format header of the percentile
+/// columns reported for timers with a histogram.
+///
+/// @retval std::string Fixed format header string.
+inline const std::string& PercentileHeader(void) {
+    static const std::string header =
+        "p50" + std::string(12, ' ') + "p90" + std::string(12, ' ') + "p99" +
+        std::string(12, ' ') + "p99.9" + std::string(10, ' ') + "Max" +
+        std::string(12, ' ');
+    return header;
+}
+}
+
+/// The stats namespace holds the statistics policies a BasicTimer is
+/// parameterized with, in addition to its accumulator policy.
+///
+/// A statistics policy is a class template on the clock policy. The timer
+/// derives from each of its statistics policies, so their public functions
+/// are functions of the timer. A statistics policy provides the protected
+/// functions:
+///   * Reset_() clearing the statistics
+///   * Start_() and Stop_(stop) called by Start and Stop around the clock
+///     reads of the timed start-stop cycles, where 'stop' is the clock tick
+///     Stop read; Stop then calls Add_ with the duration
+///   * Add_(x, count) adding duration 'x', in clock ticks, where 'count' is
+///     the number of durations including 'x'
+///   * Merge_(s, count, s_count) merging the statistics 's' of 's_count'
+///     durations into ones of 'count' durations
+///   * ReportHeader_(out) appending the header of the reported columns to
+///     the FormatBuffer 'out'
+///   * Report_(out) appending the reported columns to the FormatBuffer 'out'
+///   * Export_(fields) adding the statistics, in nanoseconds, to the
+///     TimerFields 'fields'
+///
+/// Stop only does the work of the chosen policies, so statistics that are
+/// not needed cost nothing.
+///
+/// Example:
+/// @code
+///     // Count and total only
+///     BasicTimer<SteadyClock, NoMoments, stats::Pack<>> cheap;
+///     // Mean, standard deviation, min and max
+///     BasicTimer<SteadyClock, DefaultMoments, stats::Pack<stats::MinMax>> t;
+/// @endcode
+namespace stats {
+/// Pack is the list of statistics policies of a BasicTimer.
+template <template <class> class... Stats>
+struct Pack {};
+
+/// MinMax is a statistics policy keeping the shortest and longest duration
+/// and the index of the start-stop cycle each occurred at.
+template <class Clock>
+class MinMax {
+   public:
+    MinMax() { Reset_(); }
+
+    /// Min returns the shortest duration, or zero if the timer was never
+    /// stopped.
+    ///
+    /// @retval std::chrono::duration object in Nanoseconds
+    NanosecondsType Min(void) const { return Clock::ToNanoseconds(min_); }
+
+    /// Max returns the longest duration, or zero if the timer was never
+    /// stopped.
+    ///
+    /// @retval std::chrono::duration object in Nanoseconds
+    NanosecondsType Max(void) const { return Clock::ToNanoseconds(max_); }
+
+    /// MinIndex returns the index, from zero, of the first start-stop cycle
+    /// with the shortest duration.
+    size_t MinIndex(void) const { return minIndex_; }
+
+    /// MaxIndex returns the index, from zero, of the first start-stop cycle
+    /// with the longest duration.
+    size_t MaxIndex(void) const { return maxIndex_; }
+
+   protected:
+    void Reset_(void) {
+        min_ = 0;
+        max_ = 0;
+        minIndex_ = 0;
+        maxIndex_ = 0;
+    }
+
+    void Start_(void) {}
+
+    void Stop_(int64_t) {}
+
+    void Add_(int64_t x, size_t count) {
+        if (count == 1 || x < min_) {
+            min_ = x;
+            minIndex_ = count - 1;
+        }
+        if (count == 1 || x > max_) {
+            max_ = x;
+            maxIndex_ = count - 1;
+        }
+    }
+
+    void Merge_(const MinMax& s, size_t count, size_t s_count) {
+        if (s_count == 0) {
+            return;
+        }
+        if (count == 0 || s.min_ < min_) {
+            min_ = s.min_;
+            minIndex_ = count + s.minIndex_;
+        }
+        if (count == 0 || s.max_ > max_) {
+            max_ = s.max_;
+            maxIndex_ = count + s.maxIndex_;
+        }
+    }
+
+    void ReportHeader_(FormatBuffer& out) const {
+        out.Column("Min", 15).Column("Max", 15);
+    }
+
+    void Report_(FormatBuffer& out) const {
+        out.Column(Min(), 15).Column(Max(), 15);
+    }
+
+    void Export_(TimerFields& fields) const {
+        fields.Add("min_ns", Min().count());
+        fields.Add("max_ns", Max().count());
+    }
+
+   private:
+    int64_t min_;
+    int64_t max_;
+    size_t minIndex_;
+    size_t maxIndex_;
+};
+
+/// PerSample is a statistics policy optionally storing the duration of each
+/// start-stop cycle in a preallocated buffer. See ReserveSamples.
+template <class Clock>
+class PerSample {
+   public:
+    /// ReserveSamples makes the timer store the duration of each start-stop
+    /// cycle in a preallocated buffer of 'capacity' samples, so that Stop
+    /// never allocates. Once the buffer is full, SampleMode::Ring keeps the
+    /// latest samples and SampleMode::Fixed keeps the first ones. A capacity
+    /// of zero stops storing samples. Previously stored samples are
+    /// discarded.
+    ///
+    /// @param [in] capacity Number of samples to keep
+    /// @param [in] mode What to do once the buffer is full
+    void ReserveSamples(size_t capacity, SampleMode mode = SampleMode::Ring) {
+        samples_.Reserve(capacity, mode);
+    }
+
+    /// Samples returns a view of the stored durations, oldest first, without
+    /// copying them. See ReserveSamples.
+    ///
+    /// @retval SampleView of the stored durations
+    SampleView<Clock> Samples(void) const {
+        return SampleView<Clock>(samples_);
+    }
+
+   protected:
+    void Reset_(void) { samples_.Clear(); }
+
+    void Start_(void) {}
+
+    void Stop_(int64_t) {}
+
+    void Add_(int64_t x, size_t) { samples_.Add(x); }
+
+    void Merge_(const PerSample&, size_t, size_t) {}
+
+    void ReportHeader_(FormatBuffer&) const {}
+
+    void Report_(FormatBuffer&) const {}
+
+    void Export_(TimerFields&) const {}
+
+   private:
+    /// samples_ optionally stores the duration of each start-stop cycle.
+    SampleBuffer samples_;
+};
+
+/// Percentiles is a statistics policy optionally recording a log-linear
+/// histogram of the durations. See EnableHistogram.
+template <class Clock>
+class Percentiles {
+   public:
+    /// EnableHistogram makes the timer record a log-linear histogram of its
+    /// durations, from which Percentile and the percentile columns of Report
+    /// are computed. The histogram has a fixed size, set by the number of
+    /// significant digits and the highest trackable duration. Previously
+    /// recorded durations are not included.
+    ///
+    /// @throw std::invalid_argument if significant_digits is not between 1
+    /// and 5
+    ///
+    /// @param [in] significant_digits Number of significant decimal digits
+    /// @param [in] highest_trackable Highest duration tracked precisely
+    void EnableHistogram(int significant_digits = 2,
+                         NanosecondsType highest_trackable = 4 * Hour) {
+        histogram_ = Histogram(significant_digits,
+                               (int64_t)(highest_trackable.count() /
+                                         Clock::NanosecondsPerTick()));
+    }
+
+    /// HasHistogram returns true if the timer records a histogram of its
+    /// durations, false otherwise.
+    ///
+    /// @retval TRUE If the timer records a histogram
+    /// @retval FALSE Otherwise
+    bool HasHistogram(void) const { return histogram_.Enabled(); }
+
+    /// GetHistogram returns the histogram of the durations, in clock ticks.
+    ///
+    /// @retval Histogram of the durations
+    const Histogram& GetHistogram(void) const { return histogram_; }
+
+    /// Percentile returns the duration below or at which 'percentile'
+    /// percent of the start-stop cycles fall, or zero if the timer has no
+    /// histogram. See EnableHistogram.
+    ///
+    /// @param [in] percentile Percentile between 0 and 100
+    /// @retval std::chrono::duration object in Nanoseconds
+    NanosecondsType Percentile(double percentile) const {
+        return Clock::ToNanoseconds(histogram_.ValueAtPercentile(percentile));
+    }
+
+   protected:
+    void Reset_(void) { histogram_.Clear(); }
+
+    void Start_(void) {}
+
+    void Stop_(int64_t) {}
+
+    void Add_(int64_t x, size_t) { histogram_.Record(x); }
+
+    void Merge_(const Percentiles& s, size_t, size_t) {
+        histogram_.Merge(s.histogram_);
+    }
+
+    void ReportHeader_(FormatBuffer& out) const {
+        if (HasHistogram()) {
+            out.Append(internal::PercentileHeader());
+        }
+    }
+
+    void Report_(FormatBuffer& out) const {
+        if (!HasHistogram()) {
+            return;
+        }
+        out.Column(Percentile(50), 15)
+            .Column(Percentile(90), 15)
+            .Column(Percentile(99), 15)
+            .Column(Percentile(99.9), 15)
+            .Column(Percentile(100), 15);
+    }
+
+    void Export_(TimerFields& fields) const {
+        if (!HasHistogram()) {
+            return;
+        }
+        fields.Add("p50_ns", Percentile(50).count());
+        fields.Add("p90_ns", Percentile(90).count());
+        fields.Add("p99_ns", Percentile(99).count());
+        fields.Add("p999_ns", Percentile(99.9).count());
+    }
+
+   private:
+    /// histogram_ optionally records the distribution of the durations.
+    Histogram histogram_;
+};
+
+/// Default is the statistics policies of Timer: the optional per-sample
+/// buffer and the optional histogram.
+typedef Pack<PerSample, Percentiles> Default;
+}
+
+namespace internal {
+/// StatsBase derives from each statistics policy of a Pack and calls each
+/// of their functions in turn.
+template <class Clock, class Stats>
+class StatsBase;
+
+template <class Clock, template <class> class... Stats>
+class StatsBase<Clock, stats::Pack<Stats...>> : public Stats<Clock>... {
+   protected:
+    void Reset_(void) {
+        int expand[] = {0, (Stats<Clock>::Reset_(), 0)...};
+        (void)expand;
+    }
+
+    void Start_(void) {
+        int expand[] = {0, (Stats<Clock>::Start_(), 0)...};
+        (void)expand;
+    }
+
+    void Stop_(int64_t stop) {
+        int expand[] = {0, (Stats<Clock>::Stop_(stop), 0)...};
+        (void)expand;
+        (void)stop;
+    }
+
+    void Add_(int64_t x, size_t count) {
+        int expand[] = {0, (Stats<Clock>::Add_(x, count), 0)...};
+        (void)expand;
+        (void)x;
+        (void)count;
+    }
+
+    void Merge_(const StatsBase& s, size_t count, size_t s_count) {
+        int expand[] = {
+            0, (Stats<Clock>::Merge_(s, count, s_count), 0)...};
+        (void)expand;
+        (void)s;
+        (void)count;
+        (void)s_count;
+    }
+
+    void ReportHeader_(FormatBuffer& out) const {
+        int expand[] = {0, (Stats<Clock>::ReportHeader_(out), 0)...};
+        (void)expand;
+        (void)out;
+    }
+
+    void Report_(FormatBuffer& out) const {
+        int expand[] = {0, (Stats<Clock>::Report_(out), 0)...};
+        (void)expand;
+        (void)out;
+    }
+
+    void Export_(TimerFields& fields) const {
+        int expand[] = {0, (Stats<Clock>::Export_(fields), 0)...};
+        (void)expand;
+        (void)fields;
+    }
+};
+}
+}
@@ -10,8 +10,13 @@
 #include <chrono>
 #include <cstdint>
 #include <cmath>
+#include <type_traits>
 
 #include "utils.hpp"
+#include "clock.hpp"
+#include "accumulator.hpp"
+#include "stats.hpp"
+#include "snapshot.hpp"
 
 namespace timey {
 namespace internal {
@@ -19,14 +24,75 @@ namespace internal {
 /// timer and timerset statistics.
 ///
 /// @retval std::string Fixed format header string.
-const std::string ReportHeader(void) {
-    return "Timer" + std::string(10, ' ') + "Count" + std::string(10, ' ') +
-           "Total" + std::string(15, ' ') + "Mean" + std::string(16, ' ') +
-           "Std. Dev." + std::string(11, ' ');
+inline const std::string& ReportHeader(void) {
+    static const std::string header =
+        "Timer" + std::string(10, ' ') + "Count" + std::string(10, ' ') +
+        "Total" + std::string(15, ' ') + "Mean" + std::string(16, ' ') +
+        "Std. Dev." + std::string(11, ' ');
+    return header;
 }
+
+/// ReportRule returns the horizontal rule written around a report with the
+/// given header. The rule leaves out the padding of the last column of the
+/// standard header.
+///
+/// @param [in] header Header of the report
+/// @retval std::string Horizontal rule.
+inline const std::string ReportRule(const std::string& header) {
+    return std::string(header.size() - 10, '-');
 }
-/// Timer class is a wrapper around chrono::high_resolution_clock for timing
-/// computations.
+
+/// OverheadFactor is the multiple of the clock overhead below which the mean
+/// of a timer is flagged as untrustworthy in reports.
+constexpr int64_t OverheadFactor = 4;
+
+/// OverheadNote is appended to the report of a timer whose mean is within
+/// OverheadFactor times the clock overhead.
+inline const std::string& OverheadNote(void) {
+    static const std::string note = " (near clock overhead)";
+    return note;
+}
+
+/// ReportFlushSize is the number of buffered characters above which a report
+/// of many timers is written to its stream.
+constexpr size_t ReportFlushSize = 64 * 1024;
+
+/// XorShift returns the next number of a xorshift64 generator with a state
+/// per thread, for randomized sampling.
+///
+/// @retval Pseudo random number
+inline uint64_t XorShift(void) {
+    static thread_local uint64_t state =
+        0x9E3779B97F4A7C15ull ^ (uint64_t)(uintptr_t)&state;
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+/// ReportsStdDev is true if the accumulator policy keeps the second moment,
+/// so that the standard deviation is reported.
+template <class Accumulator>
+struct ReportsStdDev
+    : std::integral_constant<bool,
+                             !std::is_same<Accumulator, NoMoments>::value> {
+};
+}
+/// SamplingMode selects which start-stop cycles a sampled timer times, see
+/// BasicTimer::SampleEvery.
+enum class SamplingMode {
+    /// Fixed times every n-th cycle.
+    Fixed,
+    /// Random times cycles at random gaps of 1 to 2n - 1 cycles, n on
+    /// average, so that the samples cannot follow a period of the workload.
+    Random
+};
+
+/// BasicTimer class is a wrapper around a clock policy for timing
+/// computations. See clock.hpp for the available clock policies,
+/// accumulator.hpp for the policies accumulating the mean and standard
+/// deviation, and stats.hpp for the other statistics policies. Stop only
+/// does the work of the chosen policies.
 ///
 /// Example:
 /// @code
@@ -39,23 +105,43 @@ const std::string ReportHeader(void) {
 ///     // Write the report to stdout
 ///     std::cout << t << std::endl;
 /// @endcode
-class Timer {
+template <class Clock, class Accumulator = DefaultMoments,
+          class Stats = stats::Default>
+class BasicTimer : public internal::StatsBase<Clock, Stats> {
    public:
-    Timer();
-    Timer(const std::string name__);
-    Timer(const Timer& t);
-    ~Timer();
+    /// ClockType is the clock policy used by the timer.
+    typedef Clock ClockType;
+    /// AccumulatorType is the accumulator policy used by the timer.
+    typedef Accumulator AccumulatorType;
+    /// StatsType is the base class of the statistics policies of the timer.
+    typedef internal::StatsBase<Clock, Stats> StatsType;
+
+    BasicTimer();
+    BasicTimer(const std::string name__);
+    BasicTimer(const BasicTimer& t);
+    BasicTimer& operator=(const BasicTimer& t);
+    ~BasicTimer();
 
     // API Functions
     void Reset();
     void Start();
     void Stop();
     void Restart();
+    void Add(int64_t ticks);
+    void Merge(const BasicTimer& t);
+    BasicTimer& operator+=(const BasicTimer& t);
     NanosecondsType Elapsed() const;
     NanosecondsType ElapsedMean() const;
     NanosecondsType ElapsedStdDev() const;
+    std::string ReportHeader() const;
+    void ReportHeader(FormatBuffer& out) const;
     std::string Report() const;
-
+    void Report(FormatBuffer& out) const;
+    void Export(TimerFields& fields) const;
+    TimerSnapshot Summary() const;
+    void SampleEvery(size_t every, SamplingMode mode = SamplingMode::Fixed);
+    void SubtractClockOverhead(bool subtract = true);
+    bool NearClockOverhead() const;
     // Accessors
     /// Running returns true if the Timer is currently running, false otherwise.
     ///
@@ -68,6 +154,16 @@ class Timer {
     /// @retval Number of times the Timer was started and stopped.
     size_t Count(void) const { return count_; }
 
+    /// SampledCount returns the number of start-stop cycles that were timed,
+    /// which is Count() unless the timer is sampled.
+    ///
+    /// @retval Number of timed start-stop cycles
+    size_t SampledCount(void) const { return sampled_; }
+
+    /// SampleEvery returns the average number of start-stop cycles per timed
+    /// cycle, or 1 if the timer is not sampled.
+    size_t SampleEvery(void) const { return sampleEvery_; }
+
     /// Name returns the name of the Timer.
     ///
     /// @retval Name of the Timer
@@ -80,7 +176,13 @@ class Timer {
     void Name(const std::string name__) { name_ = name__; }
 
     // Friend functions
-    friend std::ostream& operator<<(std::ostream& out, const Timer& t);
+    template <class C, class A, class S>
+    friend std::ostream& operator<<(std::ostream& out,
+                                    const BasicTimer<C, A, S>& t);
+    template <class C>
+    friend class BasicConcurrentTimerSet;
+    template <class C>
+    friend class BasicSharedTimerSet;
 
    private:
     /// name_ is the name of the timer.
@@ -91,154 +193,567 @@ class Timer {
     /// count_ is the number of times the timer was started.
     ///
     size_t count_;
-    /// totalTime_ is the total duration of time that the timer
-    /// was running.
-    NanosecondsType totalTime_;
-    /// sampleMean_ is the estimated sample mean of the durations up to the
-    /// current count.
-    int64_t sampleMean_;
-    /// secondMoment_ is the estimate of secondMoment_ of the durations up to
-    /// the current count.
-    int64_t secondMoment_;
-    /// startTime_ is the latest time_point that timer was started.
+    /// sampled_ is the number of start-stop cycles that were timed.
+    size_t sampled_;
+    /// totalTime_ is the total duration of time, in clock ticks, of the
+    /// timed start-stop cycles.
+    int64_t totalTime_;
+    /// moments_ accumulates the mean and second moment of the durations, in
+    /// clock ticks, up to the current sampled count.
+    Accumulator moments_;
+    /// startTime_ is the latest clock tick that timer was started.
     ///
-    std::chrono::high_resolution_clock::time_point startTime_;
-    /// stopTime_ is the latest time_point that timer was stopped.
+    int64_t startTime_;
+    /// stopTime_ is the latest clock tick that timer was stopped.
     ///
-    std::chrono::high_resolution_clock::time_point stopTime_;
+    int64_t stopTime_;
+    /// overhead_ is the clock overhead, in clock ticks, subtracted from each
+    /// duration recorded by Stop, or zero.
+    int64_t overhead_;
+    /// sampleEvery_ is the average number of cycles per timed cycle.
+    size_t sampleEvery_;
+    /// countdown_ is the number of cycles left until the next timed cycle
+    /// of a sampled timer.
+    size_t countdown_;
+    /// sampling_ is the sampling mode of a sampled timer.
+    SamplingMode sampling_;
+    /// timing_ is false while the timer runs a cycle that is not timed.
+    bool timing_;
+};
+
+/// NullTimer class has the API of Timer and does nothing. Every function is
+/// an empty inline function, so instrumentation with a NullTimer compiles to
+/// nothing. Timer is a NullTimer when TIMEY_DISABLE is defined.
+class NullTimer {
+   public:
+    typedef HighResolutionClock ClockType;
+    typedef NoMoments AccumulatorType;
 
-    // Temporary variables
-    int64_t x_;
-    int64_t sampleMeanNew_;
+    NullTimer() = default;
+    template <class T>
+    explicit NullTimer(const T&) {}
+
+    void Reset(void) {}
+    void Start(void) {}
+    void Stop(void) {}
+    void Restart(void) {}
+    void Add(int64_t) {}
+    void Merge(const NullTimer&) {}
+    NullTimer& operator+=(const NullTimer&) { return *this; }
+    NanosecondsType Elapsed(void) const { return NanosecondsType(0); }
+    NanosecondsType ElapsedMean(void) const { return NanosecondsType(0); }
+    NanosecondsType ElapsedStdDev(void) const { return NanosecondsType(0); }
+    std::string ReportHeader(void) const { return internal::ReportHeader(); }
+    void ReportHeader(FormatBuffer& out) const {
+        out.Append(internal::ReportHeader());
+    }
+    std::string Report(void) const { return ""; }
+    void Report(FormatBuffer&) const {}
+    void Export(TimerFields&) const {}
+    TimerSnapshot Summary(void) const { return TimerSnapshot(); }
+    void SampleEvery(size_t, SamplingMode = SamplingMode::Fixed) {}
+    size_t SampleEvery(void) const { return 1; }
+    void ReserveSamples(size_t, SampleMode = SampleMode::Ring) {}
+    SampleView<ClockType> Samples(void) const {
+        static const SampleBuffer samples;
+        return SampleView<ClockType>(samples);
+    }
+    void EnableHistogram(int = 2, NanosecondsType = 4 * Hour) {}
+    bool HasHistogram(void) const { return false; }
+    const Histogram& GetHistogram(void) const {
+        static const Histogram histogram;
+        return histogram;
+    }
+    NanosecondsType Percentile(double) const { return NanosecondsType(0); }
+    void SubtractClockOverhead(bool = true) {}
+    bool NearClockOverhead(void) const { return false; }
+    bool Running(void) const { return false; }
+    size_t Count(void) const { return 0; }
+    size_t SampledCount(void) const { return 0; }
+    std::string Name(void) const { return ""; }
+    template <class T>
+    void Name(const T&) {}
 };
 
-Timer::Timer()
+/// Operator overloading to write a NullTimer object to std::ostream, which
+/// writes nothing.
+///
+/// @param out std::outstream&
+/// @retval Unchanged std::ostream
+inline std::ostream& operator<<(std::ostream& out, const NullTimer&) {
+    return out;
+}
+
+#ifdef TIMEY_DISABLE
+/// Timer is a NullTimer, as TIMEY_DISABLE is defined.
+typedef NullTimer Timer;
+#else
+/// Timer is a BasicTimer using the default HighResolutionClock policy.
+typedef BasicTimer<HighResolutionClock> Timer;
+#endif
+
+template <class Clock, class Accumulator, class Stats>
+BasicTimer<Clock, Accumulator, Stats>::BasicTimer()
     : running_(false),
       count_(0),
+      sampled_(0),
       totalTime_(0),
-      sampleMean_(0),
-      secondMoment_(0) {}
+      startTime_(0),
+      stopTime_(0),
+      overhead_(0),
+      sampleEvery_(1),
+      countdown_(1),
+      sampling_(SamplingMode::Fixed),
+      timing_(true) {
+    // Calibrate the clock and measure its overhead now rather than in a
+    // timed region or a report
+    Clock::NanosecondsPerTick();
+    ClockOverheadTicks<Clock>();
+}
 
-Timer::Timer(const std::string name__)
+template <class Clock, class Accumulator, class Stats>
+BasicTimer<Clock, Accumulator, Stats>::BasicTimer(const std::string name__)
     : name_(name__),
       running_(false),
       count_(0),
+      sampled_(0),
       totalTime_(0),
-      sampleMean_(0),
-      secondMoment_(0) {}
+      startTime_(0),
+      stopTime_(0),
+      overhead_(0),
+      sampleEvery_(1),
+      countdown_(1),
+      sampling_(SamplingMode::Fixed),
+      timing_(true) {
+    // Calibrate the clock and measure its overhead now rather than in a
+    // timed region or a report
+    Clock::NanosecondsPerTick();
+    ClockOverheadTicks<Clock>();
+}
 
-Timer::Timer(const Timer& t)
-    : name_(t.name_),
+template <class Clock, class Accumulator, class Stats>
+BasicTimer<Clock, Accumulator, Stats>::BasicTimer(const BasicTimer& t)
+    : StatsType(t),
+      name_(t.name_),
       running_(t.running_),
       count_(t.count_),
+      sampled_(t.sampled_),
       totalTime_(t.totalTime_),
-      sampleMean_(t.sampleMean_),
-      secondMoment_(t.secondMoment_),
+      moments_(t.moments_),
       startTime_(t.startTime_),
-      stopTime_(t.stopTime_) {}
+      stopTime_(t.stopTime_),
+      overhead_(t.overhead_),
+      sampleEvery_(t.sampleEvery_),
+      countdown_(t.countdown_),
+      sampling_(t.sampling_),
+      timing_(t.timing_) {}
 
-Timer::~Timer() {}
+template <class Clock, class Accumulator, class Stats>
+BasicTimer<Clock, Accumulator, Stats>&
+BasicTimer<Clock, Accumulator, Stats>::operator=(const BasicTimer& t) {
+    StatsType::operator=(t);
+    name_ = t.name_;
+    running_ = t.running_;
+    count_ = t.count_;
+    sampled_ = t.sampled_;
+    totalTime_ = t.totalTime_;
+    moments_ = t.moments_;
+    startTime_ = t.startTime_;
+    stopTime_ = t.stopTime_;
+    overhead_ = t.overhead_;
+    sampleEvery_ = t.sampleEvery_;
+    countdown_ = t.countdown_;
+    sampling_ = t.sampling_;
+    timing_ = t.timing_;
+    return *this;
+}
+
+template <class Clock, class Accumulator, class Stats>
+BasicTimer<Clock, Accumulator, Stats>::~BasicTimer() {}
 
 /// Reset resets the timer
 ///
-inline void Timer::Reset() {
+template <class Clock, class Accumulator, class Stats>
+inline void BasicTimer<Clock, Accumulator, Stats>::Reset() {
     running_ = false;
     count_ = 0;
-    totalTime_ = std::chrono::nanoseconds(0);
-    sampleMean_ = 0;
-    secondMoment_ = 0;
+    sampled_ = 0;
+    totalTime_ = 0;
+    countdown_ = 1;
+    timing_ = true;
+    moments_.Reset();
+    StatsType::Reset_();
 }
 
-/// Start starts an idle timer.
+/// Start starts an idle timer. A sampled timer only reads the clock for the
+/// cycles it times, see SampleEvery.
 ///
 /// @throw std::runtime_error if the timer is already running.
-inline void Timer::Start() {
+template <class Clock, class Accumulator, class Stats>
+inline void BasicTimer<Clock, Accumulator, Stats>::Start() {
     if (running_) {
         throw std::runtime_error("Start called on a running timer");
     }
-    startTime_ = std::chrono::high_resolution_clock::now();
     running_ = true;
+    if (sampleEvery_ > 1) {
+        timing_ = --countdown_ == 0;
+        if (!timing_) {
+            return;
+        }
+        countdown_ = sampling_ == SamplingMode::Fixed
+                         ? sampleEvery_
+                         : 1 + internal::XorShift() % (2 * sampleEvery_ - 1);
+    }
+    StatsType::Start_();
+    startTime_ = Clock::Now();
 }
 
 /// Stop stops a running timer.
 ///
 /// @throw std::runtime_error if the timer is already idle.
-inline void Timer::Stop() {
+template <class Clock, class Accumulator, class Stats>
+inline void BasicTimer<Clock, Accumulator, Stats>::Stop() {
     if (!running_) {
         throw std::runtime_error("Stop called on an idle timer");
     }
-    stopTime_ = std::chrono::high_resolution_clock::now();
-    count_++;
-    totalTime_ += stopTime_ - startTime_;
-    x_ = (std::chrono::duration_cast<NanosecondsType>(stopTime_ - startTime_))
-             .count();
-    sampleMeanNew_ = sampleMean_ + ((double)(x_ - sampleMean_) / count_);
-    secondMoment_ += (x_ - sampleMeanNew_) * (x_ - sampleMean_);
-    sampleMean_ = sampleMeanNew_;
     running_ = false;
+    count_++;
+    if (!timing_) {
+        timing_ = true;
+        return;
+    }
+    stopTime_ = Clock::Now();
+    StatsType::Stop_(stopTime_);
+    sampled_++;
+    int64_t x = stopTime_ - startTime_ - overhead_;
+    x = x < 0 ? 0 : x;
+    totalTime_ += x;
+    moments_.Add(x, sampled_);
+    StatsType::Add_(x, sampled_);
 }
 
 /// Restart is an alias for Stop + Start.
 ///
 /// @throw std::runtime_error as per Stop and Stop rules.
-inline void Timer::Restart() {
+template <class Clock, class Accumulator, class Stats>
+inline void BasicTimer<Clock, Accumulator, Stats>::Restart() {
     Stop();
     Start();
 }
 
+/// Add records a duration measured outside the timer, as if the timer had
+/// been started and stopped around it, and timed even if the timer is
+/// sampled. The running state of the timer is unchanged.
+///
+/// @param [in] ticks Duration in clock ticks
+template <class Clock, class Accumulator, class Stats>
+inline void BasicTimer<Clock, Accumulator, Stats>::Add(int64_t ticks) {
+    count_++;
+    sampled_++;
+    totalTime_ += ticks;
+    moments_.Add(ticks, sampled_);
+    StatsType::Add_(ticks, sampled_);
+}
+
+/// Merge combines the statistics of another timer into the timer, as if
+/// every start-stop cycle of 't' had been recorded by the timer. The
+/// accumulators combine the mean and second moment with the parallel
+/// algorithm of Chan et al., or exactly for Int128Moments.
+/// The statistics policies are merged likewise.
+/// The name, running state and sampling of the timer are unchanged. The
+/// estimated total of merged sampled timers assumes they were sampled at
+/// the same rate.
+///
+/// @param [in] t Timer to merge
+template <class Clock, class Accumulator, class Stats>
+inline void BasicTimer<Clock, Accumulator, Stats>::Merge(const BasicTimer& t) {
+    if (t.count_ == 0) {
+        return;
+    }
+    moments_.Merge(t.moments_, sampled_, t.sampled_);
+    StatsType::Merge_(t, sampled_, t.sampled_);
+    totalTime_ += t.totalTime_;
+    count_ += t.count_;
+    sampled_ += t.sampled_;
+}
+
+/// Operator overloading to merge the statistics of another timer into the
+/// timer. See Merge.
+///
+/// @param [in] t Timer to merge
+/// @retval Updated timer
+template <class Clock, class Accumulator, class Stats>
+inline BasicTimer<Clock, Accumulator, Stats>&
+BasicTimer<Clock, Accumulator, Stats>::operator+=(const BasicTimer& t) {
+    Merge(t);
+    return *this;
+}
+
 /// Elapsed returns the total time the timer was running for in
-/// duration of Nanoseconds.
+/// duration of Nanoseconds. For a sampled timer, it is the total of the
+/// timed cycles scaled by Count() / SampledCount(), which estimates the
+/// total of every cycle without bias when sampling is independent of the
+/// durations.
 ///
 /// @retval std::chrono::duration object in Nanoseconds
-inline NanosecondsType Timer::Elapsed() const { return totalTime_; }
+template <class Clock, class Accumulator, class Stats>
+inline NanosecondsType BasicTimer<Clock, Accumulator, Stats>::Elapsed() const {
+    if (sampled_ == count_) {
+        return Clock::ToNanoseconds(totalTime_);
+    }
+    if (sampled_ == 0) {
+        return NanosecondsType(0);
+    }
+    return (int64_t)((double)Clock::ToNanoseconds(totalTime_).count() *
+                     count_ / sampled_) *
+           Nanosecond;
+}
 
 /// ElapsedMean returns the mean time the timer was running per
-/// start-stop cycle in duration of Nanonseconds.
+/// start-stop cycle in duration of Nanonseconds, or zero if the timer was
+/// never stopped. For a sampled timer, it is the mean of the timed cycles.
 ///
 /// @retval std::chrono::duration object in Nanoseconds
-inline NanosecondsType Timer::ElapsedMean() const {
-    return totalTime_ / count_;
+template <class Clock, class Accumulator, class Stats>
+inline NanosecondsType BasicTimer<Clock, Accumulator, Stats>::ElapsedMean()
+    const {
+    if (sampled_ == 0) {
+        return NanosecondsType(0);
+    }
+    return Clock::ToNanoseconds(totalTime_) / sampled_;
 }
 
 /// ElapsedStdDev returns the sample standard deviation of the time the timer
-/// was running per start-stop cycle in duration of Nanoseconds.
+/// was running per start-stop cycle in duration of Nanoseconds, or zero if
+/// the timer was never stopped. For a sampled timer, it is the standard
+/// deviation of the timed cycles.
 ///
 /// @retval std::chrono::duration object in Nanoseconds
-inline NanosecondsType Timer::ElapsedStdDev() const {
-    return ((int64_t)sqrt((double)secondMoment_ / count_)) * timey::Nanosecond;
+template <class Clock, class Accumulator, class Stats>
+inline NanosecondsType BasicTimer<Clock, Accumulator, Stats>::ElapsedStdDev()
+    const {
+    if (sampled_ == 0) {
+        return NanosecondsType(0);
+    }
+    return ((int64_t)(sqrt(moments_.Variance(sampled_)) *
+                      Clock::NanosecondsPerTick())) *
+           timey::Nanosecond;
+}
+
+/// ReportHeader returns the fixed format header of the columns written by
+/// Report, which depend on the accumulator and statistics policies of the
+/// timer, on the optional statistics enabled, and on whether the timer is
+/// sampled.
+///
+/// @retval std::string Fixed format header string.
+template <class Clock, class Accumulator, class Stats>
+inline std::string BasicTimer<Clock, Accumulator, Stats>::ReportHeader()
+    const {
+    FormatBuffer out;
+    ReportHeader(out);
+    return out.Str();
+}
+
+/// ReportHeader appends the header returned by ReportHeader() to 'out'.
+///
+/// @param [in,out] out Buffer the header is appended to
+template <class Clock, class Accumulator, class Stats>
+inline void BasicTimer<Clock, Accumulator, Stats>::ReportHeader(
+    FormatBuffer& out) const {
+    const std::string& header = internal::ReportHeader();
+    if (internal::ReportsStdDev<Accumulator>::value) {
+        out.Append(header);
+    } else {
+        out.Append(header.data(), header.size() - 20);
+    }
+    if (sampleEvery_ > 1 || sampled_ != count_) {
+        out.Column("Sampled", 15);
+    }
+    StatsType::ReportHeader_(out);
 }
 
 /// Report returns a std::string report of the timer without the header or
 /// decorations.
 ///
 /// @returns std::string report of the timer
-inline std::string Timer::Report() const {
-    using std::setw;
-    using std::left;
-    std::ostringstream out;
+template <class Clock, class Accumulator, class Stats>
+inline std::string BasicTimer<Clock, Accumulator, Stats>::Report() const {
+    FormatBuffer out;
+    Report(out);
+    return out.Str();
+}
+
+/// Report appends the report returned by Report() to 'out', without
+/// allocating once the buffer has grown to the length of a report.
+///
+/// @param [in,out] out Buffer the report is appended to
+template <class Clock, class Accumulator, class Stats>
+inline void BasicTimer<Clock, Accumulator, Stats>::Report(
+    FormatBuffer& out) const {
+    out.Column(name_, 15)
+        .Column((uint64_t)count_, 15)
+        .Column(Elapsed(), 20)
+        .Column(ElapsedMean(), 20);
+    if (internal::ReportsStdDev<Accumulator>::value) {
+        out.Column(ElapsedStdDev(), 20);
+    }
+    if (sampleEvery_ > 1 || sampled_ != count_) {
+        out.Column((uint64_t)sampled_, 15);
+    }
+    StatsType::Report_(out);
+    if (NearClockOverhead()) {
+        out.Append(internal::OverheadNote());
+    }
+}
+
+/// Export adds the statistics of the timer to 'fields', as integers with
+/// durations in nanoseconds: the count, total, mean and, if the accumulator
+/// keeps it, standard deviation, the number of timed cycles of a sampled
+/// timer, followed by the fields of the statistics policies. See
+/// WriteJsonLines, WriteCsv and WriteOpenMetrics.
+///
+/// @param [in,out] fields Fields the statistics are added to
+template <class Clock, class Accumulator, class Stats>
+inline void BasicTimer<Clock, Accumulator, Stats>::Export(
+    TimerFields& fields) const {
+    fields.Add("count", (int64_t)count_, true);
+    fields.Add("total_ns", Elapsed().count(), true);
+    fields.Add("mean_ns", ElapsedMean().count());
+    if (internal::ReportsStdDev<Accumulator>::value) {
+        fields.Add("stddev_ns", ElapsedStdDev().count());
+    }
+    if (sampleEvery_ > 1 || sampled_ != count_) {
+        fields.Add("sampled", (int64_t)sampled_, true);
+    }
+    StatsType::Export_(fields);
+}
+
+/// Summary returns the count, total and second moment of the durations of
+/// the timer, in nanoseconds, as a named TimerSnapshot, which can be
+/// written to a snapshot file and merged with the timers of other
+/// processes. The second moment is the accumulator's own, so it is zero for
+/// NoMoments. The total and second moment of a sampled timer are estimates
+/// scaled from the timed cycles, as with Elapsed.
+///
+/// @retval TimerSnapshot of the timer
+template <class Clock, class Accumulator, class Stats>
+inline TimerSnapshot BasicTimer<Clock, Accumulator, Stats>::Summary() const {
+    double ns_per_tick = Clock::NanosecondsPerTick();
+    double second_moment = moments_.Variance(sampled_) * sampled_;
+    if (sampled_ != count_) {
+        second_moment =
+            sampled_ == 0 ? 0 : second_moment * count_ / sampled_;
+    }
+    TimerSnapshot s(count_, Elapsed(),
+                    second_moment * ns_per_tick * ns_per_tick);
+    s.Name(name_);
+    return s;
+}
 
-    int64_t stddev = sqrt((double)secondMoment_ / count_);
+/// SampleEvery makes the timer time only one in 'every' start-stop cycles,
+/// so that the other cycles cost no clock read and only count. The cycles
+/// are chosen by 'mode': every 'every'-th cycle, or at random gaps of
+/// 'every' cycles on average, drawn from a xorshift generator per thread.
+/// An 'every' of 0 or 1 times every cycle.
+///
+/// The statistics policies, the mean and the standard deviation describe
+/// the timed cycles; Elapsed scales their total to every cycle and Report
+/// adds their number as the "Sampled" column.
+///
+/// @param [in] every Average number of cycles per timed cycle
+/// @param [in] mode Fixed or Random sampling
+template <class Clock, class Accumulator, class Stats>
+inline void BasicTimer<Clock, Accumulator, Stats>::SampleEvery(
+    size_t every, SamplingMode mode) {
+    sampleEvery_ = every > 1 ? every : 1;
+    sampling_ = mode;
+    countdown_ = 1;
+}
 
-    out << setw(15) << left << name_ << setw(15) << count_ << setw(20)
-        << Humanize(totalTime_) << setw(20) << Humanize(totalTime_ / count_)
-        << setw(20) << Humanize(stddev * timey::Nanosecond);
+/// SubtractClockOverhead makes Stop subtract the clock overhead, see
+/// ClockOverhead, from each duration, clamping it at zero. Durations
+/// recorded before, or with Add, are unchanged.
+///
+/// @param [in] subtract Whether to subtract the clock overhead
+template <class Clock, class Accumulator, class Stats>
+inline void BasicTimer<Clock, Accumulator, Stats>::SubtractClockOverhead(
+    bool subtract) {
+    overhead_ = subtract ? ClockOverheadTicks<Clock>() : 0;
+}
 
-    return out.str();
+/// NearClockOverhead returns true if the mean duration of the timer, before
+/// any subtraction of the clock overhead, is within a few multiples of the
+/// clock overhead, so that it mostly measures the cost of timing.
+///
+/// @retval TRUE If the mean is near the clock overhead
+/// @retval FALSE Otherwise, or if the timer was never stopped
+template <class Clock, class Accumulator, class Stats>
+inline bool BasicTimer<Clock, Accumulator, Stats>::NearClockOverhead() const {
+    if (sampled_ == 0) {
+        return false;
+    }
+    int64_t overhead = ClockOverheadTicks<Clock>();
+    return totalTime_ / (int64_t)sampled_ + overhead_ <
+           internal::OverheadFactor * overhead;
 }
 
 /// Operator overloading to write a Timer object to std::ostream
 ///
 /// @param out std::outstream&
-/// @param t const Timer&
+/// @param t const BasicTimer&
 /// @retval Updated std::ostream
-std::ostream& operator<<(std::ostream& out, const Timer& t) {
-    using std::setw;
-    using std::endl;
-    using std::left;
-    out << internal::ReportHeader() << endl;
-    out << std::string(80, '-') << endl;
-    out << t.Report() << endl;
-    out << std::string(80, '-') << endl;
-    return out;
+template <class Clock, class Accumulator, class Stats>
+std::ostream& operator<<(std::ostream& out,
+                         const BasicTimer<Clock, Accumulator, Stats>& t) {
+    FormatBuffer header;
+    t.ReportHeader(header);
+    FormatBuffer report;
+    report.Append(header).Append('\n');
+    report.Repeat('-', header.Size() - 10).Append('\n');
+    t.Report(report);
+    report.Append('\n');
+    report.Repeat('-', header.Size() - 10).Append('\n');
+    return out << report;
+}
+
+namespace internal {
+/// WriteReport writes the report of the timers in ['first', 'last') to
+/// 'out', under the longest of their headers. The report is formatted into
+/// one buffer written every ReportFlushSize characters, so writing many
+/// timers does not allocate per timer.
+///
+/// @param [in] out Output Stream
+/// @param [in] first Iterator to the first timer
+/// @param [in] last Iterator past the last timer
+/// @param [in] get Function returning the timer an iterator points to
+template <class TimerType, class Iterator, class Get>
+void WriteReport(std::ostream& out, Iterator first, Iterator last, Get get) {
+    // Timers report the columns of their optional statistics only when
+    // enabled, so the longest header covers the columns of every timer
+    FormatBuffer header;
+    TimerType().ReportHeader(header);
+    FormatBuffer h;
+    for (Iterator it = first; it != last; ++it) {
+        h.Clear();
+        get(*it).ReportHeader(h);
+        if (h.Size() > header.Size()) {
+            header.Swap(h);
+        }
+    }
+
+    FormatBuffer report;
+    report.Append(header).Append('\n');
+    report.Repeat('-', header.Size() - 10).Append('\n');
+    for (Iterator it = first; it != last; ++it) {
+        get(*it).Report(report);
+        report.Append('\n');
+        if (report.Size() >= ReportFlushSize) {
+            out << report;
+            report.Clear();
+        }
+    }
+    report.Repeat('-', header.Size() - 10).Append('\n');
+    out << report;
+}
 }
 }
@@ -8,59 +8,272 @@
 #include <iomanip>
 #include <stdexcept>
 #include <map>
+#include <deque>
+#include <vector>
 
 #include "utils.hpp"
 #include "timer.hpp"
+#include "snapshot.hpp"
 
 namespace timey {
-/// TimerSet class is a container for Timer objects.
+/// TimerHandle is a cheap, stable reference to a timer in a TimerSet.
+///
+/// A handle is obtained from TimerSet::Add or TimerSet::Handle and goes
+/// straight to the timer, without looking up its name. A handle remains valid
+/// until the timer it refers to is deleted from the TimerSet. The handle
+/// carries the generation of its slot, which Delete advances, so that a
+/// stale handle is detected rather than reaching a timer added later in the
+/// same slot.
+class TimerHandle {
+   public:
+    /// Constructs an invalid handle.
+    TimerHandle() : index_(-1), generation_(0) {}
+
+    /// Index returns the position of the timer in the TimerSet storage.
+    ///
+    /// @retval Index of the timer
+    size_t Index(void) const { return index_; }
+
+    /// Valid returns true if the handle refers to a timer, false otherwise.
+    ///
+    /// @retval TRUE If the handle was obtained from a TimerSet
+    /// @retval FALSE Otherwise
+    bool Valid(void) const { return index_ != (size_t)-1; }
+
+    bool operator==(const TimerHandle& h) const {
+        return index_ == h.index_ && generation_ == h.generation_;
+    }
+    bool operator!=(const TimerHandle& h) const { return !(*this == h); }
+
+   private:
+    explicit TimerHandle(size_t index__, uint32_t generation__ = 0)
+        : index_(index__), generation_(generation__) {}
+
+    template <class T>
+    friend class BasicTimerSet;
+    template <class C>
+    friend class BasicConcurrentTimerSet;
+    template <class C>
+    friend class BasicSharedTimerSet;
+
+    /// index_ is the position of the timer in the TimerSet storage.
+    size_t index_;
+    /// generation_ is the generation of the slot when the handle was made.
+    uint32_t generation_;
+};
+
+/// BasicTimerSet class is a container for timer objects of type TimerType.
+/// TimerSet is a BasicTimerSet of Timer objects using the default clock
+/// policy.
+///
+/// Timers can be addressed by name or, on hot paths, by the TimerHandle
+/// returned from Add or Handle, which skips the name lookup.
 ///
 /// Example:
 /// @code
 ///     TimerSet ts;
 ///     ts.Add("timer1");
-///     ts.Add("timer2");
+///     TimerHandle timer2 = ts.Add("timer2");
 ///
 ///     for(size_t i = 0; i < n; i++) {
 ///         ts.Start("timer1");
 ///         compute_intensive_function_1();
 ///         ts.Stop("timer1");
 ///     }
-///     ts.Start("timer2");
-///     compute_intensive_function_2();
-///     ts.Stop("timer2");
+///     for(size_t i = 0; i < n; i++) {
+///         ts.Start(timer2);
+///         compute_intensive_function_2();
+///         ts.Stop(timer2);
+///     }
 ///
 ///     // Write the timing report to stdout
 ///     std::cout << ts << std::endl;
 /// @endcode
-class TimerSet {
+template <class TimerType>
+class BasicTimerSet {
    public:
-    TimerSet();
-    ~TimerSet();
+    BasicTimerSet();
+    ~BasicTimerSet();
 
     // API
     size_t Count(void) const;
     bool Running(void) const;
-    void Add(const std::string& timer_name);
-    void Add(const Timer& timer);
+    TimerHandle Add(const std::string& timer_name);
+    TimerHandle Add(const TimerType& timer);
     void Delete(const std::string& timer_name);
     void Start(const std::string& timer_name);
     void Stop(const std::string& timer_name);
     void Restart(const std::string& timer_name);
     void Reset(const std::string& timer_name);
-    Timer& Get(const std::string& timer_name);
+    TimerType& Get(const std::string& timer_name);
+    TimerHandle Handle(const std::string& timer_name) const;
+    void Merge(const BasicTimerSet& ts);
+    BasicTimerSet& operator+=(const BasicTimerSet& ts);
+    std::vector<TimerSnapshot> Snapshot(void) const;
+
+    // Handle API
+    /// Start starts a timer in the TimerSet by handle.
+    ///
+    /// @throw std::runtime_error if the handle is stale, unless NDEBUG is
+    /// defined
+    ///
+    /// @param [in] h Handle of the timer
+    void Start(TimerHandle h) { Slot_(h).Start(); }
+
+    /// Stop stops a timer in the TimerSet by handle.
+    ///
+    /// @throw std::runtime_error if the handle is stale, unless NDEBUG is
+    /// defined
+    ///
+    /// @param [in] h Handle of the timer
+    void Stop(TimerHandle h) { Slot_(h).Stop(); }
+
+    /// Restart restarts a timer in the TimerSet by handle.
+    ///
+    /// @throw std::runtime_error if the handle is stale, unless NDEBUG is
+    /// defined
+    ///
+    /// @param [in] h Handle of the timer
+    void Restart(TimerHandle h) { Slot_(h).Restart(); }
+
+    /// Reset resets a timer in the TimerSet to its initial state by handle.
+    ///
+    /// @throw std::runtime_error if the handle is stale, unless NDEBUG is
+    /// defined
+    ///
+    /// @param [in] h Handle of the timer
+    void Reset(TimerHandle h) { Slot_(h).Reset(); }
+
+    /// Get returns a timer in the TimerSet by handle.
+    ///
+    /// @throw std::runtime_error if the handle is invalid or its timer was
+    /// deleted
+    ///
+    /// @param [in] h Handle of the timer
+    /// @retval Timer object referred to by the handle
+    TimerType& Get(TimerHandle h) { return Checked_(h); }
+
+    /// Find returns a timer in the TimerSet by handle, or nullptr if the
+    /// handle is stale or does not belong to the TimerSet. Find never
+    /// throws.
+    ///
+    /// @param [in] h Handle of the timer
+    /// @retval Pointer to the timer referred to by the handle, or nullptr
+    TimerType* Find(TimerHandle h) noexcept {
+        if (h.index_ >= slots_.size() ||
+            generations_[h.index_] != h.generation_) {
+            return nullptr;
+        }
+        return &slots_[h.index_];
+    }
+
+    /// ForEach calls 'fn' with each timer in the TimerSet, in the order of
+    /// their names.
+    ///
+    /// @param [in] fn Function taking a const TimerType&
+    template <class Fn>
+    void ForEach(Fn fn) const {
+        for (auto& t : timers_) {
+            fn(slots_[t.second]);
+        }
+    }
 
     // Friend functions
-    friend std::ostream& operator<<(std::ostream& out, const TimerSet& ts);
+    template <class T>
+    friend std::ostream& operator<<(std::ostream& out,
+                                    const BasicTimerSet<T>& ts);
 
    private:
     bool Contains_(const std::string& timer_name) const;
-    std::map<std::string, Timer> timers_;
+    size_t Index_(const std::string& timer_name) const;
+    TimerHandle Insert_(const TimerType& t);
+    TimerType& Checked_(TimerHandle h);
+
+    /// Slot_ returns the timer referred to by a handle, checking the handle
+    /// with Checked_ unless NDEBUG is defined.
+    ///
+    /// @param h Handle of the timer
+    /// @retval Timer object referred to by the handle
+    TimerType& Slot_(TimerHandle h) {
+#ifdef NDEBUG
+        return slots_[h.index_];
+#else
+        return Checked_(h);
+#endif
+    }
+
+    /// timers_ maps timer names to their index in slots_.
+    std::map<std::string, size_t> timers_;
+    /// slots_ holds the timers. A deque keeps references to timers stable
+    /// as timers are added.
+    std::deque<TimerType> slots_;
+    /// free_ holds the indices of slots_ released by Delete.
+    std::vector<size_t> free_;
+    /// generations_ holds the generation of each slot, advanced by Delete.
+    std::vector<uint32_t> generations_;
 };
 
-TimerSet::TimerSet() {}
+/// NullTimerSet class has the API of TimerSet and does nothing. Every
+/// function is an empty inline function taking its arguments as they are, so
+/// instrumentation with a NullTimerSet compiles to nothing, not even the
+/// construction of a timer name. TimerSet is a NullTimerSet when
+/// TIMEY_DISABLE is defined.
+class NullTimerSet {
+   public:
+    size_t Count(void) const { return 0; }
+    bool Running(void) const { return false; }
+    template <class T>
+    TimerHandle Add(const T&) {
+        return TimerHandle();
+    }
+    template <class T>
+    void Delete(const T&) {}
+    template <class T>
+    void Start(const T&) {}
+    template <class T>
+    void Stop(const T&) {}
+    template <class T>
+    void Restart(const T&) {}
+    template <class T>
+    void Reset(const T&) {}
+    template <class T>
+    NullTimer& Get(const T&) {
+        static NullTimer timer;
+        return timer;
+    }
+    NullTimer* Find(TimerHandle h) noexcept { return &Get(h); }
+    template <class T>
+    TimerHandle Handle(const T&) const {
+        return TimerHandle();
+    }
+    void Merge(const NullTimerSet&) {}
+    NullTimerSet& operator+=(const NullTimerSet&) { return *this; }
+    template <class Fn>
+    void ForEach(Fn) const {}
+};
 
-TimerSet::~TimerSet() {}
+/// Operator overloading to write a NullTimerSet object to std::ostream,
+/// which writes nothing.
+///
+/// @param [in] out Output Stream
+/// @retval Unchanged output stream
+inline std::ostream& operator<<(std::ostream& out, const NullTimerSet&) {
+    return out;
+}
+
+#ifdef TIMEY_DISABLE
+/// TimerSet is a NullTimerSet, as TIMEY_DISABLE is defined.
+typedef NullTimerSet TimerSet;
+#else
+/// TimerSet is a BasicTimerSet of Timer objects.
+typedef BasicTimerSet<Timer> TimerSet;
+#endif
+
+template <class TimerType>
+BasicTimerSet<TimerType>::BasicTimerSet() {}
+
+template <class TimerType>
+BasicTimerSet<TimerType>::~BasicTimerSet() {}
 
 /// Contains_ returns true if a timer with the provided name exists in the
 /// TimerSet, false otherwise.
@@ -70,26 +283,89 @@ TimerSet::~TimerSet() {}
 ///
 /// @retval TRUE if a timer with name 'timer_name' exists in the TimerSet
 /// @retval FALSE otherwise
-inline bool TimerSet::Contains_(const std::string& timer_name) const {
+template <class TimerType>
+inline bool BasicTimerSet<TimerType>::Contains_(
+    const std::string& timer_name) const {
     if (timers_.find(timer_name) == timers_.end()) {
         return false;
     }
     return true;
 }
 
+/// Index_ returns the index in slots_ of a timer by name.
+/// Index_ is a private function and should not be used by end users.
+///
+/// @throw std::runtime_error if a timer with the provided name does not exist
+/// in the TimerSet
+///
+/// @param timer_name Name of the Timer
+/// @retval Index of the timer in slots_
+template <class TimerType>
+inline size_t BasicTimerSet<TimerType>::Index_(
+    const std::string& timer_name) const {
+    auto it = timers_.find(timer_name);
+    if (it == timers_.end()) {
+        throw std::runtime_error("Invalid Timer '" + timer_name + "'");
+    }
+    return it->second;
+}
+
+/// Insert_ stores a timer in a free slot, or a new one, and indexes it by
+/// name.
+/// Insert_ is a private function and should not be used by end users.
+///
+/// @param t Timer
+/// @retval Handle of the stored timer
+template <class TimerType>
+TimerHandle BasicTimerSet<TimerType>::Insert_(const TimerType& t) {
+    size_t index;
+    if (free_.empty()) {
+        index = slots_.size();
+        slots_.push_back(t);
+        generations_.push_back(0);
+    } else {
+        index = free_.back();
+        free_.pop_back();
+        slots_[index] = t;
+    }
+    timers_.insert({t.Name(), index});
+    return TimerHandle(index, generations_[index]);
+}
+
+/// Checked_ returns the timer referred to by a handle.
+/// Checked_ is a private function and should not be used by end users.
+///
+/// @throw std::runtime_error if the handle is invalid or the timer it
+/// referred to was deleted
+///
+/// @param h Handle of the timer
+/// @retval Timer object referred to by the handle
+template <class TimerType>
+inline TimerType& BasicTimerSet<TimerType>::Checked_(TimerHandle h) {
+    if (h.index_ >= slots_.size() ||
+        generations_[h.index_] != h.generation_) {
+        throw std::runtime_error("Invalid or stale TimerHandle");
+    }
+    return slots_[h.index_];
+}
+
 /// Count returns the count of timers in the TimerSet
 ///
 /// @retval Number of timers in the TimerSet
-inline size_t TimerSet::Count(void) const { return timers_.size(); }
+template <class TimerType>
+inline size_t BasicTimerSet<TimerType>::Count(void) const {
+    return timers_.size();
+}
 
 /// Running returns true if any of the timers in the TimerSet are currently
 /// running, false otherwise.
 ///
 /// @retval TRUE if any of the timers in the TimerSet are running
 /// @retval FALSE otherwise
-inline bool TimerSet::Running(void) const {
-    for (auto t : timers_) {
-        if (t.second.Running()) {
+template <class TimerType>
+inline bool BasicTimerSet<TimerType>::Running(void) const {
+    for (auto& t : timers_) {
+        if (slots_[t.second].Running()) {
             return true;
         }
     }
@@ -105,38 +381,46 @@ inline bool TimerSet::Running(void) const {
 /// in the TimerSet
 ///
 /// @param [in] timer_name Name of the timer
-void TimerSet::Add(const std::string& timer_name) {
+/// @retval Handle of the new timer
+template <class TimerType>
+TimerHandle BasicTimerSet<TimerType>::Add(const std::string& timer_name) {
     if (Contains_(timer_name)) {
         throw std::runtime_error("Duplicate Timer '" + timer_name + "'");
     }
-    Timer t(timer_name);
-    timers_.insert({timer_name, t});
+    TimerType t(timer_name);
+    return Insert_(t);
 }
 
-/// Add (const Timer& t) adds an existing timer to the TimerSet.
+/// Add (const TimerType& t) adds an existing timer to the TimerSet.
 ///
 /// @throw std::runtime_error if a timer with the provided name already exists
 /// in the TimerSet
 ///
 /// @param [in] t Timer
-void TimerSet::Add(const Timer& t) {
+/// @retval Handle of the new timer
+template <class TimerType>
+TimerHandle BasicTimerSet<TimerType>::Add(const TimerType& t) {
     if (Contains_(t.Name())) {
         throw std::runtime_error("Duplicate Timer '" + t.Name() + "'");
     }
-    timers_.insert({t.Name(), t});
+    return Insert_(t);
 }
 
-/// Delete deletes a timer in the TimerSet by name.
+/// Delete deletes a timer in the TimerSet by name. Handles to the deleted
+/// timer become stale, and are rejected by Get and, unless NDEBUG is
+/// defined, by the other handle functions.
 ///
 /// @throw std::runtime_error if a timer with the provided name does not exist
 /// in the TimerSet
 ///
 /// @param [in] timer_name Name of the timer
-void TimerSet::Delete(const std::string& timer_name) {
-    if (!Contains_(timer_name)) {
-        throw std::runtime_error("Invalid Timer '" + timer_name + "'");
-    }
+template <class TimerType>
+void BasicTimerSet<TimerType>::Delete(const std::string& timer_name) {
+    size_t index = Index_(timer_name);
     timers_.erase(timer_name);
+    slots_[index] = TimerType();
+    generations_[index]++;
+    free_.push_back(index);
 }
 
 /// Start starts a timer in the TimerSet by name.
@@ -145,11 +429,9 @@ void TimerSet::Delete(const std::string& timer_name) {
 /// in the TimerSet
 ///
 /// @param [in] timer_name Name of the timer
-void TimerSet::Start(const std::string& timer_name) {
-    if (!Contains_(timer_name)) {
-        throw std::runtime_error("Invalid Timer '" + timer_name + "'");
-    }
-    timers_[timer_name].Start();
+template <class TimerType>
+void BasicTimerSet<TimerType>::Start(const std::string& timer_name) {
+    slots_[Index_(timer_name)].Start();
 }
 
 /// Stop stops a timer in the TimerSet by name.
@@ -158,11 +440,9 @@ void TimerSet::Start(const std::string& timer_name) {
 /// in the TimerSet
 ///
 /// @param [in] timer_name Name of the timer
-void TimerSet::Stop(const std::string& timer_name) {
-    if (!Contains_(timer_name)) {
-        throw std::runtime_error("Invalid Timer '" + timer_name + "'");
-    }
-    timers_[timer_name].Stop();
+template <class TimerType>
+void BasicTimerSet<TimerType>::Stop(const std::string& timer_name) {
+    slots_[Index_(timer_name)].Stop();
 }
 
 /// Restart restarts a timer in the TimerSet by name.
@@ -171,11 +451,9 @@ void TimerSet::Stop(const std::string& timer_name) {
 /// in the TimerSet
 ///
 /// @param [in] timer_name Name of the timer
-void TimerSet::Restart(const std::string& timer_name) {
-    if (!Contains_(timer_name)) {
-        throw std::runtime_error("Invalid Timer '" + timer_name + "'");
-    }
-    timers_[timer_name].Restart();
+template <class TimerType>
+void BasicTimerSet<TimerType>::Restart(const std::string& timer_name) {
+    slots_[Index_(timer_name)].Restart();
 }
 
 /// Reset resets a timer in the TimerSet to its initial state by name.
@@ -184,11 +462,9 @@ void TimerSet::Restart(const std::string& timer_name) {
 /// in the TimerSet
 ///
 /// @param [in] timer_name Name of the timer
-void TimerSet::Reset(const std::string& timer_name) {
-    if (!Contains_(timer_name)) {
-        throw std::runtime_error("Invalid Timer '" + timer_name + "'");
-    }
-    timers_[timer_name].Reset();
+template <class TimerType>
+void BasicTimerSet<TimerType>::Reset(const std::string& timer_name) {
+    slots_[Index_(timer_name)].Reset();
 }
 
 /// Get returns a timer in the TimerSet by name.
@@ -199,11 +475,72 @@ void TimerSet::Reset(const std::string& timer_name) {
 /// @param [in] timer_name Name of the timer
 ///
 /// @retval Timer object with the given timer_name
-Timer& TimerSet::Get(const std::string& timer_name) {
-    if (!Contains_(timer_name)) {
-        throw std::runtime_error("Invalid Timer '" + timer_name + "'");
+template <class TimerType>
+TimerType& BasicTimerSet<TimerType>::Get(const std::string& timer_name) {
+    return slots_[Index_(timer_name)];
+}
+
+/// Handle returns a handle to a timer in the TimerSet by name, for use with
+/// the handle overloads of Start, Stop, Restart, Reset and Get.
+///
+/// @throw std::runtime_error if a timer with the provided name does not exist
+/// in the TimerSet
+///
+/// @param [in] timer_name Name of the timer
+///
+/// @retval Handle of the timer with the given timer_name
+template <class TimerType>
+TimerHandle BasicTimerSet<TimerType>::Handle(
+    const std::string& timer_name) const {
+    size_t index = Index_(timer_name);
+    return TimerHandle(index, generations_[index]);
+}
+
+/// Merge combines the timers of another TimerSet into the TimerSet by name.
+/// Timers present in both sets are merged with Timer::Merge; timers only
+/// present in 'ts' are added.
+///
+/// @param [in] ts TimerSet to merge
+template <class TimerType>
+void BasicTimerSet<TimerType>::Merge(const BasicTimerSet& ts) {
+    for (auto& t : ts.timers_) {
+        const TimerType& timer = ts.slots_[t.second];
+        auto it = timers_.find(t.first);
+        if (it == timers_.end()) {
+            Insert_(timer);
+        } else {
+            slots_[it->second].Merge(timer);
+        }
     }
-    return timers_.find(timer_name)->second;
+}
+
+/// Operator overloading to merge another TimerSet into the TimerSet. See
+/// Merge.
+///
+/// @param [in] ts TimerSet to merge
+/// @retval Updated TimerSet
+template <class TimerType>
+BasicTimerSet<TimerType>& BasicTimerSet<TimerType>::operator+=(
+    const BasicTimerSet& ts) {
+    Merge(ts);
+    return *this;
+}
+
+/// Snapshot returns a consistent snapshot of every timer, in name order,
+/// while other threads start and stop them. It is only available for timers
+/// with the stats::Snapshots policy, such as SnapshotTimer. Timers must not
+/// be added or deleted while a snapshot is taken.
+///
+/// @retval Snapshots of the timers
+template <class TimerType>
+std::vector<TimerSnapshot> BasicTimerSet<TimerType>::Snapshot(void) const {
+    std::vector<TimerSnapshot> snapshots;
+    snapshots.reserve(timers_.size());
+    for (auto& t : timers_) {
+        snapshots.push_back(slots_[t.second].Snapshot());
+        snapshots.back().Name(t.first);
+    }
+    return snapshots;
 }
 
 /// Operator overloading to write a TimerSet object to std::ostream
@@ -211,20 +548,14 @@ Timer& TimerSet::Get(const std::string& timer_name) {
 /// @param [in] out Output Stream
 /// @param [in] ts TimerSet object
 /// @retval Updated output stream
-std::ostream& operator<<(std::ostream& out, const TimerSet& ts) {
-    using std::setw;
-    using std::endl;
-    using std::left;
-    out << left;
-
-    // Report header is defined in Timer.hpp
-    out << internal::ReportHeader() << endl;
-    out << std::string(80, '-') << endl;
-    for (auto& t : ts.timers_) {
-        out << t.second.Report() << endl;
-    }
-    out << std::string(80, '-') << endl;
-
+template <class TimerType>
+std::ostream& operator<<(std::ostream& out,
+                         const BasicTimerSet<TimerType>& ts) {
+    out << std::left;
+    internal::WriteReport<TimerType>(
+        out, ts.timers_.begin(), ts.timers_.end(),
+        [&ts](const std::pair<const std::string, size_t>& t)
+            -> const TimerType& { return ts.slots_[t.second]; });
     return out;
 }
 }
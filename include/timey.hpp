@@ -5,5 +5,26 @@
 #pragma once
 
 #include "utils.hpp"
+#include "clock.hpp"
+#include "accumulator.hpp"
+#include "samplebuffer.hpp"
+#include "histogram.hpp"
+#include "stats.hpp"
+#include "perfcounters.hpp"
+#include "cputime.hpp"
 #include "timer.hpp"
 #include "timerset.hpp"
+#include "snapshot.hpp"
+#include "window.hpp"
+#include "reporter.hpp"
+#include "scopedtimer.hpp"
+#include "calltree.hpp"
+#include "trace.hpp"
+#include "samplelog.hpp"
+#include "statictimerset.hpp"
+#include "concurrenttimerset.hpp"
+#include "sharedtimerset.hpp"
+#include "reduce.hpp"
+#include "export.hpp"
+#include "snapshotfile.hpp"
+#include "metricsserver.hpp"
@@ -0,0 +1,534 @@
+/// @file trace.hpp
+///
+/// Tracer class writing begin and end events to a Chrome trace file
+///
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "utils.hpp"
+#include "clock.hpp"
+#include "stats.hpp"
+#include "timer.hpp"
+#include "concurrenttimerset.hpp"
+#include "calltree.hpp"
+
+#ifdef TIMEY_DISABLE
+#define TIMEY_TRACE_SCOPE(tracer, name) static_cast<void>(0)
+#else
+/// TIMEY_TRACE_SCOPE traces the rest of the enclosing scope as the event
+/// 'name' of 'tracer'. The name is registered the first time the scope is
+/// entered. TIMEY_TRACE_SCOPE compiles to nothing when TIMEY_DISABLE is
+/// defined.
+///
+/// @param tracer Tracer receiving the events
+/// @param name Name of the event
+#define TIMEY_TRACE_SCOPE(tracer, name)                                    \
+    static const ::timey::ScopeId TIMEY_CONCAT(timey_trace_id_,            \
+                                               __LINE__) =                 \
+        ::timey::RegisterScope(name);                                      \
+    ::timey::TraceScope TIMEY_CONCAT(timey_trace_scope_, __LINE__)(        \
+        tracer, TIMEY_CONCAT(timey_trace_id_, __LINE__))
+#endif
+
+namespace timey {
+/// TraceEvent is a begin or end event, in clock ticks.
+struct TraceEvent {
+    int64_t ticks;
+    ScopeId scope;
+    char phase;
+};
+
+namespace internal {
+/// TraceBuffer is a fixed capacity single producer, single consumer queue of
+/// trace events. The owning thread pushes events without locks or atomic
+/// read-modify-write instructions; the writer thread drains them. Events
+/// pushed while the buffer is full are dropped and counted.
+class TraceBuffer {
+   public:
+    TraceBuffer(size_t capacity, uint32_t thread)
+        : events_(RoundUpPow2(capacity)), mask_(events_.size() - 1),
+          thread_(thread), head_(0), tailCache_(0), dropped_(0), tail_(0) {}
+
+    /// Push adds an event, or drops it if the buffer is full.
+    ///
+    /// @param [in] e Event to add
+    /// @retval TRUE If the event was added
+    /// @retval FALSE If the event was dropped
+    bool Push(const TraceEvent& e) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        // Only read the writer's cache line when the buffer looks full
+        if (head - tailCache_ == events_.size()) {
+            tailCache_ = tail_.load(std::memory_order_acquire);
+            if (head - tailCache_ == events_.size()) {
+                dropped_.store(dropped_.load(std::memory_order_relaxed) + 1,
+                               std::memory_order_relaxed);
+                return false;
+            }
+        }
+        events_[head & mask_] = e;
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Drain calls 'f' on each buffered event, oldest first, and removes
+    /// them from the buffer.
+    ///
+    /// @param [in] f Function called with each event
+    /// @retval Number of drained events
+    template <class F>
+    size_t Drain(F f) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        size_t head = head_.load(std::memory_order_acquire);
+        for (size_t i = tail; i != head; i++) {
+            f(events_[i & mask_]);
+        }
+        tail_.store(head, std::memory_order_release);
+        return head - tail;
+    }
+
+    /// Thread returns the identifier of the owning thread in the trace.
+    uint32_t Thread(void) const { return thread_; }
+
+    /// Dropped returns the number of events dropped since construction.
+    uint64_t Dropped(void) const {
+        return dropped_.load(std::memory_order_relaxed);
+    }
+
+    /// Pending returns the number of events pushed but not drained yet.
+    size_t Pending(void) const {
+        size_t tail = tail_.load(std::memory_order_acquire);
+        return head_.load(std::memory_order_acquire) - tail;
+    }
+
+   private:
+    /// RoundUpPow2 returns the smallest power of two not less than 'n', or
+    /// 0 if 'n' is 0.
+    static size_t RoundUpPow2(size_t n) {
+        size_t p = 1;
+        while (p < n) {
+            p <<= 1;
+        }
+        return n == 0 ? 0 : p;
+    }
+
+    std::vector<TraceEvent> events_;
+    /// mask_ maps event counts to indices; the capacity is a power of two.
+    size_t mask_;
+    uint32_t thread_;
+    char padding0_[CacheLineSize];
+    /// head_ is the number of events pushed, written by the owner.
+    std::atomic<size_t> head_;
+    /// tailCache_ is the owner's last read of tail_.
+    size_t tailCache_;
+    std::atomic<uint64_t> dropped_;
+    char padding1_[CacheLineSize];
+    /// tail_ is the number of events drained, written by the writer.
+    std::atomic<size_t> tail_;
+};
+}
+
+/// BasicTracer class records begin and end events from any number of
+/// threads and writes them, from a background thread, to a file in the
+/// Chrome trace event format, which chrome://tracing and the Perfetto UI
+/// open.
+///
+/// Every thread writes its events to its own fixed capacity buffer, so Begin
+/// and End take no locks and never wait for the file. When a buffer is full,
+/// events are dropped and counted; see Dropped. Dropping a begin event but
+/// not its end event leaves an unmatched end event in the trace.
+///
+/// Timers with the stats::Trace policy record each timed start-stop cycle
+/// as a begin and an end event; see TraceTo.
+///
+/// Tracer is a BasicTracer using the default clock policy.
+///
+/// Example:
+/// @code
+///     Tracer tracer("trace.json");
+///     ScopeId solve = RegisterScope("solve");
+///
+///     // On any thread
+///     tracer.Begin(solve);
+///     solve();
+///     tracer.End(solve);
+///
+///     // or
+///     {
+///         TIMEY_TRACE_SCOPE(tracer, "assemble");
+///         assemble();
+///     }
+/// @endcode
+template <class Clock>
+class BasicTracer {
+   public:
+    explicit BasicTracer(const std::string& path,
+                         size_t buffer_capacity = 1 << 16,
+                         NanosecondsType flush_interval = 10 * Millisecond);
+    ~BasicTracer();
+    BasicTracer(const BasicTracer&) = delete;
+    BasicTracer& operator=(const BasicTracer&) = delete;
+
+    // API
+    void Begin(ScopeId s);
+    void End(ScopeId s);
+    void Close(void);
+    uint64_t Dropped(void) const;
+    uint64_t Written(void) const;
+
+   private:
+    typedef internal::TraceBuffer Buffer;
+
+    Buffer& LocalBuffer_();
+    Buffer& NewBuffer_();
+    void Run_(void);
+    size_t Drain_(void);
+    const std::string& Name_(ScopeId s);
+
+    /// id_ identifies this tracer in the per-thread tables.
+    size_t id_;
+    /// bufferCapacity_ is the capacity of each thread's buffer.
+    size_t bufferCapacity_;
+    /// flushInterval_ is the time between two drains of the buffers.
+    NanosecondsType flushInterval_;
+    /// startTime_ is the clock tick of the origin of the trace.
+    int64_t startTime_;
+    /// out_ is the trace file, written by the writer thread only.
+    std::ofstream out_;
+    /// written_ is the number of events written to the file.
+    std::atomic<uint64_t> written_;
+    /// mutex_ protects buffers_ and stopping_.
+    mutable std::mutex mutex_;
+    /// wakeup_ wakes the writer thread up when the tracer is closed.
+    std::condition_variable wakeup_;
+    /// buffers_ holds one buffer per thread that used the tracer.
+    std::vector<std::unique_ptr<Buffer>> buffers_;
+    /// stopping_ tells the writer thread to write the last events and stop.
+    bool stopping_;
+    /// closed_ is true once the writer thread wrote the last events, so
+    /// that events still buffered are dropped.
+    bool closed_;
+    /// names_ caches the escaped event names, for the writer thread only.
+    std::vector<std::string> names_;
+    /// writer_ drains the buffers to the file.
+    std::thread writer_;
+};
+
+/// Tracer is a BasicTracer using the default clock policy.
+typedef BasicTracer<HighResolutionClock> Tracer;
+
+/// Constructs a tracer writing to 'path' and starts its writer thread.
+///
+/// @throw std::runtime_error if the file cannot be opened
+///
+/// @param [in] path Path of the trace file
+/// @param [in] buffer_capacity Number of events buffered per thread, rounded
+///                             up to a power of two
+/// @param [in] flush_interval Time between two writes to the file
+template <class Clock>
+BasicTracer<Clock>::BasicTracer(const std::string& path,
+                                size_t buffer_capacity,
+                                NanosecondsType flush_interval)
+    : id_(internal::NextConcurrentTimerSetId()),
+      bufferCapacity_(buffer_capacity),
+      flushInterval_(flush_interval),
+      startTime_(Clock::Now()),
+      out_(path),
+      written_(0),
+      stopping_(false),
+      closed_(false) {
+    if (!out_) {
+        throw std::runtime_error("Cannot open trace file '" + path + "'");
+    }
+    out_ << "{\"traceEvents\":[";
+    writer_ = std::thread(&BasicTracer::Run_, this);
+}
+
+template <class Clock>
+BasicTracer<Clock>::~BasicTracer() {
+    Close();
+}
+
+/// Begin records the beginning of the event 's' on the calling thread.
+///
+/// @param [in] s Identifier of the event name
+template <class Clock>
+inline void BasicTracer<Clock>::Begin(ScopeId s) {
+    LocalBuffer_().Push(TraceEvent{Clock::Now(), s, 'B'});
+}
+
+/// End records the end of the event 's' on the calling thread.
+///
+/// @param [in] s Identifier of the event name
+template <class Clock>
+inline void BasicTracer<Clock>::End(ScopeId s) {
+    LocalBuffer_().Push(TraceEvent{Clock::Now(), s, 'E'});
+}
+
+/// Close writes the remaining events, completes the trace file and stops
+/// the writer thread. Events recorded after Close are dropped and counted
+/// by Dropped. Close is called by the destructor.
+template <class Clock>
+void BasicTracer<Clock>::Close(void) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_) {
+            return;
+        }
+        stopping_ = true;
+    }
+    wakeup_.notify_one();
+    writer_.join();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    closed_ = true;
+    uint64_t dropped = 0;
+    for (auto& b : buffers_) {
+        dropped += b->Dropped() + b->Pending();
+    }
+    out_ << "],\"displayTimeUnit\":\"ns\",\"otherData\":{\"dropped_events\":"
+         << "\"" << dropped << "\"}}" << std::endl;
+    out_.close();
+}
+
+/// Dropped returns the number of events dropped because a buffer was full
+/// or because they were recorded after Close.
+///
+/// @retval Number of dropped events
+template <class Clock>
+uint64_t BasicTracer<Clock>::Dropped(void) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint64_t dropped = 0;
+    for (auto& b : buffers_) {
+        // Nothing drains the events buffered after Close
+        dropped += b->Dropped() + (closed_ ? b->Pending() : 0);
+    }
+    return dropped;
+}
+
+/// Written returns the number of events written to the trace file so far.
+///
+/// @retval Number of written events
+template <class Clock>
+uint64_t BasicTracer<Clock>::Written(void) const {
+    return written_.load(std::memory_order_relaxed);
+}
+
+/// LocalBuffer_ returns the buffer of the calling thread, creating it on
+/// first use.
+/// LocalBuffer_ is a private function and should not be used by end users.
+///
+/// @retval Buffer of the calling thread
+template <class Clock>
+inline typename BasicTracer<Clock>::Buffer&
+BasicTracer<Clock>::LocalBuffer_() {
+    std::vector<void*>& buffers = internal::LocalShards();
+    if (id_ < buffers.size() && buffers[id_] != nullptr) {
+        return *static_cast<Buffer*>(buffers[id_]);
+    }
+    return NewBuffer_();
+}
+
+/// NewBuffer_ creates the buffer of the calling thread. The buffer is owned
+/// by the tracer, so its events are written after the thread exits.
+/// NewBuffer_ is a private function and should not be used by end users.
+///
+/// @retval Buffer of the calling thread
+template <class Clock>
+typename BasicTracer<Clock>::Buffer& BasicTracer<Clock>::NewBuffer_() {
+    Buffer* buffer;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // Events of threads that start after Close go to a full buffer
+        buffer = new Buffer(stopping_ ? 0 : bufferCapacity_,
+                            (uint32_t)buffers_.size() + 1);
+        buffers_.emplace_back(buffer);
+    }
+    std::vector<void*>& buffers = internal::LocalShards();
+    if (buffers.size() <= id_) {
+        buffers.resize(id_ + 1, nullptr);
+    }
+    buffers[id_] = buffer;
+    return *buffer;
+}
+
+/// Run_ is the writer thread: it drains the buffers every flush interval
+/// until the tracer is closed.
+/// Run_ is a private function and should not be used by end users.
+template <class Clock>
+void BasicTracer<Clock>::Run_(void) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_) {
+        wakeup_.wait_for(lock, flushInterval_);
+        lock.unlock();
+        Drain_();
+        lock.lock();
+    }
+    lock.unlock();
+    Drain_();
+}
+
+/// Drain_ writes the buffered events of every thread to the file.
+/// Drain_ is a private function and should not be used by end users.
+///
+/// @retval Number of written events
+template <class Clock>
+size_t BasicTracer<Clock>::Drain_(void) {
+    std::vector<Buffer*> buffers;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& b : buffers_) {
+            buffers.push_back(b.get());
+        }
+    }
+
+    size_t n = 0;
+    uint64_t written = written_.load(std::memory_order_relaxed);
+    for (Buffer* b : buffers) {
+        uint32_t thread = b->Thread();
+        n += b->Drain([this, thread, &written](const TraceEvent& e) {
+            double us = Clock::ToNanoseconds(e.ticks - startTime_).count() /
+                        1000.0;
+            out_ << (written++ == 0 ? "" : ",") << "\n{\"name\":\""
+                 << Name_(e.scope)
+                 << "\",\"ph\":\"" << e.phase << "\",\"ts\":" << std::fixed
+                 << std::setprecision(3) << us
+                 << ",\"pid\":1,\"tid\":" << thread << "}";
+        });
+    }
+    written_.store(written, std::memory_order_relaxed);
+    out_.flush();
+    return n;
+}
+
+/// Name_ returns the escaped name of an event, caching the names so that
+/// the scope registry is only locked for new names.
+/// Name_ is a private function and should not be used by end users.
+///
+/// @param [in] s Identifier of the event name
+/// @retval Name of the event escaped for JSON
+template <class Clock>
+const std::string& BasicTracer<Clock>::Name_(ScopeId s) {
+    if (s.Id() >= names_.size()) {
+        names_.resize(s.Id() + 1);
+    }
+    if (names_[s.Id()].empty()) {
+        names_[s.Id()] = internal::JsonEscape(ScopeName(s));
+    }
+    return names_[s.Id()];
+}
+
+/// BasicTraceScope class records a begin event when constructed and the
+/// matching end event when destroyed. TraceScope is a BasicTraceScope of
+/// Tracer.
+template <class TracerType>
+class BasicTraceScope {
+   public:
+    /// Constructs a TraceScope recording the event 's' on 'tracer'.
+    ///
+    /// @param [in] tracer Tracer receiving the events
+    /// @param [in] s Identifier of the event name
+    BasicTraceScope(TracerType& tracer, ScopeId s)
+        : tracer_(tracer), scope_(s) {
+        tracer_.Begin(scope_);
+    }
+
+    ~BasicTraceScope() { tracer_.End(scope_); }
+
+    BasicTraceScope(const BasicTraceScope&) = delete;
+    BasicTraceScope& operator=(const BasicTraceScope&) = delete;
+
+   private:
+    TracerType& tracer_;
+    ScopeId scope_;
+};
+
+/// TraceScope is a BasicTraceScope of Tracer.
+typedef BasicTraceScope<Tracer> TraceScope;
+
+namespace stats {
+/// Trace is a statistics policy recording each timed start-stop cycle of
+/// the timer as a begin and an end event of a Tracer, so that a timer, or
+/// every timer of a TimerSet, shows up on the trace timeline next to the
+/// events of TIMEY_TRACE_SCOPE. The begin event is recorded before the
+/// clock read of Start and the end event after the clock read of Stop.
+/// Timers record no events until TraceTo is called. See TracingTimer.
+///
+/// Example:
+/// @code
+///     Tracer tracer("trace.json");
+///     TracingTimer t("solve");
+///     t.TraceTo(tracer, RegisterScope(t.Name()));
+///     t.Start();
+///     solve();
+///     t.Stop();
+/// @endcode
+template <class Clock>
+class Trace {
+   public:
+    Trace() : tracer_(nullptr), scope_() {}
+
+    /// TraceTo makes the timer record its timed start-stop cycles as the
+    /// event 's' of 'tracer', which must outlive the tracing. A timer
+    /// started before TraceTo records no begin event for that cycle.
+    ///
+    /// @param [in] tracer Tracer receiving the events
+    /// @param [in] s Identifier of the event name
+    void TraceTo(Tracer& tracer, ScopeId s) {
+        tracer_ = &tracer;
+        scope_ = s;
+    }
+
+    /// StopTracing stops recording events.
+    void StopTracing(void) { tracer_ = nullptr; }
+
+    /// IsTracing returns true if the timer records events.
+    bool IsTracing(void) const { return tracer_ != nullptr; }
+
+   protected:
+    void Reset_(void) {}
+
+    void Start_(void) {
+        if (tracer_ != nullptr) {
+            tracer_->Begin(scope_);
+        }
+    }
+
+    void Stop_(int64_t) {
+        if (tracer_ != nullptr) {
+            tracer_->End(scope_);
+        }
+    }
+
+    void Add_(int64_t, size_t) {}
+    void Merge_(const Trace&, size_t, size_t) {}
+    void ReportHeader_(FormatBuffer&) const {}
+    void Report_(FormatBuffer&) const {}
+    void Export_(TimerFields&) const {}
+
+   private:
+    /// tracer_ receives the events, or is null if the timer is not traced.
+    Tracer* tracer_;
+    /// scope_ is the name of the events.
+    ScopeId scope_;
+};
+}
+
+/// TracingTimer is a Timer whose timed start-stop cycles are also recorded
+/// as trace events; see stats::Trace.
+typedef BasicTimer<HighResolutionClock, DefaultMoments,
+                   stats::Pack<stats::PerSample, stats::Percentiles,
+                               stats::Trace>>
+    TracingTimer;
+}
@@ -5,9 +5,14 @@
 #pragma once
 
 #include <iomanip>
+#include <cerrno>
 #include <chrono>
 #include <cstdint>
+#include <cstdio>
+#include <cstring>
 #include <sstream>
+#include <stdexcept>
+#include <string>
 
 namespace timey {
 typedef std::chrono::duration<int64_t, std::nano> NanosecondsType;
@@ -49,6 +54,173 @@ std::string DoubleToFixedString(const double& d) {
 
     return astr;
 }
+
+/// SystemError returns a runtime_error describing the last system error.
+///
+/// @param [in] what Description of the failed operation
+/// @retval Exception to throw
+inline std::runtime_error SystemError(const std::string& what) {
+    return std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+/// JsonEscape returns 's' escaped for use inside a JSON string.
+///
+/// @param s std::string
+/// @return std::string
+inline std::string JsonEscape(const std::string& s) {
+    std::ostringstream out;
+    for (char c : s) {
+        switch (c) {
+            case '"':
+                out << "\\\"";
+                break;
+            case '\\':
+                out << "\\\\";
+                break;
+            case '\n':
+                out << "\\n";
+                break;
+            case '\t':
+                out << "\\t";
+                break;
+            default:
+                if ((unsigned char)c < 0x20) {
+                    out << "\\u" << std::hex << std::setw(4)
+                        << std::setfill('0') << (int)c << std::dec;
+                } else {
+                    out << c;
+                }
+        }
+    }
+    return out.str();
+}
+}
+
+namespace internal {
+/// HumanizeBufferSize is the size of a buffer that holds any duration
+/// formatted by HumanizeTo.
+constexpr size_t HumanizeBufferSize = 32;
+
+/// IntegerTo writes the decimal digits of 'x' to 'out' and returns their
+/// number. 'out' must hold 20 characters.
+///
+/// @param [out] out Buffer to write to
+/// @param [in] x Value
+/// @retval Number of characters written
+inline size_t IntegerTo(char* out, uint64_t x) {
+    char digits[20];
+    size_t n = 0;
+    do {
+        digits[n++] = (char)('0' + x % 10);
+        x /= 10;
+    } while (x != 0);
+    for (size_t i = 0; i < n; i++) {
+        out[i] = digits[n - 1 - i];
+    }
+    return n;
+}
+
+/// DecimalTo writes 'x' / 10^'decimals' to 'out' without trailing zeros,
+/// and without the decimal point for whole numbers, and returns the number
+/// of characters written. 'out' must hold 21 characters.
+///
+/// @param [out] out Buffer to write to
+/// @param [in] x Value in units of 10^-'decimals'
+/// @param [in] decimals Number of decimals of 'x', at most 9
+/// @retval Number of characters written
+inline size_t DecimalTo(char* out, uint64_t x, int decimals) {
+    uint64_t scale = 1;
+    for (int i = 0; i < decimals; i++) {
+        scale *= 10;
+    }
+    size_t n = IntegerTo(out, x / scale);
+    uint64_t fraction = x % scale;
+    if (fraction == 0) {
+        return n;
+    }
+    out[n++] = '.';
+    for (uint64_t digit = scale / 10; fraction != 0; digit /= 10) {
+        out[n++] = (char)('0' + fraction / digit);
+        fraction %= digit;
+    }
+    return n;
+}
+
+/// HumanizeTo writes the human readable form of a duration of 'ns'
+/// nanoseconds, see Humanize, to 'out' and returns the number of characters
+/// written. 'out' must hold HumanizeBufferSize characters.
+///
+/// Durations are formatted from their integer count of nanoseconds, which
+/// gives the digits std::ostream gives for the same durations in floating
+/// point. Negative durations, and milliseconds exactly halfway between two
+/// roundings to 6 significant digits, fall back to the %g formatting of
+/// std::ostream, so that the output is the same.
+///
+/// @param [out] out Buffer to write to
+/// @param [in] ns Duration in nanoseconds
+/// @retval Number of characters written
+inline size_t HumanizeTo(char* out, int64_t ns) {
+    const int64_t us = 1000;
+    const int64_t ms = 1000 * us;
+    const int64_t s = 1000 * ms;
+    const int64_t m = 60 * s;
+    const int64_t h = 60 * m;
+    size_t n = 0;
+
+    if (ns == 0) {
+        std::memcpy(out, "0s", 2);
+        return 2;
+    }
+    if (ns < 0) {
+        n = (size_t)std::snprintf(out, HumanizeBufferSize - 2, "%g",
+                                  (double)ns);
+        std::memcpy(out + n, "ns", 2);
+        return n + 2;
+    }
+    if (ns < us) {
+        n = IntegerTo(out, (uint64_t)ns);
+        std::memcpy(out + n, "ns", 2);
+        return n + 2;
+    }
+    if (ns < ms) {
+        // At most 6 significant digits, so no rounding
+        n = DecimalTo(out, (uint64_t)ns, 3);
+        std::memcpy(out + n, "us", 2);
+        return n + 2;
+    }
+    if (ns < s) {
+        // Round to 6 significant digits: drop as many digits as the
+        // integer part of the milliseconds has
+        int drop = ns < 10 * ms ? 1 : (ns < 100 * ms ? 2 : 3);
+        int64_t unit = drop == 1 ? 10 : (drop == 2 ? 100 : 1000);
+        int64_t q = ns / unit;
+        int64_t r = ns % unit;
+        if (2 * r == unit) {
+            n = (size_t)std::snprintf(out, HumanizeBufferSize - 2, "%g",
+                                      (double)ns / 1e6);
+        } else {
+            q += 2 * r > unit ? 1 : 0;
+            n = DecimalTo(out, (uint64_t)q, 6 - drop);
+        }
+        std::memcpy(out + n, "ms", 2);
+        return n + 2;
+    }
+    if (ns >= h) {
+        n += IntegerTo(out + n, (uint64_t)(ns / h));
+        out[n++] = 'h';
+        ns %= h;
+    }
+    if (ns >= m) {
+        n += IntegerTo(out + n, (uint64_t)(ns / m));
+        out[n++] = 'm';
+        ns %= m;
+    }
+    if (ns != 0) {
+        n += DecimalTo(out + n, (uint64_t)ns, 9);
+        out[n++] = 's';
+    }
+    return n;
+}
 }
 
 /// Humanize returns a human readable string representation of a duration.
@@ -77,43 +249,204 @@ std::string DoubleToFixedString(const double& d) {
 /// @return std::string
 template <class T1, class T2>
 std::string Humanize(const std::chrono::duration<T1, T2>& dur) {
-    using std::chrono::duration_cast;
-    using std::chrono::duration;
+    char buffer[internal::HumanizeBufferSize];
+    size_t n = internal::HumanizeTo(
+        buffer, std::chrono::duration_cast<NanosecondsType>(dur).count());
+    return std::string(buffer, n);
+}
 
-    std::ostringstream out;
-    int64_t i;
-    auto d = duration_cast<NanosecondsType>(dur);
-
-    if (d == ZeroSeconds) {
-        out << "0s";
-    } else if (d < Second) {
-        if (d >= Millisecond) {
-            out << (duration_cast<duration<double, std::milli>>(d)).count()
-                << "ms";
-        } else if (d >= Microsecond) {
-            out << (duration_cast<duration<double, std::micro>>(d)).count()
-                << "us";
-        } else {
-            out << (duration_cast<duration<double, std::nano>>(d)).count()
-                << "ns";
+/// FormatBuffer class is a reusable character buffer that reports are
+/// written into without iostreams. Clear keeps the memory, so a buffer
+/// reused across reports stops allocating once it has grown to the longest
+/// report.
+///
+/// Example:
+/// @code
+///     FormatBuffer buffer;
+///     for(auto& t : timers) {
+///         buffer.Clear();
+///         t.Report(buffer);
+///         std::cout.write(buffer.Data(), buffer.Size());
+///     }
+/// @endcode
+class FormatBuffer {
+   public:
+    FormatBuffer() { data_.reserve(256); }
+
+    /// Clear empties the buffer, keeping its memory.
+    void Clear(void) { data_.clear(); }
+
+    /// Data returns the characters of the buffer, which are not null
+    /// terminated.
+    const char* Data(void) const { return data_.data(); }
+
+    /// Size returns the number of characters in the buffer.
+    size_t Size(void) const { return data_.size(); }
+
+    /// Str returns a copy of the characters of the buffer.
+    std::string Str(void) const { return data_; }
+
+    /// Swap exchanges the content of the buffer with that of 'b'.
+    void Swap(FormatBuffer& b) { data_.swap(b.data_); }
+
+    /// Append appends a character.
+    FormatBuffer& Append(char c) {
+        data_.push_back(c);
+        return *this;
+    }
+
+    /// Append appends a string.
+    FormatBuffer& Append(const std::string& s) {
+        data_.append(s);
+        return *this;
+    }
+
+    /// Append appends 'n' characters.
+    FormatBuffer& Append(const char* s, size_t n) {
+        data_.append(s, n);
+        return *this;
+    }
+
+    /// Append appends the content of buffer 'b'.
+    FormatBuffer& Append(const FormatBuffer& b) {
+        data_.append(b.data_);
+        return *this;
+    }
+
+    /// Repeat appends 'n' copies of character 'c'.
+    FormatBuffer& Repeat(char c, size_t n) {
+        data_.append(n, c);
+        return *this;
+    }
+
+    /// AppendInteger appends the decimal digits of 'x'.
+    FormatBuffer& AppendInteger(uint64_t x) {
+        char digits[20];
+        data_.append(digits, internal::IntegerTo(digits, x));
+        return *this;
+    }
+
+    /// AppendSigned appends the decimal digits of 'x', after a minus sign
+    /// if it is negative.
+    FormatBuffer& AppendSigned(int64_t x) {
+        if (x < 0) {
+            data_.push_back('-');
+            return AppendInteger(0 - (uint64_t)x);
         }
-    } else {
-        if (d >= Hour) {
-            i = (duration_cast<HoursType>(d)).count();
-            out << i << "h";
-            d -= i * Hour;
+        return AppendInteger((uint64_t)x);
+    }
+
+    /// AppendDuration appends the human readable form of 'd', see Humanize.
+    FormatBuffer& AppendDuration(NanosecondsType d) {
+        char buffer[internal::HumanizeBufferSize];
+        data_.append(buffer, internal::HumanizeTo(buffer, d.count()));
+        return *this;
+    }
+
+    /// Pad appends spaces until the characters from position 'start' fill
+    /// 'width' columns, as std::setw does with left alignment.
+    ///
+    /// @param [in] start Position of the first character of the column
+    /// @param [in] width Width of the column
+    FormatBuffer& Pad(size_t start, size_t width) {
+        size_t used = data_.size() - start;
+        if (used < width) {
+            data_.append(width - used, ' ');
         }
-        if (d >= Minute) {
-            i = (duration_cast<MinutesType>(d)).count();
-            out << i << "m";
-            d -= i * Minute;
+        return *this;
+    }
+
+    /// Column appends 's' left aligned in a column of 'width' characters.
+    FormatBuffer& Column(const std::string& s, size_t width) {
+        size_t start = data_.size();
+        return Append(s).Pad(start, width);
+    }
+
+    /// Column appends 'x' left aligned in a column of 'width' characters.
+    FormatBuffer& Column(uint64_t x, size_t width) {
+        size_t start = data_.size();
+        return AppendInteger(x).Pad(start, width);
+    }
+
+    /// Column appends the human readable form of 'd' left aligned in a
+    /// column of 'width' characters.
+    FormatBuffer& Column(NanosecondsType d, size_t width) {
+        size_t start = data_.size();
+        return AppendDuration(d).Pad(start, width);
+    }
+
+   private:
+    std::string data_;
+};
+
+/// TimerFields holds the statistics of a timer as named integers, durations
+/// in nanoseconds, in the order a timer exports them. Exporters read the
+/// fields of each timer into one TimerFields object, so exporting does not
+/// allocate. Field names are string literals.
+class TimerFields {
+   public:
+    /// Capacity is the maximum number of fields of a timer.
+    static constexpr size_t Capacity = 16;
+
+    TimerFields() : size_(0) {}
+
+    /// Clear removes every field.
+    void Clear(void) { size_ = 0; }
+
+    /// Add adds a field, unless the fields are full.
+    ///
+    /// @param [in] name Name of the field, a string literal
+    /// @param [in] value Value of the field
+    /// @param [in] counter True if the value only grows with the count, as
+    ///                     with the count and the total
+    void Add(const char* name, int64_t value, bool counter = false) {
+        if (size_ < Capacity) {
+            fields_[size_++] = Field{name, value, counter};
         }
-        if (d != ZeroSeconds) {
-            out << internal::DoubleToFixedString(
-                       (duration_cast<duration<double>>(d)).count()) << "s";
+    }
+
+    /// Size returns the number of fields.
+    size_t Size(void) const { return size_; }
+
+    /// Name returns the name of field 'i'.
+    const char* Name(size_t i) const { return fields_[i].name; }
+
+    /// Value returns the value of field 'i'.
+    int64_t Value(size_t i) const { return fields_[i].value; }
+
+    /// Counter returns true if field 'i' is a counter.
+    bool Counter(size_t i) const { return fields_[i].counter; }
+
+    /// Find returns the index of the field named 'name', or Size() if there
+    /// is none.
+    size_t Find(const char* name) const {
+        for (size_t i = 0; i < size_; i++) {
+            if (std::strcmp(fields_[i].name, name) == 0) {
+                return i;
+            }
         }
+        return size_;
     }
 
-    return out.str();
+   private:
+    struct Field {
+        const char* name;
+        int64_t value;
+        bool counter;
+    };
+
+    Field fields_[Capacity];
+    size_t size_;
+};
+
+/// Operator overloading to write the content of a FormatBuffer to
+/// std::ostream.
+///
+/// @param out std::outstream&
+/// @param buffer const FormatBuffer&
+/// @retval Updated std::ostream
+inline std::ostream& operator<<(std::ostream& out,
+                                const FormatBuffer& buffer) {
+    return out.write(buffer.Data(), (std::streamsize)buffer.Size());
 }
 }
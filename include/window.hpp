@@ -0,0 +1,257 @@
+/// @file window.hpp
+///
+/// Windows statistics policy keeping the statistics of the last seconds of
+/// a Timer
+///
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+#include "utils.hpp"
+
+namespace timey {
+/// WindowStats is the statistics of the start-stop cycles of a timer that
+/// stopped within a window of time ending now.
+class WindowStats {
+   public:
+    WindowStats(uint64_t count__, NanosecondsType total__,
+                NanosecondsType length__)
+        : count_(count__), total_(total__), length_(length__) {}
+
+    /// Count returns the number of start-stop cycles in the window.
+    uint64_t Count(void) const { return count_; }
+
+    /// Elapsed returns the total duration of the start-stop cycles in the
+    /// window.
+    NanosecondsType Elapsed(void) const { return total_; }
+
+    /// Mean returns the mean duration of the start-stop cycles in the
+    /// window, or zero if there was none.
+    NanosecondsType Mean(void) const {
+        return count_ == 0 ? NanosecondsType(0) : total_ / (int64_t)count_;
+    }
+
+    /// Length returns the length of time the window covers.
+    NanosecondsType Length(void) const { return length_; }
+
+    /// Rate returns the number of start-stop cycles per second in the
+    /// window.
+    double Rate(void) const {
+        return length_.count() <= 0 ? 0 : count_ * 1e9 / length_.count();
+    }
+
+   private:
+    uint64_t count_;
+    NanosecondsType total_;
+    NanosecondsType length_;
+};
+
+namespace internal {
+/// WindowRing is a ring of N buckets of consecutive time intervals of equal
+/// width, each counting the start-stop cycles that stopped in it. The ring
+/// is rotated when a duration is added after the end of the current
+/// bucket, so no thread is needed to age the buckets out.
+template <size_t N>
+class WindowRing {
+   public:
+    explicit WindowRing(int64_t width__) : width_(width__) { Clear(); }
+
+    /// Width returns the width of a bucket in clock ticks.
+    int64_t Width(void) const { return width_; }
+
+    /// Clear empties every bucket.
+    void Clear(void) {
+        current_ = 0;
+        end_ = 0;
+        for (size_t i = 0; i < N; i++) {
+            buckets_[i] = Bucket();
+        }
+    }
+
+    /// Add counts duration 'x' in the bucket of clock tick 'now'.
+    ///
+    /// @param [in] now Clock tick the duration ended at
+    /// @param [in] x Duration in clock ticks
+    void Add(int64_t now, int64_t x) {
+        if (now >= end_) {
+            Rotate_(now / width_);
+        }
+        Bucket& b = buckets_[current_ % N];
+        b.count++;
+        b.total += x;
+    }
+
+    /// Merge adds the buckets of 'r' that fall within the ring.
+    ///
+    /// @param [in] r Ring of the same width
+    void Merge(const WindowRing& r) {
+        if (r.current_ > current_) {
+            Rotate_(r.current_);
+        }
+        for (int64_t i = r.current_ - (int64_t)N + 1; i <= r.current_; i++) {
+            if (i > current_ - (int64_t)N && i >= 0) {
+                buckets_[i % N].count += r.buckets_[i % N].count;
+                buckets_[i % N].total += r.buckets_[i % N].total;
+            }
+        }
+    }
+
+    /// Sum returns the count and total of the 'n' buckets ending with the
+    /// bucket of clock tick 'now'.
+    ///
+    /// @param [in] now Current clock tick
+    /// @param [in] n Number of buckets, from 1 to N
+    /// @param [out] count Number of durations in the buckets
+    /// @param [out] total Total duration in clock ticks
+    void Sum(int64_t now, size_t n, uint64_t& count, int64_t& total) const {
+        int64_t last = now / width_;
+        int64_t first = last - (int64_t)n + 1;
+        first = first > current_ - (int64_t)N ? first
+                                              : current_ - (int64_t)N + 1;
+        last = last < current_ ? last : current_;
+        count = 0;
+        total = 0;
+        for (int64_t i = first < 0 ? 0 : first; i <= last; i++) {
+            count += buckets_[i % N].count;
+            total += buckets_[i % N].total;
+        }
+    }
+
+   private:
+    struct Bucket {
+        Bucket() : total(0), count(0) {}
+        int64_t total;
+        uint32_t count;
+    };
+
+    /// Rotate_ makes 'bucket' the current bucket, emptying the buckets
+    /// between the previous current bucket and it.
+    void Rotate_(int64_t bucket) {
+        int64_t last = current_ + (int64_t)N;
+        for (int64_t i = current_ + 1; i <= bucket && i <= last; i++) {
+            buckets_[i % N] = Bucket();
+        }
+        current_ = bucket;
+        end_ = (bucket + 1) * width_;
+    }
+
+    /// width_ is the width of a bucket in clock ticks.
+    int64_t width_;
+    /// current_ is the number of the latest bucket, counted from the epoch
+    /// of the clock.
+    int64_t current_;
+    /// end_ is the clock tick at which the current bucket ends.
+    int64_t end_;
+    Bucket buckets_[N];
+};
+}
+
+namespace stats {
+/// Windows is a statistics policy keeping the count and total of the
+/// start-stop cycles of the last minute, so that a recent change is not
+/// hidden by hours of history. See Window.
+///
+/// Windows up to a second are kept in ten buckets of 100ms and longer ones
+/// in twelve buckets of 5s, which is less than 400 bytes per timer. A
+/// duration is counted in the bucket of the clock tick Stop read, without
+/// reading the clock again; a duration recorded with Timer::Add in the
+/// bucket of the time of the call, and merged timers bucket by bucket.
+///
+/// Example:
+/// @code
+///     BasicTimer<SteadyClock, DefaultMoments, stats::Pack<stats::Windows>> t;
+///     ...
+///     WindowStats last = t.Window(10 * Second);
+///     std::cout << Humanize(last.Mean()) << " " << last.Rate() << "/s";
+/// @endcode
+template <class Clock>
+class Windows {
+   public:
+    Windows()
+        : fine_((int64_t)(1e8 / Clock::NanosecondsPerTick())),
+          coarse_((int64_t)(5e9 / Clock::NanosecondsPerTick())),
+          stop_(0),
+          stopped_(false) {}
+
+    /// Window returns the statistics of the start-stop cycles that stopped
+    /// in the last 'length' of time, rounded up to 100ms up to a second and
+    /// to 5s above, and at most one minute.
+    ///
+    /// @param [in] length Length of the window
+    /// @retval WindowStats of the window
+    WindowStats Window(NanosecondsType length) const {
+        int64_t now = Clock::Now();
+        if (length <= Second) {
+            return Sum_(fine_, now, length);
+        }
+        return Sum_(coarse_, now,
+                    length < Minute ? length : NanosecondsType(Minute));
+    }
+
+   protected:
+    void Reset_(void) {
+        fine_.Clear();
+        coarse_.Clear();
+        stopped_ = false;
+    }
+
+    void Start_(void) {}
+
+    void Stop_(int64_t stop) {
+        stop_ = stop;
+        stopped_ = true;
+    }
+
+    void Add_(int64_t x, size_t) {
+        // Durations not ended by Stop_ are added with Timer::Add
+        int64_t now = stopped_ ? stop_ : Clock::Now();
+        stopped_ = false;
+        fine_.Add(now, x);
+        coarse_.Add(now, x);
+    }
+
+    void Merge_(const Windows& s, size_t, size_t) {
+        fine_.Merge(s.fine_);
+        coarse_.Merge(s.coarse_);
+    }
+
+    void ReportHeader_(FormatBuffer&) const {}
+
+    void Report_(FormatBuffer&) const {}
+
+    void Export_(TimerFields&) const {}
+
+   private:
+    /// Sum_ returns the statistics of the buckets of 'ring' covering
+    /// 'length' up to clock tick 'now'. The window spans from the start of
+    /// its oldest bucket to now.
+    template <class Ring>
+    static WindowStats Sum_(const Ring& ring, int64_t now,
+                            NanosecondsType length) {
+        int64_t width = ring.Width();
+        int64_t n = (int64_t)(length.count() / Clock::NanosecondsPerTick() +
+                              width - 1) /
+                    width;
+        n = n < 1 ? 1 : n;
+        uint64_t count;
+        int64_t total;
+        ring.Sum(now, (size_t)n, count, total);
+        int64_t covered = (n - 1) * width + now % width;
+        return WindowStats(count, Clock::ToNanoseconds(total),
+                           Clock::ToNanoseconds(covered));
+    }
+
+    /// fine_ holds ten buckets of 100ms.
+    internal::WindowRing<10> fine_;
+    /// coarse_ holds twelve buckets of 5s.
+    internal::WindowRing<12> coarse_;
+    /// stop_ is the clock tick of the last Stop_.
+    int64_t stop_;
+    /// stopped_ is true from Stop_ until Add_ buckets its duration.
+    bool stopped_;
+};
+}
+}
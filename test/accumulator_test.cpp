@@ -0,0 +1,124 @@
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "gtest/gtest.h"
+
+#include "timey.hpp"
+
+// Adversarial sample streams, fed to every accumulator policy.
+template <class Accumulator>
+class TimeyAccumulatorTest : public ::testing::Test {
+   protected:
+    void SetUp() override { count_ = 0; }
+
+    void Add(int64_t x) { moments_.Add(x, ++count_); }
+
+    double Mean(void) const { return moments_.Mean(count_); }
+    double StdDev(void) const { return sqrt(moments_.Variance(count_)); }
+
+    Accumulator moments_;
+    size_t count_;
+};
+
+#ifdef __SIZEOF_INT128__
+typedef ::testing::Types<timey::CompensatedMoments, timey::Int128Moments>
+    AccumulatorTypes;
+#else
+typedef ::testing::Types<timey::CompensatedMoments> AccumulatorTypes;
+#endif
+TYPED_TEST_SUITE(TimeyAccumulatorTest, AccumulatorTypes);
+
+TYPED_TEST(TimeyAccumulatorTest, Empty) {
+    EXPECT_EQ(this->Mean(), 0);
+    EXPECT_EQ(this->StdDev(), 0);
+}
+
+TYPED_TEST(TimeyAccumulatorTest, Ramp) {
+    const int64_t n = 100000;
+    for (int64_t i = 1; i <= n; i++) {
+        this->Add(i);
+    }
+    EXPECT_DOUBLE_EQ(this->Mean(), (n + 1) / 2.0);
+    EXPECT_NEAR(this->StdDev(), sqrt((n * n - 1) / 12.0), 1e-6);
+}
+
+TYPED_TEST(TimeyAccumulatorTest, MultiSecondSamples) {
+    // 3s and 5s samples square to more than 2^63 nanoseconds^2
+    for (int i = 0; i < 1000; i++) {
+        this->Add(3000000000LL);
+        this->Add(5000000000LL);
+    }
+    EXPECT_DOUBLE_EQ(this->Mean(), 4e9);
+    EXPECT_NEAR(this->StdDev(), 1e9, 1e-3);
+}
+
+TYPED_TEST(TimeyAccumulatorTest, LargeOffsetSmallSpread) {
+    // About 16 minutes with a spread of 1ns
+    const int64_t offset = 1000000000000LL;
+    for (int i = 0; i < 1000000; i++) {
+        this->Add(offset + i % 2);
+    }
+    EXPECT_NEAR(this->Mean(), offset + 0.5, 1e-3);
+    EXPECT_NEAR(this->StdDev(), 0.5, 1e-3);
+}
+
+TYPED_TEST(TimeyAccumulatorTest, Outliers) {
+    const int n = 100000;
+    for (int i = 0; i < n; i++) {
+        this->Add(i % 1000 == 0 ? 10000000000LL : 100);
+    }
+    double mean = (100 * 10000000000.0 + (n - 100) * 100.0) / n;
+    double variance = (100 * pow(10000000000.0 - mean, 2) +
+                       (n - 100) * pow(100.0 - mean, 2)) /
+                      n;
+    EXPECT_NEAR(this->Mean(), mean, 1e-6 * mean);
+    EXPECT_NEAR(this->StdDev(), sqrt(variance), 1e-9 * sqrt(variance));
+}
+
+TYPED_TEST(TimeyAccumulatorTest, TwoToTheFortySamples) {
+    // 2^20 samples, merged with themselves 20 times
+    for (int i = 0; i < (1 << 20); i++) {
+        this->Add(i % 2 == 0 ? 1000000000LL : 3000000000LL);
+    }
+    for (int i = 0; i < 20; i++) {
+        TypeParam copy = this->moments_;
+        this->moments_.Merge(copy, this->count_, this->count_);
+        this->count_ *= 2;
+    }
+    EXPECT_EQ(this->count_, (size_t)1 << 40);
+    EXPECT_NEAR(this->Mean(), 2e9, 1e-3);
+    EXPECT_NEAR(this->StdDev(), 1e9, 1e-3);
+}
+
+TYPED_TEST(TimeyAccumulatorTest, FromSums) {
+    for (int64_t i = 1; i <= 10; i++) {
+        this->Add(i * 1000);
+    }
+    TypeParam m =
+        TypeParam::FromSums(10, 55000, timey::internal::Uint128{0, 385000000});
+    EXPECT_NEAR(m.Mean(10), this->Mean(), 1e-9);
+    EXPECT_NEAR(m.Variance(10), this->moments_.Variance(10), 1e-6);
+}
+
+// ManualClock is a clock policy whose time is set by the test.
+struct ManualClock {
+    static int64_t now;
+    static int64_t Now() { return now; }
+    static timey::NanosecondsType ToNanoseconds(int64_t ticks) {
+        return ticks * timey::Nanosecond;
+    }
+    static double NanosecondsPerTick() { return 1; }
+};
+int64_t ManualClock::now = 0;
+
+TYPED_TEST(TimeyAccumulatorTest, Timer) {
+    timey::BasicTimer<ManualClock, TypeParam> t;
+    for (int i = 0; i < 10; i++) {
+        t.Start();
+        ManualClock::now += (i % 2 == 0) ? 3000000000LL : 5000000000LL;
+        t.Stop();
+    }
+    EXPECT_EQ(t.Elapsed(), 40 * timey::Second);
+    EXPECT_EQ(t.ElapsedMean(), 4 * timey::Second);
+    EXPECT_EQ(t.ElapsedStdDev(), timey::Second);
+}
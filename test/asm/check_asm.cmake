@@ -0,0 +1,57 @@
+# Compiles SOURCE with TIMEY_DISABLE to assembly and checks that the body of
+# timey_instrumented is the same as the body of timey_plain, and that no
+# static initializer runs timey code before main.
+#
+# Usage: cmake -DCXX=<compiler> -DINCLUDE_DIR=<dir> -DSOURCE=<file>
+#              -P check_asm.cmake
+execute_process(
+    COMMAND ${CXX} -std=c++11 -O2 -DTIMEY_DISABLE -I${INCLUDE_DIR}
+            -fno-asynchronous-unwind-tables -S -o - ${SOURCE}
+    OUTPUT_VARIABLE asm
+    RESULT_VARIABLE result
+    )
+if(result)
+    message(FATAL_ERROR "Compiling ${SOURCE} failed: ${result}")
+endif()
+
+# function_body sets 'out' to the instructions of function 'name'
+function(function_body name out)
+    string(REPLACE ";" "," lines "${asm}")
+    string(REPLACE "\n" ";" lines "${lines}")
+    set(inside OFF)
+    set(body "")
+    foreach(line IN LISTS lines)
+        if(line MATCHES "^_?${name}:")
+            set(inside ON)
+        elseif(inside AND line MATCHES "^[^ \t.].*:")
+            set(inside OFF)
+        elseif(inside AND line MATCHES "^[ \t]*\\.size")
+            set(inside OFF)
+        elseif(inside AND NOT line MATCHES "^[ \t]*(\\.|#|$)")
+            string(STRIP "${line}" line)
+            list(APPEND body "${line}")
+        endif()
+    endforeach()
+    set(${out} "${body}" PARENT_SCOPE)
+endfunction()
+
+function_body(timey_plain plain)
+function_body(timey_instrumented instrumented)
+if(NOT plain)
+    message(FATAL_ERROR "timey_plain not found in the assembly")
+endif()
+if(NOT "${plain}" STREQUAL "${instrumented}")
+    message(FATAL_ERROR "Instrumentation is not compiled out:\n"
+        "timey_plain: ${plain}\ntimey_instrumented: ${instrumented}")
+endif()
+
+# The static initializer of the translation unit, if any, may only set up
+# the standard library, such as std::ios_base::Init for <iostream>
+function_body("_GLOBAL__sub_I_[A-Za-z0-9_]*" initializer)
+foreach(line IN LISTS initializer)
+    if(line MATCHES "timey")
+        message(FATAL_ERROR "timey code runs during static initialization:\n"
+            "${initializer}")
+    endif()
+endforeach()
+message("timey_instrumented compiles to: ${instrumented}")
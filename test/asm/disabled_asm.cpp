@@ -0,0 +1,26 @@
+// Compiled with TIMEY_DISABLE by check_asm.cmake, which checks that the
+// instrumented function compiles to the same code as the plain one.
+#include "timey.hpp"
+
+extern "C" int timey_plain(int x) { return 3 * x + 1; }
+
+extern "C" int timey_instrumented(int x) {
+    TIMEY_SCOPE("instrumented");
+    timey::Timer t("t");
+    timey::TimerSet ts;
+    timey::TimerHandle h = ts.Add("h");
+    ts.Add("named");
+    t.Start();
+    ts.Start("named");
+    ts.Start(h);
+    int y;
+    {
+        timey::ScopedTimer scope(ts, h);
+        timey::ScopedTimer scope_t(t);
+        y = 3 * x + 1;
+    }
+    ts.Stop(h);
+    ts.Stop("named");
+    t.Stop();
+    return y;
+}
@@ -0,0 +1,135 @@
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include "gtest/gtest.h"
+
+#include "timey.hpp"
+
+// ManualClock is a clock policy whose time is set by the test.
+struct ManualClock {
+    static int64_t now;
+    static int64_t Now() { return now; }
+    static timey::NanosecondsType ToNanoseconds(int64_t ticks) {
+        return ticks * timey::Nanosecond;
+    }
+    static double NanosecondsPerTick() { return 1; }
+};
+int64_t ManualClock::now = 0;
+
+typedef timey::BasicCallTree<timey::BasicTimer<ManualClock>> ManualCallTree;
+
+// Solve records one call of solve with assemble and factorize children.
+void Solve(ManualCallTree& tree) {
+    tree.Push("solve");
+    ManualClock::now += 100;
+    tree.Push("assemble");
+    ManualClock::now += 300;
+    tree.Pop();
+    tree.Push("factorize");
+    ManualClock::now += 500;
+    tree.Pop();
+    ManualClock::now += 100;
+    tree.Pop();
+}
+
+TEST(TimeyCallTreeTest, InclusiveExclusive) {
+    ManualCallTree tree;
+    for (int i = 0; i < 3; i++) {
+        Solve(tree);
+    }
+    tree.Push("output");
+    ManualClock::now += 1000;
+    tree.Pop();
+
+    EXPECT_EQ(tree.Count(), (size_t)4);
+    EXPECT_EQ(tree.Depth(), (size_t)0);
+    EXPECT_EQ(tree.Get("solve").Count(), (size_t)3);
+    EXPECT_EQ(tree.Get("solve").Elapsed().count(), 3000);
+    EXPECT_EQ(tree.Exclusive("solve").count(), 600);
+    EXPECT_EQ(tree.Get("solve/assemble").Elapsed().count(), 900);
+    EXPECT_EQ(tree.Exclusive("solve/factorize").count(), 1500);
+    EXPECT_EQ(tree.Get("output").Elapsed().count(), 1000);
+    EXPECT_THROW(tree.Get("assemble"), std::runtime_error);
+    EXPECT_THROW(tree.Get("solve/output"), std::runtime_error);
+    EXPECT_THROW(tree.Pop(), std::runtime_error);
+}
+
+TEST(TimeyCallTreeTest, SameNameAtDifferentPaths) {
+    ManualCallTree tree;
+    tree.Push("a");
+    tree.Push("a");
+    ManualClock::now += 10;
+    tree.Pop();
+    tree.Pop();
+    tree.Push("b");
+    tree.Push("a");
+    tree.Pop();
+    tree.Pop();
+    EXPECT_EQ(tree.Count(), (size_t)4);
+    EXPECT_EQ(tree.Get("a/a").Elapsed().count(), 10);
+    EXPECT_EQ(tree.Get("b/a").Count(), (size_t)1);
+}
+
+TEST(TimeyCallTreeTest, Merge) {
+    ManualCallTree a;
+    ManualCallTree b;
+    Solve(a);
+    Solve(b);
+    b.Push("output");
+    b.Pop();
+
+    a += b;
+    EXPECT_EQ(a.Count(), (size_t)4);
+    EXPECT_EQ(a.Get("solve").Count(), (size_t)2);
+    EXPECT_EQ(a.Get("solve/factorize").Elapsed().count(), 1000);
+    EXPECT_EQ(a.Get("output").Count(), (size_t)1);
+}
+
+TEST(TimeyCallTreeTest, WriteToStream) {
+    ManualCallTree tree;
+    Solve(tree);
+
+    std::stringstream actual;
+    actual << tree;
+    std::string header = timey::internal::CallTreeHeader();
+    std::string rule(header.size() - 10, '-');
+    std::stringstream expected;
+    expected << std::left << header << std::endl << rule << std::endl;
+    expected << std::setw(25) << "solve" << std::setw(15) << 1
+             << std::setw(20) << "1us" << std::setw(20) << "200ns"
+             << std::setw(20) << "1us" << std::setw(20) << "100.0%"
+             << std::endl;
+    expected << std::setw(25) << "  assemble" << std::setw(15) << 1
+             << std::setw(20) << "300ns" << std::setw(20) << "300ns"
+             << std::setw(20) << "300ns" << std::setw(20) << "30.0%"
+             << std::endl;
+    expected << std::setw(25) << "  factorize" << std::setw(15) << 1
+             << std::setw(20) << "500ns" << std::setw(20) << "500ns"
+             << std::setw(20) << "500ns" << std::setw(20) << "50.0%"
+             << std::endl;
+    expected << rule << std::endl;
+    EXPECT_EQ(actual.str(), expected.str());
+}
+
+// Work times nested TIMEY_CALL_SCOPEs in the tree of the calling thread.
+void Work(int n) {
+    TIMEY_CALL_SCOPE("work");
+    for (int i = 0; i < n; i++) {
+        TIMEY_CALL_SCOPE("step");
+    }
+}
+
+TEST(TimeyCallTreeTest, ThreadCallTree) {
+    Work(5);
+    EXPECT_EQ(timey::ThreadCallTree().Get("work/step").Count(), (size_t)5);
+
+    timey::CallTree merged;
+    std::thread worker([&merged]() {
+        Work(3);
+        merged.Merge(timey::ThreadCallTree());
+    });
+    worker.join();
+    EXPECT_EQ(merged.Get("work/step").Count(), (size_t)3);
+    EXPECT_EQ(timey::ThreadCallTree().Get("work/step").Count(), (size_t)5);
+}
@@ -0,0 +1,68 @@
+#include <thread>
+#include "gtest/gtest.h"
+
+#include "timey.hpp"
+
+TEST(TimeyClockTest, ChronoClocks) {
+    EXPECT_EQ(timey::SteadyClock::ToNanoseconds(1000).count(),
+              std::chrono::duration_cast<timey::NanosecondsType>(
+                  std::chrono::steady_clock::duration(1000))
+                  .count());
+    EXPECT_GT(timey::SteadyClock::NanosecondsPerTick(), 0);
+    int64_t first = timey::SteadyClock::Now();
+    EXPECT_LE(first, timey::SteadyClock::Now());
+    first = timey::HighResolutionClock::Now();
+    EXPECT_LE(first, timey::HighResolutionClock::Now());
+}
+
+TEST(TimeyClockTest, SteadyClockTimer) {
+    timey::BasicTimer<timey::SteadyClock> t("steady");
+    t.Start();
+    std::this_thread::sleep_for(10 * timey::Millisecond);
+    t.Stop();
+    EXPECT_EQ(t.Count(), (size_t)1);
+    EXPECT_NEAR(t.Elapsed().count(), 10e6, 2e6);
+}
+
+TEST(TimeyClockTest, ClockOverhead) {
+    // Calibrate measures once, and the overhead does not change afterwards
+    timey::Calibrate();
+    timey::NanosecondsType overhead = timey::ClockOverhead();
+    EXPECT_GE(overhead.count(), 0);
+    EXPECT_LT(overhead, timey::Microsecond);
+    EXPECT_EQ(timey::ClockOverhead(), overhead);
+    EXPECT_EQ(timey::ClockOverhead<timey::HighResolutionClock>(), overhead);
+    EXPECT_LT(timey::ClockOverhead<timey::SteadyClock>(), timey::Microsecond);
+}
+
+#ifdef TIMEY_HAS_TSC
+TEST(TimeyClockTest, TscClock) {
+    // Calibrated on first use
+    double ns_per_tick = timey::TscClock::NanosecondsPerTick();
+    EXPECT_GT(ns_per_tick, 0);
+    double calibrated = timey::TscClock::Calibrate(timey::Millisecond);
+    EXPECT_NEAR(calibrated, ns_per_tick, ns_per_tick / 10);
+    EXPECT_EQ(timey::TscClock::NanosecondsPerTick(), calibrated);
+    int64_t first = timey::TscClock::Now();
+    EXPECT_LT(first, timey::TscClock::Now());
+
+    timey::BasicTimer<timey::TscClock> t("tsc");
+    for (int i = 0; i < 10; i++) {
+        t.Start();
+        std::this_thread::sleep_for(timey::Millisecond);
+        t.Stop();
+    }
+    EXPECT_EQ(t.Count(), (size_t)10);
+    EXPECT_NEAR(t.Elapsed().count(), 10e6, 2e6);
+    EXPECT_NEAR(t.ElapsedMean().count(), 1e6, 2e5);
+}
+
+TEST(TimeyClockTest, TscClockTimerSet) {
+    timey::BasicTimerSet<timey::BasicTimer<timey::TscClock>> ts;
+    ts.Add("timer1");
+    ts.Start("timer1");
+    std::this_thread::sleep_for(timey::Millisecond);
+    ts.Stop("timer1");
+    EXPECT_GT(ts.Get("timer1").Elapsed(), timey::Millisecond);
+}
+#endif
@@ -0,0 +1,305 @@
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include "gtest/gtest.h"
+
+#include "timey.hpp"
+
+TEST(TimeyConcurrentTimerSetTest, Add) {
+    timey::ConcurrentTimerSet ts(2);
+    EXPECT_EQ(ts.Count(), (size_t)0);
+    EXPECT_EQ(ts.Capacity(), (size_t)2);
+
+    timey::TimerHandle h1 = ts.Add("timer1");
+    timey::TimerHandle h2 = ts.Add("timer2");
+    EXPECT_EQ(ts.Count(), (size_t)2);
+    EXPECT_EQ(ts.Handle("timer1"), h1);
+    EXPECT_EQ(ts.Handle("timer2"), h2);
+
+    EXPECT_THROW(ts.Add("timer1"), std::runtime_error);
+    EXPECT_THROW(ts.Add("timer3"), std::runtime_error);
+    EXPECT_THROW(ts.Handle("unknown"), std::runtime_error);
+    EXPECT_THROW(ts.Get("unknown"), std::runtime_error);
+
+    // A default handle is rejected instead of indexing past the shards
+    timey::TimerHandle invalid;
+    EXPECT_THROW(ts.Start(invalid), std::runtime_error);
+    EXPECT_THROW(ts.Stop(invalid), std::runtime_error);
+    EXPECT_THROW(ts.Begin(invalid), std::runtime_error);
+    EXPECT_THROW(ts.InFlight(invalid), std::runtime_error);
+    EXPECT_THROW(ts.Get(invalid), std::runtime_error);
+    EXPECT_EQ(ts.InFlight(h1), 0);
+}
+
+TEST(TimeyConcurrentTimerSetTest, StartStop) {
+    timey::ConcurrentTimerSet ts;
+    timey::TimerHandle h = ts.Add("timer1");
+
+    for (int i = 0; i < 10; i++) {
+        ts.Start(h);
+        std::this_thread::sleep_for(timey::Millisecond);
+        ts.Stop("timer1");
+    }
+    EXPECT_THROW(ts.Stop(h), std::runtime_error);
+    ts.Start("timer1");
+    EXPECT_THROW(ts.Start(h), std::runtime_error);
+    ts.Stop(h);
+
+    timey::Timer t = ts.Get(h);
+    EXPECT_EQ(t.Name(), "timer1");
+    EXPECT_EQ(t.Running(), false);
+    EXPECT_EQ(t.Count(), (size_t)11);
+    EXPECT_GT(t.Elapsed(), 10 * timey::Millisecond);
+    EXPECT_EQ(ts.Threads(), (size_t)1);
+}
+
+TEST(TimeyConcurrentTimerSetTest, MultipleThreads) {
+    const size_t n_threads = 8;
+    const size_t n_iterations = 10000;
+    timey::ConcurrentTimerSet ts;
+    timey::TimerHandle h1 = ts.Add("timer1");
+    timey::TimerHandle h2 = ts.Add("timer2");
+
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < n_threads; i++) {
+        threads.emplace_back([&]() {
+            for (size_t j = 0; j < n_iterations; j++) {
+                ts.Start(h1);
+                ts.Start(h2);
+                ts.Stop(h2);
+                ts.Stop(h1);
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    EXPECT_EQ(ts.Threads(), n_threads);
+    EXPECT_EQ(ts.Get(h1).Count(), n_threads * n_iterations);
+    EXPECT_EQ(ts.Get("timer2").Count(), n_threads * n_iterations);
+    EXPECT_GE(ts.Get(h1).Elapsed(), ts.Get(h2).Elapsed());
+}
+
+TEST(TimeyConcurrentTimerSetTest, ReadWhileWriting) {
+    timey::ConcurrentTimerSet ts;
+    timey::TimerHandle h = ts.Add("timer1");
+    std::atomic<bool> done(false);
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; i++) {
+        threads.emplace_back([&]() {
+            while (!done.load()) {
+                ts.Start(h);
+                ts.Stop(h);
+            }
+        });
+    }
+    size_t last = 0;
+    for (int i = 0; i < 100; i++) {
+        size_t count = ts.Get(h).Count();
+        EXPECT_GE(count, last);
+        last = count;
+        std::ostringstream out;
+        out << ts;
+    }
+    done.store(true);
+    for (auto& t : threads) {
+        t.join();
+    }
+    EXPECT_GE(ts.Get(h).Count(), last);
+}
+
+TEST(TimeyConcurrentTimerSetTest, Statistics) {
+    timey::ConcurrentTimerSet ts;
+    timey::TimerHandle h = ts.Add("timer1");
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 2; i++) {
+        threads.emplace_back([&]() {
+            for (int j = 0; j < 5; j++) {
+                ts.Start(h);
+                std::this_thread::sleep_for(timey::Millisecond);
+                ts.Stop(h);
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    timey::Timer t = ts.Get(h);
+    EXPECT_EQ(t.Count(), (size_t)10);
+    EXPECT_NEAR(t.ElapsedMean().count(), 1e6, 2e5);
+    EXPECT_LT(t.ElapsedStdDev().count(), 2e5);
+}
+
+// ManualClock is a clock policy whose time is set by the test.
+struct ManualClock {
+    static int64_t now;
+    static int64_t Now() { return now; }
+    static timey::NanosecondsType ToNanoseconds(int64_t ticks) {
+        return ticks * timey::Nanosecond;
+    }
+    static double NanosecondsPerTick() { return 1; }
+};
+int64_t ManualClock::now = 0;
+
+TEST(TimeyConcurrentTimerSetTest, StatisticsLargeMean) {
+    timey::BasicConcurrentTimerSet<ManualClock> ts;
+    timey::TimerHandle h = ts.Add("timer1");
+
+    // Durations of 1s +- 10ns on two threads, one after the other, whose
+    // sum of squares does not fit the precision of a double
+    auto record = [&]() {
+        for (int64_t i = 0; i < 100000; i++) {
+            ts.Start(h);
+            ManualClock::now += 1000000000 + (i % 2 == 0 ? 10 : -10);
+            ts.Stop(h);
+        }
+    };
+    std::thread other(record);
+    other.join();
+    record();
+
+    timey::BasicTimer<ManualClock> t = ts.Get(h);
+    EXPECT_EQ(t.Count(), (size_t)200000);
+    EXPECT_EQ(t.ElapsedMean().count(), 1000000000);
+    EXPECT_NEAR(t.ElapsedStdDev().count(), 10, 1);
+}
+
+TEST(TimeyConcurrentTimerSetTest, WriteToStream) {
+    timey::ConcurrentTimerSet ts;
+    ts.Add("timer2");
+    ts.Add("timer1");
+    ts.Start("timer1");
+    ts.Stop("timer1");
+
+    std::ostringstream expected;
+    using std::endl;
+    expected << timey::internal::ReportHeader() << endl;
+    expected << std::string(80, '-') << endl;
+    expected << ts.Get("timer1").Report() << endl;
+    expected << ts.Get("timer2").Report() << endl;
+    expected << std::string(80, '-') << endl;
+
+    std::ostringstream actual;
+    actual << ts;
+
+    EXPECT_EQ(actual.str(), expected.str());
+}
+
+TEST(TimeyConcurrentTimerSetTest, Span) {
+    timey::ConcurrentTimerSet ts;
+    timey::TimerHandle h = ts.Add("timer1");
+
+    timey::ConcurrentTimerSet::Span s1 = ts.Begin(h);
+    timey::ConcurrentTimerSet::Span s2 = ts.Begin("timer1");
+    EXPECT_EQ(s1.Active(), true);
+    EXPECT_EQ(ts.InFlight(h), 2);
+    std::this_thread::sleep_for(timey::Millisecond);
+    s1.End();
+    EXPECT_EQ(s1.Active(), false);
+    EXPECT_THROW(s1.End(), std::runtime_error);
+    EXPECT_EQ(ts.InFlight(h), 1);
+
+    // Moving transfers the span, which is ended once
+    timey::ConcurrentTimerSet::Span s3(std::move(s2));
+    EXPECT_EQ(s2.Active(), false);
+    EXPECT_EQ(s3.Active(), true);
+    s1 = std::move(s3);
+    s1.Cancel();
+    EXPECT_THROW(s1.Cancel(), std::runtime_error);
+    EXPECT_EQ(ts.InFlight(h), 0);
+    {
+        timey::ConcurrentTimerSet::Span scoped = ts.Begin(h);
+    }
+    EXPECT_EQ(ts.InFlight(h), 0);
+    EXPECT_EQ(ts.PeakInFlight(h), 2);
+
+    timey::Timer t = ts.Get(h);
+    EXPECT_EQ(t.Count(), (size_t)2);
+    EXPECT_GT(t.Elapsed(), timey::Millisecond);
+    EXPECT_EQ(t.Running(), false);
+
+    // Spans and Start/Stop of the same timer do not interfere
+    ts.Start(h);
+    timey::ConcurrentTimerSet::Span s4 = ts.Begin(h);
+    ts.Stop(h);
+    s4.End();
+    EXPECT_EQ(ts.Get(h).Count(), (size_t)4);
+}
+
+TEST(TimeyConcurrentTimerSetTest, SpanLost) {
+    // The shards of this set are 64 MiB, so that the shard of this thread
+    // cannot be allocated below the address space limit
+    timey::ConcurrentTimerSet ts(1 << 20);
+    timey::TimerHandle h = ts.Add("timer1");
+    timey::ConcurrentTimerSet::Span s1 = ts.Begin(h);
+    timey::ConcurrentTimerSet::Span s2 = ts.Begin(h);
+    timey::ConcurrentTimerSet::Span s3 = ts.Begin(h);
+    EXPECT_EQ(ts.InFlight(h), 3);
+
+    struct rlimit old_limit;
+    ASSERT_EQ(getrlimit(RLIMIT_AS, &old_limit), 0);
+    long pages = 0;
+    std::ifstream("/proc/self/statm") >> pages;
+    ASSERT_GT(pages, 0);
+    struct rlimit limit = old_limit;
+    limit.rlim_cur = (rlim_t)pages * sysconf(_SC_PAGESIZE) + (16 << 20);
+    ASSERT_EQ(setrlimit(RLIMIT_AS, &limit), 0);
+    // The destructor and the move assignment cannot throw, and count the
+    // durations they cannot record
+    EXPECT_THROW(s3.End(), std::bad_alloc);
+    s1 = std::move(s2);
+    {
+        timey::ConcurrentTimerSet::Span scoped(std::move(s1));
+    }
+    setrlimit(RLIMIT_AS, &old_limit);
+
+    EXPECT_EQ(ts.InFlight(h), 1);
+    EXPECT_EQ(ts.Lost(h), 2);
+    EXPECT_EQ(ts.Threads(), (size_t)0);
+    s3.End();
+    EXPECT_EQ(ts.InFlight(h), 0);
+    EXPECT_EQ(ts.Lost(h), 2);
+    EXPECT_EQ(ts.Get(h).Count(), (size_t)1);
+}
+
+TEST(TimeyConcurrentTimerSetTest, SpanAcrossThreads) {
+    const size_t n_threads = 4;
+    const size_t n_spans = 1000;
+    timey::ConcurrentTimerSet ts;
+    timey::TimerHandle h = ts.Add("rpc");
+
+    // Spans begun on this thread are ended on the worker threads
+    std::vector<std::vector<timey::ConcurrentTimerSet::Span>> spans(n_threads);
+    for (size_t i = 0; i < n_threads; i++) {
+        for (size_t j = 0; j < n_spans; j++) {
+            spans[i].push_back(ts.Begin(h));
+        }
+    }
+    EXPECT_EQ(ts.InFlight(h), (int64_t)(n_threads * n_spans));
+
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < n_threads; i++) {
+        threads.emplace_back([&spans, i]() {
+            for (auto& s : spans[i]) {
+                s.End();
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    EXPECT_EQ(ts.InFlight(h), 0);
+    EXPECT_EQ(ts.PeakInFlight(h), (int64_t)(n_threads * n_spans));
+    EXPECT_EQ(ts.Get(h).Count(), n_threads * n_spans);
+    EXPECT_EQ(ts.Threads(), n_threads);
+}
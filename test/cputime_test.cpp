@@ -0,0 +1,107 @@
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include "gtest/gtest.h"
+
+#include "timey.hpp"
+
+typedef timey::BasicTimer<timey::SteadyClock, timey::DefaultMoments,
+                          timey::stats::Pack<timey::stats::CpuTime>>
+    CpuTimer;
+
+#ifdef TIMEY_HAS_CPU_CLOCKS
+// Spin keeps the calling thread busy until it has used 'ms' milliseconds of
+// CPU time, however long it is descheduled.
+void Spin(int64_t ms) {
+    int64_t end = timey::ThreadCpuClock::Now() + ms * 1000000;
+    volatile uint64_t x = 0;
+    while (timey::ThreadCpuClock::Now() < end) {
+        x = x + 1;
+    }
+}
+
+TEST(TimeyCpuTimeTest, Clocks) {
+    int64_t thread = timey::ThreadCpuClock::Now();
+    int64_t process = timey::ProcessCpuClock::Now();
+    Spin(5);
+    EXPECT_GT(timey::ThreadCpuClock::Now(), thread);
+    EXPECT_GT(timey::ProcessCpuClock::Now(), process);
+    EXPECT_EQ(timey::ThreadCpuClock::ToNanoseconds(5).count(), 5);
+
+    // The CPU time of a sleeping thread barely moves
+    thread = timey::ThreadCpuClock::Now();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_LT(timey::ThreadCpuClock::Now() - thread, 10000000);
+}
+
+TEST(TimeyCpuTimeTest, Timer) {
+    CpuTimer t("t");
+    EXPECT_EQ(t.HasCpuTime(), false);
+    EXPECT_EQ(t.EnableCpuTime(), true);
+    EXPECT_EQ(t.HasCpuTime(), true);
+
+    t.Start();
+    Spin(20);
+    t.Stop();
+    EXPECT_EQ(t.MeasuredCalls(), (uint64_t)1);
+    EXPECT_GE(t.ElapsedCpu().count(), 20000000);
+    EXPECT_LE(t.ElapsedWait(), t.Elapsed());
+    timey::NanosecondsType busy = t.ElapsedCpu();
+
+    // A sleeping thread uses less CPU time than a spinning one, however
+    // loaded the machine
+    t.Reset();
+    t.Start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    t.Stop();
+    EXPECT_LT(t.ElapsedCpu(), busy);
+    EXPECT_LT(t.CpuUtilisation(), 50);
+    EXPECT_GT(t.ElapsedWait(), t.ElapsedCpu());
+
+    // Added durations are not measured
+    t.Add(1000000000);
+    EXPECT_EQ(t.Count(), (size_t)2);
+    EXPECT_EQ(t.MeasuredCalls(), (uint64_t)1);
+    EXPECT_LT(t.ElapsedWait().count(), 1000000000);
+
+    std::string header = t.ReportHeader();
+    EXPECT_NE(header.find("Wait"), std::string::npos);
+    EXPECT_NE(header.find("CPU %"), std::string::npos);
+    timey::TimerFields fields;
+    t.Export(fields);
+    EXPECT_NE(fields.Find("cpu_ns"), fields.Size());
+    EXPECT_NE(fields.Find("wait_ns"), fields.Size());
+
+    CpuTimer merged("merged");
+    merged.EnableCpuTime(timey::CpuScope::Process);
+    merged.Merge(t);
+    EXPECT_EQ(merged.MeasuredCalls(), (uint64_t)1);
+    EXPECT_EQ(merged.ElapsedCpu(), t.ElapsedCpu());
+    EXPECT_EQ(merged.ElapsedWait(), t.ElapsedWait());
+}
+
+TEST(TimeyCpuTimeTest, ProcessScope) {
+    CpuTimer t("t");
+    t.EnableCpuTime(timey::CpuScope::Process);
+    t.Start();
+    std::thread other([] { Spin(20); });
+    other.join();
+    t.Stop();
+    // The process CPU time counts the other thread
+    EXPECT_GE(t.ElapsedCpu().count(), 20000000);
+}
+#endif
+
+TEST(TimeyCpuTimeTest, Disabled) {
+    CpuTimer t("t");
+    CpuTimer plain("plain");
+    t.Start();
+    Spin(1);
+    t.Stop();
+    EXPECT_EQ(t.MeasuredCalls(), (uint64_t)0);
+    EXPECT_EQ(t.ElapsedCpu().count(), 0);
+    EXPECT_EQ(t.ReportHeader(), plain.ReportHeader());
+    t.EnableCpuTime();
+    t.DisableCpuTime();
+    EXPECT_EQ(t.HasCpuTime(), false);
+}
@@ -0,0 +1,66 @@
+#define TIMEY_DISABLE
+
+#include <sstream>
+#include <type_traits>
+#include "gtest/gtest.h"
+
+#include "timey.hpp"
+
+static_assert(std::is_same<timey::Timer, timey::NullTimer>::value,
+              "Timer is a NullTimer with TIMEY_DISABLE");
+static_assert(std::is_same<timey::TimerSet, timey::NullTimerSet>::value,
+              "TimerSet is a NullTimerSet with TIMEY_DISABLE");
+static_assert(std::is_empty<timey::Timer>::value &&
+                  std::is_empty<timey::TimerSet>::value,
+              "Disabled timers hold nothing");
+
+TEST(TimeyDisabledTest, Timer) {
+    timey::Timer t("t");
+    t.EnableHistogram();
+    t.ReserveSamples(10);
+    t.SampleEvery(8);
+    t.Start();
+    t.Stop();
+    t.Restart();
+    t.Stop();
+    EXPECT_EQ(t.Running(), false);
+    EXPECT_EQ(t.Count(), (size_t)0);
+    EXPECT_EQ(t.SampledCount(), (size_t)0);
+    EXPECT_EQ(t.Elapsed().count(), 0);
+    EXPECT_EQ(t.Percentile(99).count(), 0);
+    EXPECT_EQ(t.Samples().Size(), (size_t)0);
+
+    std::stringstream out;
+    out << t;
+    EXPECT_EQ(out.str(), "");
+}
+
+TEST(TimeyDisabledTest, TimerSet) {
+    timey::TimerSet ts;
+    timey::TimerHandle h = ts.Add("a");
+    ts.Start("a");
+    ts.Stop("a");
+    ts.Start(h);
+    ts.Stop(h);
+    EXPECT_EQ(ts.Count(), (size_t)0);
+    EXPECT_EQ(ts.Get(h).Count(), (size_t)0);
+
+    std::stringstream out;
+    out << ts;
+    EXPECT_EQ(out.str(), "");
+    std::stringstream csv;
+    timey::WriteCsv(csv, ts);
+    EXPECT_EQ(csv.str(), "name\n");
+    std::stringstream json;
+    timey::WriteJsonLines(json, ts.Get(h));
+    EXPECT_EQ(json.str(), "");
+}
+
+TEST(TimeyDisabledTest, Scope) {
+    timey::TimerSet ts;
+    {
+        TIMEY_SCOPE("scope");
+        timey::ScopedTimer scope(ts, ts.Add("a"));
+    }
+    EXPECT_EQ(timey::GlobalTimerSet().Count(), (size_t)0);
+}
@@ -0,0 +1,262 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "gtest/gtest.h"
+
+#include "timey.hpp"
+
+// NanosecondClock is a clock policy counting in nanoseconds, for timers whose
+// durations are added by the test.
+struct NanosecondClock {
+    static int64_t Now() { return 0; }
+    static timey::NanosecondsType ToNanoseconds(int64_t ticks) {
+        return ticks * timey::Nanosecond;
+    }
+    static double NanosecondsPerTick() { return 1; }
+};
+
+typedef timey::BasicTimer<NanosecondClock> ExportTimer;
+typedef timey::BasicTimerSet<ExportTimer> ExportTimerSet;
+
+// Connect opens a connection to the local 'port'.
+int Connect(uint16_t port) {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(port);
+    EXPECT_EQ(::connect(fd, (sockaddr*)&address, sizeof(address)), 0);
+    return fd;
+}
+
+// Get sends an HTTP GET request for 'path' to the local 'port' and returns
+// the response.
+std::string Get(uint16_t port, const std::string& path) {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(port);
+    std::string response;
+    if (::connect(fd, (sockaddr*)&address, sizeof(address)) == 0) {
+        std::string request = "GET " + path + " HTTP/1.1\r\n\r\n";
+        EXPECT_EQ(::send(fd, request.data(), request.size(), 0),
+                  (ssize_t)request.size());
+        char data[1024];
+        ssize_t n;
+        while ((n = ::recv(fd, data, sizeof(data), 0)) > 0) {
+            response.append(data, n);
+        }
+    }
+    ::close(fd);
+    return response;
+}
+
+TEST(TimeyExportTest, Fields) {
+    ExportTimer t("t");
+    t.Add(1000);
+    t.Add(3000);
+    timey::TimerFields fields;
+    t.Export(fields);
+    ASSERT_EQ(fields.Size(), 4u);
+    EXPECT_STREQ(fields.Name(0), "count");
+    EXPECT_EQ(fields.Value(0), 2);
+    EXPECT_TRUE(fields.Counter(0));
+    EXPECT_EQ(fields.Value(fields.Find("total_ns")), 4000);
+    EXPECT_EQ(fields.Value(fields.Find("mean_ns")), 2000);
+    EXPECT_EQ(fields.Value(fields.Find("stddev_ns")),
+              t.ElapsedStdDev().count());
+    EXPECT_FALSE(fields.Counter(fields.Find("mean_ns")));
+    EXPECT_EQ(fields.Find("p50_ns"), fields.Size());
+
+    t.EnableHistogram();
+    t.Add(2000);
+    fields.Clear();
+    t.Export(fields);
+    EXPECT_EQ(fields.Value(fields.Find("p50_ns")), t.Percentile(50).count());
+    EXPECT_EQ(fields.Value(fields.Find("p999_ns")),
+              t.Percentile(99.9).count());
+
+    timey::BasicTimer<NanosecondClock, timey::NoMoments,
+                      timey::stats::Pack<timey::stats::MinMax>>
+        m;
+    m.Add(5);
+    m.Add(7);
+    fields.Clear();
+    m.Export(fields);
+    EXPECT_EQ(fields.Find("stddev_ns"), fields.Size());
+    EXPECT_EQ(fields.Value(fields.Find("min_ns")), 5);
+    EXPECT_EQ(fields.Value(fields.Find("max_ns")), 7);
+}
+
+TEST(TimeyExportTest, JsonLines) {
+    ExportTimerSet ts;
+    ts.Get(ts.Add("b")).Add(1000);
+    ts.Get(ts.Add("a \"quoted\"\n")).Add(10);
+
+    std::ostringstream out;
+    timey::WriteJsonLines(out, ts);
+    EXPECT_EQ(out.str(),
+              "{\"name\":\"a \\\"quoted\\\"\\n\",\"count\":1,\"total_ns\":10,"
+              "\"mean_ns\":10,\"stddev_ns\":0}\n"
+              "{\"name\":\"b\",\"count\":1,\"total_ns\":1000,"
+              "\"mean_ns\":1000,\"stddev_ns\":0}\n");
+
+    std::ostringstream single;
+    timey::WriteJsonLines(single, ts.Get("b"));
+    EXPECT_EQ(single.str(),
+              "{\"name\":\"b\",\"count\":1,\"total_ns\":1000,"
+              "\"mean_ns\":1000,\"stddev_ns\":0}\n");
+}
+
+TEST(TimeyExportTest, Csv) {
+    ExportTimerSet ts;
+    ts.Get(ts.Add("plain")).Add(100);
+    ExportTimer& h = ts.Get(ts.Add("with,comma"));
+    h.EnableHistogram();
+    h.Add(200);
+
+    std::ostringstream out;
+    timey::WriteCsv(out, ts);
+    EXPECT_EQ(out.str(),
+              "name,count,total_ns,mean_ns,stddev_ns,p50_ns,p90_ns,p99_ns,"
+              "p999_ns\n"
+              "plain,1,100,100,0,,,,\n"
+              "\"with,comma\",1,200,200,0,200,200,200,200\n");
+}
+
+TEST(TimeyExportTest, OpenMetrics) {
+    ExportTimerSet ts;
+    ts.Get(ts.Add("a")).Add(10);
+    ts.Get(ts.Add("b")).Add(30);
+
+    std::ostringstream out;
+    timey::WriteOpenMetrics(out, ts, "app");
+    EXPECT_EQ(out.str(),
+              "# TYPE app_count counter\n"
+              "app_count_total{timer=\"a\"} 1\n"
+              "app_count_total{timer=\"b\"} 1\n"
+              "# TYPE app_total_nanoseconds counter\n"
+              "# UNIT app_total_nanoseconds nanoseconds\n"
+              "app_total_nanoseconds_total{timer=\"a\"} 10\n"
+              "app_total_nanoseconds_total{timer=\"b\"} 30\n"
+              "# TYPE app_mean_nanoseconds gauge\n"
+              "# UNIT app_mean_nanoseconds nanoseconds\n"
+              "app_mean_nanoseconds{timer=\"a\"} 10\n"
+              "app_mean_nanoseconds{timer=\"b\"} 30\n"
+              "# TYPE app_stddev_nanoseconds gauge\n"
+              "# UNIT app_stddev_nanoseconds nanoseconds\n"
+              "app_stddev_nanoseconds{timer=\"a\"} 0\n"
+              "app_stddev_nanoseconds{timer=\"b\"} 0\n"
+              "# EOF\n");
+
+    std::ostringstream empty;
+    timey::WriteOpenMetrics(empty, ExportTimerSet());
+    EXPECT_EQ(empty.str(), "# EOF\n");
+}
+
+TEST(TimeyExportTest, LargeSet) {
+    ExportTimerSet ts;
+    for (int i = 0; i < 5000; i++) {
+        ts.Get(ts.Add("timer_" + std::to_string(i))).Add(i);
+    }
+    std::ostringstream out;
+    timey::WriteJsonLines(out, ts);
+    std::string s = out.str();
+    EXPECT_EQ((size_t)std::count(s.begin(), s.end(), '\n'), 5000u);
+    EXPECT_NE(s.find("{\"name\":\"timer_4999\",\"count\":1,"
+                     "\"total_ns\":4999,"),
+              std::string::npos);
+}
+
+TEST(TimeyExportTest, Snapshots) {
+    timey::SnapshotTimerSet ts;
+    ts.Get(ts.Add("s")).Add(0);
+    std::ostringstream out;
+    timey::WriteCsv(out, ts.Snapshot());
+    EXPECT_EQ(out.str(),
+              "name,count,total_ns,mean_ns,stddev_ns\ns,1,0,0,0\n");
+}
+
+TEST(TimeyExportTest, OpenMetricsFile) {
+    ExportTimerSet ts;
+    ts.Get(ts.Add("a")).Add(10);
+    std::string path = ::testing::TempDir() + "timey_export_test.prom";
+    timey::WriteOpenMetricsFile(path, ts);
+
+    std::ifstream in(path.c_str());
+    std::stringstream content;
+    content << in.rdbuf();
+    std::ostringstream expected;
+    timey::WriteOpenMetrics(expected, ts);
+    EXPECT_EQ(content.str(), expected.str());
+    EXPECT_FALSE(std::ifstream((path + ".tmp").c_str()).good());
+    std::remove(path.c_str());
+
+    EXPECT_THROW(timey::WriteOpenMetricsFile("/nonexistent/dir/x.prom", ts),
+                 std::runtime_error);
+}
+
+TEST(TimeyExportTest, MetricsServer) {
+    ExportTimerSet ts;
+    ts.Get(ts.Add("a")).Add(10);
+    timey::MetricsServer server(
+        [&ts](std::ostream& out) { timey::WriteOpenMetrics(out, ts); });
+    ASSERT_NE(server.Port(), 0);
+
+    std::string response = Get(server.Port(), "/metrics");
+    std::ostringstream expected;
+    timey::WriteOpenMetrics(expected, ts);
+    EXPECT_EQ(response.compare(0, 15, "HTTP/1.1 200 OK"), 0);
+    EXPECT_NE(response.find("application/openmetrics-text"),
+              std::string::npos);
+    EXPECT_EQ(response.substr(response.find("\r\n\r\n") + 4),
+              expected.str());
+
+    response = Get(server.Port(), "/other");
+    EXPECT_EQ(response.compare(0, 22, "HTTP/1.1 404 Not Found"), 0);
+    server.Stop();
+    EXPECT_EQ(Get(server.Port(), "/metrics"), "");
+}
+
+TEST(TimeyExportTest, MetricsServerSlowClient) {
+    typedef std::chrono::steady_clock Clock;
+    ExportTimerSet ts;
+    timey::MetricsServer server(
+        [&ts](std::ostream& out) { timey::WriteOpenMetrics(out, ts); });
+
+    // A client sending a byte at a time is dropped at the deadline
+    int fd = Connect(server.Port());
+    Clock::time_point start = Clock::now();
+    bool dropped = false;
+    while (!dropped && Clock::now() - start < std::chrono::seconds(5)) {
+        ::send(fd, "G", 1, MSG_NOSIGNAL);
+        pollfd p = {fd, POLLIN, 0};
+        char c;
+        dropped = ::poll(&p, 1, 100) > 0 && ::recv(fd, &c, 1, 0) <= 0;
+    }
+    EXPECT_TRUE(dropped);
+    EXPECT_LT(Clock::now() - start,
+              timey::MetricsRequestTimeout + std::chrono::milliseconds(500));
+    ::close(fd);
+
+    // Stop does not wait for a connection that sends nothing
+    fd = Connect(server.Port());
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    start = Clock::now();
+    server.Stop();
+    EXPECT_LT(Clock::now() - start, std::chrono::milliseconds(500));
+    ::close(fd);
+}
@@ -0,0 +1,103 @@
+#include <cstdint>
+#include <stdexcept>
+#include "gtest/gtest.h"
+
+#include "timey.hpp"
+
+TEST(TimeyHistogramTest, Disabled) {
+    timey::Histogram h;
+    h.Record(10);
+    EXPECT_EQ(h.Enabled(), false);
+    EXPECT_EQ(h.TotalCount(), (uint64_t)0);
+    EXPECT_EQ(h.MemoryBytes(), (size_t)0);
+    EXPECT_EQ(h.ValueAtPercentile(50), 0);
+}
+
+TEST(TimeyHistogramTest, InvalidArguments) {
+    EXPECT_THROW(timey::Histogram(0), std::invalid_argument);
+    EXPECT_THROW(timey::Histogram(6), std::invalid_argument);
+    EXPECT_THROW(timey::Histogram(3, 1), std::invalid_argument);
+}
+
+TEST(TimeyHistogramTest, ExactSmallValues) {
+    timey::Histogram h(3);
+    for (int64_t i = 1; i <= 1000; i++) {
+        h.Record(i);
+    }
+    EXPECT_EQ(h.TotalCount(), (uint64_t)1000);
+    EXPECT_EQ(h.Min(), 1);
+    EXPECT_EQ(h.Max(), 1000);
+    EXPECT_EQ(h.ValueAtPercentile(0), 1);
+    EXPECT_EQ(h.ValueAtPercentile(50), 500);
+    EXPECT_EQ(h.ValueAtPercentile(99), 990);
+    EXPECT_EQ(h.ValueAtPercentile(100), 1000);
+}
+
+TEST(TimeyHistogramTest, PercentileAccuracy) {
+    for (int digits = 1; digits <= 4; digits++) {
+        timey::Histogram h(digits);
+        const int64_t n = 100000;
+        for (int64_t i = 1; i <= n; i++) {
+            h.Record(i * 997);
+        }
+        double tolerance = 1.0;
+        for (int d = 0; d < digits; d++) {
+            tolerance /= 10;
+        }
+        const double percentiles[] = {1, 10, 50, 90, 99, 99.9, 99.99};
+        for (double p : percentiles) {
+            double expected = p / 100 * n * 997;
+            double actual = (double)h.ValueAtPercentile(p);
+            EXPECT_NEAR(actual, expected, expected * tolerance)
+                << "digits " << digits << " percentile " << p;
+        }
+        EXPECT_EQ(h.ValueAtPercentile(100), n * 997);
+    }
+}
+
+TEST(TimeyHistogramTest, BoundedMemory) {
+    timey::Histogram h(3);
+    size_t bytes = h.MemoryBytes();
+    EXPECT_GT(bytes, (size_t)0);
+    EXPECT_LT(bytes, (size_t)512 * 1024);
+    for (int64_t i = 0; i < 1000000; i++) {
+        h.Record(i * 1234567);
+    }
+    EXPECT_EQ(h.MemoryBytes(), bytes);
+
+    // Values above the highest trackable value are clamped
+    timey::Histogram small(2, 1000);
+    small.Record(5000);
+    EXPECT_EQ(small.Max(), 1000);
+    EXPECT_EQ(small.ValueAtPercentile(100), 1000);
+}
+
+TEST(TimeyHistogramTest, Merge) {
+    timey::Histogram all(3);
+    timey::Histogram a(3);
+    timey::Histogram b(3);
+    for (int64_t i = 1; i <= 10000; i++) {
+        all.Record(i * 31);
+        (i % 3 == 0 ? a : b).Record(i * 31);
+    }
+    a.Merge(b);
+    EXPECT_EQ(a.TotalCount(), all.TotalCount());
+    EXPECT_EQ(a.Min(), all.Min());
+    EXPECT_EQ(a.Max(), all.Max());
+    const double percentiles[] = {0, 25, 50, 75, 99, 99.9, 100};
+    for (double p : percentiles) {
+        EXPECT_EQ(a.ValueAtPercentile(p), all.ValueAtPercentile(p));
+    }
+
+    timey::Histogram disabled;
+    disabled.Merge(a);
+    EXPECT_EQ(disabled.Enabled(), true);
+    EXPECT_EQ(disabled.TotalCount(), a.TotalCount());
+
+    timey::Histogram other(2);
+    EXPECT_THROW(a.Merge(other), std::runtime_error);
+
+    a.Clear();
+    EXPECT_EQ(a.TotalCount(), (uint64_t)0);
+    EXPECT_EQ(a.ValueAtPercentile(50), 0);
+}
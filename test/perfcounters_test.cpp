@@ -0,0 +1,93 @@
+#include <cstdint>
+#include "gtest/gtest.h"
+
+#include "timey.hpp"
+
+typedef timey::BasicTimer<timey::SteadyClock, timey::DefaultMoments,
+                          timey::stats::Pack<timey::stats::Counters>>
+    CounterTimer;
+
+// Spin keeps the CPU busy for about 'ms' milliseconds.
+void Spin(int64_t ms) {
+    int64_t end = timey::SteadyClock::Now() + ms * 1000000;
+    volatile uint64_t x = 0;
+    while (timey::SteadyClock::Now() < end) {
+        x = x + 1;
+    }
+}
+
+TEST(TimeyPerfCountersTest, SoftwareGroup) {
+    // Software events are available where hardware ones often are not,
+    // which exercises opening and reading a group
+    const timey::PerfEvent events[] = {
+        {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK},
+        {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_CLOCK}};
+    timey::PerfGroup group(events, 2);
+    if (!group.Valid()) {
+        // perf_event_open is forbidden, reads return zeros
+        EXPECT_EQ(group.Read().values[0], (uint64_t)0);
+        return;
+    }
+    EXPECT_EQ(group.Rdpmc(), false);
+    timey::PerfCounts before = group.Read();
+    Spin(5);
+    timey::PerfCounts after = group.Read();
+    // The task clock runs while the thread runs; the CPU clock event may
+    // not be scheduled with it, so it is only checked not to go back
+    EXPECT_GT(after.values[0], before.values[0]);
+    EXPECT_GE(after.values[1], before.values[1]);
+    EXPECT_EQ(after.values[2], (uint64_t)0);
+}
+
+TEST(TimeyPerfCountersTest, PerfCounts) {
+    timey::PerfCounts c;
+    EXPECT_EQ(c.Ipc(), 0);
+    c.values[0] = 200;
+    c.values[1] = 500;
+    c.values[2] = 3;
+    c.values[3] = 4;
+    EXPECT_DOUBLE_EQ(c.Ipc(), 2.5);
+    EXPECT_EQ(c.Cycles(), (uint64_t)200);
+    EXPECT_EQ(c.Instructions(), (uint64_t)500);
+    EXPECT_EQ(c.CacheMisses(), (uint64_t)3);
+    EXPECT_EQ(c.BranchMisses(), (uint64_t)4);
+}
+
+TEST(TimeyPerfCountersTest, Timer) {
+    CounterTimer t("t");
+    EXPECT_EQ(t.HasCounters(), false);
+    bool available = t.EnableCounters();
+    EXPECT_EQ(available, timey::ThreadPerfGroup().Valid());
+    EXPECT_EQ(t.HasCounters(), available);
+    for (int i = 0; i < 10; i++) {
+        t.Start();
+        Spin(1);
+        t.Stop();
+    }
+    t.Add(1000);
+    EXPECT_EQ(t.Count(), (size_t)11);
+
+    CounterTimer plain("plain");
+    if (!available) {
+        // Without perf events the timer falls back to timing only
+        EXPECT_EQ(t.CountedCalls(), (uint64_t)0);
+        EXPECT_EQ(t.ReportHeader(), plain.ReportHeader());
+        return;
+    }
+    EXPECT_EQ(t.CountedCalls(), (uint64_t)10);
+    EXPECT_GT(t.Counts().Instructions(), (uint64_t)0);
+    EXPECT_GT(t.Counts().Ipc(), 0);
+    EXPECT_NE(t.ReportHeader().find("IPC"), std::string::npos);
+    timey::TimerFields fields;
+    t.Export(fields);
+    EXPECT_NE(fields.Find("instructions"), fields.Size());
+
+    CounterTimer merged("merged");
+    merged.EnableCounters();
+    merged.Merge(t);
+    EXPECT_EQ(merged.CountedCalls(), (uint64_t)10);
+    t.Reset();
+    EXPECT_EQ(t.CountedCalls(), (uint64_t)0);
+    t.EnableCounters(false);
+    EXPECT_EQ(t.HasCounters(), false);
+}
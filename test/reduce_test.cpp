@@ -0,0 +1,100 @@
+#include <vector>
+#include "gtest/gtest.h"
+
+#include "timey.hpp"
+
+// CountingClock is a clock policy that advances by one tick per reading.
+struct CountingClock {
+    static int64_t now;
+    static int64_t Now() { return now++; }
+    static timey::NanosecondsType ToNanoseconds(int64_t ticks) {
+        return ticks * timey::Nanosecond;
+    }
+    static double NanosecondsPerTick() { return 1; }
+};
+int64_t CountingClock::now = 0;
+
+typedef timey::BasicTimer<CountingClock> CountingTimer;
+typedef timey::BasicTimer<CountingClock, timey::CompensatedMoments>
+    CompensatedTimer;
+
+// CheckDurations reduces shards whose durations differ within and across
+// shards and compares the result with one timer adding every duration.
+template <class TimerType>
+void CheckDurations(int64_t tolerance) {
+    for (size_t n : {2, 3, 7, 64, 1000}) {
+        std::vector<TimerType> timers(n);
+        TimerType serial;
+        for (size_t i = 0; i < n; i++) {
+            // Shards have different means and spreads
+            for (size_t j = 0; j < i % 5 + 1; j++) {
+                int64_t x = 1000 * (int64_t)(i % 7 + 1) +
+                            (int64_t)(j * j * (i % 11 + 1)) * 37;
+                timers[i].Add(x);
+                serial.Add(x);
+            }
+        }
+
+        for (size_t threads : {1, 4}) {
+            TimerType t = timey::Reduce(timers.begin(), timers.end(),
+                                        threads);
+            EXPECT_EQ(t.Count(), serial.Count());
+            EXPECT_EQ(t.Elapsed(), serial.Elapsed());
+            EXPECT_NEAR(t.ElapsedMean().count(),
+                        serial.ElapsedMean().count(), tolerance);
+            EXPECT_GT(serial.ElapsedStdDev().count(), 0);
+            EXPECT_NEAR(t.ElapsedStdDev().count(),
+                        serial.ElapsedStdDev().count(), tolerance);
+        }
+    }
+}
+
+TEST(TimeyReduceTest, Empty) {
+    std::vector<CountingTimer> timers;
+    EXPECT_THROW(timey::Reduce(timers.begin(), timers.end()),
+                 std::runtime_error);
+}
+
+TEST(TimeyReduceTest, Timers) {
+    for (size_t n : {1, 2, 3, 7, 64, 1000, 5000}) {
+        std::vector<CountingTimer> timers(n);
+        timers[0].Name("first");
+        CountingTimer all;
+        for (size_t i = 0; i < n; i++) {
+            for (size_t j = 0; j < i % 3 + 1; j++) {
+                timers[i].Start();
+                timers[i].Stop();
+            }
+            all.Merge(timers[i]);
+        }
+
+        for (size_t threads : {1, 4}) {
+            CountingTimer t = timey::Reduce(timers.begin(), timers.end(),
+                                            threads);
+            EXPECT_EQ(t.Name(), "first");
+            EXPECT_EQ(t.Count(), all.Count());
+            EXPECT_EQ(t.Elapsed(), all.Elapsed());
+            EXPECT_EQ(t.ElapsedMean(), all.ElapsedMean());
+        }
+    }
+}
+
+TEST(TimeyReduceTest, Durations) {
+    // The exact sums of the default accumulator merge exactly
+    CheckDurations<CountingTimer>(0);
+    CheckDurations<CompensatedTimer>(1);
+}
+
+TEST(TimeyReduceTest, TimerSets) {
+    std::vector<timey::TimerSet> sets(100);
+    for (size_t i = 0; i < sets.size(); i++) {
+        sets[i].Add("common");
+        sets[i].Add("worker" + std::to_string(i % 10));
+        sets[i].Start("common");
+        sets[i].Stop("common");
+    }
+
+    timey::TimerSet ts = timey::Reduce(sets.begin(), sets.end());
+    EXPECT_EQ(ts.Count(), (size_t)11);
+    EXPECT_EQ(ts.Get("common").Count(), (size_t)100);
+}
@@ -0,0 +1,159 @@
+#include <atomic>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "gtest/gtest.h"
+
+#include "timey.hpp"
+
+// ManualClock is a clock policy whose time is set by the test.
+struct ManualClock {
+    static int64_t now;
+    static int64_t Now() { return now; }
+    static timey::NanosecondsType ToNanoseconds(int64_t ticks) {
+        return ticks * timey::Nanosecond;
+    }
+    static double NanosecondsPerTick() { return 1; }
+};
+int64_t ManualClock::now = 0;
+
+typedef timey::BasicTimer<ManualClock, timey::DefaultMoments,
+                          timey::stats::Pack<timey::stats::Snapshots>>
+    ManualSnapshotTimer;
+
+TEST(TimeyReporterTest, Snapshot) {
+    ManualSnapshotTimer t("t");
+    for (int64_t i = 1; i <= 10; i++) {
+        t.Add(i * 1000);
+    }
+    timey::TimerSnapshot s = t.Snapshot();
+    EXPECT_EQ(s.Count(), (uint64_t)10);
+    EXPECT_EQ(s.Elapsed(), t.Elapsed());
+    EXPECT_EQ(s.Mean(), t.ElapsedMean());
+    EXPECT_NEAR(s.StdDev().count(), t.ElapsedStdDev().count(), 1);
+
+    for (int64_t i = 0; i < 5; i++) {
+        t.Add(500);
+    }
+    timey::TimerSnapshot delta = t.Snapshot().Since(s);
+    EXPECT_EQ(delta.Count(), (uint64_t)5);
+    EXPECT_EQ(delta.Elapsed().count(), 2500);
+    EXPECT_EQ(delta.Mean().count(), 500);
+    EXPECT_EQ(delta.StdDev().count(), 0);
+
+    ManualSnapshotTimer copy(t);
+    EXPECT_EQ(copy.Snapshot().Count(), (uint64_t)15);
+    copy.Merge(t);
+    EXPECT_EQ(copy.Snapshot().Count(), (uint64_t)30);
+    t.Reset();
+    EXPECT_EQ(t.Snapshot().Count(), (uint64_t)0);
+    // A reset timer reports everything since the reset
+    EXPECT_EQ(t.Snapshot().Since(s).Count(), (uint64_t)0);
+}
+
+TEST(TimeyReporterTest, SnapshotManySamples) {
+    // A mean of a second and a standard deviation of a nanosecond, which a
+    // double sum of squares loses entirely
+    ManualSnapshotTimer t("t");
+    for (int64_t i = 0; i < 1000000; i++) {
+        t.Add(1000000000 + (i % 2 == 0 ? -1 : 1));
+    }
+    timey::TimerSnapshot s = t.Snapshot();
+    EXPECT_EQ(s.Mean().count(), 1000000000);
+    EXPECT_DOUBLE_EQ(s.SecondMoment(), 1000000);
+    EXPECT_EQ(s.StdDev().count(), 1);
+
+    for (int64_t i = 0; i < 1000; i++) {
+        t.Add(1000000000 + (i % 2 == 0 ? -3 : 3));
+    }
+    timey::TimerSnapshot delta = t.Snapshot().Since(s);
+    EXPECT_EQ(delta.Count(), (uint64_t)1000);
+    EXPECT_EQ(delta.Mean().count(), 1000000000);
+    EXPECT_EQ(delta.StdDev().count(), 3);
+    EXPECT_NEAR(delta.SecondMoment(), 9000, 1e-3);
+
+    // Merging the delta back gives the later snapshot
+    s.Merge(delta);
+    EXPECT_EQ(s.Count(), t.Snapshot().Count());
+    EXPECT_NEAR(s.SecondMoment(), t.Snapshot().SecondMoment(),
+                1e-9 * t.Snapshot().SecondMoment());
+}
+
+TEST(TimeyReporterTest, ConsistentWhileRunning) {
+    ManualSnapshotTimer t("t");
+    std::atomic<bool> done(false);
+    std::thread writer([&t, &done]() {
+        for (int i = 0; i < 200000; i++) {
+            t.Add(10);
+        }
+        done = true;
+    });
+    while (!done) {
+        timey::TimerSnapshot s = t.Snapshot();
+        ASSERT_EQ(s.Elapsed().count(), 10 * (int64_t)s.Count());
+        ASSERT_EQ(s.StdDev().count(), 0);
+    }
+    writer.join();
+    EXPECT_EQ(t.Snapshot().Count(), (uint64_t)200000);
+}
+
+TEST(TimeyReporterTest, TimerSetSnapshot) {
+    timey::SnapshotTimerSet ts;
+    timey::TimerHandle b = ts.Add("b");
+    ts.Add("a");
+    ts.Get(b).Add(100);
+    std::vector<timey::TimerSnapshot> snapshots = ts.Snapshot();
+    ASSERT_EQ(snapshots.size(), (size_t)2);
+    EXPECT_EQ(snapshots[0].Name(), "a");
+    EXPECT_EQ(snapshots[0].Count(), (uint64_t)0);
+    EXPECT_EQ(snapshots[1].Name(), "b");
+    EXPECT_EQ(snapshots[1].Count(), (uint64_t)1);
+}
+
+TEST(TimeyReporterTest, Reporter) {
+    timey::SnapshotTimerSet ts;
+    timey::TimerHandle h = ts.Add("request");
+    ts.Get(h).Add(100);
+
+    std::atomic<uint64_t> reported(0);
+    std::atomic<int> calls(0);
+    {
+        timey::Reporter reporter(
+            ts,
+            [&reported, &calls](
+                const std::vector<timey::TimerSnapshot>& deltas,
+                timey::NanosecondsType) {
+                ASSERT_EQ(deltas.size(), (size_t)1);
+                reported += deltas[0].Count();
+                calls++;
+            },
+            timey::Millisecond);
+        for (int i = 0; i < 20000; i++) {
+            ts.Start(h);
+            ts.Stop(h);
+        }
+        while (calls == 0) {
+            std::this_thread::yield();
+        }
+    }
+    // Samples before the reporter started are not reported
+    EXPECT_EQ(reported, (uint64_t)20000);
+    EXPECT_GE(calls, 2);
+}
+
+TEST(TimeyReporterTest, WriteToStream) {
+    timey::SnapshotTimerSet ts;
+    ts.Add("request");
+    std::stringstream out;
+    {
+        timey::Reporter reporter(ts, out, timey::Hour);
+        ts.Start("request");
+        ts.Stop("request");
+    }
+    std::string report = out.str();
+    EXPECT_EQ(report.find("Interval "), (size_t)0);
+    EXPECT_NE(report.find(timey::internal::ReportHeader()), std::string::npos);
+    EXPECT_NE(report.find("request        1  "), std::string::npos);
+}
@@ -0,0 +1,99 @@
+#include <cstdint>
+#include "gtest/gtest.h"
+
+#include "timey.hpp"
+
+TEST(TimeySampleBufferTest, Disabled) {
+    timey::SampleBuffer b;
+    b.Add(1);
+    EXPECT_EQ(b.Capacity(), (size_t)0);
+    EXPECT_EQ(b.Size(), (size_t)0);
+    EXPECT_EQ(b.Dropped(), (size_t)1);
+}
+
+TEST(TimeySampleBufferTest, Ring) {
+    timey::SampleBuffer b;
+    b.Reserve(3, timey::SampleMode::Ring);
+    EXPECT_EQ(b.Capacity(), (size_t)3);
+    b.Add(1);
+    b.Add(2);
+    EXPECT_EQ(b.Size(), (size_t)2);
+    EXPECT_EQ(b.Ticks(0), 1);
+    EXPECT_EQ(b.Ticks(1), 2);
+
+    for (int64_t i = 3; i <= 7; i++) {
+        b.Add(i);
+    }
+    EXPECT_EQ(b.Size(), (size_t)3);
+    EXPECT_EQ(b.Dropped(), (size_t)4);
+    EXPECT_EQ(b.Ticks(0), 5);
+    EXPECT_EQ(b.Ticks(1), 6);
+    EXPECT_EQ(b.Ticks(2), 7);
+
+    b.Clear();
+    EXPECT_EQ(b.Size(), (size_t)0);
+    EXPECT_EQ(b.Capacity(), (size_t)3);
+}
+
+TEST(TimeySampleBufferTest, Fixed) {
+    timey::SampleBuffer b;
+    b.Reserve(3, timey::SampleMode::Fixed);
+    for (int64_t i = 1; i <= 7; i++) {
+        b.Add(i);
+    }
+    EXPECT_EQ(b.Size(), (size_t)3);
+    EXPECT_EQ(b.Dropped(), (size_t)4);
+    EXPECT_EQ(b.Ticks(0), 1);
+    EXPECT_EQ(b.Ticks(1), 2);
+    EXPECT_EQ(b.Ticks(2), 3);
+}
+
+// ManualClock is a clock policy whose time is set by the test.
+struct ManualClock {
+    static int64_t now;
+    static int64_t Now() { return now; }
+    static timey::NanosecondsType ToNanoseconds(int64_t ticks) {
+        return ticks * timey::Nanosecond;
+    }
+    static double NanosecondsPerTick() { return 1; }
+};
+int64_t ManualClock::now = 0;
+
+TEST(TimeySampleBufferTest, Timer) {
+    timey::BasicTimer<ManualClock> t;
+    t.ReserveSamples(4);
+    for (int64_t i = 1; i <= 6; i++) {
+        t.Start();
+        ManualClock::now += i * 10;
+        t.Stop();
+    }
+
+    timey::SampleView<ManualClock> samples = t.Samples();
+    EXPECT_EQ(samples.Size(), (size_t)4);
+    EXPECT_EQ(samples.Dropped(), (size_t)2);
+    EXPECT_EQ(samples[0], 30 * timey::Nanosecond);
+    EXPECT_EQ(samples[3], 60 * timey::Nanosecond);
+    EXPECT_EQ(samples.Ticks(1), 40);
+
+    timey::BasicTimer<ManualClock> copy(t);
+    EXPECT_EQ(copy.Samples().Size(), (size_t)4);
+    EXPECT_EQ(copy.Samples()[0], 30 * timey::Nanosecond);
+
+    t.Reset();
+    EXPECT_EQ(t.Samples().Size(), (size_t)0);
+    EXPECT_EQ(copy.Samples().Size(), (size_t)4);
+
+    t.ReserveSamples(2, timey::SampleMode::Fixed);
+    for (int64_t i = 1; i <= 3; i++) {
+        t.Start();
+        ManualClock::now += i;
+        t.Stop();
+    }
+    EXPECT_EQ(t.Samples().Size(), (size_t)2);
+    EXPECT_EQ(t.Samples()[1], 2 * timey::Nanosecond);
+
+    t.ReserveSamples(0);
+    t.Start();
+    t.Stop();
+    EXPECT_EQ(t.Samples().Size(), (size_t)0);
+}
@@ -0,0 +1,118 @@
+#include <csignal>
+#include <cstdio>
+#include <fstream>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <stdexcept>
+#include <string>
+#include "gtest/gtest.h"
+
+#include "timey.hpp"
+
+TEST(TimeySampleLogTest, WriteRead) {
+    const std::string path = "timey_samplelog_test.log";
+    {
+        timey::SampleLog log(path, {"assemble", "solve"}, 4);
+        EXPECT_EQ(log.Handle("solve"), (uint32_t)1);
+        EXPECT_THROW(log.Handle("missing"), std::runtime_error);
+        // Grows the initial mapping of 4 records twice
+        for (int64_t i = 0; i < 10; i++) {
+            log.Add((uint32_t)(i % 2), 100 * i, 100 * i + i);
+        }
+        EXPECT_EQ(log.Size(), (size_t)10);
+        log.Close();
+        EXPECT_THROW(log.Add(0, 0, 1), std::runtime_error);
+    }
+
+    timey::SampleLogReader log(path);
+    ASSERT_EQ(log.Names().size(), (size_t)2);
+    EXPECT_EQ(log.Names()[0], "assemble");
+    EXPECT_EQ(log.Names()[1], "solve");
+    EXPECT_EQ(log.NanosecondsPerTick(),
+              timey::HighResolutionClock::NanosecondsPerTick());
+    ASSERT_EQ(log.Size(), (size_t)10);
+    for (size_t i = 0; i < log.Size(); i++) {
+        EXPECT_EQ(log[i].timer, (uint32_t)(i % 2));
+        EXPECT_EQ(log[i].start, 100 * (int64_t)i);
+        EXPECT_EQ(log[i].elapsed, (int64_t)i);
+    }
+    size_t n = 0;
+    for (const timey::SampleRecord& r : log) {
+        n += (size_t)r.elapsed;
+    }
+    EXPECT_EQ(n, (size_t)45);
+    std::remove(path.c_str());
+}
+
+TEST(TimeySampleLogTest, FailedGrow) {
+    const std::string path = "timey_samplelog_grow_test.log";
+    {
+        timey::SampleLog log(path, {"solve"}, 4);
+        for (int64_t i = 0; i < 4; i++) {
+            log.Add(0, i, i + 1);
+        }
+        // Limit the file to the initial mapping, so that growing fails
+        struct stat st;
+        ASSERT_EQ(stat(path.c_str(), &st), 0);
+        struct rlimit old_limit;
+        ASSERT_EQ(getrlimit(RLIMIT_FSIZE, &old_limit), 0);
+        struct rlimit limit = old_limit;
+        limit.rlim_cur = (rlim_t)st.st_size;
+        void (*old_handler)(int) = std::signal(SIGXFSZ, SIG_IGN);
+        ASSERT_EQ(setrlimit(RLIMIT_FSIZE, &limit), 0);
+        EXPECT_THROW(log.Add(0, 4, 5), std::runtime_error);
+        EXPECT_THROW(log.Add(0, 4, 5), std::runtime_error);
+        setrlimit(RLIMIT_FSIZE, &old_limit);
+        std::signal(SIGXFSZ, old_handler);
+
+        // A mapping the size of the log's, likely placed where an unmapped
+        // log mapping was, must survive the log growing
+        size_t length = (size_t)st.st_size;
+        char* other = static_cast<char*>(mmap(nullptr, length,
+                                              PROT_READ | PROT_WRITE,
+                                              MAP_PRIVATE | MAP_ANONYMOUS,
+                                              -1, 0));
+        ASSERT_NE(other, MAP_FAILED);
+
+        // The log kept its records and grows once the limit is lifted
+        EXPECT_EQ(log.Size(), (size_t)4);
+        log.Add(0, 4, 5);
+        EXPECT_EQ(log.Size(), (size_t)5);
+        other[0] = 1;
+        EXPECT_EQ(other[0], 1);
+        munmap(other, length);
+    }
+
+    timey::SampleLogReader log(path);
+    ASSERT_EQ(log.Size(), (size_t)5);
+    for (size_t i = 0; i < log.Size(); i++) {
+        EXPECT_EQ(log[i].start, (int64_t)i);
+        EXPECT_EQ(log[i].elapsed, 1);
+    }
+    std::remove(path.c_str());
+}
+
+TEST(TimeySampleLogTest, Empty) {
+    const std::string path = "timey_samplelog_empty_test.log";
+    { timey::SampleLog log(path, {}); }
+    timey::SampleLogReader log(path);
+    EXPECT_EQ(log.Names().size(), (size_t)0);
+    EXPECT_EQ(log.Size(), (size_t)0);
+    EXPECT_EQ(log.begin(), log.end());
+    std::remove(path.c_str());
+}
+
+TEST(TimeySampleLogTest, Invalid) {
+    const std::string path = "timey_samplelog_invalid_test.log";
+    EXPECT_THROW(timey::SampleLogReader("timey_missing.log"),
+                 std::runtime_error);
+    {
+        std::ofstream out(path);
+        out << "not a sample log, but long enough to hold a header";
+    }
+    EXPECT_THROW(timey::SampleLogReader reader(path), std::runtime_error);
+    std::remove(path.c_str());
+    EXPECT_THROW(timey::SampleLog("/nonexistent/dir/x.log", {"a"}),
+                 std::runtime_error);
+}
@@ -0,0 +1,93 @@
+#include <sstream>
+#include <type_traits>
+#include "gtest/gtest.h"
+
+#include "timey.hpp"
+
+static_assert(std::is_nothrow_constructible<timey::ScopedTimer,
+                                            timey::Timer&>::value,
+              "ScopedTimer must not throw");
+static_assert(std::is_nothrow_constructible<timey::ScopedTimer,
+                                            timey::TimerSet&,
+                                            timey::TimerHandle>::value,
+              "ScopedTimer must not throw");
+
+TEST(TimeyScopedTimerTest, Timer) {
+    timey::Timer t("t");
+    {
+        timey::ScopedTimer scope(t);
+        EXPECT_EQ(t.Running(), true);
+    }
+    EXPECT_EQ(t.Running(), false);
+    EXPECT_EQ(t.Count(), (size_t)1);
+}
+
+TEST(TimeyScopedTimerTest, TimerSet) {
+    timey::TimerSet ts;
+    timey::TimerHandle h = ts.Add("t");
+    for (int i = 0; i < 3; i++) {
+        timey::ScopedTimer scope(ts, h);
+        EXPECT_EQ(ts.Running(), true);
+    }
+    EXPECT_EQ(ts.Running(), false);
+    EXPECT_EQ(ts.Get("t").Count(), (size_t)3);
+}
+
+TEST(TimeyScopedTimerTest, StaleHandle) {
+    timey::TimerSet ts;
+    timey::TimerHandle h = ts.Add("t");
+    ts.Delete("t");
+    EXPECT_EQ(ts.Find(h), nullptr);
+#ifdef NDEBUG
+    {
+        // The scope is not timed
+        timey::ScopedTimer scope(ts, h);
+        EXPECT_EQ(ts.Running(), false);
+    }
+#else
+    EXPECT_DEATH({ timey::ScopedTimer scope(ts, h); }, "stale TimerHandle");
+#endif
+}
+
+TEST(TimeyScopedTimerTest, Nested) {
+    timey::Timer t("t");
+    {
+        timey::ScopedTimer outer(t);
+        {
+            // Does not throw on the running timer
+            timey::ScopedTimer inner(t);
+        }
+        EXPECT_EQ(t.Running(), true);
+    }
+    EXPECT_EQ(t.Count(), (size_t)1);
+}
+
+TEST(TimeyScopedTimerTest, Exception) {
+    timey::Timer t("t");
+    try {
+        timey::ScopedTimer scope(t);
+        throw std::runtime_error("error");
+    } catch (const std::runtime_error&) {
+    }
+    EXPECT_EQ(t.Running(), false);
+    EXPECT_EQ(t.Count(), (size_t)1);
+}
+
+// Recurse times each level of the recursion with the same TIMEY_SCOPE.
+int Recurse(int depth) {
+    TIMEY_SCOPE("recurse");
+    return depth == 0 ? 0 : 1 + Recurse(depth - 1);
+}
+
+TEST(TimeyScopedTimerTest, Scope) {
+    for (int i = 0; i < 4; i++) {
+        TIMEY_SCOPE("loop");
+        EXPECT_EQ(timey::GlobalTimerSet().Get("loop").Running(), true);
+    }
+    EXPECT_EQ(timey::GlobalTimerSet().Get("loop").Count(), (size_t)4);
+
+    EXPECT_EQ(Recurse(5), 5);
+    EXPECT_EQ(Recurse(2), 2);
+    EXPECT_EQ(timey::GlobalTimerSet().Get("recurse").Count(), (size_t)2);
+    EXPECT_EQ(timey::GlobalTimerSet().Running(), false);
+}
@@ -0,0 +1,308 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include "gtest/gtest.h"
+
+#include "timey.hpp"
+
+// StepClock is a clock policy advancing by 100 ticks every time it is read.
+struct StepClock {
+    static int64_t now;
+    static int64_t Now() { return now += 100; }
+    static timey::NanosecondsType ToNanoseconds(int64_t ticks) {
+        return ticks * timey::Nanosecond;
+    }
+    static double NanosecondsPerTick() { return 1; }
+};
+int64_t StepClock::now = 0;
+
+typedef timey::BasicSharedTimerSet<StepClock> StepSharedTimerSet;
+
+// ManualClock is a clock policy whose time is set by the test.
+struct ManualClock {
+    static int64_t now;
+    static int64_t Now() { return now; }
+    static timey::NanosecondsType ToNanoseconds(int64_t ticks) {
+        return ticks * timey::Nanosecond;
+    }
+    static double NanosecondsPerTick() { return 1; }
+};
+int64_t ManualClock::now = 0;
+
+// SharedName returns a shared memory name unique to the test process.
+std::string SharedName(const std::string& test) {
+    return "timey_test_" + test + "_" + std::to_string(getpid());
+}
+
+TEST(TimeySharedTimerSetTest, Basics) {
+    std::string name = SharedName("basics");
+    StepSharedTimerSet ts(name, 4, 2);
+    EXPECT_EQ(ts.Capacity(), (size_t)4);
+    EXPECT_EQ(ts.Workers(), (size_t)2);
+    EXPECT_EQ(ts.Worker(), (size_t)0);
+    EXPECT_EQ(ts.Count(), (size_t)0);
+
+    timey::TimerHandle h = ts.Add("a");
+    ts.Add("b");
+    EXPECT_EQ(ts.Count(), (size_t)2);
+    EXPECT_EQ(ts.Handle("a"), h);
+    EXPECT_THROW(ts.Add("a"), std::runtime_error);
+    EXPECT_THROW(ts.Add(std::string(64, 'x')), std::runtime_error);
+    EXPECT_THROW(ts.Handle("c"), std::runtime_error);
+    // Default and unknown handles do not write out of the row
+    EXPECT_THROW(ts.Start(timey::TimerHandle()), std::runtime_error);
+    EXPECT_THROW(ts.Stop(timey::TimerHandle()), std::runtime_error);
+    StepSharedTimerSet other(SharedName("other"), 8, 1);
+    other.Add("a");
+    other.Add("b");
+    timey::TimerHandle foreign = other.Add("c");
+    EXPECT_THROW(ts.Start(foreign), std::runtime_error);
+    StepSharedTimerSet::Remove(SharedName("other"));
+
+    ts.Start(h);
+    EXPECT_THROW(ts.Start(h), std::runtime_error);
+    ts.Stop(h);
+    EXPECT_THROW(ts.Stop(h), std::runtime_error);
+    ts.Worker(1);
+    ts.Start("a");
+    ts.Stop("a");
+    EXPECT_THROW(ts.Worker(2), std::runtime_error);
+
+    timey::BasicTimer<StepClock> t = ts.Get("a");
+    EXPECT_EQ(t.Name(), "a");
+    EXPECT_EQ(t.Count(), (size_t)2);
+    EXPECT_EQ(t.Elapsed().count(), 200);
+    EXPECT_EQ(ts.Get(h, 0).Count(), (size_t)1);
+    EXPECT_EQ(ts.Get(h, 1).Count(), (size_t)1);
+    EXPECT_EQ(ts.Get("b").Count(), (size_t)0);
+
+    ts.Add("c");
+    ts.Add("d");
+    EXPECT_THROW(ts.Add("e"), std::runtime_error);
+
+    // Attaching again with a different layout fails
+    EXPECT_THROW(StepSharedTimerSet(name, 8, 2), std::runtime_error);
+    StepSharedTimerSet::Remove(name);
+    EXPECT_THROW(StepSharedTimerSet::Remove(name), std::runtime_error);
+}
+
+TEST(TimeySharedTimerSetTest, LargeMean) {
+    std::string name = SharedName("largemean");
+    timey::BasicSharedTimerSet<ManualClock> ts(name, 4, 2);
+    timey::TimerHandle h = ts.Add("a");
+
+    // Durations of 1s +- 10ns on two workers, whose sum of squares does not
+    // fit the precision of a double
+    for (size_t worker = 0; worker < 2; worker++) {
+        ts.Worker(worker);
+        for (int64_t i = 0; i < 100000; i++) {
+            ts.Start(h);
+            ManualClock::now += 1000000000 + (i % 2 == 0 ? 10 : -10);
+            ts.Stop(h);
+        }
+    }
+
+    timey::BasicSharedTimerSet<ManualClock> monitor(
+        name, timey::SharedAccess::ReadOnly);
+    timey::BasicTimer<ManualClock> t = monitor.Get(h);
+    EXPECT_EQ(t.Count(), (size_t)200000);
+    EXPECT_EQ(t.ElapsedMean().count(), 1000000000);
+    EXPECT_NEAR(t.ElapsedStdDev().count(), 10, 1);
+    EXPECT_NEAR(monitor.Get(h, 1).ElapsedStdDev().count(), 10, 1);
+    timey::BasicSharedTimerSet<ManualClock>::Remove(name);
+}
+
+TEST(TimeySharedTimerSetTest, Processes) {
+    std::string name = SharedName("processes");
+    StepSharedTimerSet ts(name, 16, 4);
+    timey::TimerHandle h = ts.Add("work");
+
+    // Every worker claims its row before any exits, as the row of a dead
+    // worker is claimed again
+    int claimed[2];
+    int done[2];
+    ASSERT_EQ(pipe(claimed), 0);
+    ASSERT_EQ(pipe(done), 0);
+    const int n_workers = 3;
+    for (int i = 0; i < n_workers; i++) {
+        pid_t pid = fork();
+        ASSERT_GE(pid, 0);
+        if (pid == 0) {
+            // Workers record into their own row and die with their timers
+            // in shared memory
+            close(done[1]);
+            size_t worker = ts.ClaimWorker();
+            for (size_t j = 0; j < 10 * worker; j++) {
+                ts.Start(h);
+                ts.Stop(h);
+            }
+            char c = 0;
+            bool ok = write(claimed[1], &c, 1) == 1 &&
+                      read(done[0], &c, 1) == 0;
+            _exit(ok ? 0 : 1);
+        }
+    }
+    close(done[0]);
+    for (int i = 0; i < n_workers; i++) {
+        char c;
+        ASSERT_EQ(read(claimed[0], &c, 1), 1);
+    }
+    close(done[1]);
+    close(claimed[0]);
+    close(claimed[1]);
+    for (int i = 0; i < n_workers; i++) {
+        int status;
+        wait(&status);
+        EXPECT_EQ(WEXITSTATUS(status), 0);
+    }
+
+    // A monitor attaches read only to the timers of the dead workers
+    StepSharedTimerSet monitor(name, timey::SharedAccess::ReadOnly);
+    EXPECT_EQ(monitor.Count(), (size_t)1);
+    timey::BasicTimer<StepClock> t = monitor.Get("work");
+    EXPECT_EQ(t.Count(), (size_t)60);
+    EXPECT_EQ(t.Elapsed().count(), 6000);
+    EXPECT_EQ(t.ElapsedMean().count(), 100);
+    EXPECT_EQ(monitor.Get(h, 3).Count(), (size_t)30);
+    EXPECT_THROW(monitor.Add("x"), std::runtime_error);
+    EXPECT_THROW(monitor.Start(h), std::runtime_error);
+    EXPECT_THROW(monitor.ClaimWorker(), std::runtime_error);
+
+    std::stringstream expected;
+    expected << std::left << timey::internal::ReportHeader() << std::endl;
+    expected << std::string(80, '-') << std::endl;
+    expected << t.Report() << std::endl;
+    expected << std::string(80, '-') << std::endl;
+    std::stringstream out;
+    out << monitor;
+    EXPECT_EQ(out.str(), expected.str());
+
+    StepSharedTimerSet::Remove(name);
+    EXPECT_THROW(StepSharedTimerSet(name, timey::SharedAccess::ReadOnly),
+                 std::runtime_error);
+}
+
+TEST(TimeySharedTimerSetTest, ReclaimWorker) {
+    std::string name = SharedName("reclaim");
+    StepSharedTimerSet ts(name, 4, 3);
+    timey::TimerHandle h = ts.Add("work");
+
+    // A worker crashes with its timer running
+    pid_t pid = fork();
+    ASSERT_GE(pid, 0);
+    if (pid == 0) {
+        size_t worker = ts.ClaimWorker();
+        ts.Start(h);
+        ts.Stop(h);
+        ts.Start(h);
+        _exit((int)worker);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    ASSERT_EQ(WEXITSTATUS(status), 1);
+
+    // Its worker is claimed again, with the timer stopped and the samples
+    // of the dead process kept
+    EXPECT_EQ(ts.ClaimWorker(), (size_t)1);
+    ts.Start(h);
+    ts.Stop(h);
+    EXPECT_EQ(ts.Get(h, 1).Count(), (size_t)2);
+
+    // Workers owned by a live process are not claimed again, and claiming
+    // again releases the worker claimed before
+    StepSharedTimerSet other(name);
+    EXPECT_EQ(other.ClaimWorker(), (size_t)2);
+    EXPECT_EQ(ts.ClaimWorker(), (size_t)1);
+    StepSharedTimerSet third(name);
+    EXPECT_THROW(third.ClaimWorker(), std::runtime_error);
+
+    // A released worker can be claimed
+    other.ReleaseWorker();
+    EXPECT_EQ(other.Worker(), (size_t)0);
+    EXPECT_EQ(third.ClaimWorker(), (size_t)2);
+    EXPECT_THROW(other.ClaimWorker(), std::runtime_error);
+
+    StepSharedTimerSet::Remove(name);
+}
+
+TEST(TimeySharedTimerSetTest, StealLock) {
+    std::string name = SharedName("lock");
+    StepSharedTimerSet ts(name, 4, 2);
+    ts.Add("a");
+
+    // A process dies holding the lock of the name table
+    pid_t pid = fork();
+    ASSERT_GE(pid, 0);
+    if (pid == 0) {
+        _exit(0);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    std::string shm_name = timey::internal::SharedName(name);
+    int fd = shm_open(shm_name.c_str(), O_RDWR, 0);
+    ASSERT_GE(fd, 0);
+    void* p = mmap(nullptr, sizeof(timey::internal::SharedHeader),
+                   PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    ASSERT_NE(p, MAP_FAILED);
+    static_cast<timey::internal::SharedHeader*>(p)->lock.store(pid);
+
+    // Adding takes the lock from the dead process
+    timey::TimerHandle h = ts.Add("b");
+    EXPECT_EQ(ts.Count(), (size_t)2);
+    EXPECT_EQ(ts.Handle("b"), h);
+    EXPECT_EQ(static_cast<timey::internal::SharedHeader*>(p)->lock.load(), 0);
+    munmap(p, sizeof(timey::internal::SharedHeader));
+
+    StepSharedTimerSet::Remove(name);
+}
+
+TEST(TimeySharedTimerSetTest, AttachWhileCreating) {
+    std::string name = SharedName("creating");
+    const size_t capacity = 4;
+    const size_t workers = 2;
+
+    // Another process has created the shared memory and not yet sized it
+    std::string shm_name = timey::internal::SharedName(name);
+    int fd = shm_open(shm_name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+    ASSERT_GE(fd, 0);
+    std::thread creator([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        size_t size = timey::internal::SharedSize(capacity, workers);
+        ASSERT_EQ(ftruncate(fd, (off_t)size), 0);
+        void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                       fd, 0);
+        ASSERT_NE(p, MAP_FAILED);
+        timey::internal::SharedHeader* header =
+            static_cast<timey::internal::SharedHeader*>(p);
+        std::memcpy(header->magic, timey::internal::SharedTimerSetMagic, 8);
+        header->version = timey::internal::SharedTimerSetVersion;
+        header->capacity = capacity;
+        header->workers = workers;
+        header->nsPerTick = 1;
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        header->ready.store(1, std::memory_order_release);
+        munmap(p, size);
+        close(fd);
+    });
+
+    // Attaching waits for the header instead of failing
+    StepSharedTimerSet ts(name, capacity, workers);
+    EXPECT_EQ(ts.Capacity(), capacity);
+    EXPECT_EQ(ts.Workers(), workers);
+    ts.Add("a");
+    StepSharedTimerSet monitor(name, timey::SharedAccess::ReadOnly);
+    EXPECT_EQ(monitor.Count(), (size_t)1);
+    creator.join();
+
+    StepSharedTimerSet::Remove(name);
+}
@@ -0,0 +1,172 @@
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "gtest/gtest.h"
+
+#include "timey.hpp"
+
+// NanosecondClock is a clock policy counting in nanoseconds, for timers whose
+// durations are added by the test.
+struct NanosecondClock {
+    static int64_t Now() { return 0; }
+    static timey::NanosecondsType ToNanoseconds(int64_t ticks) {
+        return ticks * timey::Nanosecond;
+    }
+    static double NanosecondsPerTick() { return 1; }
+};
+
+typedef timey::BasicTimer<NanosecondClock> NodeTimer;
+typedef timey::BasicTimerSet<NodeTimer> NodeTimerSet;
+
+TEST(TimeySnapshotFileTest, RoundTrip) {
+    NodeTimerSet ts;
+    ts.Add("solve");
+    ts.Add("odd name\\with\nbreak");
+    for (int64_t x = 1; x <= 1000; x++) {
+        ts.Get("solve").Add(x * 1000003);
+    }
+    ts.Get("odd name\\with\nbreak").Add(7);
+
+    std::stringstream file;
+    timey::WriteSnapshotFile(file, ts);
+    EXPECT_EQ(file.str().compare(0, 17, "timey-snapshot 2\n"), 0);
+    std::vector<timey::TimerSnapshot> read = timey::ReadSnapshotFile(file);
+    ASSERT_EQ(read.size(), (size_t)2);
+
+    // Snapshots are read back exactly
+    NodeTimer solve = ts.Get("solve");
+    timey::TimerSnapshot s = read[1];
+    EXPECT_EQ(s.Name(), "solve");
+    EXPECT_EQ(s.Count(), solve.Count());
+    EXPECT_EQ(s.Elapsed(), solve.Elapsed());
+    EXPECT_EQ(s.SecondMoment(), solve.Summary().SecondMoment());
+    EXPECT_EQ(s.StdDev(), solve.ElapsedStdDev());
+    EXPECT_EQ(read[0].Name(), "odd name\\with\nbreak");
+    EXPECT_EQ(read[0].Elapsed().count(), 7);
+
+    // Writing the snapshots again gives the same file
+    std::stringstream again;
+    timey::WriteSnapshotFile(again, read);
+    EXPECT_EQ(again.str(), file.str());
+
+    std::stringstream bad("timey-snapshot 2\n3 x 0x0p+0 a\n");
+    EXPECT_THROW(timey::ReadSnapshotFile(bad), std::runtime_error);
+    std::stringstream duplicate(
+        "timey-snapshot 2\n1 2 0x1p+2 a\n1 2 0x1p+2 a\n");
+    EXPECT_THROW(timey::ReadSnapshotFile(duplicate), std::runtime_error);
+    std::stringstream other("Timer Count\n");
+    EXPECT_THROW(timey::ReadSnapshotFile(other), std::runtime_error);
+}
+
+TEST(TimeySnapshotFileTest, Version1) {
+    // Version 1 files hold the sum of squares, 10^2 + 20^2
+    std::stringstream file("timey-snapshot 1\n2 30 0x1.f4p+8 t\n");
+    std::vector<timey::TimerSnapshot> read = timey::ReadSnapshotFile(file);
+    ASSERT_EQ(read.size(), (size_t)1);
+    EXPECT_EQ(read[0].Elapsed().count(), 30);
+    EXPECT_EQ(read[0].SecondMoment(), 50);
+    EXPECT_EQ(read[0].StdDev().count(), 5);
+}
+
+TEST(TimeySnapshotFileTest, File) {
+    std::string path = "timey_snapshot_" + std::to_string(getpid());
+    NodeTimer t("t");
+    t.Add(10);
+    t.Add(20);
+    timey::WriteSnapshotFile(path, t);
+    std::vector<timey::TimerSnapshot> read = timey::ReadSnapshotFile(path);
+    ASSERT_EQ(read.size(), (size_t)1);
+    EXPECT_EQ(read[0].Count(), (uint64_t)2);
+    EXPECT_EQ(read[0].SecondMoment(), 50);
+    std::remove(path.c_str());
+    EXPECT_THROW(timey::ReadSnapshotFile(path), std::runtime_error);
+}
+
+TEST(TimeySnapshotFileTest, MergeLongRunningNodes) {
+    // 128 nodes timing a second with a spread of a few nanoseconds, whose
+    // sum of squares is far beyond the precision of a double
+    const size_t n_nodes = 128;
+    std::vector<timey::ClusterTimerSet> nodes(n_nodes);
+    NodeTimer all("work");
+    for (size_t i = 0; i < n_nodes; i++) {
+        NodeTimer t("work");
+        for (int64_t j = 0; j < 1000; j++) {
+            t.Add(1000000000 + (int64_t)i % 3 + (j % 2 == 0 ? -4 : 4));
+        }
+        all.Merge(t);
+        std::stringstream file;
+        timey::WriteSnapshotFile(file, t);
+        nodes[i].Add(timey::ReadSnapshotFile(file));
+    }
+
+    timey::ClusterTimerSet cluster =
+        timey::Reduce(nodes.begin(), nodes.end(), 4);
+    const timey::TimerSnapshot& work = cluster.Get("work").Timer();
+    EXPECT_EQ(work.Count(), all.Count());
+    EXPECT_EQ(work.Elapsed(), all.Elapsed());
+    EXPECT_NEAR(work.SecondMoment(), all.Summary().SecondMoment(),
+                1e-9 * all.Summary().SecondMoment());
+    EXPECT_EQ(work.StdDev(), all.ElapsedStdDev());
+    EXPECT_EQ(work.StdDev().count(), 4);
+}
+
+TEST(TimeySnapshotFileTest, ClusterTimerSet) {
+    // Node i runs "work" for i + 1 samples of 100ns, and node 0 also runs
+    // "setup"
+    const size_t n_nodes = 300;
+    std::vector<timey::ClusterTimerSet> nodes(n_nodes);
+    NodeTimer all("work");
+    for (size_t i = 0; i < n_nodes; i++) {
+        NodeTimerSet ts;
+        ts.Add("work");
+        for (size_t j = 0; j <= i; j++) {
+            ts.Get("work").Add(100 + (int64_t)j);
+        }
+        if (i == 0) {
+            ts.Add("setup");
+            ts.Get("setup").Add(5);
+        }
+        all.Merge(ts.Get("work"));
+        std::stringstream file;
+        timey::WriteSnapshotFile(file, ts);
+        nodes[i].Add(timey::ReadSnapshotFile(file));
+    }
+
+    timey::ClusterTimerSet cluster =
+        timey::Reduce(nodes.begin(), nodes.end(), 4);
+    EXPECT_EQ(cluster.Nodes(), n_nodes);
+    EXPECT_EQ(cluster.Count(), (size_t)2);
+    const timey::ClusterTimer& work = cluster.Get("work");
+    EXPECT_EQ(work.Name(), "work");
+    EXPECT_EQ(work.Count(), all.Count());
+    EXPECT_EQ(work.Timer().Elapsed(), all.Elapsed());
+    EXPECT_EQ(work.Timer().Mean(), all.ElapsedMean());
+    EXPECT_EQ(work.Timer().StdDev(), all.ElapsedStdDev());
+    EXPECT_EQ(work.Nodes(), n_nodes);
+    EXPECT_EQ(work.MinNodeTotal().count(), 100);
+    EXPECT_EQ(work.MaxNodeTotal().count(), 300 * 100 + 299 * 300 / 2);
+    EXPECT_NEAR(work.Skew(),
+                work.MaxNodeTotal().count() * (double)n_nodes /
+                    all.Elapsed().count(),
+                1e-12);
+    EXPECT_EQ(cluster.Get("setup").Nodes(), (size_t)1);
+    EXPECT_DOUBLE_EQ(cluster.Get("setup").Skew(), 1);
+    EXPECT_THROW(cluster.Get("x"), std::runtime_error);
+
+    std::stringstream out;
+    out << cluster;
+    std::string report = out.str();
+    EXPECT_NE(report.find("Nodes"), std::string::npos);
+    EXPECT_NE(report.find("\nsetup"), std::string::npos);
+    EXPECT_NE(report.find(" 1\n"), std::string::npos);
+
+    std::stringstream json;
+    timey::WriteJsonLines(json, cluster);
+    EXPECT_NE(json.str().find("\"nodes\":300,\"node_min_total_ns\":100"),
+              std::string::npos);
+}
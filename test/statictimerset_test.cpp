@@ -0,0 +1,87 @@
+#include <sstream>
+#include <thread>
+#include "gtest/gtest.h"
+
+#include "timey.hpp"
+
+TIMEY_TIMER_TAG(Assemble, "assemble");
+TIMEY_TIMER_TAG(Solve, "solve");
+TIMEY_TIMER_TAG(Factorize, "factorize");
+TIMEY_TIMER_TAG(SolveAgain, "solve");
+
+TEST(TimeyStaticTimerSetTest, TimerId) {
+    static_assert(timey::TimerId("solve") == Solve::Id(), "");
+    static_assert(timey::TimerId("solve") != Assemble::Id(), "");
+    // FNV-1a reference values
+    EXPECT_EQ(timey::TimerId(""), 14695981039346656037ULL);
+    EXPECT_EQ(timey::TimerId("a"), 12638187200555641996ULL);
+}
+
+TEST(TimeyStaticTimerSetTest, DuplicateNames) {
+    static_assert(timey::internal::UniqueIds<Assemble, Solve>::value, "");
+    static_assert(!timey::internal::UniqueIds<Solve, Assemble, Solve>::value,
+                  "");
+    static_assert(!timey::internal::UniqueIds<Solve, SolveAgain>::value, "");
+}
+
+TEST(TimeyStaticTimerSetTest, Constructor) {
+    timey::StaticTimerSet<Assemble, Solve, Factorize> ts;
+    static_assert(decltype(ts)::Count() == 3, "");
+    static_assert(decltype(ts)::Index<Factorize::Id()>() == 2, "");
+    static_assert(decltype(ts)::Index<timey::TimerId("assemble")>() == 0, "");
+
+    EXPECT_EQ(ts.Running(), false);
+    EXPECT_EQ(ts.Get<Assemble>().Name(), "assemble");
+    EXPECT_EQ(ts.Get<Solve>().Name(), "solve");
+    EXPECT_EQ(ts.Get<Factorize>().Name(), "factorize");
+}
+
+TEST(TimeyStaticTimerSetTest, StartStopRestartReset) {
+    timey::StaticTimerSet<Assemble, Solve> ts;
+
+    ts.Start<Assemble>();
+    EXPECT_EQ(ts.Running(), true);
+    EXPECT_THROW(ts.Start<Assemble>(), std::runtime_error);
+    std::this_thread::sleep_for(timey::Millisecond);
+    ts.Restart<Assemble>();
+    ts.Stop<timey::TimerId("assemble")>();
+    EXPECT_EQ(ts.Running(), false);
+    EXPECT_THROW(ts.Stop<Assemble>(), std::runtime_error);
+
+    ts.Start<timey::TimerId("solve")>();
+    ts.Stop<Solve>();
+
+    EXPECT_EQ(ts.Get<Assemble>().Count(), (size_t)2);
+    EXPECT_GT(ts.Get<Assemble>().Elapsed(), timey::Millisecond);
+    EXPECT_EQ(&ts.Get<Solve>(), &ts.Get<timey::TimerId("solve")>());
+    EXPECT_EQ(ts.Get<Solve>().Count(), (size_t)1);
+
+    ts.Reset<Assemble>();
+    ts.Reset<timey::TimerId("solve")>();
+    EXPECT_EQ(ts.Get<Assemble>().Count(), (size_t)0);
+    EXPECT_EQ(ts.Get<Solve>().Count(), (size_t)0);
+}
+
+TEST(TimeyStaticTimerSetTest, WriteToStream) {
+    timey::StaticTimerSet<Solve, Assemble> ts;
+    for (int i = 0; i < 3; i++) {
+        ts.Start<Solve>();
+        std::this_thread::sleep_for(timey::Millisecond);
+        ts.Stop<Solve>();
+    }
+    ts.Start<Assemble>();
+    ts.Stop<Assemble>();
+
+    std::ostringstream expected;
+    using std::endl;
+    expected << timey::internal::ReportHeader() << endl;
+    expected << std::string(80, '-') << endl;
+    expected << ts.Get<Solve>().Report() << endl;
+    expected << ts.Get<Assemble>().Report() << endl;
+    expected << std::string(80, '-') << endl;
+
+    std::ostringstream actual;
+    actual << ts;
+
+    EXPECT_EQ(actual.str(), expected.str());
+}
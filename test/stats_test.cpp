@@ -0,0 +1,122 @@
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include "gtest/gtest.h"
+
+#include "timey.hpp"
+
+// ManualClock is a clock policy whose time is set by the test.
+struct ManualClock {
+    static int64_t now;
+    static int64_t Now() { return now; }
+    static timey::NanosecondsType ToNanoseconds(int64_t ticks) {
+        return ticks * timey::Nanosecond;
+    }
+    static double NanosecondsPerTick() { return 1; }
+};
+int64_t ManualClock::now = 0;
+
+typedef timey::BasicTimer<ManualClock, timey::NoMoments, timey::stats::Pack<>>
+    CountTimer;
+typedef timey::BasicTimer<ManualClock, timey::DefaultMoments,
+                          timey::stats::Pack<timey::stats::MinMax>>
+    MinMaxTimer;
+
+// Record adds a start-stop cycle of 'ns' nanoseconds to the timer.
+template <class TimerType>
+void Record(TimerType& t, int64_t ns) {
+    t.Start();
+    ManualClock::now += ns;
+    t.Stop();
+}
+
+TEST(TimeyStatsTest, CountAndTotalOnly) {
+    CountTimer t("t");
+    Record(t, 1000);
+    Record(t, 3000);
+    EXPECT_EQ(t.Count(), (size_t)2);
+    EXPECT_EQ(t.Elapsed().count(), 4000);
+    EXPECT_EQ(t.ElapsedMean().count(), 2000);
+    EXPECT_EQ(t.ElapsedStdDev().count(), 0);
+
+    // No standard deviation column
+    std::string header = timey::internal::ReportHeader();
+    EXPECT_EQ(t.ReportHeader(), header.substr(0, header.size() - 20));
+    std::stringstream expected;
+    expected << std::setw(15) << std::left << "t" << std::setw(15) << 2
+             << std::setw(20) << timey::Humanize(t.Elapsed()) << std::setw(20)
+             << timey::Humanize(t.ElapsedMean());
+    EXPECT_EQ(t.Report(), expected.str());
+
+    EXPECT_LT(sizeof(CountTimer), sizeof(timey::BasicTimer<ManualClock>));
+}
+
+TEST(TimeyStatsTest, MinMax) {
+    MinMaxTimer t("t");
+    EXPECT_EQ(t.Min().count(), 0);
+    EXPECT_EQ(t.Max().count(), 0);
+
+    const int64_t durations[] = {500, 200, 900, 200, 900, 300};
+    for (int64_t d : durations) {
+        Record(t, d);
+    }
+    EXPECT_EQ(t.Min().count(), 200);
+    EXPECT_EQ(t.MinIndex(), (size_t)1);
+    EXPECT_EQ(t.Max().count(), 900);
+    EXPECT_EQ(t.MaxIndex(), (size_t)2);
+
+    EXPECT_EQ(t.ReportHeader(), timey::internal::ReportHeader() + "Min" +
+                                    std::string(12, ' ') + "Max" +
+                                    std::string(12, ' '));
+    std::string report = t.Report();
+    EXPECT_EQ(report.size(), (size_t)(90 + 30));
+    EXPECT_EQ(report.substr(90, 15),
+              timey::Humanize(t.Min()) +
+                  std::string(15 - timey::Humanize(t.Min()).size(), ' '));
+
+    t.Reset();
+    EXPECT_EQ(t.Min().count(), 0);
+    EXPECT_EQ(t.MaxIndex(), (size_t)0);
+}
+
+TEST(TimeyStatsTest, MinMaxMerge) {
+    MinMaxTimer a("a");
+    MinMaxTimer b("b");
+    MinMaxTimer empty;
+    Record(a, 300);
+    Record(a, 400);
+    Record(b, 500);
+    Record(b, 100);
+    Record(b, 600);
+
+    empty.Merge(a);
+    EXPECT_EQ(empty.Min().count(), 300);
+    EXPECT_EQ(empty.MinIndex(), (size_t)0);
+
+    // Indices of 'b' follow the cycles of 'a'
+    a.Merge(b);
+    EXPECT_EQ(a.Min().count(), 100);
+    EXPECT_EQ(a.MinIndex(), (size_t)3);
+    EXPECT_EQ(a.Max().count(), 600);
+    EXPECT_EQ(a.MaxIndex(), (size_t)4);
+
+    a.Merge(MinMaxTimer());
+    EXPECT_EQ(a.MinIndex(), (size_t)3);
+}
+
+TEST(TimeyStatsTest, TimerSetReport) {
+    timey::BasicTimerSet<MinMaxTimer> ts;
+    ts.Add("a");
+    ts.Start("a");
+    ts.Stop("a");
+
+    std::string header = MinMaxTimer().ReportHeader();
+    std::stringstream expected;
+    expected << header << std::endl
+             << std::string(header.size() - 10, '-') << std::endl
+             << ts.Get("a").Report() << std::endl
+             << std::string(header.size() - 10, '-') << std::endl;
+    std::stringstream actual;
+    actual << ts;
+    EXPECT_EQ(actual.str(), expected.str());
+}
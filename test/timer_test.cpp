@@ -7,6 +7,36 @@
 
 #include "timey.hpp"
 
+// ManualClock is a clock policy whose time is set by the test.
+struct ManualClock {
+    static int64_t now;
+    static int64_t Now() { return now; }
+    static timey::NanosecondsType ToNanoseconds(int64_t ticks) {
+        return ticks * timey::Nanosecond;
+    }
+    static double NanosecondsPerTick() { return 1; }
+};
+int64_t ManualClock::now = 0;
+
+// StepClock is a clock policy advancing by 100 ticks on every read, so that
+// its clock overhead is 100 ticks.
+struct StepClock {
+    static int64_t now;
+    static int64_t Now() { return now += 100; }
+    static timey::NanosecondsType ToNanoseconds(int64_t ticks) {
+        return ticks * timey::Nanosecond;
+    }
+    static double NanosecondsPerTick() { return 1; }
+};
+int64_t StepClock::now = 0;
+
+// Record adds a start-stop cycle of 'ns' nanoseconds to the timer.
+void Record(timey::BasicTimer<ManualClock>& t, int64_t ns) {
+    t.Start();
+    ManualClock::now += ns;
+    t.Stop();
+}
+
 TEST(TimeyTimerTest, Constructor) {
     timey::Timer t;
     EXPECT_EQ(t.Running(), false);
@@ -152,3 +182,225 @@ TEST(TimeyTimerTest, WriteToStream) {
              << timey::Humanize(t.ElapsedStdDev());
     EXPECT_EQ(t.Report(), expected.str());
 }
+
+TEST(TimeyTimerTest, Merge) {
+    timey::BasicTimer<ManualClock> all("all");
+    timey::BasicTimer<ManualClock> a("a");
+    timey::BasicTimer<ManualClock> b("b");
+    timey::BasicTimer<ManualClock> empty;
+
+    for (int64_t i = 1; i <= 10; i++) {
+        Record(all, i * 1000);
+        Record(i <= 3 ? a : b, i * 1000);
+    }
+
+    a.Merge(empty);
+    EXPECT_EQ(a.Count(), (size_t)3);
+    empty.Merge(a);
+    EXPECT_EQ(empty.Count(), (size_t)3);
+    EXPECT_EQ(empty.Elapsed(), a.Elapsed());
+    EXPECT_EQ(empty.ElapsedStdDev(), a.ElapsedStdDev());
+
+    a += b;
+    EXPECT_EQ(a.Name(), "a");
+    EXPECT_EQ(a.Count(), all.Count());
+    EXPECT_EQ(a.Elapsed(), all.Elapsed());
+    EXPECT_EQ(a.ElapsedMean(), all.ElapsedMean());
+    // Population std. dev. of 1000, 2000, ..., 10000 is 2872.28
+    EXPECT_NEAR(all.ElapsedStdDev().count(), 2872, 1);
+    EXPECT_NEAR(a.ElapsedStdDev().count(), all.ElapsedStdDev().count(), 1);
+}
+
+TEST(TimeyTimerTest, Add) {
+    timey::BasicTimer<ManualClock> recorded("recorded");
+    timey::BasicTimer<ManualClock> added("added");
+    for (int64_t i = 1; i <= 10; i++) {
+        Record(recorded, i * 1000);
+        added.Add(i * 1000);
+    }
+    EXPECT_EQ(added.Running(), false);
+    EXPECT_EQ(added.Count(), recorded.Count());
+    EXPECT_EQ(added.Elapsed(), recorded.Elapsed());
+    EXPECT_EQ(added.ElapsedMean(), recorded.ElapsedMean());
+    EXPECT_EQ(added.ElapsedStdDev(), recorded.ElapsedStdDev());
+
+    added.Start();
+    added.Add(1000);
+    EXPECT_EQ(added.Running(), true);
+    EXPECT_EQ(added.Count(), (size_t)11);
+}
+
+TEST(TimeyTimerTest, SubtractClockOverhead) {
+    EXPECT_EQ(timey::ClockOverhead<StepClock>().count(), 100);
+
+    timey::BasicTimer<StepClock> t("t");
+    t.Start();
+    t.Stop();
+    EXPECT_EQ(t.Elapsed().count(), 100);
+    EXPECT_EQ(t.NearClockOverhead(), true);
+    EXPECT_NE(t.Report().find(timey::internal::OverheadNote()),
+              std::string::npos);
+
+    t.Reset();
+    t.SubtractClockOverhead();
+    t.Start();
+    t.Stop();
+    EXPECT_EQ(t.Elapsed().count(), 0);
+    t.Start();
+    StepClock::now += 500;
+    t.Stop();
+    EXPECT_EQ(t.Elapsed().count(), 500);
+    // Durations are clamped at zero
+    t.Start();
+    StepClock::now -= 50;
+    t.Stop();
+    EXPECT_EQ(t.Elapsed().count(), 500);
+    EXPECT_EQ(t.Count(), (size_t)3);
+    // Mean of 166 plus the overhead is below 4 times the overhead
+    EXPECT_EQ(t.NearClockOverhead(), true);
+    t.Add(10000);
+    EXPECT_EQ(t.Elapsed().count(), 10500);
+    EXPECT_EQ(t.NearClockOverhead(), false);
+    EXPECT_EQ(t.Report().find(timey::internal::OverheadNote()),
+              std::string::npos);
+
+    t.SubtractClockOverhead(false);
+    t.Start();
+    t.Stop();
+    EXPECT_EQ(t.Elapsed().count(), 10600);
+
+    timey::BasicTimer<ManualClock> never;
+    EXPECT_EQ(never.NearClockOverhead(), false);
+}
+
+// CountingClock is a clock policy counting its reads.
+struct CountingClock {
+    static int64_t reads;
+    static int64_t Now() { return ++reads; }
+    static timey::NanosecondsType ToNanoseconds(int64_t ticks) {
+        return ticks * timey::Nanosecond;
+    }
+    static double NanosecondsPerTick() { return 1; }
+};
+int64_t CountingClock::reads = 0;
+
+TEST(TimeyTimerTest, ClockOverheadMeasuredOnConstruction) {
+    timey::BasicTimer<CountingClock> t("t");
+    EXPECT_GT(CountingClock::reads, 0);
+    t.Start();
+    t.Stop();
+    // Neither the report nor SubtractClockOverhead read the clock
+    int64_t reads = CountingClock::reads;
+    EXPECT_EQ(t.NearClockOverhead(), true);
+    t.Report();
+    t.SubtractClockOverhead();
+    EXPECT_EQ(CountingClock::reads, reads);
+}
+
+TEST(TimeyTimerTest, SampleEvery) {
+    // Every 4th cycle is timed, starting with the first
+    timey::BasicTimer<StepClock> t("t");
+    t.SampleEvery(4);
+    EXPECT_EQ(t.SampleEvery(), (size_t)4);
+    int64_t before = StepClock::now;
+    for (int i = 0; i < 10; i++) {
+        t.Start();
+        t.Stop();
+    }
+    // Only the 3 timed cycles read the clock
+    EXPECT_EQ(StepClock::now - before, 600);
+    EXPECT_EQ(t.Count(), (size_t)10);
+    EXPECT_EQ(t.SampledCount(), (size_t)3);
+    EXPECT_EQ(t.ElapsedMean().count(), 100);
+    EXPECT_EQ(t.ElapsedStdDev().count(), 0);
+    // The total is scaled to every cycle
+    EXPECT_EQ(t.Elapsed().count(), 1000);
+    // The sampled count is reported under its own column
+    size_t column = t.ReportHeader().find("Sampled");
+    EXPECT_NE(column, std::string::npos);
+    EXPECT_EQ(t.Report().substr(column, 3), "3  ");
+    EXPECT_EQ(t.Summary().Elapsed().count(), 1000);
+    EXPECT_DOUBLE_EQ(t.Summary().SecondMoment(), 0);
+
+    // Stopping the sampling during an untimed cycle counts it
+    t.Start();
+    t.SampleEvery(1);
+    t.Stop();
+    t.Start();
+    t.Stop();
+    EXPECT_EQ(t.Count(), (size_t)12);
+    EXPECT_EQ(t.SampledCount(), (size_t)4);
+
+    t.Reset();
+    EXPECT_EQ(t.SampledCount(), (size_t)0);
+    EXPECT_EQ(t.Elapsed().count(), 0);
+    t.Start();
+    t.Stop();
+    EXPECT_EQ(t.ReportHeader(), timey::internal::ReportHeader());
+
+    // Random gaps average to one timed cycle in 'every'
+    timey::BasicTimer<StepClock> r("r");
+    r.SampleEvery(16, timey::SamplingMode::Random);
+    const size_t n = 160000;
+    for (size_t i = 0; i < n; i++) {
+        r.Start();
+        r.Stop();
+    }
+    EXPECT_EQ(r.Count(), n);
+    EXPECT_NEAR((double)r.SampledCount(), n / 16.0, n / 16.0 * 0.05);
+    EXPECT_EQ(r.ElapsedMean().count(), 100);
+    EXPECT_NEAR((double)r.Elapsed().count(), n * 100.0, 1);
+
+    // Merged and added cycles are timed
+    timey::BasicTimer<StepClock> all("all");
+    all.Add(100);
+    all.Merge(r);
+    EXPECT_EQ(all.Count(), n + 1);
+    EXPECT_EQ(all.SampledCount(), r.SampledCount() + 1);
+}
+
+TEST(TimeyTimerTest, Histogram) {
+    timey::BasicTimer<ManualClock> t("t");
+    Record(t, 1000);
+    EXPECT_EQ(t.HasHistogram(), false);
+    EXPECT_EQ(t.Percentile(50).count(), 0);
+
+    t.EnableHistogram(3);
+    EXPECT_EQ(t.HasHistogram(), true);
+    for (int64_t i = 1; i <= 100; i++) {
+        Record(t, i * 1000);
+    }
+    EXPECT_EQ(t.GetHistogram().TotalCount(), (uint64_t)100);
+    // Percentiles are exact to 3 significant digits
+    EXPECT_NEAR(t.Percentile(50).count(), 50000, 50);
+    EXPECT_NEAR(t.Percentile(99).count(), 99000, 99);
+    EXPECT_EQ(t.Percentile(100).count(), 100000);
+
+    timey::BasicTimer<ManualClock> u(t);
+    u.Merge(t);
+    EXPECT_EQ(u.GetHistogram().TotalCount(), (uint64_t)200);
+    EXPECT_NEAR(u.Percentile(50).count(), 50000, 50);
+
+    t.Reset();
+    EXPECT_EQ(t.HasHistogram(), true);
+    EXPECT_EQ(t.GetHistogram().TotalCount(), (uint64_t)0);
+}
+
+TEST(TimeyTimerTest, WriteToStreamWithHistogram) {
+    timey::BasicTimer<ManualClock> t("t");
+    t.EnableHistogram();
+    Record(t, 1000);
+
+    std::stringstream actual;
+    actual << t;
+    std::string rule(80 + timey::internal::PercentileHeader().size(), '-');
+    std::stringstream expected;
+    expected << timey::internal::ReportHeader()
+             << timey::internal::PercentileHeader() << std::endl
+             << rule << std::endl
+             << t.Report() << std::endl
+             << rule << std::endl;
+    EXPECT_EQ(actual.str(), expected.str());
+    EXPECT_NE(t.Report().find(timey::Humanize(t.Percentile(99))),
+              std::string::npos);
+}
@@ -151,3 +151,93 @@ TEST(TimeyTimerSetTest, WriteToStream) {
 
     EXPECT_EQ(actual.str(), expected.str());
 }
+
+TEST(TimeyTimerSetTest, Handle) {
+    timey::TimerSet ts;
+    timey::TimerHandle h1 = ts.Add("timer1");
+    timey::TimerHandle h2 = ts.Add(timey::Timer("timer2"));
+
+    EXPECT_TRUE(h1.Valid());
+    EXPECT_FALSE(timey::TimerHandle().Valid());
+    EXPECT_EQ(ts.Handle("timer1"), h1);
+    EXPECT_EQ(ts.Handle("timer2"), h2);
+    EXPECT_NE(h1, h2);
+    EXPECT_THROW(ts.Handle("unknown"), std::runtime_error);
+
+    ts.Start(h1);
+    EXPECT_EQ(ts.Running(), true);
+    EXPECT_THROW(ts.Start(h1), std::runtime_error);
+    std::this_thread::sleep_for(timey::Millisecond);
+    ts.Restart(h1);
+    ts.Stop("timer1");
+    EXPECT_THROW(ts.Stop(h1), std::runtime_error);
+
+    EXPECT_EQ(&ts.Get(h1), &ts.Get("timer1"));
+    EXPECT_EQ(ts.Get(h1).Count(), 2);
+    EXPECT_GT(ts.Get(h1).Elapsed(), timey::Millisecond);
+
+    ts.Reset(h1);
+    EXPECT_EQ(ts.Get(h1).Count(), 0);
+}
+
+TEST(TimeyTimerSetTest, HandleStability) {
+    timey::TimerSet ts;
+    timey::TimerHandle h1 = ts.Add("timer1");
+    auto& t1 = ts.Get(h1);
+    for (int i = 0; i < 1000; i++) {
+        ts.Add("extra" + std::to_string(i));
+    }
+    EXPECT_EQ(&t1, &ts.Get(h1));
+    EXPECT_EQ(ts.Get(h1).Name(), "timer1");
+
+    // Deleted slots are reused by new timers
+    timey::TimerHandle stale = ts.Handle("extra0");
+    ts.Delete("extra0");
+    EXPECT_THROW(ts.Get(stale), std::runtime_error);
+    timey::TimerHandle h2 = ts.Add("timer2");
+    EXPECT_EQ(ts.Get(h2).Name(), "timer2");
+    EXPECT_EQ(ts.Get(h2).Count(), 0);
+    EXPECT_EQ(ts.Count(), (size_t)1001);
+    EXPECT_EQ(ts.Handle("timer1"), h1);
+
+    // A stale handle does not reach the timer reusing its slot
+    EXPECT_EQ(stale.Index(), h2.Index());
+    EXPECT_NE(stale, h2);
+    EXPECT_THROW(ts.Get(stale), std::runtime_error);
+    EXPECT_THROW(ts.Get(timey::TimerHandle()), std::runtime_error);
+    EXPECT_EQ(ts.Find(stale), nullptr);
+    EXPECT_EQ(ts.Find(timey::TimerHandle()), nullptr);
+    EXPECT_EQ(ts.Find(h2), &ts.Get(h2));
+#ifndef NDEBUG
+    EXPECT_THROW(ts.Start(stale), std::runtime_error);
+    EXPECT_EQ(ts.Get(h2).Running(), false);
+#endif
+}
+
+TEST(TimeyTimerSetTest, Merge) {
+    timey::TimerSet ts1;
+    ts1.Add("timer1");
+    ts1.Add("timer2");
+    timey::TimerSet ts2;
+    ts2.Add("timer2");
+    ts2.Add("timer3");
+
+    ts1.Start("timer2");
+    ts1.Stop("timer2");
+    for (int i = 0; i < 2; i++) {
+        ts2.Start("timer2");
+        ts2.Stop("timer2");
+        ts2.Start("timer3");
+        ts2.Stop("timer3");
+    }
+
+    ts1 += ts2;
+    EXPECT_EQ(ts1.Count(), (size_t)3);
+    EXPECT_EQ(ts1.Get("timer1").Count(), (size_t)0);
+    EXPECT_EQ(ts1.Get("timer2").Count(), (size_t)3);
+    EXPECT_EQ(ts1.Get("timer3").Count(), (size_t)2);
+    EXPECT_EQ(ts2.Get("timer2").Count(), (size_t)2);
+
+    ts1.Merge(ts1);
+    EXPECT_EQ(ts1.Get("timer2").Count(), (size_t)6);
+}
@@ -0,0 +1,140 @@
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include "gtest/gtest.h"
+
+#include "timey.hpp"
+
+// ReadFile returns the content of a file.
+std::string ReadFile(const std::string& path) {
+    std::ifstream in(path);
+    std::stringstream content;
+    content << in.rdbuf();
+    return content.str();
+}
+
+// CountOf returns the number of occurrences of 'pattern' in 's'.
+size_t CountOf(const std::string& s, const std::string& pattern) {
+    size_t n = 0;
+    for (size_t i = s.find(pattern); i != std::string::npos;
+         i = s.find(pattern, i + 1)) {
+        n++;
+    }
+    return n;
+}
+
+TEST(TimeyTraceTest, BeginEnd) {
+    const std::string path = "timey_trace_test.json";
+    timey::ScopeId solve = timey::RegisterScope("solve");
+    timey::ScopeId quoted = timey::RegisterScope("say \"hi\"");
+    {
+        timey::Tracer tracer(path);
+        for (int i = 0; i < 10; i++) {
+            tracer.Begin(solve);
+            tracer.End(solve);
+        }
+        {
+            TIMEY_TRACE_SCOPE(tracer, "scope");
+            tracer.Begin(quoted);
+            tracer.End(quoted);
+        }
+        tracer.Close();
+        EXPECT_EQ(tracer.Written(), (uint64_t)24);
+        EXPECT_EQ(tracer.Dropped(), (uint64_t)0);
+
+        // Events after Close are dropped
+        tracer.Begin(solve);
+        tracer.End(solve);
+        EXPECT_EQ(tracer.Dropped(), (uint64_t)2);
+    }
+
+    std::string trace = ReadFile(path);
+    EXPECT_EQ(trace.find("{\"traceEvents\":["), (size_t)0);
+    EXPECT_EQ(CountOf(trace, "\"name\":\"solve\",\"ph\":\"B\""), (size_t)10);
+    EXPECT_EQ(CountOf(trace, "\"name\":\"solve\",\"ph\":\"E\""), (size_t)10);
+    EXPECT_EQ(CountOf(trace, "\"name\":\"scope\""), (size_t)2);
+    EXPECT_EQ(CountOf(trace, "\"name\":\"say \\\"hi\\\"\""), (size_t)2);
+    EXPECT_NE(trace.find("\"dropped_events\":\"0\"}}"), std::string::npos);
+    std::remove(path.c_str());
+}
+
+TEST(TimeyTraceTest, Threads) {
+    const std::string path = "timey_trace_threads_test.json";
+    timey::ScopeId work = timey::RegisterScope("work");
+    {
+        timey::Tracer tracer(path);
+        std::thread worker([&tracer, work]() {
+            tracer.Begin(work);
+            tracer.End(work);
+        });
+        tracer.Begin(work);
+        tracer.End(work);
+        worker.join();
+    }
+
+    std::string trace = ReadFile(path);
+    EXPECT_EQ(CountOf(trace, "\"tid\":1}"), (size_t)2);
+    EXPECT_EQ(CountOf(trace, "\"tid\":2}"), (size_t)2);
+    std::remove(path.c_str());
+}
+
+TEST(TimeyTraceTest, DropWhenFull) {
+    const std::string path = "timey_trace_drop_test.json";
+    timey::ScopeId work = timey::RegisterScope("work");
+    {
+        // Flush interval long enough that the writer does not drain
+        timey::Tracer tracer(path, 8, 10 * timey::Second);
+        for (int i = 0; i < 10; i++) {
+            tracer.Begin(work);
+            tracer.End(work);
+        }
+        EXPECT_EQ(tracer.Dropped(), (uint64_t)12);
+        tracer.Close();
+        EXPECT_EQ(tracer.Written(), (uint64_t)8);
+    }
+
+    std::string trace = ReadFile(path);
+    EXPECT_NE(trace.find("\"dropped_events\":\"12\"}}"), std::string::npos);
+    std::remove(path.c_str());
+}
+
+TEST(TimeyTraceTest, InvalidPath) {
+    EXPECT_THROW(timey::Tracer("/nonexistent/dir/trace.json"),
+                 std::runtime_error);
+}
+
+TEST(TimeyTraceTest, TracingTimer) {
+    const std::string path = "timey_trace_timer_test.json";
+    {
+        timey::Tracer tracer(path);
+        timey::BasicTimerSet<timey::TracingTimer> ts;
+        timey::TimerHandle h = ts.Add("traced");
+        timey::TimerHandle g = ts.Add("untraced");
+        ts.Get(h).TraceTo(tracer, timey::RegisterScope(ts.Get(h).Name()));
+        EXPECT_TRUE(ts.Get(h).IsTracing());
+        EXPECT_FALSE(ts.Get(g).IsTracing());
+        for (int i = 0; i < 3; i++) {
+            ts.Start(h);
+            ts.Stop(h);
+            ts.Start(g);
+            ts.Stop(g);
+        }
+        ts.Get(h).StopTracing();
+        ts.Start(h);
+        ts.Stop(h);
+        EXPECT_EQ(ts.Get(h).Count(), (size_t)4);
+        tracer.Close();
+        EXPECT_EQ(tracer.Written(), (uint64_t)6);
+    }
+
+    std::string trace = ReadFile(path);
+    EXPECT_EQ(CountOf(trace, "\"name\":\"traced\",\"ph\":\"B\""),
+              (size_t)3);
+    EXPECT_EQ(CountOf(trace, "\"name\":\"traced\",\"ph\":\"E\""),
+              (size_t)3);
+    EXPECT_EQ(CountOf(trace, "untraced"), (size_t)0);
+    std::remove(path.c_str());
+}
@@ -1,3 +1,7 @@
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
 #include "gtest/gtest.h"
 
 #include "timey.hpp"
@@ -19,6 +23,21 @@ TEST(TimeyInternalTest, DoubleToFixedString) {
     }
 }
 
+TEST(TimeyInternalTest, JsonEscape) {
+    std::vector<std::pair<std::string, std::string>> test_data = {
+        std::make_pair("", ""), std::make_pair("solve", "solve"),
+        std::make_pair("say \"hi\"", "say \\\"hi\\\""),
+        std::make_pair("a\\b", "a\\\\b"),
+        std::make_pair("a\nb\tc", "a\\nb\\tc"),
+        std::make_pair("\x01", "\\u0001")
+        // End of test_data
+    };
+
+    for (auto test : test_data) {
+        EXPECT_EQ(timey::internal::JsonEscape(test.first), test.second);
+    }
+}
+
 TEST(TimeyUtilsTest, HumanizeDuration) {
     std::vector<std::pair<timey::NanosecondsType, std::string>> test_data = {
         std::make_pair(0 * timey::Second, "0s"),
@@ -50,3 +69,55 @@ TEST(TimeyUtilsTest, HumanizeDuration) {
         EXPECT_EQ(timey::Humanize(test.first), test.second);
     }
 }
+
+TEST(TimeyUtilsTest, HumanizeRounding) {
+    // Durations below a second keep six significant digits, as with %g
+    std::vector<std::pair<timey::NanosecondsType, std::string>> test_data = {
+        std::make_pair(1500 * timey::Nanosecond, "1.5us"),
+        std::make_pair(1234567 * timey::Nanosecond, "1.23457ms"),
+        std::make_pair(12345678 * timey::Nanosecond, "12.3457ms"),
+        std::make_pair(999999500 * timey::Nanosecond, "1000ms"),
+        std::make_pair(1000000500 * timey::Nanosecond, "1.0000005s"),
+        std::make_pair(-1500 * timey::Nanosecond, "-1500ns"),
+        std::make_pair(-2500 * timey::Millisecond, "-2.5e+09ns")
+        // End of test_data
+    };
+
+    for (auto test : test_data) {
+        EXPECT_EQ(timey::Humanize(test.first), test.second);
+    }
+}
+
+TEST(TimeyUtilsTest, FormatBuffer) {
+    timey::FormatBuffer buffer;
+    EXPECT_EQ(buffer.Size(), 0u);
+
+    buffer.Column("name", 6)
+        .Column(uint64_t(42), 4)
+        .Column(1500 * timey::Nanosecond, 8)
+        .Column("too long", 3)
+        .Append('|');
+    EXPECT_EQ(buffer.Str(), "name  42  1.5us   too long|");
+
+    std::ostringstream expected;
+    expected << std::left << std::setw(6) << "name" << std::setw(4) << 42
+             << std::setw(8) << timey::Humanize(1500 * timey::Nanosecond)
+             << std::setw(3) << "too long" << '|';
+    std::ostringstream out;
+    out << buffer;
+    EXPECT_EQ(out.str(), expected.str());
+
+    timey::FormatBuffer other;
+    other.Repeat('-', 3).Append(buffer);
+    EXPECT_EQ(other.Str(), "---" + buffer.Str());
+    other.Swap(buffer);
+    EXPECT_EQ(buffer.Str(), "---" + other.Str());
+
+    buffer.Clear();
+    EXPECT_EQ(buffer.Size(), 0u);
+    timey::Timer t("timer");
+    t.Start();
+    t.Stop();
+    t.Report(buffer);
+    EXPECT_EQ(buffer.Str(), t.Report());
+}
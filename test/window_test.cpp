@@ -0,0 +1,131 @@
+#include <cstdint>
+#include "gtest/gtest.h"
+
+#include "timey.hpp"
+
+// ManualClock is a clock policy whose time is set by the test.
+struct ManualClock {
+    static int64_t now;
+    static int64_t Now() { return now; }
+    static timey::NanosecondsType ToNanoseconds(int64_t ticks) {
+        return ticks * timey::Nanosecond;
+    }
+    static double NanosecondsPerTick() { return 1; }
+};
+int64_t ManualClock::now = 0;
+
+// CountingClock is a ManualClock counting its reads.
+struct CountingClock {
+    static int64_t now;
+    static int64_t reads;
+    static int64_t Now() {
+        reads++;
+        return now;
+    }
+    static timey::NanosecondsType ToNanoseconds(int64_t ticks) {
+        return ticks * timey::Nanosecond;
+    }
+    static double NanosecondsPerTick() { return 1; }
+};
+int64_t CountingClock::now = 0;
+int64_t CountingClock::reads = 0;
+
+typedef timey::BasicTimer<ManualClock, timey::DefaultMoments,
+                          timey::stats::Pack<timey::stats::Windows>>
+    WindowTimer;
+
+const int64_t ms = 1000000;
+
+TEST(TimeyWindowTest, Empty) {
+    ManualClock::now = 10000 * ms;
+    WindowTimer t;
+    timey::WindowStats w = t.Window(timey::Second);
+    EXPECT_EQ(w.Count(), (uint64_t)0);
+    EXPECT_EQ(w.Mean().count(), 0);
+}
+
+TEST(TimeyWindowTest, Window) {
+    WindowTimer t;
+    ManualClock::now = 10050 * ms;
+    for (int i = 0; i < 5; i++) {
+        t.Add(1000);
+    }
+    ManualClock::now = 10550 * ms;
+    for (int i = 0; i < 5; i++) {
+        t.Add(3000);
+    }
+
+    timey::WindowStats last = t.Window(100 * timey::Millisecond);
+    EXPECT_EQ(last.Count(), (uint64_t)5);
+    EXPECT_EQ(last.Mean().count(), 3000);
+
+    timey::WindowStats second = t.Window(timey::Second);
+    EXPECT_EQ(second.Count(), (uint64_t)10);
+    EXPECT_EQ(second.Elapsed().count(), 20000);
+    EXPECT_EQ(second.Mean().count(), 2000);
+    // Nine full buckets of 100ms and 50ms of the current one
+    EXPECT_EQ(second.Length().count(), 950 * ms);
+    EXPECT_NEAR(second.Rate(), 10 / 0.95, 1e-9);
+
+    // The durations age out of the short windows, not the long ones
+    ManualClock::now = 12000 * ms;
+    EXPECT_EQ(t.Window(timey::Second).Count(), (uint64_t)0);
+    EXPECT_EQ(t.Window(10 * timey::Second).Count(), (uint64_t)10);
+    ManualClock::now = 69000 * ms;
+    EXPECT_EQ(t.Window(timey::Minute).Count(), (uint64_t)10);
+    ManualClock::now = 75000 * ms;
+    EXPECT_EQ(t.Window(timey::Minute).Count(), (uint64_t)0);
+    EXPECT_EQ(t.Window(timey::Hour).Count(), (uint64_t)0);
+
+    // Stopping long after the last stop empties the old buckets
+    t.Add(500);
+    EXPECT_EQ(t.Window(timey::Minute).Count(), (uint64_t)1);
+    EXPECT_EQ(t.Count(), (size_t)11);
+
+    t.Reset();
+    EXPECT_EQ(t.Window(timey::Minute).Count(), (uint64_t)0);
+}
+
+TEST(TimeyWindowTest, Merge) {
+    WindowTimer a;
+    WindowTimer b;
+    ManualClock::now = 20000 * ms;
+    a.Add(1000);
+    ManualClock::now = 20500 * ms;
+    b.Add(3000);
+    a.Merge(b);
+    timey::WindowStats w = a.Window(timey::Second);
+    EXPECT_EQ(w.Count(), (uint64_t)2);
+    EXPECT_EQ(w.Mean().count(), 2000);
+    EXPECT_EQ(a.Window(200 * timey::Millisecond).Count(), (uint64_t)1);
+
+    // Merged durations keep the buckets they stopped in
+    WindowTimer c;
+    ManualClock::now = 21000 * ms;
+    c.Merge(a);
+    EXPECT_EQ(c.Window(200 * timey::Millisecond).Count(), (uint64_t)0);
+    EXPECT_EQ(c.Window(timey::Second).Count(), (uint64_t)1);
+    EXPECT_EQ(c.Window(2 * timey::Second).Count(), (uint64_t)2);
+}
+
+TEST(TimeyWindowTest, StopTick) {
+    timey::BasicTimer<CountingClock, timey::DefaultMoments,
+                      timey::stats::Pack<timey::stats::Windows>>
+        t;
+    CountingClock::now = 30000 * ms;
+    int64_t reads = CountingClock::reads;
+    t.Start();
+    CountingClock::now += 50 * ms;
+    t.Stop();
+    // Stop buckets the duration at the tick it read, without reading again
+    EXPECT_EQ(CountingClock::reads - reads, 2);
+    CountingClock::now += 150 * ms;
+    EXPECT_EQ(t.Window(100 * timey::Millisecond).Count(), (uint64_t)0);
+    timey::WindowStats w = t.Window(300 * timey::Millisecond);
+    EXPECT_EQ(w.Count(), (uint64_t)1);
+    EXPECT_EQ(w.Elapsed().count(), 50 * ms);
+
+    // Add buckets at the time of the call
+    t.Add(1000);
+    EXPECT_EQ(t.Window(100 * timey::Millisecond).Count(), (uint64_t)1);
+}
@@ -0,0 +1,172 @@
+/// @file timey_analyze.cpp
+///
+/// timey-analyze reads a sample log written by SampleLog and reports the
+/// statistics of each timer, with percentiles, over the whole log and
+/// optionally per time window.
+///
+/// Usage: timey-analyze [-w seconds] [-d digits] <sample log>
+///
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "timey.hpp"
+
+namespace {
+/// LogClock is a clock policy converting the ticks of the analysed log into
+/// nanoseconds. It never reads the time; Now is only there to satisfy the
+/// clock policy interface.
+struct LogClock {
+    static double nsPerTick;
+    static int64_t Now() { return 0; }
+    static timey::NanosecondsType ToNanoseconds(int64_t ticks) {
+        return static_cast<int64_t>(ticks * nsPerTick) * timey::Nanosecond;
+    }
+    static double NanosecondsPerTick() { return nsPerTick; }
+};
+double LogClock::nsPerTick = 1;
+
+/// LogTimer accumulates the whole log of a timer, with percentiles.
+typedef timey::BasicTimer<
+    LogClock, timey::DefaultMoments,
+    timey::stats::Pack<timey::stats::MinMax, timey::stats::Percentiles>>
+    LogTimer;
+/// WindowTimer accumulates a window of a timer. Windows have no histogram,
+/// so that memory stays small with many windows.
+typedef timey::BasicTimer<LogClock, timey::DefaultMoments,
+                          timey::stats::Pack<timey::stats::MinMax>>
+    WindowTimer;
+
+/// Usage writes the usage of the tool to 'out'.
+void Usage(std::ostream& out) {
+    out << "Usage: timey-analyze [-w seconds] [-d digits] <sample log>"
+        << std::endl
+        << "  -w seconds  Also report every window of 'seconds'" << std::endl
+        << "  -d digits   Significant digits of the percentiles (1 to 5, "
+           "default 2)"
+        << std::endl;
+}
+
+/// WriteReport writes the report of 'timers' in the format of TimerSet,
+/// leaving out timers that were never stopped.
+template <class TimerType>
+void WriteReport(std::ostream& out, const std::vector<TimerType>& timers) {
+    std::string header = TimerType().ReportHeader();
+    for (auto& t : timers) {
+        std::string h = t.ReportHeader();
+        header = h.size() > header.size() ? h : header;
+    }
+    out << std::left << header << std::endl;
+    out << timey::internal::ReportRule(header) << std::endl;
+    for (auto& t : timers) {
+        if (t.Count() > 0) {
+            out << t.Report() << std::endl;
+        }
+    }
+    out << timey::internal::ReportRule(header) << std::endl;
+}
+}
+
+int main(int argc, char* argv[]) {
+    double window_seconds = 0;
+    int digits = 2;
+    std::string path;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if ((arg == "-w" || arg == "-d") && i + 1 < argc) {
+            double value = std::atof(argv[++i]);
+            if (arg == "-w") {
+                window_seconds = value;
+            } else {
+                digits = (int)value;
+            }
+        } else if (arg == "-h" || arg == "--help") {
+            Usage(std::cout);
+            return 0;
+        } else if (path.empty() && arg[0] != '-') {
+            path = arg;
+        } else {
+            Usage(std::cerr);
+            return 2;
+        }
+    }
+    if (path.empty() || window_seconds < 0) {
+        Usage(std::cerr);
+        return 2;
+    }
+
+    try {
+        timey::SampleLogReader log(path);
+        LogClock::nsPerTick = log.NanosecondsPerTick();
+        const std::vector<std::string>& names = log.Names();
+
+        std::vector<LogTimer> timers;
+        for (auto& name : names) {
+            timers.push_back(LogTimer(name));
+            timers.back().EnableHistogram(digits);
+        }
+        std::vector<WindowTimer> empty_window;
+        for (auto& name : names) {
+            empty_window.push_back(WindowTimer(name));
+        }
+
+        // Windows are counted from the earliest start. Records are written
+        // when timers stop, so nested timers are not in start order, but
+        // mostly are, and the window of the previous record is cached.
+        double window_ticks = window_seconds * 1e9 / log.NanosecondsPerTick();
+        int64_t origin = log.Size() > 0 ? log[0].start : 0;
+        if (window_ticks > 0) {
+            for (const timey::SampleRecord& r : log) {
+                origin = r.start < origin ? r.start : origin;
+            }
+        }
+        std::map<int64_t, std::vector<WindowTimer>> windows;
+        std::vector<WindowTimer>* window = nullptr;
+        int64_t window_index = 0;
+
+        for (const timey::SampleRecord& r : log) {
+            if (r.timer >= timers.size()) {
+                throw std::runtime_error("Record of unknown timer " +
+                                         std::to_string(r.timer));
+            }
+            timers[r.timer].Add(r.elapsed);
+            if (window_ticks <= 0) {
+                continue;
+            }
+            int64_t index = (int64_t)((double)(r.start - origin) / window_ticks);
+            if (window == nullptr || index != window_index) {
+                auto it = windows.find(index);
+                if (it == windows.end()) {
+                    it = windows.insert(std::make_pair(index, empty_window))
+                             .first;
+                }
+                window = &it->second;
+                window_index = index;
+            }
+            (*window)[r.timer].Add(r.elapsed);
+        }
+
+        std::cout << "Sample log: " << path << std::endl
+                  << "Records: " << log.Size() << std::endl
+                  << std::endl;
+        WriteReport(std::cout, timers);
+
+        timey::NanosecondsType window_length =
+            (int64_t)(window_seconds * 1e9) * timey::Nanosecond;
+        for (auto& w : windows) {
+            std::cout << std::endl
+                      << "Window " << timey::Humanize(w.first * window_length)
+                      << " - "
+                      << timey::Humanize((w.first + 1) * window_length)
+                      << std::endl;
+            WriteReport(std::cout, w.second);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "timey-analyze: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
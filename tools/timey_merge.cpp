@@ -0,0 +1,159 @@
+/// @file timey_merge.cpp
+///
+/// timey-merge reads the snapshot files written by WriteSnapshotFile on the
+/// nodes of a cluster and reports the timers merged over all nodes, with the
+/// spread of their total between the nodes. Files are read and merged in
+/// parallel.
+///
+/// Usage: timey-merge [-j threads] [--csv | --json] <file or directory>...
+///
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "timey.hpp"
+
+namespace {
+/// Usage writes the usage of the tool to 'out'.
+void Usage(std::ostream& out) {
+    out << "Usage: timey-merge [-j threads] [--csv | --json] <file or "
+           "directory>..."
+        << std::endl
+        << "  -j threads  Number of threads reading files (default: number "
+           "of cores)"
+        << std::endl
+        << "  --csv       Write CSV instead of a report" << std::endl
+        << "  --json      Write JSON lines instead of a report" << std::endl
+        << "Directories are read for every file they hold." << std::endl;
+}
+
+/// AddPath adds 'path' to 'files', or the regular files in it, in name
+/// order, if it is a directory.
+void AddPath(const std::string& path, std::vector<std::string>& files) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+        throw timey::internal::SystemError("Cannot open '" + path + "'");
+    }
+    if (!S_ISDIR(st.st_mode)) {
+        files.push_back(path);
+        return;
+    }
+    DIR* dir = opendir(path.c_str());
+    if (dir == nullptr) {
+        throw timey::internal::SystemError("Cannot open '" + path + "'");
+    }
+    std::vector<std::string> entries;
+    while (dirent* entry = readdir(dir)) {
+        std::string file = path + "/" + entry->d_name;
+        if (entry->d_name[0] != '.' && stat(file.c_str(), &st) == 0 &&
+            S_ISREG(st.st_mode)) {
+            entries.push_back(file);
+        }
+    }
+    closedir(dir);
+    std::sort(entries.begin(), entries.end());
+    files.insert(files.end(), entries.begin(), entries.end());
+}
+
+/// ReadNodes reads 'files' on up to 'threads' threads, each file into its
+/// own ClusterTimerSet. The first error is rethrown once every thread is
+/// done.
+std::vector<timey::ClusterTimerSet> ReadNodes(
+    const std::vector<std::string>& files, size_t threads) {
+    std::vector<timey::ClusterTimerSet> nodes(files.size());
+    std::vector<std::exception_ptr> errors(files.size());
+    std::atomic<size_t> next(0);
+    auto read = [&]() {
+        for (size_t i = next++; i < files.size(); i = next++) {
+            try {
+                nodes[i].Add(timey::ReadSnapshotFile(files[i]));
+            } catch (...) {
+                errors[i] = std::current_exception();
+            }
+        }
+    };
+
+    threads = std::max(std::min(threads, files.size()), (size_t)1);
+    std::vector<std::thread> workers;
+    for (size_t t = 1; t < threads; t++) {
+        workers.emplace_back(read);
+    }
+    read();
+    for (auto& w : workers) {
+        w.join();
+    }
+    for (auto& e : errors) {
+        if (e) {
+            std::rethrow_exception(e);
+        }
+    }
+    return nodes;
+}
+}
+
+int main(int argc, char* argv[]) {
+    // hardware_concurrency is 0 when the number of cores is unknown
+    size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    std::string format;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-j" && i + 1 < argc) {
+            threads = (size_t)std::atol(argv[++i]);
+            if (threads == 0) {
+                Usage(std::cerr);
+                return 2;
+            }
+        } else if (arg == "--csv" || arg == "--json") {
+            format = arg;
+        } else if (arg == "-h" || arg == "--help") {
+            Usage(std::cout);
+            return 0;
+        } else if (arg[0] != '-') {
+            paths.push_back(arg);
+        } else {
+            Usage(std::cerr);
+            return 2;
+        }
+    }
+    if (paths.empty()) {
+        Usage(std::cerr);
+        return 2;
+    }
+
+    try {
+        std::vector<std::string> files;
+        for (auto& path : paths) {
+            AddPath(path, files);
+        }
+        if (files.empty()) {
+            throw std::runtime_error("No snapshot files");
+        }
+        std::vector<timey::ClusterTimerSet> nodes = ReadNodes(files, threads);
+        timey::ClusterTimerSet cluster =
+            timey::Reduce(nodes.begin(), nodes.end(), threads);
+
+        if (format == "--csv") {
+            timey::WriteCsv(std::cout, cluster);
+        } else if (format == "--json") {
+            timey::WriteJsonLines(std::cout, cluster);
+        } else {
+            std::cout << "Nodes: " << cluster.Nodes() << std::endl
+                      << std::endl
+                      << cluster;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "timey-merge: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
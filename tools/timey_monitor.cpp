@@ -0,0 +1,93 @@
+/// @file timey_monitor.cpp
+///
+/// timey-monitor attaches read only to a SharedTimerSet and reports its
+/// timers, aggregated over all worker processes, at a fixed interval.
+///
+/// Usage: timey-monitor [-i seconds] [-n reports] <shared memory name>
+///
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "timey.hpp"
+
+namespace {
+/// SharedClock is a clock policy converting the ticks of the monitored set
+/// into nanoseconds. It never reads the time; Now is only there to satisfy
+/// the clock policy interface.
+struct SharedClock {
+    static double nsPerTick;
+    static int64_t Now() { return 0; }
+    static timey::NanosecondsType ToNanoseconds(int64_t ticks) {
+        return static_cast<int64_t>(ticks * nsPerTick) * timey::Nanosecond;
+    }
+    static double NanosecondsPerTick() { return nsPerTick; }
+};
+double SharedClock::nsPerTick = 1;
+
+/// Usage writes the usage of the tool to 'out'.
+void Usage(std::ostream& out) {
+    out << "Usage: timey-monitor [-i seconds] [-n reports] <shared memory "
+           "name>"
+        << std::endl
+        << "  -i seconds  Time between two reports (default 1)" << std::endl
+        << "  -n reports  Number of reports, 0 to report until interrupted "
+           "(default 0)"
+        << std::endl;
+}
+}
+
+int main(int argc, char* argv[]) {
+    double interval_seconds = 1;
+    long reports = 0;
+    std::string name;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if ((arg == "-i" || arg == "-n") && i + 1 < argc) {
+            double value = std::atof(argv[++i]);
+            if (arg == "-i") {
+                interval_seconds = value;
+            } else {
+                reports = (long)value;
+            }
+        } else if (arg == "-h" || arg == "--help") {
+            Usage(std::cout);
+            return 0;
+        } else if (name.empty() && arg[0] != '-') {
+            name = arg;
+        } else {
+            Usage(std::cerr);
+            return 2;
+        }
+    }
+    if (name.empty() || interval_seconds <= 0 || reports < 0) {
+        Usage(std::cerr);
+        return 2;
+    }
+
+    try {
+        timey::BasicSharedTimerSet<SharedClock> ts(
+            name, timey::SharedAccess::ReadOnly);
+        SharedClock::nsPerTick = ts.NanosecondsPerTick();
+
+        auto interval = std::chrono::duration_cast<
+            std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(interval_seconds));
+        auto next = std::chrono::steady_clock::now();
+        for (long n = 0; reports == 0 || n < reports; n++) {
+            if (n > 0) {
+                next += interval;
+                std::this_thread::sleep_until(next);
+                std::cout << std::endl;
+            }
+            std::cout << ts << std::flush;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "timey-monitor: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}